@@ -35,6 +35,8 @@
 #include <QtCore/QTimer>
 #include <QtCore/QDebug>
 
+#include <boost/atomic.hpp>
+
 #include "Engine/AppManager.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/Node.h"
@@ -57,6 +59,7 @@ struct AbortableRenderInfoPrivate
     bool canAbort;
     QAtomicInt aborted;
     U64 age;
+    boost::atomic<std::size_t> cacheBytesAllocated;
     mutable QMutex threadsMutex;
     ThreadSet threadsForThisRender;
     mutable QMutex timerMutex;
@@ -71,6 +74,7 @@ struct AbortableRenderInfoPrivate
         , canAbort(canAbort)
         , aborted()
         , age(age)
+        , cacheBytesAllocated(0)
         , threadsMutex()
         , threadsForThisRender()
         , timerMutex()
@@ -111,6 +115,29 @@ AbortableRenderInfo::getRenderAge() const
     return _imp->age;
 }
 
+std::size_t
+AbortableRenderInfo::getCacheBytesAllocated() const
+{
+    return _imp->cacheBytesAllocated.load();
+}
+
+void
+AbortableRenderInfo::addCacheBytesToCurrentRender(std::size_t size)
+{
+    AbortableThread* isAbortableThread = dynamic_cast<AbortableThread*>( QThread::currentThread() );
+
+    if (!isAbortableThread) {
+        return;
+    }
+    bool isRenderResponseToUserInteraction;
+    AbortableRenderInfoPtr abortInfo;
+    EffectInstancePtr treeRoot;
+    if ( !isAbortableThread->getAbortInfo(&isRenderResponseToUserInteraction, &abortInfo, &treeRoot) || !abortInfo ) {
+        return;
+    }
+    abortInfo->_imp->cacheBytesAllocated.fetch_add(size);
+}
+
 bool
 AbortableRenderInfo::canAbort() const
 {
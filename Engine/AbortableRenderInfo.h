@@ -28,6 +28,8 @@
 
 #include "Global/Macros.h"
 
+#include <cstddef>
+
 #include "Global/GlobalDefines.h"
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
@@ -120,6 +122,18 @@ public:
      **/
     U64 getRenderAge() const;
 
+    /**
+     * @brief Returns the number of bytes allocated in the caches by this render so far, see addCacheBytesToCurrentRender()
+     **/
+    std::size_t getCacheBytesAllocated() const;
+
+    /**
+     * @brief Adds size to the bytes allocated in the caches by the render of the calling thread. This is called by the caches
+     * whenever an entry is allocated or grows. Only the renders of the threads deriving AbortableThread, on which
+     * AbortableThread::setAbortInfo was called, are accounted for.
+     **/
+    static void addCacheBytesToCurrentRender(std::size_t size);
+
     /**
      * @brief Registers the thread as part of this render request. Whenever AbortableThread::setAbortInfo is called, the thread is automatically registered
      * in this class as to be part of this render. This is used to monitor running threads for a specific render and to know if a thread has stalled when
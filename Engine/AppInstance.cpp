@@ -71,6 +71,7 @@ CLANG_DIAG_ON(unknown-pragmas)
 #include "Engine/Project.h"
 #include "Engine/ProcessHandler.h"
 #include "Engine/ReadNode.h"
+#include "Engine/RenderTrace.h"
 #include "Engine/Settings.h"
 #include "Engine/WriteNode.h"
 
@@ -203,6 +204,11 @@ public:
 
     void getSequenceNameFromWriter(const OutputEffectInstance* writer, QString* sequenceName);
 
+    /**
+     * @brief Writes the render trace recorded while rendering next to the project, with the same name and a -trace.json extension.
+     **/
+    void writeRenderTrace();
+
     void startRenderingFullSequence(bool blocking, const RenderQueueItem& writerWork);
 };
 
@@ -1810,8 +1816,28 @@ AppInstance::startWritersRendering(bool doBlockingRender,
     }
 
     if (appPTR->isBackground() || doBlockingRender) {
+        // When rendering with render statistics from the command line, also trace the render pipeline of all writers
+        bool traceRender = false;
+        if ( appPTR->isBackground() ) {
+            for (std::list<RenderQueueItem>::const_iterator it = itemsToQueue.begin(); it != itemsToQueue.end(); ++it) {
+                if (it->work.useRenderStats && !it->process) {
+                    traceRender = true;
+                    break;
+                }
+            }
+        }
+        if (traceRender) {
+            RenderTrace::clear();
+            RenderTrace::setEnabled(true);
+        }
+
         //blocking call, we don't want this function to return pre-maturely, in which case it would kill the app
         QtConcurrent::blockingMap( itemsToQueue, boost::bind(&AppInstancePrivate::startRenderingFullSequence, _imp.get(), true, _1) );
+
+        if (traceRender) {
+            RenderTrace::setEnabled(false);
+            _imp->writeRenderTrace();
+        }
     } else {
         bool isQueuingEnabled = appPTR->getCurrentSettings()->isRenderQueuingEnabled();
         if (isQueuingEnabled) {
@@ -1838,6 +1864,28 @@ AppInstance::startWritersRendering(bool doBlockingRender,
     }
 } // AppInstance::startWritersRendering
 
+void
+AppInstancePrivate::writeRenderTrace()
+{
+    ProjectPtr project = _publicInterface->getProject();
+    QString projectPath = project->getProjectPath();
+
+    if ( projectPath.isEmpty() ) {
+        projectPath = QDir::currentPath();
+    }
+    QString traceFileName = project->getProjectFilename();
+    QtCompat::removeFileExtension(traceFileName);
+    if ( traceFileName.isEmpty() ) {
+        traceFileName = QString::fromUtf8(NATRON_APPLICATION_NAME);
+    }
+    QString traceFilePath = QDir(projectPath).absoluteFilePath( traceFileName + QString::fromUtf8("-trace.json") );
+    if ( RenderTrace::writeChromeTraceFile( traceFilePath.toStdString() ) ) {
+        std::cout << tr("Render trace written to %1").arg(traceFilePath).toStdString() << std::endl;
+    } else {
+        std::cout << tr("Failure to write render trace file %1.").arg(traceFilePath).toStdString() << std::endl;
+    }
+}
+
 void
 AppInstancePrivate::getSequenceNameFromWriter(const OutputEffectInstance* writer,
                                               QString* sequenceName)
@@ -87,6 +87,7 @@
 #include <QtCore/QDateTime>
 #include <QtCore/QDebug>
 #include <QtCore/QDir>
+#include <QtCore/QFile>
 #include <QtCore/QTextCodec>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QSettings>
@@ -106,6 +107,7 @@
 
 #include "Engine/AppInstance.h"
 #include "Engine/Backdrop.h"
+#include "Engine/BufferPool.h"
 #include "Engine/CLArgs.h"
 #include "Engine/DiskCacheNode.h"
 #include "Engine/Dot.h"
@@ -126,6 +128,7 @@
 #include "Engine/ProcessHandler.h" // ProcessInputChannel
 #include "Engine/Project.h"
 #include "Engine/PrecompNode.h"
+#include "Engine/PyPlugCache.h"
 #include "Engine/ReadNode.h"
 #include "Engine/RotoPaint.h"
 #include "Engine/RotoSmear.h"
@@ -1074,6 +1077,7 @@ AppManager::loadInternalAfterInitGui(const CLArgs& cl)
 
         _imp->_nodeCache = boost::make_shared<Cache<Image> >("NodeCache", NATRON_CACHE_VERSION, maxCacheRAM, 1.);
         _imp->_diskCache = boost::make_shared<Cache<Image> >("DiskCache", NATRON_CACHE_VERSION, maxDiskCacheNode, 0.);
+        _imp->_diskCache->setDiskCompression( _imp->_settings->getDiskCacheNodeCompression() );
         _imp->_viewerCache = boost::make_shared<Cache<FrameEntry> >("ViewerCache", NATRON_CACHE_VERSION, viewerCacheSize, 0.);
         _imp->setViewerCacheTileSize();
     } catch (std::logic_error&) {
@@ -1096,6 +1100,7 @@ AppManager::loadInternalAfterInitGui(const CLArgs& cl)
     } else {
         setLoadingStatus( tr("Restoring the image cache...") );
         _imp->restoreCaches();
+        _imp->startCacheJournals();
     }
 
     setLoadingStatus( tr("Loading plugin cache...") );
@@ -1384,12 +1389,24 @@ AppManager::clearNodeCache()
         (*it)->clearAllLastRenderedImages();
     }
     _imp->_nodeCache->clear();
+    BufferPool::releaseRetainedBuffers();
+}
+
+///Return the file caching the infos of the PyPlugs between launches
+static QString
+getPyPlugCacheFilePath()
+{
+    return appPTR->getDiskCacheLocation() + QString::fromUtf8("/PyPlugLoadCache/PyPlugCache_") +
+           QString::fromUtf8(NATRON_VERSION_STRING) + QString::fromUtf8("_") +
+           QString::fromUtf8(NATRON_DEVELOPMENT_STATUS) + QString::fromUtf8("_") +
+           QString::number(NATRON_BUILD_NUMBER) + QString::fromUtf8(".bin");
 }
 
 void
 AppManager::clearPluginsLoadedCache()
 {
     _imp->ofxHost->clearPluginsLoadedCache();
+    QFile::remove( getPyPlugCacheFilePath() );
 }
 
 void
@@ -1435,6 +1452,8 @@ AppManager::wipeAndCreateDiskCacheStructure()
     _imp->cleanUpCacheDiskStructure( _imp->_diskCache->getCachePath(), false );
     assert(_imp->_viewerCache);
     _imp->cleanUpCacheDiskStructure( _imp->_viewerCache->getCachePath() , true);
+    // The journal was removed with the cache files
+    _imp->startCacheJournals();
 }
 
 AppInstancePtr
@@ -1497,6 +1516,7 @@ AppManager::setApplicationsCachesMaximumMemoryPercent(double p)
 
     _imp->_nodeCache->setMaximumCacheSize(maxCacheRAM);
     _imp->_nodeCache->setMaximumInMemorySize(1);
+    BufferPool::setMaximumRetainedSize(maxCacheRAM * NATRON_BUFFER_POOL_RETAINED_CACHE_FRACTION);
 }
 
 void
@@ -1511,6 +1531,12 @@ AppManager::setApplicationsCachesMaximumDiskSpace(unsigned long long size)
     _imp->_diskCache->setMaximumCacheSize(size);
 }
 
+void
+AppManager::setApplicationsCachesDiskCompression(CacheCompressionEnum compression)
+{
+    _imp->_diskCache->setDiskCompression(compression);
+}
+
 void
 AppManager::loadAllPlugins()
 {
@@ -2054,8 +2080,17 @@ AppManager::loadPythonGroups()
 
     appPTR->setLoadingStatus( tr("Loading PyPlugs...") );
 
-    Q_FOREACH(const QString &plugin, allPlugins) {
-        QString moduleName = plugin;
+    // Scripts that did not change since the last launch are neither read nor imported: their PyPlug is registered
+    // from the cache and the module is only imported when the PyPlug is first instantiated
+    PyPlugCache cache;
+    QString cacheFilePath = getPyPlugCacheFilePath();
+    cache.read(cacheFilePath);
+
+    std::vector<PyPlugCache::Entry> scripts;
+    cache.scanScripts(allPlugins, &scripts);
+
+    for (std::vector<PyPlugCache::Entry>::iterator it = scripts.begin(); it != scripts.end(); ++it) {
+        QString moduleName = it->scriptPath;
         QString modulePath;
         int lastDot = moduleName.lastIndexOf( QChar::fromLatin1('.') );
 
@@ -2068,65 +2103,32 @@ AppManager::loadPythonGroups()
             moduleName = moduleName.remove(0, lastSlash + 1);
         }
 
+        // Scripts importing NatronGui are not loaded in background mode
+        bool load = it->isPyPlug && ( !appPTR->isBackground() || !it->importsNatronGui );
 
-        {
-            // Open the file and check for a line that imports NatronGui, if so do not attempt to load the script.
-            QFile file(plugin);
-            if (!file.open(QIODevice::ReadOnly)) {
-                continue;
-            }
-            QTextStream ts(&file);
-            bool gotNatronGuiImport = false;
-            bool isPyPlug = false;
-            while (!ts.atEnd()) {
-                QString line = ts.readLine();
-                if (line.startsWith(QString::fromUtf8("import %1").arg(QLatin1String(NATRON_GUI_PYTHON_MODULE_NAME))) ||
-                    line.startsWith(QString::fromUtf8("from %1 import").arg(QLatin1String(NATRON_GUI_PYTHON_MODULE_NAME)))) {
-                    gotNatronGuiImport = true;
-                }
-                // We have to find a way to tell PyPlugs from other python files.
-                // We could check if the file was created by Natron...
-                if (line.startsWith(QString::fromUtf8(NATRON_PYPLUG_GENERATED))) {
-                    isPyPlug = true;
-                }
-                // Or we could check if createInstance(app,group) is defined
-                if ( line.startsWith( QString::fromUtf8("def createInstance(") ) ) {
-                    isPyPlug = true;
-                }
-                // Or we could check if it implements getIsToolSet()
-                if ( line.startsWith( QString::fromUtf8("def getIsToolSet(") ) ) {
-                    isPyPlug = true;
-                }
-                // Or we could check for the magic line that is in the doc.
-                // See https://natron.readthedocs.io/en/master/devel/groups.html#creating-a-group-by-hand
-                // and https://natron.readthedocs.io/en/master/devel/groups.html#toolsets
-                if ( line.startsWith( QString::fromUtf8(NATRON_PYPLUG_MAGIC) ) ) {
-                    isPyPlug = true;
-                }
-            }
-            if (appPTR->isBackground() && gotNatronGuiImport) {
-                continue;
-            }
-            if (!isPyPlug) {
-                continue;
-            }
+        if (load && !it->hasInfos) {
+            std::string pluginDescription;
+            it->hasInfos = NATRON_PYTHON_NAMESPACE::getGroupInfos(modulePath.toStdString(), moduleName.toStdString(), &it->pluginID, &it->pluginLabel, &it->iconFilePath, &it->grouping, &pluginDescription, &it->isToolset, &it->version);
         }
 
-        std::string pluginLabel, pluginID, pluginGrouping, iconFilePath, pluginDescription;
-        unsigned int version;
-        bool isToolset;
-        bool gotInfos = NATRON_PYTHON_NAMESPACE::getGroupInfos(modulePath.toStdString(), moduleName.toStdString(), &pluginID, &pluginLabel, &iconFilePath, &pluginGrouping, &pluginDescription, &isToolset, &version);
-
+        // A script whose infos could not be read is tried again at the next launch
+        if (!it->isPyPlug || it->hasInfos || !load) {
+            cache.insert(*it);
+        }
 
-        if (gotInfos) {
+        if (load && it->hasInfos) {
             qDebug() << "Loading " << moduleName;
-            QStringList grouping = QString::fromUtf8( pluginGrouping.c_str() ).split( QChar::fromLatin1('/') );
-            Plugin* p = registerPlugin(modulePath, grouping, QString::fromUtf8( pluginID.c_str() ), QString::fromUtf8( pluginLabel.c_str() ), QString::fromUtf8( iconFilePath.c_str() ), QStringList(), false, false, 0, false, version, 0, false);
+            QStringList grouping = QString::fromUtf8( it->grouping.c_str() ).split( QChar::fromLatin1('/') );
+            Plugin* p = registerPlugin(modulePath, grouping, QString::fromUtf8( it->pluginID.c_str() ), QString::fromUtf8( it->pluginLabel.c_str() ), QString::fromUtf8( it->iconFilePath.c_str() ), QStringList(), false, false, 0, false, it->version, 0, false);
 
             p->setPythonModule(modulePath + moduleName);
-            p->setToolsetScript(isToolset);
+            p->setToolsetScript(it->isToolset);
         }
     }
+
+    if ( cache.isDirty() ) {
+        cache.write(cacheFilePath);
+    }
 } // AppManager::loadPythonGroups
 
 Plugin*
@@ -2579,7 +2581,11 @@ AppManager::isAggressiveCachingEnabled() const
 U64
 AppManager::getCachesTotalMemorySize() const
 {
-    return  _imp->_nodeCache->getMemoryCacheSize();
+    // Freed image buffers kept for reuse are memory held on behalf of the caches
+    BufferPool::Stats poolStats;
+    BufferPool::getStats(&poolStats);
+
+    return  _imp->_nodeCache->getMemoryCacheSize() + poolStats.retainedBytes;
 }
 
 U64
@@ -2588,6 +2594,14 @@ AppManager::getCachesTotalDiskSize() const
     return  _imp->_diskCache->getDiskCacheSize() + _imp->_viewerCache->getDiskCacheSize();
 }
 
+void
+AppManager::getRenderCachesUsage(std::size_t* size,
+                                 std::size_t* maximumSize) const
+{
+    *size = _imp->_nodeCache->getMemoryCacheSize() + _imp->_viewerCache->getMemoryCacheSize() + _imp->_viewerCache->getDiskCacheSize();
+    *maximumSize = _imp->_nodeCache->getMaximumMemorySize() + _imp->_viewerCache->getMaximumSize();
+}
+
 CacheSignalEmitterPtr
 AppManager::getOrActivateViewerCacheSignalEmitter() const
 {
@@ -2893,6 +2907,12 @@ AppManager::checkCacheFreeMemoryIsGoodEnough()
     size_t systemRAMToKeepFree = getSystemTotalRAM() * appPTR->getCurrentSettings()->getUnreachableRamPercent();
     size_t totalFreeRAM = getAmountFreePhysicalRAM();
 
+    if (totalFreeRAM <= systemRAMToKeepFree) {
+        // Give the freed buffers back to the system before evicting images
+        BufferPool::releaseRetainedBuffers();
+        totalFreeRAM = getAmountFreePhysicalRAM();
+    }
+
     while (totalFreeRAM <= systemRAMToKeepFree) {
 #ifdef NATRON_DEBUG_CACHE
         qDebug() << "Total system free RAM is below the threshold:" << printAsRAM(totalFreeRAM)
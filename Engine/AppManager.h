@@ -222,6 +222,12 @@ public:
 
     U64 getCachesTotalMemorySize() const;
     U64 getCachesTotalDiskSize() const;
+
+    /**
+     * @brief Returns the size of the images and textures held by the node and viewer caches, and the maximum size
+     * they may reach.
+     **/
+    void getRenderCachesUsage(std::size_t* size, std::size_t* maximumSize) const;
     CacheSignalEmitterPtr getOrActivateViewerCacheSignalEmitter() const;
 
     void setApplicationsCachesMaximumMemoryPercent(double p);
@@ -230,6 +236,8 @@ public:
 
     void setApplicationsCachesMaximumDiskSpace(unsigned long long size);
 
+    void setApplicationsCachesDiskCompression(CacheCompressionEnum compression);
+
     void removeFromNodeCache(const ImagePtr & image);
     void removeFromViewerCache(const FrameEntryPtr & texture);
 
@@ -60,6 +60,7 @@ GCC_DIAG_ON(unused-parameter)
 #include "Global/StrUtils.h"
 #include "Global/FStreamsSupport.h"
 
+#include "Engine/CacheJournal.h"
 #include "Engine/CacheSerialization.h"
 #include "Engine/CLArgs.h"
 #include "Engine/ExistenceCheckThread.h"
@@ -316,6 +317,13 @@ template <typename T>
 void
 saveCache(Cache<T>* cache)
 {
+    if ( cache->isTileCache() ) {
+        // The journal is already up to date, just make sure the last changes are written
+        cache->syncJournal();
+
+        return;
+    }
+
     std::string cacheRestoreFilePath = cache->getRestoreFilePath();
     FStreamsSupport::ofstream ofile;
     FStreamsSupport::open(&ofile, cacheRestoreFilePath);
@@ -354,7 +362,18 @@ restoreCache(AppManagerPrivate* p,
              Cache<T>* cache)
 {
     if ( p->checkForCacheDiskStructure( cache->getCachePath(), cache->isTileCache() ) ) {
+        typename Cache<T>::CacheTOC tableOfContents;
         std::string settingsFilePath = cache->getRestoreFilePath();
+        if ( cache->isTileCache() && !QFile::exists( QString::fromUtf8( settingsFilePath.c_str() ) ) ) {
+            // Tiled caches are restored from their journal, which also holds the entries of a session that crashed
+            if ( !cache->readJournal(&tableOfContents) ) {
+                p->cleanUpCacheDiskStructure( cache->getCachePath(), cache->isTileCache() );
+            }
+            cache->restore(tableOfContents);
+
+            return;
+        }
+
         FStreamsSupport::ifstream ifile;
         FStreamsSupport::open(&ifile, settingsFilePath);
         if (!ifile) {
@@ -362,7 +381,6 @@ restoreCache(AppManagerPrivate* p,
 
             return;
         }
-        typename Cache<T>::CacheTOC tableOfContents;
         unsigned int cacheVersion = 0x1; //< default to 1 before NATRON_CACHE_VERSION was introduced
         try {
             boost::archive::binary_iarchive iArchive(ifile);
@@ -396,6 +414,15 @@ AppManagerPrivate::restoreCaches()
     restoreCache<Image>( this, _diskCache.get() );
 } // restoreCaches
 
+void
+AppManagerPrivate::startCacheJournals()
+{
+    // Like saveCaches(), the viewer cache is not persisted by background processes
+    if ( _viewerCache && !appPTR->isBackground() ) {
+        _viewerCache->startJournal();
+    }
+} // startCacheJournals
+
 bool
 AppManagerPrivate::checkForCacheDiskStructure(const QString & cachePath, bool isTiled)
 {
@@ -404,9 +431,10 @@ AppManagerPrivate::checkForCacheDiskStructure(const QString & cachePath, bool is
     if ( !settingsFilePath.endsWith( QChar::fromLatin1('/') ) ) {
         settingsFilePath += QChar::fromLatin1('/');
     }
+    QString journalFilePath = settingsFilePath + QString::fromUtf8(NATRON_CACHE_JOURNAL_FILE_NAME);
     settingsFilePath += QString::fromUtf8("restoreFile." NATRON_CACHE_FILE_EXT);
 
-    if ( !QFile::exists(settingsFilePath) ) {
+    if ( !QFile::exists(settingsFilePath) && ( !isTiled || !CacheJournal::exists( journalFilePath.toStdString() ) ) ) {
         cleanUpCacheDiskStructure(cachePath, isTiled);
 
         return false;
@@ -220,6 +220,8 @@ public:
 
     void restoreCaches();
 
+    void startCacheJournals();
+
     static void addOpenGLRequirementsString(QString& str, OpenGLRequirementsTypeEnum type);
 
     bool checkForCacheDiskStructure(const QString & cachePath, bool isTiled);
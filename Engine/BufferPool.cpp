@@ -0,0 +1,242 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "BufferPool.h"
+
+#include <cstdlib> // malloc, free
+#include <list>
+#include <new> // std::bad_alloc
+#include <vector>
+
+#include <QtCore/QMutex>
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+const int kClassesPerPower = 1 << NATRON_BUFFER_POOL_CLASSES_PER_POWER_LOG2;
+const int kNumClasses = (NATRON_BUFFER_POOL_MAX_SIZE_LOG2 - NATRON_BUFFER_POOL_MIN_SIZE_LOG2) * kClassesPerPower;
+
+/**
+ * @brief Returns the index of the size class of nBytes and its size in capacity, or -1 and nBytes if the pool
+ * does not handle buffers of that size.
+ **/
+int
+getSizeClass(std::size_t nBytes,
+             std::size_t* capacity)
+{
+    if ( ( nBytes <= ( (std::size_t)1 << NATRON_BUFFER_POOL_MIN_SIZE_LOG2 ) ) || ( nBytes > ( (std::size_t)1 << NATRON_BUFFER_POOL_MAX_SIZE_LOG2 ) ) ) {
+        *capacity = nBytes;
+
+        return -1;
+    }
+
+    // nBytes is in ]2^k, 2^(k+1)], which is split in kClassesPerPower classes
+    int k = NATRON_BUFFER_POOL_MIN_SIZE_LOG2;
+    while ( ( (std::size_t)1 << (k + 1) ) < nBytes ) {
+        ++k;
+    }
+    std::size_t base = (std::size_t)1 << k;
+    std::size_t step = base >> NATRON_BUFFER_POOL_CLASSES_PER_POWER_LOG2;
+    std::size_t j = (nBytes - base + step - 1) / step;
+    *capacity = base + j * step;
+
+    return (k - NATRON_BUFFER_POOL_MIN_SIZE_LOG2) * kClassesPerPower + (int)j - 1;
+}
+
+/**
+ * @brief Returns the size of the buffers of the size class of the given index
+ **/
+std::size_t
+getClassCapacity(int sizeClass)
+{
+    std::size_t base = (std::size_t)1 << (NATRON_BUFFER_POOL_MIN_SIZE_LOG2 + sizeClass / kClassesPerPower);
+
+    return base + (std::size_t)(sizeClass % kClassesPerPower + 1) * (base >> NATRON_BUFFER_POOL_CLASSES_PER_POWER_LOG2);
+}
+
+struct BufferPoolData
+{
+    // Protects all fields
+    QMutex lock;
+
+    // The freed buffers of each size class, the most recently freed last
+    std::vector<std::vector<void*> > freeBuffers;
+    std::size_t retainedBytes;
+    std::size_t maximumRetainedBytes;
+    U64 nReused;
+    U64 nAllocated;
+
+    BufferPoolData()
+        : lock()
+        , freeBuffers(kNumClasses)
+        , retainedBytes(0)
+        , maximumRetainedBytes(0)
+        , nReused(0)
+        , nAllocated(0)
+    {
+    }
+
+    /**
+     * @brief Removes retained buffers, the largest first, until at most maxBytes are retained and returns them
+     **/
+    void trim(std::size_t maxBytes,
+              std::list<void*>* toFree)
+    {
+        for (int i = kNumClasses - 1; i >= 0 && retainedBytes > maxBytes; --i) {
+            std::vector<void*>& buffers = freeBuffers[i];
+            if ( buffers.empty() ) {
+                continue;
+            }
+            std::size_t capacity = getClassCapacity(i);
+            while ( !buffers.empty() && retainedBytes > maxBytes ) {
+                toFree->push_back( buffers.back() );
+                buffers.pop_back();
+                retainedBytes -= capacity;
+            }
+        }
+    }
+};
+
+// Never destroyed, so that buffers freed by static objects at exit do not reach a destroyed pool
+BufferPoolData* pool = new BufferPoolData;
+
+void
+freeAll(const std::list<void*>& buffers)
+{
+    for (std::list<void*>::const_iterator it = buffers.begin(); it != buffers.end(); ++it) {
+        free(*it);
+    }
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+std::size_t
+BufferPool::getCapacity(std::size_t nBytes)
+{
+    std::size_t capacity;
+
+    getSizeClass(nBytes, &capacity);
+
+    return capacity;
+}
+
+void*
+BufferPool::allocate(std::size_t nBytes,
+                     std::size_t* capacity)
+{
+    int sizeClass = getSizeClass(nBytes, capacity);
+
+    if ( (sizeClass != -1) && pool ) {
+        QMutexLocker k(&pool->lock);
+        std::vector<void*>& buffers = pool->freeBuffers[sizeClass];
+        if ( !buffers.empty() ) {
+            void* buffer = buffers.back();
+            buffers.pop_back();
+            pool->retainedBytes -= *capacity;
+            ++pool->nReused;
+
+            return buffer;
+        }
+        ++pool->nAllocated;
+    }
+
+    void* buffer = malloc(*capacity);
+    if (!buffer) {
+        // Give the memory retained by the pool back to the system and try again
+        releaseRetainedBuffers();
+        buffer = malloc(*capacity);
+        if (!buffer) {
+            throw std::bad_alloc();
+        }
+    }
+
+    return buffer;
+}
+
+void
+BufferPool::deallocate(void* buffer,
+                       std::size_t capacity)
+{
+    if (!buffer) {
+        return;
+    }
+    std::size_t classCapacity;
+    int sizeClass = getSizeClass(capacity, &classCapacity);
+    if ( (sizeClass != -1) && (classCapacity == capacity) && pool ) {
+        QMutexLocker k(&pool->lock);
+        if (pool->retainedBytes + capacity <= pool->maximumRetainedBytes) {
+            pool->freeBuffers[sizeClass].push_back(buffer);
+            pool->retainedBytes += capacity;
+
+            return;
+        }
+    }
+    free(buffer);
+}
+
+void
+BufferPool::setMaximumRetainedSize(std::size_t nBytes)
+{
+    std::list<void*> toFree;
+    {
+        QMutexLocker k(&pool->lock);
+        pool->maximumRetainedBytes = nBytes;
+        pool->trim(nBytes, &toFree);
+    }
+    freeAll(toFree);
+}
+
+std::size_t
+BufferPool::getMaximumRetainedSize()
+{
+    QMutexLocker k(&pool->lock);
+
+    return pool->maximumRetainedBytes;
+}
+
+void
+BufferPool::releaseRetainedBuffers()
+{
+    std::list<void*> toFree;
+    {
+        QMutexLocker k(&pool->lock);
+        pool->trim(0, &toFree);
+    }
+    freeAll(toFree);
+}
+
+void
+BufferPool::getStats(Stats* stats)
+{
+    QMutexLocker k(&pool->lock);
+
+    stats->retainedBytes = pool->retainedBytes;
+    stats->maximumRetainedBytes = pool->maximumRetainedBytes;
+    stats->nReused = pool->nReused;
+    stats->nAllocated = pool->nAllocated;
+}
+
+NATRON_NAMESPACE_EXIT
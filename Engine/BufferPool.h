@@ -0,0 +1,113 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_BUFFERPOOL_H
+#define NATRON_ENGINE_BUFFERPOOL_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+///Log2 of the smallest buffer size handled by the pool: smaller buffers go straight to malloc
+#define NATRON_BUFFER_POOL_MIN_SIZE_LOG2 16
+
+///Log2 of the largest buffer size handled by the pool
+#define NATRON_BUFFER_POOL_MAX_SIZE_LOG2 31
+
+///Log2 of the number of size classes between two powers of two: a buffer is at most 1/8th larger than requested
+#define NATRON_BUFFER_POOL_CLASSES_PER_POWER_LOG2 3
+
+///The pool retains at most this fraction of the in-memory cache size in freed buffers
+#define NATRON_BUFFER_POOL_RETAINED_CACHE_FRACTION 0.1
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Allocates the large buffers of images and plug-in memory, keeping freed buffers for reuse instead of
+ * returning them to the system allocator.
+ * Sizes are rounded up to a size class, so that buffers freed for an image or a tile can be reused for another
+ * image or tile of a close size. Under playback the same sizes are allocated and freed for every frame:
+ * they are then served from the pool without touching the system allocator, which avoids fragmenting the heap.
+ * The freed buffers retained by the pool are bounded by getMaximumRetainedSize(): beyond that they are freed.
+ **/
+class BufferPool
+{
+public:
+
+    struct Stats
+    {
+        // Bytes held by the pool in freed buffers
+        std::size_t retainedBytes;
+        std::size_t maximumRetainedBytes;
+
+        // Number of buffers served from the pool, and allocated with malloc
+        U64 nReused;
+        U64 nAllocated;
+
+        Stats()
+            : retainedBytes(0)
+            , maximumRetainedBytes(0)
+            , nReused(0)
+            , nAllocated(0)
+        {
+        }
+    };
+
+    /**
+     * @brief Returns the size of the buffer allocated for nBytes: the size of its class, or nBytes itself if it is
+     * not handled by the pool.
+     **/
+    static std::size_t getCapacity(std::size_t nBytes);
+
+    /**
+     * @brief Returns a buffer of at least nBytes bytes, whose actual size is returned in capacity.
+     * Throws std::bad_alloc if the allocation failed.
+     **/
+    static void* allocate(std::size_t nBytes, std::size_t* capacity);
+
+    /**
+     * @brief Frees a buffer returned by allocate(), given the capacity it returned.
+     **/
+    static void deallocate(void* buffer, std::size_t capacity);
+
+    static void setMaximumRetainedSize(std::size_t nBytes);
+
+    static std::size_t getMaximumRetainedSize();
+
+    /**
+     * @brief Frees all buffers retained by the pool, e.g when the system is low on memory or the caches are cleared.
+     **/
+    static void releaseRetainedBuffers();
+
+    static void getStats(Stats* stats);
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_BUFFERPOOL_H
@@ -340,6 +340,10 @@ CLArgs::printUsage(const std::string& programName)
         "     breakdown contains information about each nodes, render times etc...\n"
         "     This option is useful for debugging purposes or to control that a render\n"
         "     is working correctly.\n"
+        "     A trace of the render of all Write nodes is also written next to the\n"
+        "     project, with the same name and a -trace.json extension. It can be\n"
+        "     opened in chrome://tracing, Perfetto or speedscope to see the time spent\n"
+        "     by each thread in each node and action.\n"
         "     **Please note** that it does not work when writing video files."
         "Sample uses:\n"
         "  %1 /Users/Me/MyNatronProjects/MyProject.ntp\n"
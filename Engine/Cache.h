@@ -55,13 +55,17 @@ GCC_DIAG_ON(deprecated)
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/atomic.hpp>
 #endif
 
+#include "Engine/AbortableRenderInfo.h"
 #include "Engine/AppManager.h" //for access to settings
 #include "Engine/CacheEntry.h"
+#include "Engine/CacheJournal.h"
 #include "Engine/ImageLocker.h"
 #include "Engine/LRUHashTable.h"
 #include "Engine/MemoryInfo.h" // getSystemTotalRAM
+#include "Engine/RenderTrace.h"
 #include "Engine/Settings.h"
 #include "Engine/StandardPaths.h"
 
@@ -72,6 +76,12 @@ GCC_DIAG_ON(deprecated)
 
 #define NATRON_TILE_CACHE_FILE_SIZE_BYTES 2000000000
 
+///Name of the journal of a tiled cache, in the cache directory
+#define NATRON_CACHE_JOURNAL_FILE_NAME "journal." NATRON_CACHE_FILE_EXT
+
+///Number of independently locked partitions of the cache, entries are dispatched by hash key. Must be a power of 2.
+#define NATRON_CACHE_SHARDS_COUNT 16
+
 ///When defined, number of opened files, memory size and disk size of the cache are printed whenever there's activity.
 //#define NATRON_DEBUG_CACHE
 
@@ -465,6 +475,30 @@ public:
 
 private:
 
+    /**
+     * @brief The cache is split in NATRON_CACHE_SHARDS_COUNT shards, the shard of an entry is
+     * selected from its hash key. Each shard has its own locks and LRU containers so that threads
+     * looking-up entries with different hash keys do not wait for each other.
+     * Eviction is done per shard: an entry is always evicted from the LRU list of its own shard.
+     **/
+    struct CacheShard
+    {
+        mutable QMutex getLock; //prevents get() and getOrCreate() to be called simultaneously on the same shard
+        mutable QMutex lock; //protects memoryCache & diskCache
+
+        /*These 2 are mutable because we need to modify the LRU list even
+             when we call get() and we want this function to be const.*/
+        mutable CacheContainer memoryCache;
+        mutable CacheContainer diskCache;
+
+        CacheShard()
+            : getLock()
+            , lock()
+            , memoryCache()
+            , diskCache()
+        {
+        }
+    };
 
     std::size_t _maximumInMemorySize;     // the maximum size of the in-memory portion of the cache.(in % of the maximum cache size)
     std::size_t _maximumCacheSize;     // maximum size allowed for the cache
@@ -472,17 +506,13 @@ private:
     /*mutable because we need to change modify it in the sealEntryInternal function which
          is called by an external object that have a const ref to the cache.
      */
-    mutable std::size_t _memoryCacheSize;     // current size of the cache in bytes
-    mutable std::size_t _diskCacheSize;
-    mutable QMutex _sizeLock; // protects _memoryCacheSize & _diskCacheSize & _maximumInMemorySize & _maximumCacheSize
-    mutable QMutex _lock; //protects _memoryCache & _diskCache
-    mutable QMutex _getLock;  //prevents get() and getOrCreate() to be called simultaneously
-
+    mutable boost::atomic<std::size_t> _memoryCacheSize;     // current size of the cache in bytes
+    mutable boost::atomic<std::size_t> _diskCacheSize;
+    mutable QMutex _sizeLock; // protects _maximumInMemorySize & _maximumCacheSize, used to wait on _memoryFullCondition
+    mutable CacheShard _shards[NATRON_CACHE_SHARDS_COUNT];
 
-    /*These 2 are mutable because we need to modify the LRU list even
-         when we call get() and we want this function to be const.*/
-    mutable CacheContainer _memoryCache;
-    mutable CacheContainer _diskCache;
+    // Index of the next shard to evict from when the cache is full, so that all shards are evicted evenly
+    mutable boost::atomic<unsigned int> _nextShardToEvict;
     const std::string _cacheName;
     const unsigned int _version;
 
@@ -503,6 +533,9 @@ private:
     bool _isTiled;
     std::size_t _tileByteSize;
 
+    // A CacheCompressionEnum: how the entries that are not tiles are compressed when written back to disk
+    boost::atomic<int> _diskCompression;
+
     // True when clearing the cache, protected by _tileCacheMutex
     bool _clearingCache;
 
@@ -512,6 +545,24 @@ private:
     // When set these are used for fast search of a free tile
     TileCacheFileWPtr _nextAvailableCacheFile;
     int _nextAvailableCacheFileIndex;
+
+    // A freed tile cannot be given to another entry before its removal is written to the journal
+    struct PendingTileRelease
+    {
+        TileCacheFilePtr file;
+        std::size_t dataOffset;
+        U64 journalSequence;
+    };
+
+    // Protected by _tileCacheMutex
+    std::list<PendingTileRelease> _tilesPendingRelease;
+
+    // Records the tiles of a tiled cache so that they can be restored even if the application does not quit cleanly
+    mutable CacheJournal _journal;
+
+    // Set by startJournal(): the serialization code is only available in CacheSerialization.h
+    typedef void (*JournalEntrySerializer)(const EntryType& entry, std::string* data);
+    JournalEntrySerializer _journalEntrySerializer;
 public:
 
 
@@ -526,10 +577,8 @@ public:
         , _memoryCacheSize(0)
         , _diskCacheSize(0)
         , _sizeLock()
-        , _lock()
-        , _getLock()
-        , _memoryCache()
-        , _diskCache()
+        , _shards()
+        , _nextShardToEvict(0)
         , _cacheName(cacheName)
         , _version(version)
         , _signalEmitter()
@@ -541,21 +590,28 @@ public:
         , _tileCacheMutex()
         , _isTiled(false)
         , _tileByteSize(0)
+        , _diskCompression(eCacheCompressionNone)
         , _clearingCache(false)
         , _cacheFiles()
         , _nextAvailableCacheFile()
         , _nextAvailableCacheFileIndex(-1)
+        , _tilesPendingRelease()
+        , _journal()
+        , _journalEntrySerializer(0)
     {
         _signalEmitter = boost::make_shared<CacheSignalEmitter>();
     }
 
     virtual ~Cache()
     {
-        QMutexLocker locker(&_lock);
-
         _tearingDown = true;
-        _memoryCache.clear();
-        _diskCache.clear();
+        // The entries destroyed below are still valid, they must not be removed from the journal
+        _journal.quitThread();
+        for (int i = 0; i < NATRON_CACHE_SHARDS_COUNT; ++i) {
+            QMutexLocker locker(&_shards[i].lock);
+            _shards[i].memoryCache.clear();
+            _shards[i].diskCache.clear();
+        }
     }
 
     virtual bool isTileCache() const OVERRIDE FINAL
@@ -582,6 +638,21 @@ public:
         _tileByteSize = tileByteSize;
     }
 
+    /**
+     * @brief Set how the entries are compressed when written back to disk. This applies to the entries written from
+     * now on, entries already on disk can still be read whatever their compression.
+     * Tiles have a fixed size in the cache files, they are never compressed.
+     **/
+    void setDiskCompression(CacheCompressionEnum compression)
+    {
+        _diskCompression.store( (int)compression );
+    }
+
+    virtual CacheCompressionEnum getDiskCompression() const OVERRIDE FINAL
+    {
+        return (CacheCompressionEnum)_diskCompression.load();
+    }
+
 
     void waitForDeleterThread()
     {
@@ -603,18 +674,118 @@ public:
     bool get(const typename EntryType::key_type & key,
              std::list<EntryTypePtr>* returnValue) const
     {
-        ///Be atomic, so it cannot be created by another thread in the meantime
-        QMutexLocker getlocker(&_getLock);
+        RenderTraceScope trace("Cache::get", kRenderTraceCategoryCache);
+        CacheShard& shard = getShard( key.getHash() );
 
-        ///lock the cache before reading it.
-        QMutexLocker locker(&_lock);
+        bool reopenedFromDisk = false;
+        bool found;
+        {
+            ///lock the shard before reading it. Entries are inserted while the shard is locked, so
+            ///we do not need to take the getLock: another thread creating the entry is not visible until it is sealed.
+            QMutexLocker locker(&shard.lock);
+            found = getInternal(shard, key, returnValue, &reopenedFromDisk);
+        }
+        if (reopenedFromDisk) {
+            evictInMemoryEntriesToFitMaximumSize();
+        }
 
-        return getInternal(key, returnValue);
+        return found;
     } // get
 
 private:
 
+    CacheShard& getShard(hash_type hash) const
+    {
+        return _shards[hash & (NATRON_CACHE_SHARDS_COUNT - 1)];
+    }
+
+    static void subtractSize(boost::atomic<std::size_t>& value,
+                             std::size_t size)
+    {
+        ///Avoid overflows, the size may not always fallback to 0
+        std::size_t current = value.load();
+
+        while ( !value.compare_exchange_weak(current, size > current ? 0 : current - size) ) {
+        }
+    }
+
+    /**
+     * @brief Evicts the last recently used entry of the in-memory portion of a shard, shards are visited
+     * in a round-robin fashion. Only the lock of the visited shard is taken.
+     * Returns false if there's nothing left to evict in any shard.
+     **/
+    bool evictInMemoryEntryFromAnyShard(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    {
+        unsigned int first = _nextShardToEvict.fetch_add(1);
+
+        for (int i = 0; i < NATRON_CACHE_SHARDS_COUNT; ++i) {
+            CacheShard& shard = _shards[(first + i) & (NATRON_CACHE_SHARDS_COUNT - 1)];
+            QMutexLocker locker(&shard.lock);
+            if ( tryEvictInMemoryEntry(shard, entriesToBeDeleted) ) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Evicts the last recently used entries of the in-memory portion of all shards until it fits in the
+     * maximum in-memory size. No shard lock must be held when calling this.
+     **/
+    void evictInMemoryEntriesToFitMaximumSize() const
+    {
+        std::list<EntryTypePtr> entriesToBeDeleted;
+        // The size of the entries deleted is only subtracted from _memoryCacheSize once the deleter thread destroyed
+        // them, whereas the size of the entries moved back to disk is subtracted right away
+        std::size_t sizeToBeDeleted = 0;
+
+        for (;;) {
+            std::size_t maximumInMemorySize;
+            {
+                QMutexLocker k(&_sizeLock);
+                maximumInMemorySize = _maximumInMemorySize;
+            }
+            if ( _memoryCacheSize.load() <= maximumInMemorySize + sizeToBeDeleted ) {
+                break;
+            }
+            std::list<EntryTypePtr> deleted;
+            if ( !evictInMemoryEntryFromAnyShard(deleted) ) {
+                break;
+            }
+            for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
+                sizeToBeDeleted += (*it)->size();
+                entriesToBeDeleted.push_back(*it);
+            }
+        }
+
+        if ( !entriesToBeDeleted.empty() ) {
+            ///Launch a separate thread whose function will be to delete all the entries to be deleted
+            _deleterThread.appendToQueue(entriesToBeDeleted);
+
+            ///Clearing the list here will not delete the objects pointing to by the shared_ptr's because we made a copy
+            ///that the separate thread will delete
+            entriesToBeDeleted.clear();
+        }
+    }
+
+    /**
+     * @brief Same as evictInMemoryEntryFromAnyShard() for the disk portion.
+     **/
+    bool evictDiskEntryFromAnyShard(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    {
+        unsigned int first = _nextShardToEvict.fetch_add(1);
+
+        for (int i = 0; i < NATRON_CACHE_SHARDS_COUNT; ++i) {
+            CacheShard& shard = _shards[(first + i) & (NATRON_CACHE_SHARDS_COUNT - 1)];
+            QMutexLocker locker(&shard.lock);
+            if ( tryEvictDiskEntry(shard, entriesToBeDeleted) ) {
+                return true;
+            }
+        }
 
+        return false;
+    }
 
     virtual TileCacheFilePtr getTileCacheFile(const std::string& filepath, std::size_t dataOffset) OVERRIDE FINAL WARN_UNUSED_RETURN
     {
@@ -672,6 +843,8 @@ private:
         if (!_isTiled) {
             throw std::logic_error("allocTile() but cache is not tiled!");
         }
+        releaseJournaledTilesInternal();
+
         // First, search for a file with available space.
         // If not found create one
         TileCacheFilePtr foundAvailableFile;
@@ -734,12 +907,76 @@ private:
              **/
     virtual void freeTile(const TileCacheFilePtr& file, std::size_t dataOffset) OVERRIDE FINAL
     {
+        // The tile is still marked as used: the removal is recorded before any other entry may be given the tile,
+        // otherwise the journal could restore the removed entry over the data of the new one.
+        U64 journalSequence = 0;
+        if ( _journal.isActive() ) {
+            journalSequence = _journal.appendRemoval(file->file->path(), dataOffset);
+        }
+
         QMutexLocker k(&_tileCacheMutex);
 
         assert(_isTiled);
         if (!_isTiled) {
             throw std::logic_error("allocTile() but cache is not tiled!");
         }
+        if ( journalSequence > _journal.getWrittenSequence() ) {
+            PendingTileRelease r;
+            r.file = file;
+            r.dataOffset = dataOffset;
+            r.journalSequence = journalSequence;
+            _tilesPendingRelease.push_back(r);
+
+            return;
+        }
+        releaseTileInternal(file, dataOffset);
+    }
+
+    virtual void notifyEntryStoredInTile(const AbstractCacheEntryBase* entry) const OVERRIDE FINAL
+    {
+        if ( !_journal.isActive() ) {
+            return;
+        }
+        assert(_journalEntrySerializer);
+        const EntryType* tileEntry = dynamic_cast<const EntryType*>(entry);
+        assert(tileEntry);
+        if (!tileEntry || !_journalEntrySerializer) {
+            return;
+        }
+        std::string data;
+        _journalEntrySerializer(*tileEntry, &data);
+        _journal.appendAddition(tileEntry->getFilePath(), tileEntry->getOffsetInFile(), data);
+    }
+
+    /**
+     * @brief Makes available the freed tiles whose removal has been written to the journal.
+     * Must be called under _tileCacheMutex.
+     **/
+    void releaseJournaledTilesInternal()
+    {
+        if ( _tilesPendingRelease.empty() ) {
+            return;
+        }
+        U64 writtenSequence = _journal.getWrittenSequence();
+        typename std::list<PendingTileRelease>::iterator it = _tilesPendingRelease.begin();
+        while ( it != _tilesPendingRelease.end() ) {
+            if (it->journalSequence <= writtenSequence) {
+                // Copy so that the tile file is referenced by the cache and this function only, as in freeTile()
+                TileCacheFilePtr file = it->file;
+                std::size_t dataOffset = it->dataOffset;
+                it = _tilesPendingRelease.erase(it);
+                releaseTileInternal(file, dataOffset);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    /**
+     * @brief Makes a tile available to other entries. Must be called under _tileCacheMutex.
+     **/
+    void releaseTileInternal(const TileCacheFilePtr& file, std::size_t dataOffset)
+    {
         std::set<TileCacheFilePtr>::iterator foundTileFile = _cacheFiles.find(file);
         assert(foundTileFile != _cacheFiles.end());
         if (foundTileFile == _cacheFiles.end()) {
@@ -777,7 +1014,7 @@ private:
                         ImageLockerHelper<EntryType>* entryLocker,
                         EntryTypePtr* returnValue) const
     {
-        //_lock must not be taken here
+        //No shard lock must be taken here
 
         ///Before allocating the memory check that there's enough space to fit in memory
         appPTR->checkCacheFreeMemoryIsGoodEnough();
@@ -799,24 +1036,23 @@ private:
         U64 memoryCacheSize, maximumInMemorySize;
         {
             QMutexLocker k(&_sizeLock);
-            memoryCacheSize = _memoryCacheSize;
             maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize );
         }
+        memoryCacheSize = _memoryCacheSize.load();
         {
-            QMutexLocker locker(&_lock);
             std::list<EntryTypePtr> entriesToBeDeleted;
             double occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
             ///While the current cache size can't fit the new entry, erase the last recently used entries.
             ///Also if the total free RAM is under the limit of the system free RAM to keep free, erase LRU entries.
             while (occupationPercentage > NATRON_CACHE_LIMIT_PERCENT) {
                 std::list<EntryTypePtr> deleted;
-                if ( !tryEvictInMemoryEntry(deleted) ) {
+                if ( !evictInMemoryEntryFromAnyShard(deleted) ) {
                     break;
                 }
 
                 for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
                     entriesToBeDeleted.push_back(*it);
-                    memoryCacheSize -= (*it)->size();
+                    memoryCacheSize -= std::min( (U64)(*it)->size(), memoryCacheSize );
                 }
 
                 occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
@@ -834,35 +1070,34 @@ private:
         {
             //If _maximumcacheSize == 0 we don't return 1 otherwise we would cause a deadlock
             QMutexLocker k(&_sizeLock);
-            double occupationPercentage =  _maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize / _maximumCacheSize;
+            double occupationPercentage =  _maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize.load() / _maximumCacheSize;
 
             //_memoryCacheSize member will get updated while images are being destroyed by the parallel thread.
             //we wait for cache memory occupation to be < 100% to be sure we don't hit swap here
             while ( occupationPercentage >= 1. && _deleterThread.isWorking() ) {
                 _memoryFullCondition.wait(&_sizeLock);
-                occupationPercentage =  _maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize / _maximumCacheSize;
+                occupationPercentage =  _maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize.load() / _maximumCacheSize;
             }
         }
         if (_isTiled) {
 
-            QMutexLocker locker(&_lock);
             // For tiled caches, we insert directly into the disk cache, so make sure there is room for it
             std::list<EntryTypePtr> entriesToBeDeleted;
             U64 diskCacheSize, maximumDiskCacheSize;
             {
                 QMutexLocker k(&_sizeLock);
-                diskCacheSize = _diskCacheSize;
                 maximumDiskCacheSize = std::max( (std::size_t)1, _maximumCacheSize - _maximumInMemorySize );
             }
+            diskCacheSize = _diskCacheSize.load();
             double diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
             while (diskPercentage >= NATRON_CACHE_LIMIT_PERCENT) {
                 std::list<EntryTypePtr> deleted;
-                if ( !tryEvictDiskEntry(deleted) ) {
+                if ( !evictDiskEntryFromAnyShard(deleted) ) {
                     break;
                 }
 
                 for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
-                    diskCacheSize -= (*it)->size();
+                    diskCacheSize -= std::min( (U64)(*it)->getSizeOnDisk(), diskCacheSize );
                     entriesToBeDeleted.push_back(*it);
                 }
                 diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
@@ -878,7 +1113,8 @@ private:
 
         }
         {
-            QMutexLocker locker(&_lock);
+            CacheShard& shard = getShard( key.getHash() );
+            QMutexLocker locker(&shard.lock);
 
             try {
                 returnValue->reset( new EntryType(key, params, this ) );
@@ -897,7 +1133,7 @@ private:
                 if (entryLocker) {
                     entryLocker->lock(*returnValue);
                 }
-                sealEntry(*returnValue, _isTiled ? false : true);
+                sealEntry(shard, *returnValue, _isTiled ? false : true);
             }
         }
     } // createInternal
@@ -907,13 +1143,14 @@ public:
     void swapOrInsert(const EntryTypePtr& entryToBeEvicted,
                       const EntryTypePtr& newEntry)
     {
-        QMutexLocker locker(&_lock);
-
         const typename EntryType::key_type& key = entryToBeEvicted->getKey();
         typename EntryType::hash_type hash = entryToBeEvicted->getHashKey();
+        CacheShard& shard = getShard(hash);
+        QMutexLocker locker(&shard.lock);
+
         ///find a matching value in the internal memory container
-        CacheIterator memoryCached = _memoryCache(hash);
-        if ( memoryCached != _memoryCache.end() ) {
+        CacheIterator memoryCached = shard.memoryCache(hash);
+        if ( memoryCached != shard.memoryCache.end() ) {
             std::list<EntryTypePtr> & ret = getValueFromIterator(memoryCached);
             for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                 if ( ( (*it)->getKey() == key ) && ( (*it)->getParams() == entryToBeEvicted->getParams() ) ) {
@@ -925,8 +1162,8 @@ public:
             ret.push_back(newEntry);
         } else {
             ///Look in disk cache
-            CacheIterator diskCached = _diskCache(hash);
-            if ( diskCached != _diskCache.end() ) {
+            CacheIterator diskCached = shard.diskCache(hash);
+            if ( diskCached != shard.diskCache.end() ) {
                 ///Remove the old entry
                 std::list<EntryTypePtr> & ret = getValueFromIterator(diskCached);
                 for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
@@ -937,7 +1174,7 @@ public:
                 }
             }
             ///Insert in mem cache
-            _memoryCache.insert(hash, newEntry);
+            shard.memoryCache.insert(hash, newEntry);
         }
     }
 
@@ -973,17 +1210,25 @@ public:
                      ImageLockerHelper<EntryType>* locker,
                      EntryTypePtr* returnValue) const
     {
+        RenderTraceScope trace("Cache::getOrCreate", kRenderTraceCategoryCache);
+
         ///Make sure the shared_ptrs live in this list and are destroyed not while under the lock
         ///so that the memory freeing (which might be expensive for large images) doesn't happen while under the lock
+        CacheShard& shard = getShard( key.getHash() );
 
         {
-            ///Be atomic, so it cannot be created by another thread in the meantime
-            QMutexLocker getlocker(&_getLock);
+            ///Be atomic, so it cannot be created by another thread in the meantime.
+            ///Only threads looking-up entries in the same shard have to wait.
+            QMutexLocker getlocker(&shard.getLock);
             std::list<EntryTypePtr> entries;
             bool didGetSucceed;
+            bool reopenedFromDisk = false;
             {
-                QMutexLocker locker(&_lock);
-                didGetSucceed = getInternal(key, &entries);
+                QMutexLocker locker(&shard.lock);
+                didGetSucceed = getInternal(shard, key, &entries, &reopenedFromDisk);
+            }
+            if (reopenedFromDisk) {
+                evictInMemoryEntriesToFitMaximumSize();
             }
             if (didGetSucceed) {
                 for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
@@ -1017,13 +1262,16 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-        std::pair<hash_type, EntryTypePtr> evictedFromMemory = _memoryCache.evict();
-        while (evictedFromMemory.second) {
-            if ( !_isTiled && evictedFromMemory.second->isStoredOnDisk() ) {
-                evictedFromMemory.second->removeAnyBackingFile();
+        for (int i = 0; i < NATRON_CACHE_SHARDS_COUNT; ++i) {
+            CacheShard& shard = _shards[i];
+            QMutexLocker locker(&shard.lock);
+            std::pair<hash_type, EntryTypePtr> evictedFromMemory = shard.memoryCache.evict();
+            while (evictedFromMemory.second) {
+                if ( !_isTiled && evictedFromMemory.second->isStoredOnDisk() ) {
+                    evictedFromMemory.second->removeAnyBackingFile();
+                }
+                evictedFromMemory = shard.memoryCache.evict();
             }
-            evictedFromMemory = _memoryCache.evict();
         }
 
         if (_signalEmitter) {
@@ -1047,19 +1295,22 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-
-        /// An entry which has a use_count greater than 1 is not removable:
-        /// The backing file must not be removed because it might be read/written to
-        /// at the same time. The best we can do is just let it here in the cache.
-        std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
-        //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
-        //we'll let the user of these entries purge the extra entries left in the cache later on
-        while (evictedFromDisk.second) {
-            if (!_isTiled) {
-                evictedFromDisk.second->removeAnyBackingFile();
+        for (int i = 0; i < NATRON_CACHE_SHARDS_COUNT; ++i) {
+            CacheShard& shard = _shards[i];
+            QMutexLocker locker(&shard.lock);
+
+            /// An entry which has a use_count greater than 1 is not removable:
+            /// The backing file must not be removed because it might be read/written to
+            /// at the same time. The best we can do is just let it here in the cache.
+            std::pair<hash_type, EntryTypePtr> evictedFromDisk = shard.diskCache.evict();
+            //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
+            //we'll let the user of these entries purge the extra entries left in the cache later on
+            while (evictedFromDisk.second) {
+                if (!_isTiled) {
+                    evictedFromDisk.second->removeAnyBackingFile();
+                }
+                evictedFromDisk = shard.diskCache.evict();
             }
-            evictedFromDisk = _diskCache.evict();
         }
 
 
@@ -1076,51 +1327,54 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-        std::pair<hash_type, EntryTypePtr> evictedFromMemory = _memoryCache.evict();
-        while (evictedFromMemory.second) {
-            // Move back the entry on disk if it can be store on disk
-            // For tiled caches, the tile is sharing the same file with other entries
-            // so we cannot close it, just remove the entry
-            if ( evictedFromMemory.second->isStoredOnDisk() && !_isTiled) {
-                evictedFromMemory.second->deallocate();
-                /*insert it back into the disk portion */
-
-                U64 diskCacheSize, maximumCacheSize;
-                {
-                    QMutexLocker k(&_sizeLock);
-                    diskCacheSize = _diskCacheSize;
-                    maximumCacheSize = _maximumCacheSize;
-                }
-
-                /*before that we need to clear the disk cache if it exceeds the maximum size allowed*/
-                while (diskCacheSize + evictedFromMemory.second->size() >= maximumCacheSize) {
-                    {
-                        std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
-                        //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
-                        //we'll let the user of these entries purge the extra entries left in the cache later on
-                        if (!evictedFromDisk.second) {
-                            break;
-                        }
-                        ///Erase the file from the disk if we reach the limit.
-                        evictedFromDisk.second->removeAnyBackingFile();
-                    }
+        for (int i = 0; i < NATRON_CACHE_SHARDS_COUNT; ++i) {
+            CacheShard& shard = _shards[i];
+            QMutexLocker locker(&shard.lock);
+            std::pair<hash_type, EntryTypePtr> evictedFromMemory = shard.memoryCache.evict();
+            while (evictedFromMemory.second) {
+                // Move back the entry on disk if it can be store on disk
+                // For tiled caches, the tile is sharing the same file with other entries
+                // so we cannot close it, just remove the entry
+                if ( evictedFromMemory.second->isStoredOnDisk() && !_isTiled) {
+                    evictedFromMemory.second->deallocate();
+                    /*insert it back into the disk portion */
+
+                    U64 diskCacheSize, maximumCacheSize;
                     {
                         QMutexLocker k(&_sizeLock);
-                        diskCacheSize = _diskCacheSize;
                         maximumCacheSize = _maximumCacheSize;
                     }
-                }
+                    diskCacheSize = _diskCacheSize.load();
+
+                    /*before that we need to clear the disk cache if it exceeds the maximum size allowed*/
+                    while (diskCacheSize + evictedFromMemory.second->size() >= maximumCacheSize) {
+                        {
+                            std::pair<hash_type, EntryTypePtr> evictedFromDisk = shard.diskCache.evict();
+                            //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
+                            //we'll let the user of these entries purge the extra entries left in the cache later on
+                            if (!evictedFromDisk.second) {
+                                break;
+                            }
+                            ///Erase the file from the disk if we reach the limit.
+                            evictedFromDisk.second->removeAnyBackingFile();
+                        }
+                        {
+                            QMutexLocker k(&_sizeLock);
+                            maximumCacheSize = _maximumCacheSize;
+                        }
+                        diskCacheSize = _diskCacheSize.load();
+                    }
 
-                /*update the disk cache size*/
-                CacheIterator existingDiskCacheEntry = _diskCache( evictedFromMemory.second->getHashKey() );
-                /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
-                if ( existingDiskCacheEntry == _diskCache.end() ) {
-                    _diskCache.insert(evictedFromMemory.second->getHashKey(), evictedFromMemory.second);
+                    /*update the disk cache size*/
+                    CacheIterator existingDiskCacheEntry = shard.diskCache( evictedFromMemory.second->getHashKey() );
+                    /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
+                    if ( existingDiskCacheEntry == shard.diskCache.end() ) {
+                        shard.diskCache.insert(evictedFromMemory.second->getHashKey(), evictedFromMemory.second);
+                    }
                 }
-            }
 
-            evictedFromMemory = _memoryCache.evict();
+                evictedFromMemory = shard.memoryCache.evict();
+            }
         }
 
         _signalEmitter->blockSignals(false);
@@ -1136,23 +1390,22 @@ public:
         std::list<EntryTypePtr> entriesToBeDeleted;
 
         {
-            QMutexLocker locker(&_lock);
             U64 memoryCacheSize, maximumInMemorySize;
             {
                 QMutexLocker k(&_sizeLock);
-                memoryCacheSize = _memoryCacheSize;
                 maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize );
             }
+            memoryCacheSize = _memoryCacheSize.load();
             double occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
             while (occupationPercentage >= NATRON_CACHE_LIMIT_PERCENT) {
                 std::list<EntryTypePtr> deleted;
-                if ( !tryEvictInMemoryEntry(deleted) ) {
+                if ( !evictInMemoryEntryFromAnyShard(deleted) ) {
                     break;
                 }
 
                 for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
                     if ( !(*it)->isStoredOnDisk() ) {
-                        memoryCacheSize -= (*it)->size();
+                        memoryCacheSize -= std::min( (U64)(*it)->size(), memoryCacheSize );
                     }
                     entriesToBeDeleted.push_back(*it);
                 }
@@ -1162,23 +1415,23 @@ public:
             U64 diskCacheSize, maximumDiskCacheSize;
             {
                 QMutexLocker k(&_sizeLock);
-                diskCacheSize = _diskCacheSize;
                 maximumDiskCacheSize = std::max( (std::size_t)1, _maximumCacheSize - _maximumInMemorySize );
             }
+            diskCacheSize = _diskCacheSize.load();
             double diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
             while (diskPercentage >= NATRON_CACHE_LIMIT_PERCENT) {
                 std::list<EntryTypePtr> deleted;
-                if ( !tryEvictDiskEntry(deleted) ) {
+                if ( !evictDiskEntryFromAnyShard(deleted) ) {
                     break;
                 }
 
                 for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
-                    diskCacheSize -= (*it)->size();
+                    diskCacheSize -= std::min( (U64)(*it)->getSizeOnDisk(), diskCacheSize );
                     entriesToBeDeleted.push_back(*it);
                 }
                 diskPercentage = (double)diskCacheSize / maximumDiskCacheSize;
             }
-            
+
 
         }
     }
@@ -1190,15 +1443,18 @@ public:
      **/
     void getCopy(std::list<EntryTypePtr>* copy) const
     {
-        QMutexLocker locker(&_lock);
+        for (int i = 0; i < NATRON_CACHE_SHARDS_COUNT; ++i) {
+            CacheShard& shard = _shards[i];
+            QMutexLocker locker(&shard.lock);
 
-        for (CacheIterator it = _memoryCache.begin(); it != _memoryCache.end(); ++it) {
-            const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
-            copy->insert( copy->end(), entries.begin(), entries.end() );
-        }
-        for (CacheIterator it = _diskCache.begin(); it != _diskCache.end(); ++it) {
-            const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
-            copy->insert( copy->end(), entries.begin(), entries.end() );
+            for (CacheIterator it = shard.memoryCache.begin(); it != shard.memoryCache.end(); ++it) {
+                const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
+                copy->insert( copy->end(), entries.begin(), entries.end() );
+            }
+            for (CacheIterator it = shard.diskCache.begin(); it != shard.diskCache.end(); ++it) {
+                const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
+                copy->insert( copy->end(), entries.begin(), entries.end() );
+            }
         }
     }
 
@@ -1212,13 +1468,8 @@ public:
         ///Make sure the shared_ptrs live in this list and are destroyed not while under the lock
         ///so that the memory freeing (which might be expensive for large images) doesn't happen while under the lock
         std::list<EntryTypePtr> entriesToBeDeleted;
-        bool ret;
-        {
-            QMutexLocker locker(&_lock);
-            ret = tryEvictInMemoryEntry(entriesToBeDeleted);
-        }
 
-        return ret;
+        return evictInMemoryEntryFromAnyShard(entriesToBeDeleted);
     }
 
     /**
@@ -1228,10 +1479,9 @@ public:
      **/
     bool evictLRUDiskEntry() const
     {
-
-        QMutexLocker locker(&_lock);
         std::list<EntryTypePtr> entriesToBeDeleted;
-        return tryEvictDiskEntry(entriesToBeDeleted);
+
+        return evictDiskEntryFromAnyShard(entriesToBeDeleted);
     }
 
     /**
@@ -1241,22 +1491,18 @@ public:
     virtual void notifyEntrySizeChanged(std::size_t oldSize,
                                         std::size_t newSize) const OVERRIDE FINAL
     {
-        ///The entry has notified it's memory layout has changed, it must have been due to an action from the cache
-        QMutexLocker k(&_sizeLock);
-
         ///This function can only be called for RAM buffers or while a memory mapped file is mapped into the RAM, so
         ///we just have to modify the RAM size.
 
         ///Avoid overflows, _memoryCacheSize may not always fallback to 0
-        qint64 diff = (qint64)newSize - (qint64)oldSize;
-
-        if (diff < 0) {
-            _memoryCacheSize = diff > (qint64)_memoryCacheSize ? 0 : _memoryCacheSize + diff;
+        if (newSize < oldSize) {
+            subtractSize(_memoryCacheSize, oldSize - newSize);
         } else {
-            _memoryCacheSize += diff;
+            _memoryCacheSize.fetch_add(newSize - oldSize);
+            AbortableRenderInfo::addCacheBytesToCurrentRender(newSize - oldSize);
         }
 #ifdef NATRON_DEBUG_CACHE
-        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
+        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.load() );
 #endif
     }
 
@@ -1267,27 +1513,24 @@ public:
                                       std::size_t size,
                                       StorageModeEnum storage) const OVERRIDE FINAL
     {
-        ///The entry has notified it's memory layout has changed, it must have been due to an action from the cache, hence the
-        ///lock should already be taken.
-        QMutexLocker k(&_sizeLock);
-
         if (storage == eStorageModeDisk) {
             if (_isTiled) {
                 // For tile caches, we do not control which portion of the cache is in memory, so just keep track of the disk portion
-                _diskCacheSize += size;
+                _diskCacheSize.fetch_add(size);
             } else {
-                _memoryCacheSize += size;
+                _memoryCacheSize.fetch_add(size);
                 appPTR->increaseNCacheFilesOpened();
             }
         } else {
-            _memoryCacheSize += size;
+            _memoryCacheSize.fetch_add(size);
         }
+        AbortableRenderInfo::addCacheBytesToCurrentRender(size);
 
         _signalEmitter->emitAddedEntry(time);
 
 
 #ifdef NATRON_DEBUG_CACHE
-        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
+        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.load() );
 #endif
     }
 
@@ -1298,17 +1541,15 @@ public:
                                       std::size_t size,
                                       StorageModeEnum storage) const OVERRIDE FINAL
     {
-        QMutexLocker k(&_sizeLock);
-
         if (storage == eStorageModeRAM) {
-            _memoryCacheSize = size > _memoryCacheSize ? 0 : _memoryCacheSize - size;
+            subtractSize(_memoryCacheSize, size);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
+            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.load() );
 #endif
         } else if (storage == eStorageModeDisk) {
-            _diskCacheSize = size > _diskCacheSize ? 0 : _diskCacheSize - size;
+            subtractSize(_diskCacheSize, size);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize);
+            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM( _diskCacheSize.load() );
 #endif
         }
 
@@ -1330,40 +1571,40 @@ public:
     virtual void notifyEntryStorageChanged(StorageModeEnum oldStorage,
                                            StorageModeEnum newStorage,
                                            double time,
-                                           std::size_t size) const OVERRIDE FINAL
+                                           std::size_t size,
+                                           std::size_t sizeOnDisk) const OVERRIDE FINAL
     {
         assert(!_isTiled);
 
         if (_tearingDown) {
             return;
         }
-        QMutexLocker k(&_sizeLock);
 
         assert(oldStorage != newStorage);
         assert(newStorage != eStorageModeNone);
         if (oldStorage == eStorageModeRAM) {
-            _memoryCacheSize = size > _memoryCacheSize ? 0 : _memoryCacheSize - size;
-            _diskCacheSize += size;
+            subtractSize(_memoryCacheSize, size);
+            _diskCacheSize.fetch_add(sizeOnDisk);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
-            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize);
+            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.load() );
+            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM( _diskCacheSize.load() );
 #endif
             ///We switched from RAM to DISK that means the MemoryFile object has been destroyed hence the file has been closed.
             appPTR->decreaseNCacheFilesOpened();
         } else if (oldStorage == eStorageModeDisk) {
-            _memoryCacheSize += size;
-            _diskCacheSize = size > _diskCacheSize ? 0 : _diskCacheSize - size;
+            _memoryCacheSize.fetch_add(size);
+            subtractSize(_diskCacheSize, sizeOnDisk);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
-            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize);
+            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.load() );
+            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM( _diskCacheSize.load() );
 #endif
             ///We switched from DISK to RAM that means the MemoryFile object has been created and the file opened
             appPTR->increaseNCacheFilesOpened();
         } else {
             if (newStorage == eStorageModeRAM) {
-                _memoryCacheSize += size;
+                _memoryCacheSize.fetch_add(size);
             } else if (newStorage == eStorageModeDisk) {
-                _diskCacheSize += size;
+                _diskCacheSize.fetch_add(sizeOnDisk);
             }
         }
 
@@ -1412,6 +1653,16 @@ public:
         return newCachePath.toStdString();
     }
 
+    std::string getJournalFilePath() const
+    {
+        QString newCachePath( getCachePath() );
+        StrUtils::ensureLastPathSeparator(newCachePath);
+
+        newCachePath.append( QString::fromUtf8(NATRON_CACHE_JOURNAL_FILE_NAME) );
+
+        return newCachePath.toStdString();
+    }
+
     void setMaximumCacheSize(U64 newSize)
     {
         QMutexLocker k(&_sizeLock);
@@ -1442,16 +1693,12 @@ public:
 
     std::size_t getMemoryCacheSize() const
     {
-        QMutexLocker k(&_sizeLock);
-
-        return _memoryCacheSize;
+        return _memoryCacheSize.load();
     }
 
     std::size_t getDiskCacheSize() const
     {
-        QMutexLocker k(&_sizeLock);
-
-        return _diskCacheSize;
+        return _diskCacheSize.load();
     }
 
     CacheSignalEmitterPtr activateSignalEmitter() const
@@ -1471,9 +1718,10 @@ public:
         std::list<EntryTypePtr> toRemove;
 
         {
-            QMutexLocker l(&_lock);
-            CacheIterator existingEntry = _memoryCache( entry->getHashKey() );
-            if ( existingEntry != _memoryCache.end() ) {
+            CacheShard& shard = getShard( entry->getHashKey() );
+            QMutexLocker l(&shard.lock);
+            CacheIterator existingEntry = shard.memoryCache( entry->getHashKey() );
+            if ( existingEntry != shard.memoryCache.end() ) {
                 std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                 for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                     if ( (*it)->getKey() == entry->getKey() ) {
@@ -1483,11 +1731,11 @@ public:
                     }
                 }
                 if ( ret.empty() ) {
-                    _memoryCache.erase(existingEntry);
+                    shard.memoryCache.erase(existingEntry);
                 }
             } else {
-                existingEntry = _diskCache( entry->getHashKey() );
-                if ( existingEntry != _diskCache.end() ) {
+                existingEntry = shard.diskCache( entry->getHashKey() );
+                if ( existingEntry != shard.diskCache.end() ) {
                     std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                     for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                         if ( (*it)->getKey() == entry->getKey() ) {
@@ -1497,11 +1745,11 @@ public:
                         }
                     }
                     if ( ret.empty() ) {
-                        _diskCache.erase(existingEntry);
+                        shard.diskCache.erase(existingEntry);
                     }
                 }
             }
-        } // QMutexLocker l(&_lock);
+        } // QMutexLocker l(&shard.lock);
         if ( !toRemove.empty() ) {
             _deleterThread.appendToQueue(toRemove);
 
@@ -1515,25 +1763,26 @@ public:
     {
         std::list<EntryTypePtr> toRemove;
         {
-            QMutexLocker l(&_lock);
-            CacheIterator existingEntry = _memoryCache( hash);
-            if ( existingEntry != _memoryCache.end() ) {
+            CacheShard& shard = getShard(hash);
+            QMutexLocker l(&shard.lock);
+            CacheIterator existingEntry = shard.memoryCache( hash);
+            if ( existingEntry != shard.memoryCache.end() ) {
                 std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                 for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                     toRemove.push_back(*it);
                 }
-                _memoryCache.erase(existingEntry);
+                shard.memoryCache.erase(existingEntry);
             } else {
-                existingEntry = _diskCache( hash );
-                if ( existingEntry != _diskCache.end() ) {
+                existingEntry = shard.diskCache( hash );
+                if ( existingEntry != shard.diskCache.end() ) {
                     std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                     for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                         toRemove.push_back(*it);
                     }
-                    _diskCache.erase(existingEntry);
+                    shard.diskCache.erase(existingEntry);
                 }
             }
-        } // QMutexLocker l(&_lock);
+        } // QMutexLocker l(&shard.lock);
 
         if ( !toRemove.empty() ) {
             _deleterThread.appendToQueue(toRemove);
@@ -1552,6 +1801,26 @@ public:
     /*Restores the cache from disk.*/
     void restore(const CacheTOC & tableOfContents);
 
+    /**
+     * @brief Relevant only for tiled caches. Appends to the table of contents the entries recorded in the journal.
+     * Returns false if there is no journal to restore from.
+     **/
+    bool readJournal(CacheTOC* tableOfContents) const;
+
+    /**
+     * @brief Relevant only for tiled caches. Rewrites the journal with the entries currently in the cache and
+     * starts recording the entries allocated and freed from now on.
+     **/
+    void startJournal();
+
+    /**
+     * @brief Blocks until the changes of the cache are written to the journal.
+     **/
+    void syncJournal()
+    {
+        _journal.sync();
+    }
+
 
     void removeAllEntriesWithDifferentNodeHashForHolderPublic(const CacheEntryHolder* holder,
                                                               U64 nodeHash)
@@ -1577,29 +1846,33 @@ public:
         *diskOccupied = 0;
 
         std::string holderID = holder->getCacheID();
-        QMutexLocker locker(&_lock);
 
-        for (CacheIterator memIt = _memoryCache.begin(); memIt != _memoryCache.end(); ++memIt) {
-            std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
-            if ( !entries.empty() ) {
-                const EntryTypePtr & front = entries.front();
+        for (int i = 0; i < NATRON_CACHE_SHARDS_COUNT; ++i) {
+            CacheShard& shard = _shards[i];
+            QMutexLocker locker(&shard.lock);
+
+            for (CacheIterator memIt = shard.memoryCache.begin(); memIt != shard.memoryCache.end(); ++memIt) {
+                std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
+                if ( !entries.empty() ) {
+                    const EntryTypePtr & front = entries.front();
 
-                if (front->getKey().getCacheHolderID() == holderID) {
-                    for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
-                        *ramOccupied += (*it)->size();
+                    if (front->getKey().getCacheHolderID() == holderID) {
+                        for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+                            *ramOccupied += (*it)->size();
+                        }
                     }
                 }
             }
-        }
 
-        for (CacheIterator memIt = _diskCache.begin(); memIt != _diskCache.end(); ++memIt) {
-            std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
-            if ( !entries.empty() ) {
-                const EntryTypePtr & front = entries.front();
+            for (CacheIterator memIt = shard.diskCache.begin(); memIt != shard.diskCache.end(); ++memIt) {
+                std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
+                if ( !entries.empty() ) {
+                    const EntryTypePtr & front = entries.front();
 
-                if (front->getKey().getCacheHolderID() == holderID) {
-                    for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
-                        *diskOccupied += (*it)->size();
+                    if (front->getKey().getCacheHolderID() == holderID) {
+                        for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+                            *diskOccupied += (*it)->size();
+                        }
                     }
                 }
             }
@@ -1613,11 +1886,13 @@ private:
                                                                        bool removeAll) OVERRIDE FINAL
     {
         std::list<EntryTypePtr> toDelete;
-        CacheContainer newMemCache, newDiskCache;
-        {
-            QMutexLocker locker(&_lock);
 
-            for (CacheIterator memIt = _memoryCache.begin(); memIt != _memoryCache.end(); ++memIt) {
+        for (int i = 0; i < NATRON_CACHE_SHARDS_COUNT; ++i) {
+            CacheShard& shard = _shards[i];
+            CacheContainer newMemCache, newDiskCache;
+            QMutexLocker locker(&shard.lock);
+
+            for (CacheIterator memIt = shard.memoryCache.begin(); memIt != shard.memoryCache.end(); ++memIt) {
                 std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
                 if ( !entries.empty() ) {
                     const EntryTypePtr & front = entries.front();
@@ -1634,7 +1909,7 @@ private:
                 }
             }
 
-            for (CacheIterator dIt = _diskCache.begin(); dIt != _diskCache.end(); ++dIt) {
+            for (CacheIterator dIt = shard.diskCache.begin(); dIt != shard.diskCache.end(); ++dIt) {
                 std::list<EntryTypePtr> & entries = getValueFromIterator(dIt);
                 if ( !entries.empty() ) {
                     const EntryTypePtr & front = entries.front();
@@ -1651,9 +1926,9 @@ private:
                 }
             }
 
-            _memoryCache = newMemCache;
-            _diskCache = newDiskCache;
-        } // QMutexLocker locker(&_lock);
+            shard.memoryCache = newMemCache;
+            shard.diskCache = newDiskCache;
+        } // for each shard
 
         if ( !toDelete.empty() ) {
             _deleterThread.appendToQueue(toDelete);
@@ -1664,16 +1939,23 @@ private:
         }
     } // removeAllEntriesWithDifferentNodeHashForHolderPrivate
 
-    bool getInternal(const typename EntryType::key_type & key,
-                     std::list<EntryTypePtr>* returnValue) const
+    /**
+     * @brief Looks-up the entries matching key in the shard, which must be locked. reopenedFromDisk is set to true
+     * if an entry of the disk portion was mapped back into memory: the caller must then make room in the in-memory
+     * portion once the shard is unlocked, see evictInMemoryEntriesToFitMaximumSize().
+     **/
+    bool getInternal(CacheShard& shard,
+                     const typename EntryType::key_type & key,
+                     std::list<EntryTypePtr>* returnValue,
+                     bool* reopenedFromDisk) const
     {
         ///Private should be locked
-        assert( !_lock.tryLock() );
+        assert( !shard.lock.tryLock() );
 
         ///find a matching value in the internal memory container
-        CacheIterator memoryCached = _memoryCache( key.getHash() );
+        CacheIterator memoryCached = shard.memoryCache( key.getHash() );
 
-        if ( memoryCached != _memoryCache.end() ) {
+        if ( memoryCached != shard.memoryCache.end() ) {
             ///we found something with a matching hash key. There may be several entries linked to
             ///this key, we need to find one with matching params
             std::list<EntryTypePtr> & ret = getValueFromIterator(memoryCached);
@@ -1692,9 +1974,9 @@ private:
             return returnValue->size() > 0;
         } else {
             ///fallback on the disk cache internal container
-            CacheIterator diskCached = _diskCache( key.getHash() );
+            CacheIterator diskCached = shard.diskCache( key.getHash() );
 
-            if ( diskCached == _diskCache.end() ) {
+            if ( diskCached == shard.diskCache.end() ) {
                 /*the entry was neither in memory or disk, just allocate a new one*/
                 return false;
             } else {
@@ -1726,31 +2008,12 @@ private:
                             }
 
                             //put it back into the RAM
-                            _memoryCache.insert( (*it)->getHashKey(), *it );
-
+                            shard.memoryCache.insert( (*it)->getHashKey(), *it );
 
-                            U64 memoryCacheSize, maximumInMemorySize;
-                            {
-                                QMutexLocker k(&_sizeLock);
-                                memoryCacheSize = _memoryCacheSize;
-                                maximumInMemorySize = _maximumInMemorySize;
-                            }
-                            std::list<EntryTypePtr> entriesToBeDeleted;
-
-                            //now clear extra entries from the disk cache so it doesn't exceed the RAM limit.
-                            while (memoryCacheSize > maximumInMemorySize) {
-                                if ( !tryEvictInMemoryEntry(entriesToBeDeleted) ) {
-                                    break;
-                                }
-
-                                {
-                                    QMutexLocker k(&_sizeLock);
-                                    memoryCacheSize = _memoryCacheSize;
-                                    maximumInMemorySize = _maximumInMemorySize;
-                                }
-                            }
+                            //The extra entries are evicted from all the shards by the caller, once this shard is unlocked
+                            *reopenedFromDisk = true;
                         }
-                        
+
                         returnValue->push_back(*it);
                         ///Q_EMIT the added signal otherwise when first reading something that's already cached
                         ///the timeline wouldn't update
@@ -1763,7 +2026,7 @@ private:
                             ret.erase(it);
 
                             ///Remove it from the disk cache
-                            _diskCache.erase(diskCached);
+                            shard.diskCache.erase(diskCached);
                         }
 
                         return true;
@@ -1780,25 +2043,26 @@ private:
     /** @brief Inserts into the cache an entry that was previously allocated by the createInternal()
      * function. This is called directly by createInternal() if the allocation was successful
      **/
-    void sealEntry(const EntryTypePtr & entry,
+    void sealEntry(CacheShard& shard,
+                   const EntryTypePtr & entry,
                    bool inMemory) const
     {
-        assert( !_lock.tryLock() );   // must be locked
+        assert( !shard.lock.tryLock() );   // must be locked
         typename EntryType::hash_type hash = entry->getHashKey();
 
         if (inMemory) {
             /*if the entry doesn't exist on the memory cache,make a new list and insert it*/
-            CacheIterator existingEntry = _memoryCache(hash);
-            if ( existingEntry == _memoryCache.end() ) {
-                _memoryCache.insert(hash, entry);
+            CacheIterator existingEntry = shard.memoryCache(hash);
+            if ( existingEntry == shard.memoryCache.end() ) {
+                shard.memoryCache.insert(hash, entry);
             } else {
                 /*append to the existing list*/
                 getValueFromIterator(existingEntry).push_back(entry);
             }
         } else {
-            CacheIterator existingEntry = _diskCache(hash);
-            if ( existingEntry == _diskCache.end() ) {
-                _diskCache.insert(hash, entry);
+            CacheIterator existingEntry = shard.diskCache(hash);
+            if ( existingEntry == shard.diskCache.end() ) {
+                shard.diskCache.insert(hash, entry);
             } else {
                 /*append to the existing list*/
                 getValueFromIterator(existingEntry).push_back(entry);
@@ -1806,10 +2070,11 @@ private:
         }
     }
 
-    bool tryEvictInMemoryEntry(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    bool tryEvictInMemoryEntry(CacheShard& shard,
+                               std::list<EntryTypePtr> & entriesToBeDeleted) const
     {
-        assert( !_lock.tryLock() );
-        std::pair<hash_type, EntryTypePtr> evicted = _memoryCache.evict();
+        assert( !shard.lock.tryLock() );
+        std::pair<hash_type, EntryTypePtr> evicted = shard.memoryCache.evict();
         //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
         //we'll let the user of these entries purge the extra entries left in the cache later on
         if (!evicted.second) {
@@ -1833,14 +2098,14 @@ private:
             U64 diskCacheSize, maximumCacheSize, maximumInMemorySize;
             {
                 QMutexLocker k(&_sizeLock);
-                diskCacheSize = _diskCacheSize;
                 maximumInMemorySize = _maximumInMemorySize;
                 maximumCacheSize = _maximumCacheSize;
             }
+            diskCacheSize = _diskCacheSize.load();
 
             /*before that we need to clear the disk cache if it exceeds the maximum size allowed*/
             while ( ( diskCacheSize  + evicted.second->size() ) >= (maximumCacheSize - maximumInMemorySize) ) {
-                std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
+                std::pair<hash_type, EntryTypePtr> evictedFromDisk = shard.diskCache.evict();
                 //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
                 //we'll let the user of these entries purge the extra entries left in the cache later on
                 if (!evictedFromDisk.second) {
@@ -1859,15 +2124,15 @@ private:
                 }
 
                 //The entry is not yet deleted for real since it's done in a separate thread when this function
-                ///size() will return 0 at this point, we have to recompute it
-                std::size_t fsize = evictedFromDisk.second->getElementsCountFromParams();
-                diskCacheSize -= fsize;
+                ///size() will return 0 at this point, the file may be compressed
+                std::size_t fsize = evictedFromDisk.second->getSizeOnDisk();
+                diskCacheSize -= std::min( (U64)fsize, diskCacheSize );
             }
 
-            CacheIterator existingDiskCacheEntry = _diskCache(evicted.first);
+            CacheIterator existingDiskCacheEntry = shard.diskCache(evicted.first);
             /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
-            if ( existingDiskCacheEntry == _diskCache.end() ) {
-                _diskCache.insert(evicted.first, evicted.second);
+            if ( existingDiskCacheEntry == shard.diskCache.end() ) {
+                shard.diskCache.insert(evicted.first, evicted.second);
             } else {   /*append to the existing list*/
                 getValueFromIterator(existingDiskCacheEntry).push_back(evicted.second);
             }
@@ -1876,11 +2141,12 @@ private:
         return true;
     } // tryEvictEntry
 
-    bool tryEvictDiskEntry(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    bool tryEvictDiskEntry(CacheShard& shard,
+                           std::list<EntryTypePtr> & entriesToBeDeleted) const
     {
 
-        assert( !_lock.tryLock() );
-        std::pair<hash_type, EntryTypePtr> evicted = _diskCache.evict();
+        assert( !shard.lock.tryLock() );
+        std::pair<hash_type, EntryTypePtr> evicted = shard.diskCache.evict();
         //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
         //we'll let the user of these entries purge the extra entries left in the cache later on
         if (!evicted.second) {
@@ -0,0 +1,372 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "CacheCompression.h"
+
+#include <algorithm> // min
+#include <cstring> // memcpy, memcmp
+
+#include <QtCore/QByteArray>
+#include <QtCore/QThreadPool>
+#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+const std::size_t kBlockSize = (std::size_t)1 << NATRON_CACHE_COMPRESSION_BLOCK_SIZE_LOG2;
+
+const char kMagic[4] = {'N', 'C', 'Z', '1'};
+
+// The compressed data is the header, followed by the end offset of each block (U64) relative to the first block,
+// followed by the blocks
+struct CompressedHeader
+{
+    char magic[4];
+    U32 codec;
+    U32 elementSize;
+    U32 nBlocks;
+    U64 decompressedSize;
+};
+
+unsigned short
+floatToHalf(float f)
+{
+    U32 x;
+
+    std::memcpy( &x, &f, sizeof(x) );
+    U32 sign = (x >> 16) & 0x8000;
+    U32 absx = x & 0x7fffffff;
+
+    if (absx >= 0x7f800000) {
+        // Inf or NaN: keep NaNs NaNs
+        return (unsigned short)( sign | 0x7c00 | ( (absx > 0x7f800000) ? ( 0x200 | ( (absx >> 13) & 0x3ff ) ) : 0 ) );
+    }
+    if (absx >= 0x47800000) {
+        // Too large: Inf
+        return (unsigned short)(sign | 0x7c00);
+    }
+    if (absx < 0x38800000) {
+        // Half denormal, in units of 2^-24, rounded to the nearest even
+        if (absx < 0x33000000) {
+            return (unsigned short)sign;
+        }
+        U32 mantissa = (absx & 0x7fffff) | 0x800000;
+        int shift = 126 - (int)(absx >> 23);
+        U32 h = mantissa >> shift;
+        U32 rest = mantissa & ( (1u << shift) - 1 );
+        U32 halfway = 1u << (shift - 1);
+        if ( (rest > halfway) || ( (rest == halfway) && (h & 1) ) ) {
+            ++h;
+        }
+
+        return (unsigned short)(sign | h);
+    }
+
+    // Normal: rebias the exponent and round the mantissa to the nearest even, a carry correctly increments the exponent
+    U32 h = (absx - 0x38000000) >> 13;
+    U32 rest = absx & 0x1fff;
+    if ( (rest > 0x1000) || ( (rest == 0x1000) && (h & 1) ) ) {
+        ++h;
+    }
+
+    return (unsigned short)(sign | h);
+} // floatToHalf
+
+float
+halfToFloat(unsigned short h)
+{
+    U32 sign = (U32)(h & 0x8000) << 16;
+    U32 exponent = (h >> 10) & 0x1f;
+    U32 mantissa = h & 0x3ff;
+    U32 x;
+
+    if (exponent == 0) {
+        // Zero or denormal: exact in float
+        float f = (float)mantissa * (1.f / 16777216.f);
+        std::memcpy( &x, &f, sizeof(x) );
+        x |= sign;
+    } else if (exponent == 31) {
+        x = sign | 0x7f800000 | (mantissa << 13);
+    } else {
+        x = sign | ( (exponent + 112) << 23 ) | (mantissa << 13);
+    }
+    float ret;
+    std::memcpy( &ret, &x, sizeof(ret) );
+
+    return ret;
+}
+
+struct CompressBlockArgs
+{
+    const unsigned char* data;
+    std::size_t nBytes;
+    int elementSize;
+    bool toHalf;
+
+    // The compressed block, or the shuffled block if it did not compress
+    QByteArray stored;
+};
+
+struct DecompressBlockArgs
+{
+    const unsigned char* stored;
+    std::size_t storedBytes;
+    unsigned char* output;
+    std::size_t nBytes;
+    int elementSize;
+    bool fromHalf;
+    bool ok;
+};
+
+void
+compressBlock(CompressBlockArgs& args)
+{
+    // Regroup the bytes of the elements by significance: byte k of element i goes to k * nElements + i
+    std::vector<unsigned char> shuffled(args.toHalf ? args.nBytes / 2 : args.nBytes);
+
+    if (args.toHalf) {
+        std::size_t n = args.nBytes / 4;
+        for (std::size_t i = 0; i < n; ++i) {
+            float f;
+            std::memcpy(&f, args.data + i * 4, 4);
+            unsigned short h = floatToHalf(f);
+            shuffled[i] = (unsigned char)(h & 0xff);
+            shuffled[n + i] = (unsigned char)(h >> 8);
+        }
+    } else if (args.elementSize == 1) {
+        std::memcpy(&shuffled[0], args.data, args.nBytes);
+    } else {
+        std::size_t n = args.nBytes / args.elementSize;
+        for (int k = 0; k < args.elementSize; ++k) {
+            const unsigned char* src = args.data + k;
+            unsigned char* dst = &shuffled[k * n];
+            for (std::size_t i = 0; i < n; ++i, src += args.elementSize) {
+                dst[i] = *src;
+            }
+        }
+    }
+
+    args.stored = qCompress(&shuffled[0], (int)shuffled.size(), NATRON_CACHE_COMPRESSION_LEVEL);
+    if ( (std::size_t)args.stored.size() >= shuffled.size() ) {
+        // A stored block of the size of the shuffled block is not compressed
+        args.stored = QByteArray( (const char*)&shuffled[0], (int)shuffled.size() );
+    }
+}
+
+void
+decompressBlock(DecompressBlockArgs& args)
+{
+    std::size_t shuffledBytes = args.fromHalf ? args.nBytes / 2 : args.nBytes;
+    const unsigned char* shuffled = args.stored;
+    QByteArray decompressed;
+
+    args.ok = false;
+    if (args.storedBytes != shuffledBytes) {
+        decompressed = qUncompress(args.stored, (int)args.storedBytes);
+        if ( (std::size_t)decompressed.size() != shuffledBytes ) {
+            return;
+        }
+        shuffled = (const unsigned char*)decompressed.constData();
+    }
+
+    if (args.fromHalf) {
+        std::size_t n = args.nBytes / 4;
+        for (std::size_t i = 0; i < n; ++i) {
+            float f = halfToFloat( (unsigned short)( shuffled[i] | (shuffled[n + i] << 8) ) );
+            std::memcpy(args.output + i * 4, &f, 4);
+        }
+    } else if (args.elementSize == 1) {
+        std::memcpy(args.output, shuffled, args.nBytes);
+    } else {
+        std::size_t n = args.nBytes / args.elementSize;
+        for (int k = 0; k < args.elementSize; ++k) {
+            const unsigned char* src = shuffled + k * n;
+            unsigned char* dst = args.output + k;
+            for (std::size_t i = 0; i < n; ++i, dst += args.elementSize) {
+                *dst = src[i];
+            }
+        }
+    }
+    args.ok = true;
+}
+
+bool
+canRunBlocksInParallel(std::size_t nBlocks)
+{
+    return nBlocks > 1 && QThreadPool::globalInstance()->activeThreadCount() < QThreadPool::globalInstance()->maxThreadCount();
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+bool
+CacheCompression::compress(const void* data,
+                           std::size_t nBytes,
+                           int elementSize,
+                           CacheCompressionEnum codec,
+                           std::vector<char>* compressed)
+{
+    compressed->clear();
+    if ( (codec == eCacheCompressionNone) || (nBytes == 0) ) {
+        return false;
+    }
+    if ( ( (elementSize != 1) && (elementSize != 2) && (elementSize != 4) ) || (nBytes % elementSize != 0) ) {
+        elementSize = 1;
+    }
+    bool toHalf = codec == eCacheCompressionHalfFloat && elementSize == 4;
+
+    std::size_t nBlocks = (nBytes + kBlockSize - 1) / kBlockSize;
+    std::vector<CompressBlockArgs> blocks(nBlocks);
+    for (std::size_t i = 0; i < nBlocks; ++i) {
+        CompressBlockArgs& args = blocks[i];
+        args.data = (const unsigned char*)data + i * kBlockSize;
+        args.nBytes = std::min(kBlockSize, nBytes - i * kBlockSize);
+        args.elementSize = elementSize;
+        args.toHalf = toHalf;
+    }
+    if ( canRunBlocksInParallel(nBlocks) ) {
+        QtConcurrent::map(blocks, &compressBlock).waitForFinished();
+    } else {
+        for (std::size_t i = 0; i < nBlocks; ++i) {
+            compressBlock(blocks[i]);
+        }
+    }
+
+    std::size_t tableBytes = nBlocks * sizeof(U64);
+    std::size_t totalBytes = sizeof(CompressedHeader) + tableBytes;
+    for (std::size_t i = 0; i < nBlocks; ++i) {
+        totalBytes += blocks[i].stored.size();
+    }
+    if (totalBytes >= nBytes) {
+        return false;
+    }
+
+    compressed->resize(totalBytes);
+    char* dst = &(*compressed)[0];
+    CompressedHeader header;
+    std::memcpy( header.magic, kMagic, sizeof(kMagic) );
+    header.codec = (U32)(toHalf ? eCacheCompressionHalfFloat : eCacheCompressionLossless);
+    header.elementSize = (U32)elementSize;
+    header.nBlocks = (U32)nBlocks;
+    header.decompressedSize = (U64)nBytes;
+    std::memcpy( dst, &header, sizeof(header) );
+
+    char* table = dst + sizeof(header);
+    char* blockData = table + tableBytes;
+    U64 end = 0;
+    for (std::size_t i = 0; i < nBlocks; ++i) {
+        std::memcpy( blockData + end, blocks[i].stored.constData(), blocks[i].stored.size() );
+        end += blocks[i].stored.size();
+        std::memcpy( table + i * sizeof(U64), &end, sizeof(U64) );
+    }
+
+    return true;
+} // CacheCompression::compress
+
+std::size_t
+CacheCompression::getDecompressedSize(const void* data,
+                                      std::size_t nBytes)
+{
+    if ( !data || (nBytes < sizeof(CompressedHeader)) ) {
+        return 0;
+    }
+    CompressedHeader header;
+    std::memcpy( &header, data, sizeof(header) );
+    if ( std::memcmp( header.magic, kMagic, sizeof(kMagic) ) != 0 ) {
+        return 0;
+    }
+    if ( (header.codec != (U32)eCacheCompressionLossless) && (header.codec != (U32)eCacheCompressionHalfFloat) ) {
+        return 0;
+    }
+    if ( (header.elementSize != 1) && (header.elementSize != 2) && (header.elementSize != 4) ) {
+        return 0;
+    }
+    if ( (header.decompressedSize == 0) || (header.nBlocks != (header.decompressedSize + kBlockSize - 1) / kBlockSize) ) {
+        return 0;
+    }
+    std::size_t tableBytes = (std::size_t)header.nBlocks * sizeof(U64);
+    if (nBytes < sizeof(header) + tableBytes) {
+        return 0;
+    }
+    U64 end;
+    std::memcpy( &end, (const char*)data + sizeof(header) + tableBytes - sizeof(U64), sizeof(U64) );
+    if (sizeof(header) + tableBytes + end != nBytes) {
+        return 0;
+    }
+
+    return (std::size_t)header.decompressedSize;
+}
+
+bool
+CacheCompression::decompress(const void* data,
+                             std::size_t nBytes,
+                             void* output)
+{
+    std::size_t decompressedSize = getDecompressedSize(data, nBytes);
+
+    if (decompressedSize == 0) {
+        return false;
+    }
+    CompressedHeader header;
+    std::memcpy( &header, data, sizeof(header) );
+
+    std::size_t nBlocks = header.nBlocks;
+    const char* table = (const char*)data + sizeof(header);
+    const unsigned char* blockData = (const unsigned char*)table + nBlocks * sizeof(U64);
+    std::vector<DecompressBlockArgs> blocks(nBlocks);
+    U64 start = 0;
+    for (std::size_t i = 0; i < nBlocks; ++i) {
+        U64 end;
+        std::memcpy( &end, table + i * sizeof(U64), sizeof(U64) );
+        if (end < start) {
+            return false;
+        }
+        DecompressBlockArgs& args = blocks[i];
+        args.stored = blockData + start;
+        args.storedBytes = (std::size_t)(end - start);
+        args.output = (unsigned char*)output + i * kBlockSize;
+        args.nBytes = std::min(kBlockSize, decompressedSize - i * kBlockSize);
+        args.elementSize = (int)header.elementSize;
+        args.fromHalf = header.codec == (U32)eCacheCompressionHalfFloat;
+        args.ok = false;
+        start = end;
+    }
+    if ( canRunBlocksInParallel(nBlocks) ) {
+        QtConcurrent::map(blocks, &decompressBlock).waitForFinished();
+    } else {
+        for (std::size_t i = 0; i < nBlocks; ++i) {
+            decompressBlock(blocks[i]);
+        }
+    }
+    for (std::size_t i = 0; i < nBlocks; ++i) {
+        if (!blocks[i].ok) {
+            return false;
+        }
+    }
+
+    return true;
+} // CacheCompression::decompress
+
+NATRON_NAMESPACE_EXIT
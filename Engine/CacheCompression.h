@@ -0,0 +1,85 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_CACHECOMPRESSION_H
+#define NATRON_ENGINE_CACHECOMPRESSION_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+#include "Global/Enums.h"
+
+///Log2 of the size in bytes of the blocks of an entry that are compressed independently, and decompressed in parallel
+#define NATRON_CACHE_COMPRESSION_BLOCK_SIZE_LOG2 18
+
+///Compression level passed to zlib: the fastest one, the data being shuffled beforehand is what makes it compress well
+#define NATRON_CACHE_COMPRESSION_LEVEL 1
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Compresses the data of the cache entries written to disk.
+ * The data is split in blocks which are compressed and decompressed in parallel. The bytes of the elements
+ * (e.g. the 4 bytes of a float) of each block are first regrouped by significance, so that the sign and exponent
+ * bytes, which vary little across an image, end up next to each other and compress well with the fastest zlib level.
+ * With eCacheCompressionHalfFloat, 32-bit floats are first converted to 16-bit floats (rounding to the nearest),
+ * which is lossy but halves the size before compression.
+ * The compressed data starts with a header holding everything needed to decompress it, so that entries compressed
+ * with another setting can still be read.
+ **/
+class CacheCompression
+{
+public:
+
+    /**
+     * @brief Compresses nBytes of data made of elements of elementSize bytes (1, 2 or 4) to compressed.
+     * Returns false if the compressed data is not smaller than the data, in which case compressed is left empty
+     * and the data should be stored as is.
+     **/
+    static bool compress(const void* data,
+                         std::size_t nBytes,
+                         int elementSize,
+                         CacheCompressionEnum codec,
+                         std::vector<char>* compressed);
+
+    /**
+     * @brief If the nBytes of data were returned by compress(), returns the size of the decompressed data, otherwise
+     * returns 0.
+     **/
+    static std::size_t getDecompressedSize(const void* data, std::size_t nBytes);
+
+    /**
+     * @brief Decompresses the nBytes of data returned by compress() to output, which must have
+     * getDecompressedSize() bytes. Returns false if the data is corrupted.
+     **/
+    static bool decompress(const void* data, std::size_t nBytes, void* output);
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_CACHECOMPRESSION_H
@@ -52,6 +52,7 @@
 #endif
 
 #include <QtCore/QFile>
+#include <QtCore/QFileInfo>
 #include <QtCore/QMutex>
 #include <QtCore/QReadWriteLock>
 #include <QtCore/QDir>
@@ -61,6 +62,8 @@
 #include <SequenceParsing.h> // for removePath
 #endif
 
+#include "Engine/BufferPool.h"
+#include "Engine/CacheCompression.h"
 #include "Engine/Hash64.h"
 #include "Engine/CacheEntryHolder.h"
 #include "Engine/MemoryFile.h"
@@ -80,12 +83,14 @@ class RamBuffer
 {
     T* data;
     U64 count;
+    std::size_t capacity; // the size in bytes of data, as returned by BufferPool::allocate
 
 public:
 
     RamBuffer()
         : data(0)
         , count(0)
+        , capacity(0)
     {
     }
 
@@ -103,6 +108,7 @@ public:
     {
         std::swap(data, other.data);
         std::swap(count, other.count);
+        std::swap(capacity, other.capacity);
     }
 
     U64 size() const
@@ -116,32 +122,32 @@ public:
             return;
         }
         count = size;
-        if (data) {
-            free(data);
-            data = 0;
-        }
-        if (count == 0) {
+        // The content is not preserved: keep the buffer if the pool would return one of the same size anyway
+        if ( data && ( BufferPool::getCapacity( size * sizeof(T) ) == capacity ) ) {
             return;
         }
-        data = (T*)malloc( size * sizeof(T) );
-        if (!data) {
-            throw std::bad_alloc();
+        if (data) {
+            BufferPool::deallocate(data, capacity);
+            data = 0;
+            capacity = 0;
         }
+        data = (T*)BufferPool::allocate(size * sizeof(T), &capacity);
     }
 
     void clear()
     {
         count = 0;
         if (data) {
-            free(data);
+            BufferPool::deallocate(data, capacity);
             data = 0;
+            capacity = 0;
         }
     }
 
     ~RamBuffer()
     {
         if (data) {
-            free(data);
+            BufferPool::deallocate(data, capacity);
             data = 0;
         }
     }
@@ -159,6 +165,8 @@ public:
 
 typedef TileCacheFilePtr TileCacheFilePtr;
 
+class AbstractCacheEntryBase;
+
 /**
  * @brief Defines the API of the Cache as seen by the cache entries
  **/
@@ -182,6 +190,11 @@ public:
      **/
     virtual std::size_t getTileSizeBytes() const = 0;
 
+    /**
+     * @brief Returns how the entries that are not tiles are compressed when their memory is written back to disk
+     **/
+    virtual CacheCompressionEnum getDiskCompression() const = 0;
+
     /**
      * @brief To be called by a CacheEntry whenever it's size is changed.
      * This way the cache can keep track of the real memory footprint.
@@ -211,9 +224,11 @@ public:
     /**
      * @brief To be called whenever an entry is deallocated from memory and put back on disk or whenever
      * it is reallocated in the RAM.
+     * @param size The size of the entry in memory
+     * @param sizeOnDisk The size of the entry on disk, which is smaller than size if the entry is compressed on disk
      **/
     virtual void notifyEntryStorageChanged(StorageModeEnum oldStorage, StorageModeEnum newStorage,
-                                           double time, size_t size) const = 0;
+                                           double time, size_t size, size_t sizeOnDisk) const = 0;
 
     /**
      * @brief Remove from the cache all entries that matches the holderID and have a different nodeHash than the given one.
@@ -241,6 +256,12 @@ public:
      **/
     virtual void freeTile(const TileCacheFilePtr& file, std::size_t dataOffset) = 0;
 
+    /**
+     * @brief Relevant only for tiled caches. To be called by a CacheEntry once the data of its tile is complete,
+     * so that the cache records it in its journal.
+     **/
+    virtual void notifyEntryStoredInTile(const AbstractCacheEntryBase* entry) const = 0;
+
 #ifdef DEBUG
     static bool checkFileNameMatchesHash(const std::string &originalFileName,
                                          U64 hash)
@@ -394,6 +415,11 @@ public:
         , _cacheFile()
         , _cacheFileDataOffset(0)
         , _storageMode(eStorageModeRAM)
+        , _compression(eCacheCompressionNone)
+        , _compressionElementSize(1)
+        , _sizeOnDisk(0)
+        , _decompressedBuffer()
+        , _decompressedBufferModified(false)
     {
     }
 
@@ -414,8 +440,14 @@ public:
         _buffer->resize(count);
     }
 
+    /**
+     * @brief Maps a file of count elements. When the memory is written back to the file by deallocate(), it is
+     * compressed with the given compression, the data being made of elements of elementSize bytes.
+     **/
     void allocateMMAP(U64 count,
-                      const std::string& path)
+                      const std::string& path,
+                      CacheCompressionEnum compression,
+                      int elementSize)
     {
         assert( _path.empty() );
         if (_backingFile) {
@@ -423,6 +455,8 @@ public:
         }
         _storageMode = eStorageModeDisk;
         _path = path;
+        setCompression(compression, elementSize);
+        _sizeOnDisk = count * sizeof(DataType);
         try {
             _backingFile.reset( new MemoryFile(_path, MemoryFile::eFileOpenModeEnumIfExistsKeepElseCreate) );
         } catch (const std::runtime_error & r) {
@@ -517,16 +551,22 @@ public:
                 if (!_buffer) {
                     _buffer.reset( new RamBuffer<DataType>() );
                 }
-                _buffer->resize( other._backingFile->size() / sizeof(DataType) );
-                const char* src = other._backingFile->data();
+                _buffer->resize( other.size() / sizeof(DataType) );
+                const char* src = (const char*)other.readable();
                 char* dst = (char*)_buffer->getData();
-                std::memcpy( dst, src, other._backingFile->size() );
+                std::memcpy( dst, src, other.size() );
             }
         } else if (_storageMode == eStorageModeDisk) {
             if (other._storageMode == eStorageModeDisk) {
-                assert(_backingFile);
+                assert(_backingFile || _decompressedBuffer);
                 _backingFile.swap(other._backingFile);
+                _decompressedBuffer.swap(other._decompressedBuffer);
+                std::swap(_decompressedBufferModified, other._decompressedBufferModified);
                 _path = other._path;
+            } else if (_decompressedBuffer) {
+                _decompressedBuffer->resize( other._buffer->size() );
+                std::memcpy( _decompressedBuffer->getData(), other._buffer->getData(), other._buffer->size() * sizeof(DataType) );
+                _decompressedBufferModified = true;
             } else {
                 _backingFile->resize( other._buffer->size() * sizeof(DataType) );
                 assert( _backingFile->data() );
@@ -547,11 +587,35 @@ public:
         return _cacheFileDataOffset;
     }
 
+    /**
+     * @brief Set how the mapped file is compressed when the memory is written back to it by deallocate()
+     **/
+    void setCompression(CacheCompressionEnum compression,
+                        int elementSize)
+    {
+        _compression = compression;
+        _compressionElementSize = elementSize;
+    }
+
     void reOpenFileMapping() const
     {
-        assert(!_backingFile && _storageMode == eStorageModeDisk);
+        assert(!_backingFile && !_decompressedBuffer && _storageMode == eStorageModeDisk);
         try{
             _backingFile.reset( new MemoryFile(_path, MemoryFile::eFileOpenModeEnumIfExistsKeepElseCreate) );
+
+            // If the file is compressed, decompress it to RAM and close it: the file stays compressed, and is only
+            // written again by deallocate() if the data was accessed for writing in the meantime
+            std::size_t decompressedSize = CacheCompression::getDecompressedSize( _backingFile->data(), _backingFile->size() );
+            if (decompressedSize != 0) {
+                boost::scoped_ptr<RamBuffer<DataType> > buffer( new RamBuffer<DataType>() );
+                buffer->resize( decompressedSize / sizeof(DataType) );
+                if ( !CacheCompression::decompress( _backingFile->data(), _backingFile->size(), buffer->getData() ) ) {
+                    throw std::runtime_error("Corrupted compressed cache file: " + _path);
+                }
+                _backingFile.reset();
+                _decompressedBuffer.swap(buffer);
+                _decompressedBufferModified = false;
+            }
         } catch (const std::exception & e) {
             _backingFile.reset();
             throw std::bad_alloc();
@@ -567,6 +631,8 @@ public:
                 throw std::runtime_error("Unexisting file " + path);
             }
             _cacheFileDataOffset = dataOffset;
+        } else {
+            _sizeOnDisk = (std::size_t)QFileInfo( QString::fromUtf8( path.c_str() ) ).size();
         }
         _path = path;
         _storageMode = eStorageModeDisk;
@@ -580,11 +646,19 @@ public:
             }
         } else if (_storageMode == eStorageModeDisk) {
             if (_backingFile) {
+                compressBackingFile();
+                _sizeOnDisk = _backingFile->size();
                 bool flushOk = _backingFile->flush(MemoryFile::eFlushTypeAsync, 0, 0);
                 _backingFile.reset();
                 if (!flushOk) {
                     throw std::runtime_error("Failed to flush RAM data to backing file.");
                 }
+            } else if (_decompressedBuffer) {
+                bool writeOk = !_decompressedBufferModified || writeDecompressedBuffer();
+                _decompressedBuffer.reset();
+                if (!writeOk) {
+                    throw std::runtime_error("Failed to write RAM data to backing file.");
+                }
             } else if (_cacheFile) {
                 assert(_entry);
                 _entry->freeTile(_cacheFile, _cacheFileDataOffset);
@@ -601,6 +675,8 @@ public:
     {
         if (_backingFile) {
             _backingFile->flush(MemoryFile::eFlushTypeAsync, 0, 0);
+        } else if (_decompressedBuffer && _decompressedBufferModified) {
+            writeDecompressedBuffer();
         } else if (_cacheFile && _entry) {
             _cacheFile->file->flush(MemoryFile::eFlushTypeAsync, _cacheFile->file->data() + _cacheFileDataOffset, _entry->getCacheTileSizeBytes());
         }
@@ -613,6 +689,12 @@ public:
                 _backingFile->remove();
                 _backingFile.reset();
 
+                return true;
+            } else if (_decompressedBuffer) {
+                _decompressedBuffer.reset();
+                int ret_code = std::remove( _path.c_str() );
+                Q_UNUSED(ret_code);
+
                 return true;
             } else {
                 int ret_code = std::remove( _path.c_str() );
@@ -635,6 +717,8 @@ public:
         } else if (_storageMode == eStorageModeDisk) {
             if (_backingFile) {
                 return _backingFile->size();
+            } else if (_decompressedBuffer) {
+                return _decompressedBuffer->size() * sizeof(DataType);
             } else if (_cacheFile) {
                 assert(_entry);
                 return _entry->getCacheTileSizeBytes();
@@ -648,9 +732,25 @@ public:
         return 0;
     }
 
+    /**
+     * @brief Returns the size in bytes of the buffer on disk, once its memory is written back to disk.
+     **/
+    std::size_t getSizeOnDisk() const
+    {
+        if (_storageMode != eStorageModeDisk) {
+            return 0;
+        } else if (_cacheFile) {
+            assert(_entry);
+
+            return _entry->getCacheTileSizeBytes();
+        } else {
+            return _sizeOnDisk;
+        }
+    }
+
     bool isAllocated() const
     {
-        return (_buffer && _buffer->size() > 0) || ( _backingFile && _backingFile->data() ) || _cacheFile || _glTexture;
+        return (_buffer && _buffer->size() > 0) || ( _backingFile && _backingFile->data() ) || (_decompressedBuffer && _decompressedBuffer->size() > 0) || _cacheFile || _glTexture;
     }
 
     DataType* writable()
@@ -658,6 +758,10 @@ public:
         if (_storageMode == eStorageModeDisk) {
             if (_backingFile) {
                 return (DataType*)_backingFile->data();
+            } else if (_decompressedBuffer) {
+                _decompressedBufferModified = true;
+
+                return _decompressedBuffer->getData();
             } else if (_cacheFile) {
                 return (DataType*)(_cacheFile->file->data() + _cacheFileDataOffset);
             } else {
@@ -676,6 +780,8 @@ public:
         if (_storageMode == eStorageModeDisk) {
             if (_backingFile) {
                 return (const DataType*)_backingFile->data();
+            } else if (_decompressedBuffer) {
+                return _decompressedBuffer->getData();
             } else if (_cacheFile) {
                 return (const DataType*)(_cacheFile->file->data() + _cacheFileDataOffset);
             } else {
@@ -721,6 +827,55 @@ public:
 
 private:
 
+    /**
+     * @brief Replaces the content of the mapped file by its compressed content, if compression is enabled and reduces
+     * its size. The mapping must be closed afterwards.
+     **/
+    void compressBackingFile()
+    {
+        if ( (_compression == eCacheCompressionNone) || !_backingFile->data() ) {
+            return;
+        }
+        try {
+            std::vector<char> compressed;
+            if ( !CacheCompression::compress(_backingFile->data(), _backingFile->size(), _compressionElementSize, _compression, &compressed) ) {
+                return;
+            }
+            _backingFile->resize( compressed.size() );
+            std::memcpy( _backingFile->data(), &compressed[0], compressed.size() );
+        } catch (const std::exception & e) {
+            qDebug() << "Failed to compress cache file" << _path.c_str() << ":" << e.what();
+        }
+    }
+
+    /**
+     * @brief Writes the data decompressed by reOpenFileMapping() back to the file, compressed if compression is enabled,
+     * and returns whether it could be written.
+     **/
+    bool writeDecompressedBuffer() const
+    {
+        const char* data = (const char*)_decompressedBuffer->getData();
+        std::size_t nBytes = _decompressedBuffer->size() * sizeof(DataType);
+        try {
+            std::vector<char> compressed;
+            if ( CacheCompression::compress(data, nBytes, _compressionElementSize, _compression, &compressed) ) {
+                data = &compressed[0];
+                nBytes = compressed.size();
+            }
+            MemoryFile file(_path, MemoryFile::eFileOpenModeEnumIfExistsKeepElseCreate);
+            file.resize(nBytes);
+            std::memcpy(file.data(), data, nBytes);
+            _sizeOnDisk = nBytes;
+            _decompressedBufferModified = false;
+
+            return file.flush(MemoryFile::eFlushTypeAsync, 0, 0);
+        } catch (const std::exception & e) {
+            qDebug() << "Failed to write cache file" << _path.c_str() << ":" << e.what();
+
+            return false;
+        }
+    }
+
     std::string _path;
     boost::scoped_ptr<RamBuffer<DataType> > _buffer;
 
@@ -736,6 +891,16 @@ private:
     // Used when we store images as OpenGL textures
     boost::scoped_ptr<Texture> _glTexture;
     StorageModeEnum _storageMode;
+
+    // How the mapped file is compressed when it is closed, and the size of the file once closed
+    CacheCompressionEnum _compression;
+    int _compressionElementSize;
+    mutable std::size_t _sizeOnDisk;
+
+    // The data of a compressed file reopened by reOpenFileMapping(), which leaves the file as is, and whether it
+    // was accessed for writing since
+    mutable boost::scoped_ptr<RamBuffer<DataType> > _decompressedBuffer;
+    mutable bool _decompressedBufferModified;
 };
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -854,6 +1019,23 @@ public:
         }
     }
 
+    /**
+     * @brief For entries of a tiled cache: to be called once the data of the entry is complete, so that the cache
+     * records the entry in its journal. This is not done by allocateMemory(), since a crash while the tile is
+     * being written would restore an incomplete tile at the next launch.
+     **/
+    void notifyDataComplete() const
+    {
+        if ( !_cache || !_cache->isTileCache() ) {
+            return;
+        }
+        // Under the lock, so that the removal of the tile recorded by deallocate() cannot be recorded before
+        QReadLocker k(&_entryLock);
+        if ( _data.isAllocated() && (_data.getStorageMode() == eStorageModeDisk) ) {
+            _cache->notifyEntryStoredInTile(this);
+        }
+    }
+
     /**
      * @brief To be called for disk-cached entries when restoring them from a file.
      **/
@@ -877,7 +1059,7 @@ public:
             if (_cache->isTileCache()) {
                 _cache->notifyEntryAllocated(getTime(), size, eStorageModeDisk);
             } else {
-                _cache->notifyEntryStorageChanged(eStorageModeNone, eStorageModeDisk, getTime(), size);
+                _cache->notifyEntryStorageChanged( eStorageModeNone, eStorageModeDisk, getTime(), size, _data.getSizeOnDisk() );
             }
         }
     }
@@ -947,12 +1129,14 @@ public:
         if (_cache && _cache->isTileCache()) {
             return;
         }
+        std::size_t sizeOnDisk;
         {
             QWriteLocker k(&_entryLock);
+            sizeOnDisk = _data.getSizeOnDisk();
             _data.reOpenFileMapping();
         }
         if (_cache) {
-            _cache->notifyEntryStorageChanged( eStorageModeDisk, eStorageModeRAM, getTime(), size() );
+            _cache->notifyEntryStorageChanged( eStorageModeDisk, eStorageModeRAM, getTime(), size(), sizeOnDisk );
         }
     }
 
@@ -962,12 +1146,14 @@ public:
     void deallocate()
     {
         std::size_t sz = size();
+        std::size_t sizeOnDisk;
         bool dataAllocated;
         double time = getTime();
         {
             QWriteLocker k(&_entryLock);
             dataAllocated = _data.isAllocated();
             _data.deallocate();
+            sizeOnDisk = _data.getSizeOnDisk();
         }
 
         if (_cache) {
@@ -977,7 +1163,7 @@ public:
                     if (_cache->isTileCache()) {
                          _cache->notifyEntryDestroyed(time, sz, eStorageModeDisk);
                     } else {
-                        _cache->notifyEntryStorageChanged( eStorageModeRAM, eStorageModeDisk, time, sz );
+                        _cache->notifyEntryStorageChanged( eStorageModeRAM, eStorageModeDisk, time, sz, sizeOnDisk );
                     }
                 }
             } else if (info.mode == eStorageModeRAM) {
@@ -1030,6 +1216,17 @@ public:
         return _data.getStorageMode() == eStorageModeDisk;
     }
 
+    /**
+     * @brief Returns the size of the entry on disk when its memory is not mapped, which is smaller than its size
+     * in memory if it is compressed.
+     **/
+    std::size_t getSizeOnDisk() const
+    {
+        QReadLocker k(&_entryLock);
+
+        return _data.getSizeOnDisk();
+    }
+
     bool isAllocated() const
     {
         QReadLocker k(&_entryLock);
@@ -1054,9 +1251,11 @@ public:
 
         bool isAlloc;
         bool hasRemovedFile;
+        std::size_t sizeOnDisk;
         {
             QWriteLocker k(&_entryLock);
             isAlloc = _data.isAllocated();
+            sizeOnDisk = _data.getSizeOnDisk();
             hasRemovedFile = _data.removeAnyBackingFile();
         }
 
@@ -1066,8 +1265,8 @@ public:
         if (isAlloc) {
             _cache->notifyEntryDestroyed(getTime(), getElementsCountFromParams(), eStorageModeRAM);
         } else {
-            ///size() will return 0 at this point, we have to recompute it
-            _cache->notifyEntryDestroyed(getTime(), getElementsCountFromParams(), eStorageModeDisk);
+            ///size() will return 0 at this point, the file may be compressed
+            _cache->notifyEntryDestroyed(getTime(), sizeOnDisk, eStorageModeDisk);
         }
     }
 
@@ -1218,7 +1417,7 @@ private:
                 }
 #endif
                 U64 count = getElementsCountFromParams();
-                _data.allocateMMAP(count, fileName);
+                _data.allocateMMAP( count, fileName, _cache->getDiskCompression(), (int)info.dataTypeSize );
             }
         } else if (info.mode == eStorageModeRAM) {
             U64 count = getElementsCountFromParams();
@@ -1241,6 +1440,9 @@ private:
             throw std::runtime_error("Cache restore, no such file: " + path);
         }
         _data.restoreBufferFromFile(path, offset, this, isTileCache);
+        if (!isTileCache && _cache) {
+            _data.setCompression( _cache->getDiskCompression(), (int)_params->getStorageInfo().dataTypeSize );
+        }
     }
 
 protected:
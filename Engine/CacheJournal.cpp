@@ -0,0 +1,514 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "CacheJournal.h"
+
+#include <map>
+#include <cassert>
+#include <cstring> // memcpy
+#include <algorithm> // max
+
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QWaitCondition>
+#include <QtCore/QFile>
+#include <QtCore/QByteArray>
+#include <QtCore/QDebug>
+
+// "NCJL"
+#define NATRON_CACHE_JOURNAL_MAGIC 0x4c4a434e
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+enum RecordTypeEnum
+{
+    eRecordTypeAddition = 0,
+    eRecordTypeRemoval
+};
+
+struct Record
+{
+    RecordTypeEnum type;
+    CacheJournal::Entry entry;
+};
+
+// Entries indexed by the location of their tile
+typedef std::map<std::pair<std::string, U64>, std::string> EntriesMap;
+
+// FNV-1a, to detect records torn by a crash
+static U32
+recordChecksum(const char* data,
+               std::size_t size)
+{
+    U32 h = 2166136261u;
+
+    for (std::size_t i = 0; i < size; ++i) {
+        h ^= (unsigned char)data[i];
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+template <typename T>
+static void
+appendValue(T value,
+            std::string* buffer)
+{
+    buffer->append( (const char*)&value, sizeof(T) );
+}
+
+template <typename T>
+static bool
+readValue(const char** p,
+          const char* end,
+          T* value)
+{
+    if ( (std::size_t)(end - *p) < sizeof(T) ) {
+        return false;
+    }
+    std::memcpy( value, *p, sizeof(T) );
+    *p += sizeof(T);
+
+    return true;
+}
+
+// A record is its body size, the checksum of its body, then the body: type, offset, file path and serialized entry
+static void
+encodeRecord(RecordTypeEnum type,
+             const std::string& filePath,
+             U64 dataOffset,
+             const std::string& data,
+             std::string* buffer)
+{
+    std::string body;
+
+    body.reserve(1 + sizeof(U64) + sizeof(U32) + filePath.size() + data.size());
+    appendValue( (unsigned char)type, &body );
+    appendValue( dataOffset, &body );
+    appendValue( (U32)filePath.size(), &body );
+    body.append(filePath);
+    body.append(data);
+
+    appendValue( (U32)body.size(), buffer );
+    appendValue( recordChecksum( body.data(), body.size() ), buffer );
+    buffer->append(body);
+}
+
+// Applies the record to the map, returns the change of the size of the live records
+static long long
+applyRecord(RecordTypeEnum type,
+            const std::string& filePath,
+            U64 dataOffset,
+            const std::string& data,
+            EntriesMap* entries)
+{
+    long long sizeChange = 0;
+    std::pair<std::string, U64> location(filePath, dataOffset);
+    EntriesMap::iterator found = entries->find(location);
+
+    if ( found != entries->end() ) {
+        sizeChange -= (long long)(found->first.first.size() + found->second.size());
+        if (type == eRecordTypeRemoval) {
+            entries->erase(found);
+
+            return sizeChange;
+        }
+        found->second = data;
+    } else if (type == eRecordTypeAddition) {
+        entries->insert( std::make_pair(location, data) );
+    } else {
+        return 0;
+    }
+    sizeChange += (long long)(filePath.size() + data.size());
+
+    return sizeChange;
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+struct CacheJournalPrivate
+{
+    mutable QMutex queueMutex;
+    QWaitCondition queueNotEmptyCond;
+    QWaitCondition recordsWrittenCond;
+
+    // Protected by queueMutex
+    std::list<Record> queue;
+    U64 appendedSequence;
+    U64 writtenSequence;
+    bool active;
+    bool mustQuit;
+
+    // Only used by the thread once started
+    std::string filePath;
+    U32 version;
+    QFile file;
+    qint64 fileSize;
+    EntriesMap liveEntries;
+    long long liveEntriesSize;
+    bool writeFailed;
+
+    CacheJournalPrivate()
+        : queueMutex()
+        , queueNotEmptyCond()
+        , recordsWrittenCond()
+        , queue()
+        , appendedSequence(0)
+        , writtenSequence(0)
+        , active(false)
+        , mustQuit(false)
+        , filePath()
+        , version(0)
+        , file()
+        , fileSize(0)
+        , liveEntries()
+        , liveEntriesSize(0)
+        , writeFailed(false)
+    {
+    }
+
+    bool rewrite();
+
+    void write(const std::string& buffer);
+
+    U64 append(RecordTypeEnum type, const std::string& filePath, U64 dataOffset, const std::string& data);
+};
+
+CacheJournal::CacheJournal()
+    : QThread()
+    , _imp( new CacheJournalPrivate() )
+{
+    setObjectName( QString::fromUtf8("CacheJournal") );
+}
+
+CacheJournal::~CacheJournal()
+{
+    quitThread();
+}
+
+bool
+CacheJournal::exists(const std::string& filePath)
+{
+    QString path = QString::fromUtf8( filePath.c_str() );
+
+    if ( QFile::exists(path) ) {
+        return true;
+    }
+    // The compacted journal is only removed once it is complete, see CacheJournalPrivate::rewrite()
+    QString tmpPath = path + QString::fromUtf8(".tmp");
+    if ( QFile::exists(tmpPath) && QFile::rename(tmpPath, path) ) {
+        qDebug() << "Restored the cache journal" << path << "whose compaction was interrupted";
+
+        return true;
+    }
+
+    return false;
+}
+
+bool
+CacheJournal::read(const std::string& filePath,
+                   U32 version,
+                   std::list<Entry>* entries)
+{
+    if ( !exists(filePath) ) {
+        return false;
+    }
+
+    QFile file( QString::fromUtf8( filePath.c_str() ) );
+
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        return false;
+    }
+    QByteArray content = file.readAll();
+    file.close();
+
+    const char* p = content.constData();
+    const char* end = p + content.size();
+    U32 magic, fileVersion;
+    if ( !readValue(&p, end, &magic) || !readValue(&p, end, &fileVersion) ||
+         ( magic != NATRON_CACHE_JOURNAL_MAGIC) || ( fileVersion != version) ) {
+        return false;
+    }
+
+    EntriesMap liveEntries;
+    for (;;) {
+        U32 bodySize, checksum;
+        if ( !readValue(&p, end, &bodySize) || !readValue(&p, end, &checksum) || ( (std::size_t)(end - p) < bodySize ) ) {
+            // End of the journal, or a record torn by a crash
+            break;
+        }
+        const char* bodyEnd = p + bodySize;
+        if ( recordChecksum(p, bodySize) != checksum ) {
+            qDebug() << "Cache journal" << file.fileName() << "is corrupted, ignoring the records after offset" << (p - content.constData());
+            break;
+        }
+        unsigned char type;
+        U64 dataOffset;
+        U32 pathSize;
+        if ( !readValue(&p, bodyEnd, &type) || !readValue(&p, bodyEnd, &dataOffset) || !readValue(&p, bodyEnd, &pathSize) ||
+             ( (std::size_t)(bodyEnd - p) < pathSize ) || ( type > eRecordTypeRemoval) ) {
+            break;
+        }
+        std::string path(p, pathSize);
+        p += pathSize;
+        applyRecord( (RecordTypeEnum)type, path, dataOffset, std::string(p, bodyEnd - p), &liveEntries );
+        p = bodyEnd;
+    }
+
+    for (EntriesMap::const_iterator it = liveEntries.begin(); it != liveEntries.end(); ++it) {
+        Entry e;
+        e.filePath = it->first.first;
+        e.dataOffset = it->first.second;
+        e.data = it->second;
+        entries->push_back(e);
+    }
+
+    return true;
+} // CacheJournal::read
+
+/**
+ * @brief Writes the live entries in a new file which then replaces the journal. The old journal is removed only once
+ * the new file is complete, so that a crash while compacting leaves either the old journal, or no journal and the
+ * new file, which CacheJournal::exists() then moves in place.
+ **/
+bool
+CacheJournalPrivate::rewrite()
+{
+    file.close();
+
+    QString path = QString::fromUtf8( filePath.c_str() );
+    QString tmpPath = path + QString::fromUtf8(".tmp");
+    {
+        QFile tmpFile(tmpPath);
+        if ( !tmpFile.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+            qDebug() << "Failed to write the cache journal" << tmpPath;
+
+            return false;
+        }
+        std::string buffer;
+        appendValue( (U32)NATRON_CACHE_JOURNAL_MAGIC, &buffer );
+        appendValue( version, &buffer );
+        for (EntriesMap::const_iterator it = liveEntries.begin(); it != liveEntries.end(); ++it) {
+            encodeRecord(eRecordTypeAddition, it->first.first, it->first.second, it->second, &buffer);
+        }
+        if ( tmpFile.write( buffer.data(), (qint64)buffer.size() ) != (qint64)buffer.size() ) {
+            qDebug() << "Failed to write the cache journal" << tmpPath;
+            tmpFile.remove();
+
+            return false;
+        }
+        tmpFile.close();
+    }
+    // QFile::rename() does not overwrite an existing file (and QSaveFile is not available in Qt 4)
+    QFile::remove(path);
+    if ( !QFile::rename(tmpPath, path) ) {
+        qDebug() << "Failed to write the cache journal" << path;
+
+        return false;
+    }
+    file.setFileName(path);
+    if ( !file.open(QIODevice::WriteOnly | QIODevice::Append) ) {
+        qDebug() << "Failed to open the cache journal" << path;
+
+        return false;
+    }
+    fileSize = file.size();
+
+    return true;
+}
+
+void
+CacheJournalPrivate::write(const std::string& buffer)
+{
+    if ( writeFailed || buffer.empty() ) {
+        return;
+    }
+    if ( ( file.write( buffer.data(), (qint64)buffer.size() ) != (qint64)buffer.size() ) || !file.flush() ) {
+        // The journal no longer reflects the cache: remove it so that nothing is restored from it
+        qDebug() << "Failed to write the cache journal" << file.fileName() << ", the cache will not be restored at the next launch";
+        writeFailed = true;
+        file.remove();
+
+        return;
+    }
+    fileSize += (qint64)buffer.size();
+
+    long long maxSize = std::max( (long long)NATRON_CACHE_JOURNAL_COMPACTION_MIN_SIZE, liveEntriesSize * NATRON_CACHE_JOURNAL_COMPACTION_FACTOR );
+    if (fileSize > maxSize) {
+        if ( !rewrite() ) {
+            writeFailed = true;
+            QFile::remove( QString::fromUtf8( filePath.c_str() ) );
+        }
+    }
+}
+
+void
+CacheJournal::start(const std::string& filePath,
+                    U32 version,
+                    const std::list<Entry>& entries)
+{
+    assert( !isRunning() );
+    // The sequence numbers are not reset: tiles freed before a restart are released once written
+    _imp->filePath = filePath;
+    _imp->version = version;
+    _imp->liveEntries.clear();
+    _imp->liveEntriesSize = 0;
+    _imp->writeFailed = false;
+    for (std::list<Entry>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        _imp->liveEntriesSize += applyRecord(eRecordTypeAddition, it->filePath, it->dataOffset, it->data, &_imp->liveEntries);
+    }
+    if ( !_imp->rewrite() ) {
+        return;
+    }
+    {
+        QMutexLocker k(&_imp->queueMutex);
+        _imp->active = true;
+        _imp->mustQuit = false;
+    }
+    QThread::start(QThread::LowPriority);
+}
+
+bool
+CacheJournal::isActive() const
+{
+    QMutexLocker k(&_imp->queueMutex);
+
+    return _imp->active;
+}
+
+U64
+CacheJournalPrivate::append(RecordTypeEnum type,
+                            const std::string& filePath,
+                            U64 dataOffset,
+                            const std::string& data)
+{
+    QMutexLocker k(&queueMutex);
+
+    if (!active) {
+        return 0;
+    }
+    Record r;
+    r.type = type;
+    r.entry.filePath = filePath;
+    r.entry.dataOffset = dataOffset;
+    r.entry.data = data;
+    queue.push_back(r);
+    ++appendedSequence;
+    queueNotEmptyCond.wakeOne();
+
+    return appendedSequence;
+}
+
+U64
+CacheJournal::appendAddition(const std::string& filePath,
+                             U64 dataOffset,
+                             const std::string& data)
+{
+    return _imp->append(eRecordTypeAddition, filePath, dataOffset, data);
+}
+
+U64
+CacheJournal::appendRemoval(const std::string& filePath,
+                            U64 dataOffset)
+{
+    return _imp->append( eRecordTypeRemoval, filePath, dataOffset, std::string() );
+}
+
+U64
+CacheJournal::getWrittenSequence() const
+{
+    QMutexLocker k(&_imp->queueMutex);
+
+    return _imp->writtenSequence;
+}
+
+void
+CacheJournal::sync()
+{
+    QMutexLocker k(&_imp->queueMutex);
+    U64 sequence = _imp->appendedSequence;
+
+    while (_imp->writtenSequence < sequence) {
+        _imp->recordsWrittenCond.wait(&_imp->queueMutex);
+    }
+}
+
+void
+CacheJournal::quitThread()
+{
+    if ( !isRunning() ) {
+        return;
+    }
+    {
+        QMutexLocker k(&_imp->queueMutex);
+        _imp->active = false;
+        _imp->mustQuit = true;
+        _imp->queueNotEmptyCond.wakeOne();
+    }
+    wait();
+}
+
+void
+CacheJournal::run()
+{
+    for (;;) {
+        std::list<Record> records;
+        U64 sequence;
+        bool quit;
+        {
+            QMutexLocker k(&_imp->queueMutex);
+            while ( _imp->queue.empty() && !_imp->mustQuit ) {
+                _imp->queueNotEmptyCond.wait(&_imp->queueMutex);
+            }
+            records.swap(_imp->queue);
+            sequence = _imp->appendedSequence;
+            quit = _imp->mustQuit;
+        }
+
+        // Records appended while the previous batch was written are written at once
+        std::string buffer;
+        for (std::list<Record>::const_iterator it = records.begin(); it != records.end(); ++it) {
+            _imp->liveEntriesSize += applyRecord(it->type, it->entry.filePath, it->entry.dataOffset, it->entry.data, &_imp->liveEntries);
+            encodeRecord(it->type, it->entry.filePath, it->entry.dataOffset, it->entry.data, &buffer);
+        }
+        _imp->write(buffer);
+
+        {
+            QMutexLocker k(&_imp->queueMutex);
+            _imp->writtenSequence = sequence;
+            _imp->recordsWrittenCond.wakeAll();
+        }
+        if (quit) {
+            _imp->file.close();
+
+            return;
+        }
+    }
+}
+
+NATRON_NAMESPACE_EXIT
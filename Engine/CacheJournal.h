@@ -0,0 +1,140 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_CACHEJOURNAL_H
+#define NATRON_ENGINE_CACHEJOURNAL_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+#include <string>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+GCC_DIAG_OFF(deprecated)
+#include <QtCore/QThread>
+GCC_DIAG_ON(deprecated)
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+///The journal is rewritten with only the live entries once it is this many times larger than them
+#define NATRON_CACHE_JOURNAL_COMPACTION_FACTOR 2
+
+///The journal is never compacted while smaller than this, in bytes
+#define NATRON_CACHE_JOURNAL_COMPACTION_MIN_SIZE 1000000
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief An append-only log of the entries of a tiled cache, so that they can be restored at the next launch
+ * even if the application did not quit cleanly.
+ * An entry is identified by the file and the offset of its tile. An addition record carries the serialized entry,
+ * a removal record only its location. Records are written to the file by this thread, in the order they were
+ * appended: the thread appending a record never waits for the disk.
+ * Each record is written with its length and a checksum so that a record torn by a crash is detected, in which case
+ * the journal is read up to that record.
+ * The journal is compacted by this thread once it grows much larger than the live entries.
+ **/
+struct CacheJournalPrivate;
+class CacheJournal
+    : public QThread
+{
+public:
+
+    struct Entry
+    {
+        std::string filePath;
+        U64 dataOffset;
+        std::string data; // the serialized entry
+
+        Entry()
+            : filePath()
+            , dataOffset(0)
+            , data()
+        {
+        }
+    };
+
+    CacheJournal();
+
+    virtual ~CacheJournal();
+
+    /**
+     * @brief Returns true if there is a journal at the given path. If the process stopped while the journal was compacted,
+     * after the old journal was removed and before the compacted one replaced it, the compacted one is moved in place first.
+     **/
+    static bool exists(const std::string& filePath);
+
+    /**
+     * @brief Reads the journal at the given path and returns the entries that were added and not removed since.
+     * Returns false if there is no journal or if it was written for a different version of the cache.
+     **/
+    static bool read(const std::string& filePath, U32 version, std::list<Entry>* entries);
+
+    /**
+     * @brief Rewrites the journal at the given path with the given entries and starts recording the changes.
+     **/
+    void start(const std::string& filePath, U32 version, const std::list<Entry>& entries);
+
+    /**
+     * @brief Returns true between start() and quitThread()
+     **/
+    bool isActive() const;
+
+    /**
+     * @brief Appends an addition or a removal record. Returns the sequence number of the record, it is written to the
+     * file once getWrittenSequence() is greater or equal.
+     **/
+    U64 appendAddition(const std::string& filePath, U64 dataOffset, const std::string& data);
+    U64 appendRemoval(const std::string& filePath, U64 dataOffset);
+
+    /**
+     * @brief Returns the sequence number of the last record written to the file.
+     **/
+    U64 getWrittenSequence() const;
+
+    /**
+     * @brief Blocks until all records appended so far are written to the file.
+     **/
+    void sync();
+
+    /**
+     * @brief Writes the pending records and stops recording the changes.
+     **/
+    void quitThread();
+
+private:
+
+    virtual void run() OVERRIDE FINAL;
+    boost::scoped_ptr<CacheJournalPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_CACHEJOURNAL_H
@@ -32,6 +32,7 @@
 #include <set>
 #include <cstddef>
 #include <stdexcept>
+#include <sstream>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
@@ -76,20 +77,16 @@ void
 Cache<EntryType>::save(CacheTOC* tableOfContents)
 {
     clearInMemoryPortion(false);
-    {
-        QMutexLocker l(&_lock);     // must be locked
+    for (int i = 0; i < NATRON_CACHE_SHARDS_COUNT; ++i) {
+        CacheShard& shard = _shards[i];
+        QMutexLocker l(&shard.lock);     // must be locked
 
-        for (CacheIterator it = _diskCache.begin(); it != _diskCache.end(); ++it) {
+        for (CacheIterator it = shard.diskCache.begin(); it != shard.diskCache.end(); ++it) {
             std::list<EntryTypePtr> & listOfValues  = getValueFromIterator(it);
             for (typename std::list<EntryTypePtr>::const_iterator it2 = listOfValues.begin(); it2 != listOfValues.end(); ++it2) {
                 if ( (*it2)->isStoredOnDisk() ) {
                     SerializedEntry serialization;
-                    serialization.hash = (*it2)->getHashKey();
-                    serialization.params = (*it2)->getParams();
-                    serialization.key = (*it2)->getKey();
-                    serialization.size = (*it2)->dataSize();
-                    serialization.filePath = (*it2)->getFilePath();
-                    serialization.dataOffsetInFile = (*it2)->getOffsetInFile();
+                    serialization.initialize(**it2);
 
                     (*it2)->syncBackingFile();
                     
@@ -154,8 +151,9 @@ Cache<EntryType>::restore(const CacheTOC & tableOfContents)
         const std::string& filePath = value->getFilePath();
         usedFilePaths.insert(QString::fromUtf8(filePath.c_str()));
         {
-            QMutexLocker locker(&_lock);
-            sealEntry(EntryTypePtr(value), false /*inMemory*/);
+            CacheShard& shard = getShard( value->getHashKey() );
+            QMutexLocker locker(&shard.lock);
+            sealEntry(shard, EntryTypePtr(value), false /*inMemory*/);
         }
     }
 
@@ -166,6 +164,9 @@ Cache<EntryType>::restore(const CacheTOC & tableOfContents)
         QString absolutePath = cacheFolder.absolutePath();
         QStringList etr = cacheFolder.entryList(QDir::NoDotAndDotDot);
         for (QStringList::iterator it = etr.begin(); it!=etr.end(); ++it) {
+            if ( *it == QString::fromUtf8(NATRON_CACHE_JOURNAL_FILE_NAME) ) {
+                continue;
+            }
             QString entryFilePath = absolutePath + QLatin1Char('/') + *it;
 
             std::set<QString>::iterator foundUsed = usedFilePaths.find(entryFilePath);
@@ -217,6 +218,16 @@ struct Cache<EntryType>::SerializedEntry
     {
     }
 
+    void initialize(const EntryType& entry)
+    {
+        hash = entry.getHashKey();
+        params = entry.getParams();
+        key = entry.getKey();
+        size = entry.dataSize();
+        filePath = entry.getFilePath();
+        dataOffsetInFile = entry.getOffsetInFile();
+    }
+
     template<class Archive>
     void serialize(Archive & ar,
                    const unsigned int /*version*/)
@@ -230,6 +241,79 @@ struct Cache<EntryType>::SerializedEntry
     }
 };
 
+template<typename EntryType>
+void
+serializeCacheJournalEntry(const EntryType& entry,
+                           std::string* data)
+{
+    typename Cache<EntryType>::SerializedEntry serialization;
+
+    serialization.initialize(entry);
+
+    std::ostringstream ss;
+    {
+        boost::archive::binary_oarchive oArchive(ss);
+        const typename Cache<EntryType>::SerializedEntry& constSerialization = serialization;
+        oArchive << constSerialization;
+    }
+    *data = ss.str();
+}
+
+template<typename EntryType>
+bool
+Cache<EntryType>::readJournal(CacheTOC* tableOfContents) const
+{
+    std::list<CacheJournal::Entry> entries;
+
+    if ( !CacheJournal::read(getJournalFilePath(), _version, &entries) ) {
+        return false;
+    }
+    for (std::list<CacheJournal::Entry>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        SerializedEntry serialization;
+        try {
+            std::istringstream ss(it->data);
+            boost::archive::binary_iarchive iArchive(ss);
+            iArchive >> serialization;
+        } catch (const std::exception & e) {
+            qDebug() << "Failed to read an entry of the cache journal:" << e.what();
+            continue;
+        }
+        tableOfContents->push_back(serialization);
+    }
+
+    return true;
+}
+
+/*Must be called after the cache was restored or its files removed, before it is used*/
+template<typename EntryType>
+void
+Cache<EntryType>::startJournal()
+{
+    assert(_isTiled);
+    _journal.quitThread();
+
+    std::list<CacheJournal::Entry> entries;
+    for (int i = 0; i < NATRON_CACHE_SHARDS_COUNT; ++i) {
+        CacheShard& shard = _shards[i];
+        QMutexLocker l(&shard.lock);
+
+        for (CacheIterator it = shard.diskCache.begin(); it != shard.diskCache.end(); ++it) {
+            std::list<EntryTypePtr> & listOfValues  = getValueFromIterator(it);
+            for (typename std::list<EntryTypePtr>::const_iterator it2 = listOfValues.begin(); it2 != listOfValues.end(); ++it2) {
+                if ( (*it2)->isStoredOnDisk() ) {
+                    CacheJournal::Entry e;
+                    e.filePath = (*it2)->getFilePath();
+                    e.dataOffset = (*it2)->getOffsetInFile();
+                    serializeCacheJournalEntry(**it2, &e.data);
+                    entries.push_back(e);
+                }
+            }
+        }
+    }
+    _journalEntrySerializer = &serializeCacheJournalEntry<EntryType>;
+    _journal.start(getJournalFilePath(), _version, entries);
+}
+
 NATRON_NAMESPACE_EXIT
 
 
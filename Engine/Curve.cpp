@@ -37,6 +37,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/AppManager.h"
 
 #include "Engine/CurvePrivate.h"
+#include "Engine/Hash64.h"
 #include "Engine/Interpolation.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/KnobFile.h"
@@ -305,6 +306,7 @@ Curve::setPeriodic(bool periodic)
     QMutexLocker k(&_imp->_lock);
     _imp->isPeriodic = periodic;
     _imp->keyFrames.clear();
+    _imp->invalidateSnapshot();
 }
 
 bool
@@ -325,6 +327,7 @@ Curve::clearKeyFrames()
     QMutexLocker l(&_imp->_lock);
 
     _imp->keyFrames.clear();
+    _imp->invalidateSnapshot();
 }
 
 bool
@@ -401,6 +404,29 @@ Curve::clone(const Curve & other,
     onCurveChanged();
 }
 
+void
+Curve::cloneRange(const Curve & other,
+                  const RangeD & range)
+{
+    KeyFrameSet otherKeys = other.getKeyFrames_mt_safe();
+    QMutexLocker l(&_imp->_lock);
+    KeyFrameSet newSet;
+
+    for (KeyFrameSet::iterator it = _imp->keyFrames.begin(); it != _imp->keyFrames.end(); ++it) {
+        double time = it->getTime();
+        if ( (time < range.min) || (time > range.max) ) {
+            newSet.insert(*it);
+        }
+    }
+    for (KeyFrameSet::iterator it = otherKeys.begin(); it != otherKeys.end(); ++it) {
+        double time = it->getTime();
+        if ( (time >= range.min) && (time <= range.max) ) {
+            newSet.insert(*it);
+        }
+    }
+    setKeyframesInternal(newSet, true);
+}
+
 double
 Curve::getMinimumTimeCovered() const
 {
@@ -442,9 +468,43 @@ Curve::addKeyFrame(KeyFrame key)
     return it.second;
 }
 
+int
+Curve::addKeyFrames(const std::vector<KeyFrame>& keys)
+{
+    QMutexLocker l(&_imp->_lock);
+
+    if ( keys.empty() ) {
+        return 0;
+    }
+
+    // the default interpolation for bool, string, chaice, int is constant
+    bool constantInterp = ( (_imp->type == CurvePrivate::eCurveTypeBool) || (_imp->type == CurvePrivate::eCurveTypeString) ||
+                            ( _imp->type == CurvePrivate::eCurveTypeInt) ||
+                            ( _imp->type == CurvePrivate::eCurveTypeIntConstantInterp) );
+    int nAdded = 0;
+    for (std::vector<KeyFrame>::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+        std::pair<KeyFrameSet::iterator, bool> ret;
+        if (constantInterp) {
+            KeyFrame key(*it);
+            key.setInterpolation(eKeyframeTypeConstant);
+            ret = addKeyFrameNoUpdate(key);
+        } else {
+            ret = addKeyFrameNoUpdate(*it);
+        }
+        ret.first = refreshDerivativesAround(eCurveChangedReasonKeyframeChanged, ret.first);
+        if (ret.second) {
+            ++nAdded;
+        }
+    }
+    onCurveChanged();
+
+    return nAdded;
+}
+
 std::pair<KeyFrameSet::iterator, bool> Curve::addKeyFrameNoUpdate(const KeyFrame & cp)
 {
     // PRIVATE - should not lock
+    _imp->invalidateSnapshot();
     if (!_imp->isParametric) { //< if keyframes are clamped to integers
         std::pair<KeyFrameSet::iterator, bool> newKey = _imp->keyFrames.insert(cp);
         // keyframe at this time exists, erase and insert again
@@ -889,13 +949,191 @@ interParams(const KeyFrameSet &keyFrames,
     }
 }
 
+/// round the interpolated value of a curve according to its type
+static double
+roundValueForCurveType(CurvePrivate::CurveTypeEnum type,
+                       double v)
+{
+    switch (type) {
+    case CurvePrivate::eCurveTypeString:
+    case CurvePrivate::eCurveTypeInt:
+
+        return std::floor(v + 0.5);
+    case CurvePrivate::eCurveTypeDouble:
+
+        return v;
+    case CurvePrivate::eCurveTypeBool:
+
+        return v >= 0.5 ? 1. : 0.;
+    default:
+
+        return v;
+    }
+}
+
+static double
+clampValueToYRange(const Curve::YRange& minmax,
+                   double v)
+{
+    if (v > minmax.max) {
+        return minmax.max;
+    } else if (v < minmax.min) {
+        return minmax.min;
+    }
+
+    return v;
+}
+
+CurveSnapshotPtr
+CurvePrivate::getSnapshot() const
+{
+    CurveSnapshotPtr ret = boost::atomic_load(&snapshot);
+
+    if (ret) {
+        return ret;
+    }
+
+    QMutexLocker l(&_lock);
+    ret = boost::atomic_load(&snapshot);
+    if (!ret) {
+        ret = makeSnapshot();
+        boost::atomic_store(&snapshot, ret);
+    }
+
+    return ret;
+}
+
+void
+CurvePrivate::invalidateSnapshot()
+{
+    boost::atomic_store( &snapshot, CurveSnapshotPtr() );
+}
+
+CurveSnapshotPtr
+CurvePrivate::makeSnapshot() const
+{
+    // PRIVATE - the lock must be held
+    boost::shared_ptr<CurveSnapshot> ret(new CurveSnapshot);
+
+    ret->type = type;
+    ret->isPeriodic = isPeriodic;
+    ret->xMin = xMin;
+    ret->xMax = xMax;
+    ret->mustClamp = owner || yMin != -std::numeric_limits<double>::infinity() || yMax != std::numeric_limits<double>::infinity();
+    ret->yMin = yMin;
+    ret->yMax = yMax;
+    if ( keyFrames.empty() ) {
+        return ret;
+    }
+
+    ret->times.reserve( keyFrames.size() );
+    ret->segments.resize(keyFrames.size() + 1);
+    for (KeyFrameSet::const_iterator it = keyFrames.begin(); it != keyFrames.end(); ++it) {
+        ret->times.push_back( it->getTime() );
+    }
+
+    // Same parameters as interParams()
+    const double period = xMax - xMin;
+    const KeyFrame& first = *keyFrames.begin();
+    const KeyFrame& last = *keyFrames.rbegin();
+    // The keyframes around the middle segment i are itcur and itup, advanced once per segment
+    KeyFrameSet::const_iterator itcur = keyFrames.begin();
+    KeyFrameSet::const_iterator itup = itcur;
+    for (std::size_t i = 0; i <= keyFrames.size(); ++i) {
+        double tcur, vcur, vcurDerivRight, tnext, vnext, vnextDerivLeft;
+        KeyframeTypeEnum interp, interpNext;
+        if (i == 0) {
+            tnext = first.getTime();
+            vnext = first.getValue();
+            vnextDerivLeft = first.getLeftDerivative();
+            interpNext = first.getInterpolation();
+            if (isPeriodic) {
+                tcur = last.getTime() - period;
+                vcur = last.getValue();
+                vcurDerivRight = last.getRightDerivative();
+                interp = last.getInterpolation();
+            } else {
+                tcur = tnext - 1.;
+                vcur = vnext;
+                vcurDerivRight = 0.;
+                interp = eKeyframeTypeNone;
+            }
+        } else if ( i == keyFrames.size() ) {
+            tcur = last.getTime();
+            vcur = last.getValue();
+            vcurDerivRight = last.getRightDerivative();
+            interp = last.getInterpolation();
+            if (isPeriodic) {
+                tnext = first.getTime() + period;
+                vnext = first.getValue();
+                vnextDerivLeft = first.getLeftDerivative();
+                interpNext = first.getInterpolation();
+            } else {
+                tnext = tcur + 1.;
+                vnext = vcur;
+                vnextDerivLeft = 0.;
+                interpNext = eKeyframeTypeNone;
+            }
+        } else {
+            itcur = itup;
+            ++itup;
+            tcur = itcur->getTime();
+            vcur = itcur->getValue();
+            vcurDerivRight = itcur->getRightDerivative();
+            interp = itcur->getInterpolation();
+            tnext = itup->getTime();
+            vnext = itup->getValue();
+            vnextDerivLeft = itup->getLeftDerivative();
+            interpNext = itup->getInterpolation();
+        }
+        CurveSnapshot::Segment& seg = ret->segments[i];
+        Interpolation::cubicCoefficients(tcur, vcur, vcurDerivRight, vnextDerivLeft, tnext, vnext, interp, interpNext, &seg.tStart, &seg.tLength, seg.c);
+    }
+
+    return ret;
+} // CurvePrivate::makeSnapshot
+
+double
+CurveSnapshot::interpolate(double t,
+                           int* segmentHint) const
+{
+    assert( !times.empty() );
+    if (isPeriodic) {
+        // if the curve is periodic, bring back t in the curve keyframes range, as interParams() does
+        const double period = xMax - xMin;
+        const double minKeyFrameX = times.front() + xMin;
+        assert(xMin < xMax);
+        if ( (t < minKeyFrameX) || (t > minKeyFrameX + period) ) {
+            t = std::fmod(t - minKeyFrameX, period) + minKeyFrameX;
+            if (t < minKeyFrameX) {
+                t += period;
+            }
+        }
+    }
+
+    // find the segment of the first keyframe with time greater than t
+    const int nTimes = (int)times.size();
+    int i = segmentHint ? *segmentHint : -1;
+    if ( (i < 0) || (i > nTimes) ||
+         ( (i > 0) && (times[i - 1] > t) ) ||
+         ( (i < nTimes) && (times[i] <= t) ) ) {
+        i = (int)( std::upper_bound(times.begin(), times.end(), t) - times.begin() );
+    }
+    if (segmentHint) {
+        *segmentHint = i;
+    }
+    const Segment& seg = segments[i];
+
+    return Interpolation::evaluateCubic(seg.c, (t - seg.tStart) / seg.tLength);
+}
+
 double
 Curve::getValueAt(double t,
                   bool doClamp) const
 {
-    QMutexLocker l(&_imp->_lock);
+    CurveSnapshotPtr snapshot = _imp->getSnapshot();
 
-    if ( _imp->keyFrames.empty() ) {
+    if ( snapshot->times.empty() ) {
         //throw std::runtime_error("Curve has no control points!");
 
         // A curve with no control points is considered to be 0
@@ -903,77 +1141,48 @@ Curve::getValueAt(double t,
         return 0.;
 
         // There is no special case for a curve with one (1) keyframe: the result is a linear curve before and after the keyframe.
-    //} else if (_imp->keyFrames.size() == 1) {
-    //    return _imp->keyFrames.begin()->getValue();
     }
 
-    double v;
-#ifdef NATRON_CURVE_USE_CACHE
-    std::map<double, double>::const_iterator foundCached = _imp->resultCache.find(t);
-    if ( foundCached != _imp->resultCache.end() ) {
-        v = foundCached->second;
-    } else
-#endif
-    {
-        // even when there is only one keyframe, there may be tangents!
-        //if (_imp->keyFrames.size() == 1) {
-        //    //if there's only 1 keyframe, don't bother interpolating
-        //    return (*_imp->keyFrames.begin()).getValue();
-        //}
-        double tcur, tnext;
-        double vcurDerivRight, vnextDerivLeft, vcur, vnext;
-        KeyframeTypeEnum interp, interpNext;
-        KeyFrame k(t, 0.);
-        // find the first keyframe with time greater than t
-        KeyFrameSet::const_iterator itup;
-        itup = _imp->keyFrames.upper_bound(k);
-        interParams(_imp->keyFrames,
-                    _imp->isPeriodic,
-                    _imp->xMin,
-                    _imp->xMax,
-                    &t,
-                    itup,
-                    &tcur,
-                    &vcur,
-                    &vcurDerivRight,
-                    &interp,
-                    &tnext,
-                    &vnext,
-                    &vnextDerivLeft,
-                    &interpNext);
-
-        v = Interpolation::interpolate(tcur, vcur,
-                                       vcurDerivRight,
-                                       vnextDerivLeft,
-                                       tnext, vnext,
-                                       t,
-                                       interp,
-                                       interpNext);
-#ifdef NATRON_CURVE_USE_CACHE
-        _imp->resultCache[t] = v;
-#endif
-    }
+    // even when there is only one keyframe, there may be tangents!
+    double v = snapshot->interpolate(t, NULL);
 
-    if ( doClamp && mustClamp() ) {
-        v = clampValueToCurveYRange(v);
+    if (doClamp && snapshot->mustClamp) {
+        // The Y range of knobs is not part of the snapshot: it may change without the curve being notified
+        YRange minmax = _imp->owner ? getCurveYRange_internal() : YRange(snapshot->yMin, snapshot->yMax);
+        v = clampValueToYRange(minmax, v);
     }
 
-    switch (_imp->type) {
-    case CurvePrivate::eCurveTypeString:
-    case CurvePrivate::eCurveTypeInt:
+    return roundValueForCurveType(snapshot->type, v);
+} // getValueAt
 
-        return std::floor(v + 0.5);
-    case CurvePrivate::eCurveTypeDouble:
+void
+Curve::getValuesAt(const std::vector<double>& times,
+                   std::vector<double>* values,
+                   bool doClamp) const
+{
+    CurveSnapshotPtr snapshot = _imp->getSnapshot();
 
-        return v;
-    case CurvePrivate::eCurveTypeBool:
+    values->resize( times.size() );
+    if ( snapshot->times.empty() ) {
+        std::fill(values->begin(), values->end(), 0.);
 
-        return v >= 0.5 ? 1. : 0.;
-    default:
+        return;
+    }
 
-        return v;
+    bool clamp = doClamp && snapshot->mustClamp;
+    YRange minmax(snapshot->yMin, snapshot->yMax);
+    if (clamp && _imp->owner) {
+        minmax = getCurveYRange_internal();
     }
-} // getValueAt
+    int segmentHint = -1;
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        double v = snapshot->interpolate(times[i], &segmentHint);
+        if (clamp) {
+            v = clampValueToYRange(minmax, v);
+        }
+        (*values)[i] = roundValueForCurveType(snapshot->type, v);
+    }
+}
 
 double
 Curve::getDerivativeAt(double t) const
@@ -1189,6 +1398,13 @@ Curve::YRange Curve::getCurveYRange() const
 {
     QMutexLocker l(&_imp->_lock);
 
+    return getCurveYRange_internal();
+}
+
+Curve::YRange
+Curve::getCurveYRange_internal() const
+{
+    // PRIVATE - should not lock, except for a curve held by a knob
     if ( !mustClamp() ) {
         return YRange( -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity() );
     }
@@ -1220,22 +1436,6 @@ Curve::YRange Curve::getCurveYRange() const
 
 }
 
-double
-Curve::clampValueToCurveYRange(double v) const
-{
-    // PRIVATE - should not lock
-    ////clamp to min/max if the owner of the curve is a Double or Int knob.
-    YRange minmax = getCurveYRange();
-
-    if (v > minmax.max) {
-        return minmax.max;
-    } else if (v < minmax.min) {
-        return minmax.min;
-    }
-
-    return v;
-}
-
 bool
 Curve::isAnimated() const
 {
@@ -1253,6 +1453,7 @@ Curve::setXRange(double a,
 
     _imp->xMin = a;
     _imp->xMax = b;
+    _imp->invalidateSnapshot();
 }
 
 std::pair<double, double> Curve::getXRange() const
@@ -1278,6 +1479,22 @@ Curve::getKeyFrames_mt_safe() const
     return _imp->keyFrames;
 }
 
+void
+Curve::appendToHash(Hash64* hash) const
+{
+    QMutexLocker l(&_imp->_lock);
+
+    hash->append(_imp->isPeriodic);
+    hash->append<U64>( _imp->keyFrames.size() );
+    for (KeyFrameSet::const_iterator it = _imp->keyFrames.begin(); it != _imp->keyFrames.end(); ++it) {
+        hash->append( it->getTime() );
+        hash->append( it->getValue() );
+        hash->append( it->getLeftDerivative() );
+        hash->append( it->getRightDerivative() );
+        hash->append<int>( (int)it->getInterpolation() );
+    }
+}
+
 KeyFrameSet::iterator
 Curve::setKeyFrameValueAndTimeNoUpdate(double value,
                                        double time,
@@ -1652,6 +1869,7 @@ Curve::refreshDerivatives(Curve::CurveChangedReasonEnum reason,
     newKey.setLeftDerivative(vcurDerivLeft);
     newKey.setRightDerivative(vcurDerivRight);
 
+    _imp->invalidateSnapshot();
     std::pair<KeyFrameSet::iterator, bool> newKeyIt = _imp->keyFrames.insert(newKey);
 
     // keyframe at this time exists, erase and insert again
@@ -1672,6 +1890,17 @@ Curve::refreshDerivatives(Curve::CurveChangedReasonEnum reason,
 KeyFrameSet::iterator
 Curve::evaluateCurveChanged(CurveChangedReasonEnum reason,
                             KeyFrameSet::iterator key)
+{
+    // PRIVATE - should not lock
+    key = refreshDerivativesAround(reason, key);
+    onCurveChanged();
+
+    return key;
+}
+
+KeyFrameSet::iterator
+Curve::refreshDerivativesAround(CurveChangedReasonEnum reason,
+                                KeyFrameSet::iterator key)
 {
     // PRIVATE - should not lock
     assert( key != _imp->keyFrames.end() );
@@ -1719,10 +1948,9 @@ Curve::evaluateCurveChanged(CurveChangedReasonEnum reason,
             next = refreshDerivatives(eCurveChangedReasonDerivativesChanged, next);
         }
     }
-    onCurveChanged();
 
     return key;
-}
+} // refreshDerivativesAround
 
 KeyFrameSet::const_iterator
 Curve::findWithTime(const KeyFrameSet& keys,
@@ -1818,6 +2046,7 @@ Curve::setYRange(double yMin,
 
     _imp->yMin = yMin;
     _imp->yMax = yMax;
+    _imp->invalidateSnapshot();
 }
 
 bool
@@ -1834,9 +2063,7 @@ Curve::onCurveChanged()
     if (_imp->owner) {
         _imp->owner->clearExpressionsResults(_imp->dimensionInOwner);
     }
-#ifdef NATRON_CURVE_USE_CACHE
-    _imp->resultCache.clear();
-#endif
+    _imp->invalidateSnapshot();
 }
 
 void
@@ -192,6 +192,12 @@ public:
      **/
     void clone(const Curve & other, SequenceTime offset, const RangeD* range);
 
+    /**
+     * @brief Replaces the keyframes of this curve lying in the given range by the keyframes of other lying in
+     * the same range. Keyframes outside of the range are left untouched.
+     **/
+    void cloneRange(const Curve & other, const RangeD & range);
+
     bool isAnimated() const WARN_UNUSED_RETURN;
 
     /**
@@ -215,6 +221,14 @@ public:
     ///existing key at this time.
     bool addKeyFrame(KeyFrame key);
 
+    /**
+     * @brief Adds the given keyframes in order, replacing the keyframes already existing at their time.
+     * The resulting curve is the same as with one call to addKeyFrame() per keyframe, but the curve
+     * is locked and its caches are invalidated only once, which makes it much faster to bake many keyframes.
+     * @returns The number of keyframes that did not replace an existing keyframe.
+     **/
+    int addKeyFrames(const std::vector<KeyFrame>& keys);
+
     void removeKeyFrameWithTime(double time);
 
     void removeKeyFrameWithIndex(int index);
@@ -256,12 +270,25 @@ public:
      */
     double getValueAt(double t, bool clamp = true) const WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Same as getValueAt() for many times at once, e.g to draw the curve or to sample it for motion blur.
+     * All values are computed from the same state of the curve, even if it is modified meanwhile.
+     * Increasing times are evaluated faster.
+     **/
+    void getValuesAt(const std::vector<double>& times, std::vector<double>* values, bool clamp = true) const;
+
     double getDerivativeAt(double t) const WARN_UNUSED_RETURN;
 
     double getIntegrateFromTo(double t1, double t2) const WARN_UNUSED_RETURN;
 
     KeyFrameSet getKeyFrames_mt_safe() const WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Appends the keyframes of the curve (time, value, derivatives and interpolation)
+     * to the given hash. 2 curves with the same keyframes produce the same hash.
+     **/
+    void appendToHash(Hash64* hash) const;
+
     void clearKeyFrames();
 
     /**
@@ -371,8 +398,6 @@ private:
 
     void removeKeyFrame(KeyFrameSet::const_iterator it);
 
-    double clampValueToCurveYRange(double v) const WARN_UNUSED_RETURN;
-
     void setKeyframesInternal(const KeyFrameSet& keys, bool refreshDerivatives);
 
     ///returns an iterator to the new keyframe in the keyframe set and
@@ -387,6 +412,11 @@ private:
      * The value pointed to by key before this call is now pointed to by the iterator returned by this function.
      **/
     KeyFrameSet::iterator evaluateCurveChanged(CurveChangedReasonEnum reason, KeyFrameSet::iterator key) WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Same as evaluateCurveChanged but does not call onCurveChanged(), for callers that modify several keyframes.
+     **/
+    KeyFrameSet::iterator refreshDerivativesAround(CurveChangedReasonEnum reason, KeyFrameSet::iterator key) WARN_UNUSED_RETURN;
     KeyFrameSet::iterator refreshDerivatives(CurveChangedReasonEnum reason, KeyFrameSet::iterator key);
     KeyFrameSet::iterator setKeyFrameValueAndTimeNoUpdate(double value, double time, KeyFrameSet::iterator k) WARN_UNUSED_RETURN;
 
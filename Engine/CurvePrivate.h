@@ -32,6 +32,8 @@
 #include <boost/shared_ptr.hpp>
 #endif
 
+#include <vector>
+
 #include <QtCore/QMutex>
 
 #include "Engine/Variant.h"
@@ -40,10 +42,11 @@
 #include "Engine/KnobFile.h"
 #include "Engine/EngineFwd.h"
 
-//#define NATRON_CURVE_USE_CACHE
-
 NATRON_NAMESPACE_ENTER
 
+struct CurveSnapshot;
+typedef boost::shared_ptr<const CurveSnapshot> CurveSnapshotPtr;
+
 struct CurvePrivate
 {
     enum CurveTypeEnum
@@ -58,10 +61,6 @@ struct CurvePrivate
 
     KeyFrameSet keyFrames;
 
-#ifdef NATRON_CURVE_USE_CACHE
-    std::map<double, double> resultCache; //< a cache for interpolations
-#endif
-
     KnobI* owner;
     int dimensionInOwner;
     CurveTypeEnum type;
@@ -71,11 +70,12 @@ struct CurvePrivate
     bool isParametric;
     bool isPeriodic;
 
+    ///The curve as it was when it was last read, or NULL if it changed since.
+    ///Always accessed with boost::atomic_load/atomic_store so that the render threads do not lock.
+    mutable CurveSnapshotPtr snapshot;
+
     CurvePrivate()
         : keyFrames()
-#ifdef NATRON_CURVE_USE_CACHE
-        , resultCache()
-#endif
         , owner(NULL)
         , dimensionInOwner(-1)
         , type(eCurveTypeDouble)
@@ -86,6 +86,7 @@ struct CurvePrivate
         , _lock(QMutex::Recursive)
         , isParametric(false)
         , isPeriodic(false)
+        , snapshot()
     {
     }
 
@@ -107,11 +108,61 @@ struct CurvePrivate
         yMin = other.yMin;
         yMax = other.yMax;
         isPeriodic = other.isPeriodic;
+        invalidateSnapshot();
     }
 
-    
+    /**
+     * @brief Returns the snapshot of the curve, making it if the curve changed since the last call.
+     * This only locks when the snapshot must be made.
+     **/
+    CurveSnapshotPtr getSnapshot() const;
+
+    /**
+     * @brief Must be called with the lock held whenever anything the snapshot depends on is modified.
+     **/
+    void invalidateSnapshot();
+
+private:
+
+    CurveSnapshotPtr makeSnapshot() const;
 };
 
+/**
+ * @brief An immutable copy of a curve which can be evaluated without locking.
+ * The cubic of each segment of the curve is computed when the snapshot is made, so that the evaluation
+ * only has to find the segment in a flat array of keyframe times.
+ **/
+struct CurveSnapshot
+{
+    struct Segment
+    {
+        double tStart, tLength;
+        double c[4];
+    };
+
+    ///The keyframe times, sorted
+    std::vector<double> times;
+
+    ///times.size() + 1 segments: segments[i] is used from times[i - 1] to times[i], the first
+    ///and last segments are used before the first and after the last keyframe.
+    std::vector<Segment> segments;
+    CurvePrivate::CurveTypeEnum type;
+    bool isPeriodic;
+    double xMin, xMax;
+    bool mustClamp;
+
+    ///The Y range of a curve without owner
+    double yMin, yMax;
+
+    /**
+     * @brief Returns the interpolated value at t, before clamping and rounding.
+     * If segmentHint is not NULL, the segment it contains is tried first and it is updated with the segment
+     * used, which makes the evaluation at increasing times faster.
+     **/
+    double interpolate(double t, int* segmentHint) const;
+};
+
+
 NATRON_NAMESPACE_EXIT
 
 #endif // NATRON_ENGINE_CURVEPRIVATE_H
@@ -73,6 +73,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/PluginMemory.h"
 #include "Engine/Project.h"
 #include "Engine/RenderStats.h"
+#include "Engine/RenderTrace.h"
 #include "Engine/RotoContext.h"
 #include "Engine/RotoDrawableItem.h"
 #include "Engine/ReadNode.h"
@@ -1022,8 +1023,11 @@ EffectInstance::getImage(int inputNb,
                     }
                 }
 
+                // The mask is rendered at mipMapLevel, which pixelRoI may not be at
+                RectI maskRoI;
+                roi.toPixelEnclosing(mipMapLevel, 1., &maskRoI);
                 inputImg = attachedStroke->renderMaskFromStroke(components,
-                                                                time, view, depth, mipMapLevel, rotoSrcRod);
+                                                                time, view, depth, mipMapLevel, rotoSrcRod, maskRoI);
 
                 if ( roto->isDoingNeatRender() ) {
                     getApp()->updateStrokeImage(inputImg, 0, false);
@@ -1637,6 +1641,7 @@ EffectInstance::getImageFromCacheAndConvertIfNeeded(bool /*useCache*/,
                                                     const OSGLContextAttacherPtr& glContextAttacher,
                                                     ImagePtr* image)
 {
+    RenderTraceScope trace("getImageFromCache", kRenderTraceCategoryCache, this);
     ImageList cachedImages;
     bool isCached = false;
 
@@ -2183,6 +2188,43 @@ EffectInstance::Implementation::tiledRenderingFunctor(EffectInstance::Implementa
     return ret;
 }
 
+bool
+EffectInstance::Implementation::tiledRenderingTask(const TiledRenderingFunctorArgs* args,
+                                                   const std::vector<RectToRender>* tiles,
+                                                   std::vector<RenderingFunctorRetEnum>* results,
+                                                   int tileIndex)
+{
+    EffectInstance::RenderingFunctorRetEnum ret;
+
+    // The abort info was copied along with the TLS of the thread that launched the render
+    if ( _publicInterface->aborted() ) {
+        ret = eRenderingFunctorRetAborted;
+    } else {
+        ret = tiledRenderingFunctor( (*tiles)[tileIndex],
+                                     args->renderFullScaleThenDownscale,
+                                     args->isSequentialRender,
+                                     args->isRenderResponseToUserInteraction,
+                                     args->firstFrame,
+                                     args->lastFrame,
+                                     args->preferredInput,
+                                     args->mipMapLevel,
+                                     args->renderMappedMipMapLevel,
+                                     args->rod,
+                                     args->time,
+                                     args->view,
+                                     args->par,
+                                     args->byPassCache,
+                                     args->outputClipPrefDepth,
+                                     args->outputClipPrefsComps,
+                                     args->compsNeeded,
+                                     args->processChannels,
+                                     args->planes );
+    }
+    (*results)[tileIndex] = ret;
+
+    return ret == eRenderingFunctorRetOK;
+}
+
 EffectInstance::RenderingFunctorRetEnum
 EffectInstance::Implementation::tiledRenderingFunctor(const RectToRender & rectToRender,
                                                       const bool renderFullScaleThenDownscale,
@@ -2204,6 +2246,8 @@ EffectInstance::Implementation::tiledRenderingFunctor(const RectToRender & rectT
                                                       const std::bitset<4>& processChannels,
                                                       const ImagePlanesToRenderPtr & planes) // when MT, planes is a copy so there's is no data race
 {
+    RenderTraceScope trace("tiledRenderingFunctor", kRenderTraceCategoryRender, _publicInterface);
+
     ///There cannot be the same thread running 2 concurrent instances of renderRoI on the same effect.
 #ifdef DEBUG
     {
@@ -3057,6 +3101,11 @@ EffectInstance::onSignificantEvaluateAboutToBeCalled(KnobI* knob)
     if (isMT) {
         node->refreshIdentityState();
 
+        // A button does not hold any value that would change the content-based hash
+        if ( dynamic_cast<KnobButton*>(knob) ) {
+            node->incrementContentHashAge();
+        }
+
         //Increments the knobs age following a change
         node->incrementKnobsAge();
     }
@@ -3742,6 +3791,7 @@ EffectInstance::render_public(const RenderActionArgs & args)
 {
     NON_RECURSIVE_ACTION();
     REPORT_CURRENT_THREAD_ACTION( kOfxImageEffectActionRender, getNode() );
+    RenderTraceScope trace(kOfxImageEffectActionRender, kRenderTraceCategoryAction, this);
 
     return render(args);
 }
@@ -3804,6 +3854,7 @@ EffectInstance::isIdentity_public(bool useIdentityCache, // only set to true whe
         /// Don't call isIdentity if plugin is sequential only.
         if (getSequentialPreference() != eSequentialPreferenceOnlySequential) {
             try {
+                RenderTraceScope trace(kOfxImageEffectActionIsIdentity, kRenderTraceCategoryAction, this);
                 *inputView = view;
                 ret = isIdentity(time, scale, renderWindow, view, inputTime, inputView, inputNb);
             } catch (...) {
@@ -3906,7 +3957,7 @@ EffectInstance::getRegionOfDefinition_public(U64 hash,
         RenderScale scaleOne(1.);
         {
             RECURSIVE_ACTION();
-
+            RenderTraceScope trace(kOfxImageEffectActionGetRegionOfDefinition, kRenderTraceCategoryAction, this);
 
             ret = getRegionOfDefinition(hash, time, supportsRenderScaleMaybe() == eSupportsNo ? scaleOne : scale, view, rod);
 
@@ -3954,6 +4005,7 @@ EffectInstance::getRegionsOfInterest_public(double time,
     NON_RECURSIVE_ACTION();
     assert(outputRoD.x2 >= outputRoD.x1 && outputRoD.y2 >= outputRoD.y1);
     assert(renderWindow.x2 >= renderWindow.x1 && renderWindow.y2 >= renderWindow.y1);
+    RenderTraceScope trace(kOfxImageEffectActionGetRegionsOfInterest, kRenderTraceCategoryAction, this);
 
     getRegionsOfInterest(time, scale, outputRoD, renderWindow, view, ret);
 }
@@ -3972,6 +4024,7 @@ EffectInstance::getFramesNeeded_public(U64 hash,
     }
 
     try {
+        RenderTraceScope trace(kOfxImageEffectActionGetFramesNeeded, kRenderTraceCategoryAction, this);
         framesNeeded = getFramesNeeded(time, view);
     } catch (std::exception &e) {
         if ( !hasPersistentMessage() ) { // plugin may already have set a message
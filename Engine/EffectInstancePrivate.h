@@ -340,6 +340,16 @@ public:
     RenderingFunctorRetEnum tiledRenderingFunctor(TiledRenderingFunctorArgs & args,  const RectToRender & specificData,
                                                   QThread* callingThread);
 
+    /**
+     * @brief Renders the tile of the given index for the TileScheduler, storing the result in results.
+     * Returns false if the tile could not be rendered, or if the render was aborted, so that the remaining tiles
+     * are not started.
+     **/
+    bool tiledRenderingTask(const TiledRenderingFunctorArgs* args,
+                            const std::vector<RectToRender>* tiles,
+                            std::vector<RenderingFunctorRetEnum>* results,
+                            int tileIndex);
+
     RenderingFunctorRetEnum tiledRenderingFunctor(const RectToRender & rectToRender,
                                                   const bool renderFullScaleThenDownscale,
                                                   const bool isSequentialRender,
@@ -31,6 +31,7 @@
 #include <algorithm> // min, max
 #include <fstream>
 #include <cassert>
+#include <cmath>
 #include <stdexcept>
 #include <sstream> // stringstream
 
@@ -39,7 +40,6 @@
 #include <QtCore/QThreadPool>
 #include <QtCore/QReadWriteLock>
 #include <QtCore/QCoreApplication>
-#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
 #include <QtConcurrentRun> // QtCore on Qt4, QtConcurrent on Qt5
 
 #if !defined(SBK_RUN) && !defined(Q_MOC_RUN)
@@ -71,6 +71,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/PluginMemory.h"
 #include "Engine/Project.h"
 #include "Engine/RenderStats.h"
+#include "Engine/RenderTrace.h"
 #include "Engine/RotoContext.h"
 #include "Engine/RotoDrawableItem.h"
 #include "Engine/Settings.h"
@@ -82,6 +83,10 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
 //#define NATRON_ALWAYS_ALLOCATE_FULL_IMAGE_BOUNDS
 
+// With host frame threading, the rectangles to render are split so that there are about this number of tiles
+// per thread: a thread finishing early picks up the remaining tiles instead of waiting for the slowest one.
+#define NATRON_HOST_FRAME_THREADING_TILES_PER_THREAD 4
+
 
 NATRON_NAMESPACE_ENTER
 
@@ -164,6 +169,43 @@ optimizeRectsToRender(EffectInstance* self,
     }
 } // optimizeRectsToRender
 
+/*
+ * @brief Split the non-identity rectangles to render with host frame threading in about
+ * NATRON_HOST_FRAME_THREADING_TILES_PER_THREAD tiles per thread, proportionally to their area.
+ * The tiles keep the input images and regions of interest of the rectangle they come from, which contain theirs.
+ */
+static void
+splitRectsForHostFrameThreading(const std::list<EffectInstance::RectToRender> & rectsToRender,
+                                int nThreads,
+                                std::vector<EffectInstance::RectToRender>* tiles)
+{
+    double totalArea = 0.;
+
+    for (std::list<EffectInstance::RectToRender>::const_iterator it = rectsToRender.begin(); it != rectsToRender.end(); ++it) {
+        if (!it->isIdentity) {
+            totalArea += (double)it->rect.area();
+        }
+    }
+
+    const int nTiles = std::max(1, nThreads) * NATRON_HOST_FRAME_THREADING_TILES_PER_THREAD;
+    for (std::list<EffectInstance::RectToRender>::const_iterator it = rectsToRender.begin(); it != rectsToRender.end(); ++it) {
+        std::vector<RectI> splits;
+        if ( !it->isIdentity && (totalArea > 0.) ) {
+            int nSplits = (int)std::ceil(nTiles * (double)it->rect.area() / totalArea);
+            splits = it->rect.splitIntoSmallerRects(nSplits);
+        }
+        if (splits.size() <= 1) {
+            tiles->push_back(*it);
+            continue;
+        }
+        for (std::vector<RectI>::const_iterator it2 = splits.begin(); it2 != splits.end(); ++it2) {
+            EffectInstance::RectToRender r = *it;
+            r.rect = *it2;
+            tiles->push_back(r);
+        }
+    }
+} // splitRectsForHostFrameThreading
+
 ImagePtr
 EffectInstance::convertPlanesFormatsIfNeeded(const AppInstancePtr& app,
                                              const ImagePtr& inputImage,
@@ -324,6 +366,8 @@ EffectInstance::RenderRoIRetCode
 EffectInstance::renderRoI(const RenderRoIArgs & args,
                           std::map<ImagePlaneDesc, ImagePtr>* outputPlanes)
 {
+    RenderTraceScope trace("renderRoI", kRenderTraceCategoryRender, this);
+
     //Do nothing if no components were requested
     if ( args.components.empty() ) {
         qDebug() << getScriptName_mt_safe().c_str() << "renderRoi: Early bail-out components requested empty";
@@ -1873,6 +1917,7 @@ EffectInstance::renderRoIInternal(EffectInstance* self,
                                   const ComponentsNeededMapPtr & compsNeeded,
                                   const std::bitset<4> processChannels)
 {
+    RenderTraceScope trace("renderRoIInternal", kRenderTraceCategoryRender, self);
     EffectInstance::RenderRoIStatusEnum retCode;
 
     assert( !planesToRender->planes.empty() );
@@ -1961,10 +2006,11 @@ EffectInstance::renderRoIInternal(EffectInstance* self,
 
 
     if (renderStatus != eRenderingFunctorRetFailed) {
-        if ( (safety == eRenderSafetyFullySafeFrame) && (planesToRender->rectsToRender.size() > 1) && !planesToRender->useOpenGL ) {
-            QThread* currentThread = QThread::currentThread();
+        // A single rectangle is also scheduled: it is split in tiles below
+        if ( (safety == eRenderSafetyFullySafeFrame) && !planesToRender->rectsToRender.empty() && !planesToRender->useOpenGL ) {
             boost::scoped_ptr<Implementation::TiledRenderingFunctorArgs> tiledArgs(new Implementation::TiledRenderingFunctorArgs);
             tiledArgs->renderFullScaleThenDownscale = renderFullScaleThenDownscale;
+            tiledArgs->isSequentialRender = isSequentialRender;
             tiledArgs->isRenderResponseToUserInteraction = isRenderMadeInResponseToUserInteraction;
             tiledArgs->firstFrame = firstFrame;
             tiledArgs->lastFrame = lastFrame;
@@ -1984,6 +2030,7 @@ EffectInstance::renderRoIInternal(EffectInstance* self,
 
 
 #ifdef NATRON_HOSTFRAMETHREADING_SEQUENTIAL
+            QThread* currentThread = QThread::currentThread();
             std::vector<EffectInstance::RenderingFunctorRetEnum> ret( tiledData.size() );
             int i = 0;
             for (std::list<RectToRender>::const_iterator it = planesToRender->rectsToRender.begin(); it != planesToRender->rectsToRender.end(); ++it, ++i) {
@@ -1995,15 +2042,22 @@ EffectInstance::renderRoIInternal(EffectInstance* self,
 
 #else
 
-
-            QFuture<RenderingFunctorRetEnum> ret = QtConcurrent::mapped( planesToRender->rectsToRender,
-                                                                         boost::bind(&EffectInstance::Implementation::tiledRenderingFunctor,
-                                                                                     self->_imp.get(),
-                                                                                     *tiledArgs,
-                                                                                     _1,
-                                                                                     currentThread) );
-            ret.waitForFinished();
-            QFuture<EffectInstance::RenderingFunctorRetEnum>::const_iterator it2;
+            // This thread renders tiles along with the idle threads of the pool instead of waiting for them
+            std::vector<RectToRender> tiles;
+            splitRectsForHostFrameThreading( planesToRender->rectsToRender, QThreadPool::globalInstance()->maxThreadCount(), &tiles );
+            std::vector<EffectInstance::RenderingFunctorRetEnum> ret(tiles.size(), eRenderingFunctorRetOK);
+            {
+                TileScheduler scheduler( (int)tiles.size(),
+                                         boost::bind(&EffectInstance::Implementation::tiledRenderingTask,
+                                                     self->_imp.get(),
+                                                     tiledArgs.get(),
+                                                     &tiles,
+                                                     &ret,
+                                                     _1) );
+                // Failures are reported by the tiles results below
+                ignore_result( scheduler.run() );
+            }
+            std::vector<EffectInstance::RenderingFunctorRetEnum>::const_iterator it2;
 
 #endif
             for (it2 = ret.begin(); it2 != ret.end(); ++it2) {
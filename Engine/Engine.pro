@@ -75,8 +75,11 @@ SOURCES += \
     Bezier.cpp \
     BezierCP.cpp \
     BlockingBackgroundRender.cpp \
+    BufferPool.cpp \
     CLArgs.cpp \
     Cache.cpp \
+    CacheCompression.cpp \
+    CacheJournal.cpp \
     CoonsRegularization.cpp \
     CreateNodeArgs.cpp \
     Curve.cpp \
@@ -123,6 +126,8 @@ SOURCES += \
     Markdown.cpp \
     MemoryFile.cpp \
     MemoryInfo.cpp \
+    MipMapKernels.cpp \
+    NativeExpression.cpp \
     NoOpBase.cpp \
     Node.cpp \
     NodeDocumentation.cpp \
@@ -164,6 +169,7 @@ SOURCES += \
     PyNode.cpp \
     PyNodeGroup.cpp \
     PyParameter.cpp \
+    PyPlugCache.cpp \
     PyRoto.cpp \
     PySideCompat.cpp \
     PyTracker.cpp \
@@ -171,12 +177,14 @@ SOURCES += \
     RectD.cpp \
     RectI.cpp \
     RenderStats.cpp \
+    RenderTrace.cpp \
     RotoContext.cpp \
     RotoDrawableItem.cpp \
     RotoItem.cpp \
     RotoLayer.cpp \
     RotoPaint.cpp \
     RotoPaintInteract.cpp \
+    RotoRasterizer.cpp \
     RotoSmear.cpp \
     RotoStrokeItem.cpp \
     RotoUndoCommand.cpp \
@@ -201,6 +209,7 @@ SOURCES += \
     Transform.cpp \
     Utils.cpp \
     ViewerInstance.cpp \
+    ViewerTextureKernels.cpp \
     WriteNode.cpp \
     ../Global/glad_source.c \
     ../Global/FStreamsSupport.cpp \
@@ -270,11 +279,14 @@ HEADERS += \
     BezierCPSerialization.h \
     BezierSerialization.h \
     BlockingBackgroundRender.h \
+    BufferPool.h \
     BufferableObject.h \
     CLArgs.h \
     Cache.h \
+    CacheCompression.h \
     CacheEntry.h \
     CacheEntryHolder.h \
+    CacheJournal.h \
     CacheSerialization.h \
     ChoiceOption.h \
     CoonsRegularization.h \
@@ -308,6 +320,7 @@ HEADERS += \
     GroupInput.h \
     GroupOutput.h \
     Hash64.h \
+    HashCone.h \
     HistogramCPU.h \
     HostOverlaySupport.h \
     Image.h \
@@ -336,6 +349,8 @@ HEADERS += \
     MemoryFile.h \
     MemoryInfo.h \
     MergingEnum.h \
+    MipMapKernels.h \
+    NativeExpression.h \
     NoOpBase.h \
     Node.h \
     NodeGraphI.h \
@@ -380,6 +395,7 @@ HEADERS += \
     PyNode.h \
     PyNodeGroup.h \
     PyParameter.h \
+    PyPlugCache.h \
     PyRoto.h \
     PyTracker.h \
     Pyside_Engine_Python.h \
@@ -389,6 +405,7 @@ HEADERS += \
     RectI.h \
     RectISerialization.h \
     RenderStats.h \
+    RenderTrace.h \
     RotoContext.h \
     RotoContextPrivate.h \
     RotoContextSerialization.h \
@@ -401,6 +418,7 @@ HEADERS += \
     RotoPaint.h \
     RotoPaintInteract.h \
     RotoPoint.h \
+    RotoRasterizer.h \
     RotoSmear.h \
     RotoStrokeItem.h \
     RotoStrokeItemSerialization.h \
@@ -438,6 +456,7 @@ HEADERS += \
     ViewIdx.h \
     ViewerInstance.h \
     ViewerInstancePrivate.h \
+    ViewerTextureKernels.h \
     WriteNode.h \
     fstream_mingw.h \
     ../Global/Enums.h \
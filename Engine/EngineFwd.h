@@ -194,6 +194,7 @@ class KnobTable;
 class LibraryBinary;
 class LogEntry;
 class MemoryFile;
+class NativeExpression;
 class Node;
 class NodeCollection;
 class NodeFrameRequest;
@@ -245,9 +246,11 @@ class RotoLayerSerialization;
 class RotoPaint;
 class RotoPaintInteract;
 class RotoPoint;
+class RotoRasterizer;
 class RotoStrokeItem;
 class RotoStrokeItemSerialization;
 class Settings;
+class SharedFrameRequest;
 class StringAnimationManager;
 class TLSHolderBase;
 class Texture;
@@ -379,6 +382,7 @@ typedef boost::shared_ptr<KnobString> KnobStringPtr;
 typedef boost::shared_ptr<KnobTLSData> KnobTLSDataPtr;
 typedef boost::shared_ptr<KnobTable> KnobTablePtr;
 typedef boost::shared_ptr<MemoryFile> MemoryFilePtr;
+typedef boost::shared_ptr<const NativeExpression> NativeExpressionPtr;
 typedef boost::shared_ptr<Node> NodePtr;
 typedef boost::shared_ptr<NodeCollection> NodeCollectionPtr;
 typedef boost::shared_ptr<NodeFrameRequest> NodeFrameRequestPtr;
@@ -413,6 +417,7 @@ typedef boost::shared_ptr<RotoPaintInteract> RotoPaintInteractPtr;
 typedef boost::shared_ptr<RotoStrokeItem> RotoStrokeItemPtr;
 typedef boost::shared_ptr<RotoStrokeItemSerialization> RotoStrokeItemSerializationPtr;
 typedef boost::shared_ptr<Settings> SettingsPtr;
+typedef boost::shared_ptr<SharedFrameRequest> SharedFrameRequestPtr;
 typedef boost::shared_ptr<TLSHolderBase const> TLSHolderBaseConstPtr;
 typedef boost::shared_ptr<Texture> GLTexturePtr;
 typedef boost::shared_ptr<Texture> TexturePtr;
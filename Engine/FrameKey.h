@@ -118,6 +118,20 @@ public:
         return _textureRect;
     }
 
+    /**
+     * @brief Changes the display transform of the key, to look up the same texture converted with another
+     * gain, gamma or lut.
+     **/
+    void setDisplayTransform(double gain,
+                             double gamma,
+                             int lut)
+    {
+        _gain = gain;
+        _gamma = gamma;
+        _lut = lut;
+        resetHash();
+    }
+
     template<class Archive>
     void serialize(Archive & ar, const unsigned int version);
 
@@ -25,37 +25,35 @@
 
 #include "Hash64.h"
 
-#include <algorithm>  // for std::for_each
-#include <cassert>
-#include <stdexcept>
-
-#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
-#include <boost/crc.hpp>
-#endif
 #include <QtCore/QString>
 
-#include "Engine/Node.h"
-
 NATRON_NAMESPACE_ENTER
 
 void
 Hash64::computeHash()
 {
-    if ( node_values.empty() ) {
+    if (nValues == 0) {
         return;
     }
 
-    const unsigned char* data = reinterpret_cast<const unsigned char*>( &node_values.front() );
-    boost::crc_optimal<64, 0x42F0E1EBA9EA3693ULL, 0, 0, false, false> crc_64;
-    crc_64 = std::for_each( data, data + node_values.size() * sizeof(node_values[0]), crc_64 );
-    hash = crc_64();
+    // xxHash64 avalanche, mixing in the number of bytes appended
+    U64 h = state + nValues * 8;
+    h ^= h >> 33;
+    h *= 0xC2B2AE3D27D4EB4FULL;
+    h ^= h >> 29;
+    h *= 0x165667B19E3779F9ULL;
+    h ^= h >> 32;
+
+    // 0 is the invalid hash
+    hash = h ? h : 1;
 }
 
 void
 Hash64::reset()
 {
-    node_values.clear();
     hash = 0;
+    state = 0x27D4EB2F165667C5ULL; // xxHash64 PRIME64_5, the state for a seed of 0
+    nValues = 0;
 }
 
 void
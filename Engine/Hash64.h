@@ -44,17 +44,20 @@ NATRON_NAMESPACE_ENTER
     - the hash values for the  tree upstream
  */
 
+/**
+ * @brief The values appended to the hash are mixed right away in a 64-bit state (using the xxHash64 round
+ * for 8-byte lanes), so that appending never allocates and computeHash() only has to finalize the state.
+ **/
 class Hash64
 {
 public:
     Hash64()
     {
-        hash = 0;
+        reset();
     }
 
     ~Hash64()
     {
-        node_values.clear();
     }
 
     U64 value() const
@@ -87,7 +90,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
     template<typename T>
     void append(T value)
     {
-        node_values.push_back( toU64(value) );
+        appendU64( toU64(value) );
     }
 
     bool operator== (const Hash64 & h) const
@@ -116,8 +119,24 @@ private:
         };
     };
 
+    static U64 rotateLeft(U64 x,
+                          int r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    void appendU64(U64 value)
+    {
+        U64 lane = value * 0xC2B2AE3D27D4EB4FULL;
+
+        lane = rotateLeft(lane, 31) * 0x9E3779B185EBCA87ULL;
+        state = rotateLeft(state ^ lane, 27) * 0x9E3779B185EBCA87ULL + 0x85EBCA77C2B2AE63ULL;
+        ++nValues;
+    }
+
     U64 hash;
-    std::vector<U64> node_values;
+    U64 state;
+    U64 nValues;
 };
 
 void Hash64_appendQString(Hash64* hash, const QString & str);
@@ -0,0 +1,136 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_HASHCONE_H
+#define NATRON_ENGINE_HASHCONE_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstddef>
+#include <map>
+#include <utility>
+#include <vector>
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Propagates a change of the hash of some nodes of a graph to the nodes downstream, used by Node::computeHash.
+ * The nodes downstream of the changed nodes are sorted in topological order (reverse post-order of a depth-first
+ * traversal), so that a node is recomputed after all of the nodes it depends on and at most once, and only if the hash
+ * of one of them changed: the propagation stops wherever the hash remains the same.
+ * The traversal is iterative since graphs may be very deep.
+ *
+ * DependentsFunctor must provide void operator()(NodeT node, std::vector<NodeT>* dependents), returning the nodes whose
+ * hash depends on the hash of node.
+ * RecomputeFunctor must provide bool operator()(NodeT node), recomputing the hash of node and returning true if it changed.
+ **/
+template <typename NodeT>
+class HashCone
+{
+    struct ConeNode
+    {
+        // The nodes whose hash depends on the hash of this node
+        std::vector<NodeT> dependents;
+
+        // True if the hash of a node this node depends on has changed
+        bool dirty;
+
+        // True if the hash of this node has changed
+        bool changed;
+
+        ConeNode()
+            : dependents()
+            , dirty(false)
+            , changed(false)
+        {
+        }
+    };
+
+public:
+
+    /**
+     * @brief Recomputes the nodes downstream of changedNodes, whose hash has changed, and returns the number of nodes
+     * recomputed.
+     **/
+    template <typename DependentsFunctor, typename RecomputeFunctor>
+    static int propagate(const std::vector<NodeT>& changedNodes,
+                         DependentsFunctor getDependents,
+                         RecomputeFunctor recompute)
+    {
+        typedef std::map<NodeT, ConeNode> ConeMap;
+        ConeMap cone;
+        std::vector<NodeT> postOrder;
+        std::vector<std::pair<NodeT, std::size_t> > stack;
+
+        for (typename std::vector<NodeT>::const_iterator it = changedNodes.begin(); it != changedNodes.end(); ++it) {
+            if ( cone.find(*it) != cone.end() ) {
+                continue;
+            }
+            getDependents(*it, &cone[*it].dependents);
+            stack.push_back( std::make_pair(*it, (std::size_t)0) );
+            while ( !stack.empty() ) {
+                NodeT node = stack.back().first;
+                const std::vector<NodeT>& dependents = cone[node].dependents;
+                if ( stack.back().second < dependents.size() ) {
+                    NodeT dependent = dependents[stack.back().second];
+                    ++stack.back().second;
+                    if ( cone.find(dependent) == cone.end() ) {
+                        getDependents(dependent, &cone[dependent].dependents);
+                        stack.push_back( std::make_pair(dependent, (std::size_t)0) );
+                    }
+                } else {
+                    postOrder.push_back(node);
+                    stack.pop_back();
+                }
+            }
+        }
+        for (typename std::vector<NodeT>::const_iterator it = changedNodes.begin(); it != changedNodes.end(); ++it) {
+            cone[*it].changed = true;
+        }
+
+        int nRecomputed = 0;
+        for (typename std::vector<NodeT>::reverse_iterator it = postOrder.rbegin(); it != postOrder.rend(); ++it) {
+            ConeNode& coneNode = cone[*it];
+            // The changed nodes are recomputed again if a node they depend on changed after them
+            if (coneNode.dirty) {
+                ++nRecomputed;
+                if ( recompute(*it) ) {
+                    coneNode.changed = true;
+                }
+            }
+            if (coneNode.changed) {
+                for (typename std::vector<NodeT>::const_iterator it2 = coneNode.dependents.begin(); it2 != coneNode.dependents.end(); ++it2) {
+                    cone[*it2].dirty = true;
+                }
+            }
+        }
+
+        return nRecomputed;
+    } // propagate
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_HASHCONE_H
@@ -41,107 +41,269 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/AppManager.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/GPUContextPool.h"
+#include "Engine/MipMapKernels.h"
 #include "Engine/OSGLContext.h"
+#include "Engine/RenderTrace.h"
 #include "Engine/GLShader.h"
 
 NATRON_NAMESPACE_ENTER
 
-#define BM_GET(i, j) (&_map[( i - _bounds.bottom() ) * _bounds.width() + ( j - _bounds.left() )])
-
 #define PIXEL_UNAVAILABLE 2
 
+#define BITMAP_PIXELS_PER_WORD 32
+
+// The low bit of the state of each pixel of a word
+#define BITMAP_LOW_BITS 0x5555555555555555ULL
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+enum BitmapTestEnum
+{
+    eBitmapTestZero = 0, // not rendered
+    eBitmapTestOne, // rendered
+    eBitmapTestNonZero, // rendered or being rendered
+    eBitmapTestNotOne, // not rendered or being rendered
+    eBitmapTestUnavailable // being rendered
+};
+
+/**
+ * @brief Returns the low bit of the states of the pixels of the word passing the given test
+ **/
+inline U64
+bitmapTestWord(U64 word,
+               BitmapTestEnum test)
+{
+    const U64 lo = word & BITMAP_LOW_BITS;
+    const U64 hi = (word >> 1) & BITMAP_LOW_BITS;
+
+    switch (test) {
+    case eBitmapTestZero:
+        return ~(lo | hi) & BITMAP_LOW_BITS;
+    case eBitmapTestOne:
+        return lo & ~hi;
+    case eBitmapTestNonZero:
+        return lo | hi;
+    case eBitmapTestNotOne:
+        return ~(lo & ~hi) & BITMAP_LOW_BITS;
+    case eBitmapTestUnavailable:
+        return hi & ~lo;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Mask of the 2 bits of the pixels [first, last) of a word
+ **/
+inline U64
+bitmapPixelsMask(int first,
+                 int last)
+{
+    assert(0 <= first && first < last && last <= BITMAP_PIXELS_PER_WORD);
+    U64 mask = (last == BITMAP_PIXELS_PER_WORD) ? ~(U64)0 : ( ( (U64)1 << (last * 2) ) - 1 );
+
+    return mask & ~( ( (U64)1 << (first * 2) ) - 1 );
+}
+
+inline int
+bitmapCountTrailingZeros(U64 v)
+{
+    assert(v);
+#if defined(__GNUC__)
+    return __builtin_ctzll(v);
+#else
+    int n = 0;
+    while ( !(v & 1) ) {
+        v >>= 1;
+        ++n;
+    }
+
+    return n;
+#endif
+}
+
+inline int
+bitmapCountLeadingZeros(U64 v)
+{
+    assert(v);
+#if defined(__GNUC__)
+    return __builtin_clzll(v);
+#else
+    int n = 0;
+    while ( !( v & ( (U64)1 << 63 ) ) ) {
+        v <<= 1;
+        ++n;
+    }
+
+    return n;
+#endif
+}
+
+/**
+ * @brief Read-only view of the rows of a bitmap, in the coordinates of the image
+ **/
+struct BitmapRows
+{
+    const U64* map;
+    int rowWords;
+    RectI bounds;
+
+    BitmapRows(const std::vector<U64>& map,
+               int rowWords,
+               const RectI& bounds)
+        : map( map.empty() ? 0 : &map.front() )
+        , rowWords(rowWords)
+        , bounds(bounds)
+    {
+    }
+
+    char pixel(int x,
+               int y) const
+    {
+        int col = x - bounds.x1;
+
+        return (char)( ( map[(y - bounds.y1) * rowWords + (col >> 5)] >> ( (col & 31) * 2 ) ) & 3 );
+    }
+
+    /**
+     * @brief Returns the first x in [x1, x2) of the row y whose pixel passes the test, or x2 if there is none
+     **/
+    int findFirst(int y,
+                  int x1,
+                  int x2,
+                  BitmapTestEnum test) const
+    {
+        if (x1 >= x2) {
+            return x2;
+        }
+        const U64* row = map + (y - bounds.y1) * rowWords;
+        const int c1 = x1 - bounds.x1;
+        const int c2 = x2 - bounds.x1;
+        const int lastWord = (c2 - 1) / BITMAP_PIXELS_PER_WORD;
+        for (int w = c1 / BITMAP_PIXELS_PER_WORD; w <= lastWord; ++w) {
+            const int wordStart = w * BITMAP_PIXELS_PER_WORD;
+            U64 m = bitmapTestWord(row[w], test);
+            if ( (c1 > wordStart) || (c2 < wordStart + BITMAP_PIXELS_PER_WORD) ) {
+                m &= bitmapPixelsMask( std::max(c1 - wordStart, 0), std::min(c2 - wordStart, BITMAP_PIXELS_PER_WORD) );
+            }
+            if (m) {
+                return bounds.x1 + wordStart + bitmapCountTrailingZeros(m) / 2;
+            }
+        }
+
+        return x2;
+    }
+
+    /**
+     * @brief Returns the last x in [x1, x2) of the row y whose pixel passes the test, or x1 - 1 if there is none
+     **/
+    int findLast(int y,
+                 int x1,
+                 int x2,
+                 BitmapTestEnum test) const
+    {
+        if (x1 >= x2) {
+            return x1 - 1;
+        }
+        const U64* row = map + (y - bounds.y1) * rowWords;
+        const int c1 = x1 - bounds.x1;
+        const int c2 = x2 - bounds.x1;
+        const int firstWord = c1 / BITMAP_PIXELS_PER_WORD;
+        for (int w = (c2 - 1) / BITMAP_PIXELS_PER_WORD; w >= firstWord; --w) {
+            const int wordStart = w * BITMAP_PIXELS_PER_WORD;
+            U64 m = bitmapTestWord(row[w], test);
+            if ( (c1 > wordStart) || (c2 < wordStart + BITMAP_PIXELS_PER_WORD) ) {
+                m &= bitmapPixelsMask( std::max(c1 - wordStart, 0), std::min(c2 - wordStart, BITMAP_PIXELS_PER_WORD) );
+            }
+            if (m) {
+                return bounds.x1 + wordStart + (63 - bitmapCountLeadingZeros(m) ) / 2;
+            }
+        }
+
+        return x1 - 1;
+    }
+
+    bool contains(int y,
+                  int x1,
+                  int x2,
+                  BitmapTestEnum test) const
+    {
+        return findFirst(y, x1, x2, test) < x2;
+    }
+};
+
+/**
+ * @brief Returns the 32 pixels of the row starting at the given column. Pixels past the end of the row are 0.
+ **/
+inline U64
+bitmapReadPixels(const U64* row,
+                 int rowWords,
+                 int col)
+{
+    const int w = col / BITMAP_PIXELS_PER_WORD;
+    const int shift = (col % BITMAP_PIXELS_PER_WORD) * 2;
+    U64 ret = row[w] >> shift;
+
+    if ( shift && (w + 1 < rowWords) ) {
+        ret |= row[w + 1] << (64 - shift);
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Divisions by 2 rounding towards -infinity and +infinity, also for negative coordinates
+ **/
+inline int
+floorHalf(int x)
+{
+    return (x >= 0) ? x / 2 : -( (-x + 1) / 2 );
+}
+
+inline int
+ceilHalf(int x)
+{
+    return -floorHalf(-x);
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+
 template <int trimap>
 RectI
 minimalNonMarkedBbox_internal(const RectI& roi,
-                              const RectI& _bounds,
-                              const std::vector<char>& _map,
+                              const BitmapRows& bm,
                               bool* isBeingRenderedElsewhere)
 {
     RectI bbox;
 
-    assert( _bounds.contains(roi) );
+    assert( bm.bounds.contains(roi) );
     bbox = roi;
 
+    // A row or column is skipped if it has no pixel to render: with the trimap, pixels being rendered elsewhere
+    // do not need to be rendered but the caller is told to wait for them
+    const BitmapTestEnum toRender = trimap ? eBitmapTestZero : eBitmapTestNotOne;
+
     //find bottom
     for (int i = bbox.bottom(); i < bbox.top(); ++i) {
-        const char* buf = BM_GET( i, bbox.left() );
-
-        if (trimap) {
-            const char* lineEnd = buf + bbox.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (!*buf) {
-                    buf = 0;
-                    break;
-                } else if (*buf == PIXEL_UNAVAILABLE) {
-                    metUnavailablePixel = true;
-                }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else if (metUnavailablePixel) {
-                *isBeingRenderedElsewhere = true; //< only flag if the whole row is not 0
-                ++bbox.y1;
-            } else {
-                ++bbox.y1;
-            }
-        } else {
-            const char* lineEnd = buf + bbox.width();
-            while (buf < lineEnd) {
-                if ( !*buf || (*buf == PIXEL_UNAVAILABLE) ) {
-                    buf = 0;
-                    break;
-                }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else {
-                ++bbox.y1;
-            }
+        if ( bm.contains(i, bbox.left(), bbox.right(), toRender) ) {
+            break;
         }
+        if ( trimap && bm.contains(i, bbox.left(), bbox.right(), eBitmapTestUnavailable) ) {
+            *isBeingRenderedElsewhere = true; //< only flag if the whole row is not 0
+        }
+        ++bbox.y1;
     }
 
     //find top (will do zero iteration if the bbox is already empty)
     for (int i = bbox.top() - 1; i >= bbox.bottom(); --i) {
-        const char* buf = BM_GET( i, bbox.left() );
-
-        if (trimap) {
-            const char* lineEnd = buf + bbox.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (!*buf) {
-                    buf = 0;
-                    break;
-                } else if (*buf == PIXEL_UNAVAILABLE) {
-                    metUnavailablePixel = true;
-                }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else if (metUnavailablePixel) {
-                *isBeingRenderedElsewhere = true; //< only flag if the whole row is not 0
-                --bbox.y2;
-            } else {
-                --bbox.y2;
-            }
-        } else {
-            const char* lineEnd = buf + bbox.width();
-            while (buf < lineEnd) {
-                if ( !*buf || (*buf == PIXEL_UNAVAILABLE) ) {
-                    buf = 0;
-                    break;
-                }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else {
-                --bbox.y2;
-            }
+        if ( bm.contains(i, bbox.left(), bbox.right(), toRender) ) {
+            break;
+        }
+        if ( trimap && bm.contains(i, bbox.left(), bbox.right(), eBitmapTestUnavailable) ) {
+            *isBeingRenderedElsewhere = true; //< only flag if the whole row is not 0
         }
+        --bbox.y2;
     }
 
     // avoid making bbox.width() iterations for nothing
@@ -149,61 +311,28 @@ minimalNonMarkedBbox_internal(const RectI& roi,
         return bbox;
     }
 
-    //find left
-    for (int j = bbox.left(); j < bbox.right(); ++j) {
-        const char* pix = BM_GET(bbox.bottom(), j);
-        bool metUnavailablePixel = false;
-
-        for ( int i = bbox.bottom(); i < bbox.top(); ++i, pix += _bounds.width() ) {
-            if (!*pix) {
-                pix = 0;
-                break;
-            } else if (*pix == PIXEL_UNAVAILABLE) {
-                if (trimap) {
-                    metUnavailablePixel = true;
-                } else {
-                    pix = 0;
-                    break;
-                }
-            }
-        }
-        if (pix) {
-            ++bbox.x1;
-            if (trimap && metUnavailablePixel) {
-                *isBeingRenderedElsewhere = true; //< only flag is the whole column is not 0
-            }
-        } else {
-            break;
-        }
-    }
-
-    //find right
-    for (int j = bbox.right() - 1; j >= bbox.left(); --j) {
-        const char* pix = BM_GET(bbox.bottom(), j);
-        bool metUnavailablePixel = false;
-
-        for ( int i = bbox.bottom(); i < bbox.top(); ++i, pix += _bounds.width() ) {
-            if (!*pix) {
-                pix = 0;
+    // find left and right: the first and last columns having a pixel to render in any row
+    int left = bbox.right();
+    int right = bbox.left() - 1;
+    for (int i = bbox.bottom(); i < bbox.top(); ++i) {
+        left = std::min( left, bm.findFirst(i, bbox.left(), left, toRender) );
+        right = std::max( right, bm.findLast(i, right + 1, bbox.right(), toRender) );
+    }
+    // the bottom row has a pixel to render
+    assert( left < bbox.right() && right >= left );
+
+    if (trimap) {
+        for (int i = bbox.bottom(); i < bbox.top(); ++i) {
+            //< only flag is the whole column is not 0
+            if ( bm.contains(i, bbox.left(), left, eBitmapTestUnavailable) ||
+                 bm.contains(i, right + 1, bbox.right(), eBitmapTestUnavailable) ) {
+                *isBeingRenderedElsewhere = true;
                 break;
-            } else if (*pix == PIXEL_UNAVAILABLE) {
-                if (trimap) {
-                    metUnavailablePixel = true;
-                } else {
-                    pix = 0;
-                    break;
-                }
-            }
-        }
-        if (pix) {
-            --bbox.x2;
-            if (trimap && metUnavailablePixel) {
-                *isBeingRenderedElsewhere = true; //< only flag is the whole column is not 0
             }
-        } else {
-            break;
         }
     }
+    bbox.x1 = left;
+    bbox.x2 = right + 1;
 
     return bbox;
 } // minimalNonMarkedBbox_internal
@@ -212,12 +341,12 @@ minimalNonMarkedBbox_internal(const RectI& roi,
 template <int trimap>
 void
 minimalNonMarkedRects_internal(const RectI & roi,
-                               const RectI& _bounds,
-                               const std::vector<char>& _map,
+                               const BitmapRows& bm,
                                std::list<RectI>& ret,
                                bool* isBeingRenderedElsewhere)
 {
     assert(ret.empty());
+    const RectI& _bounds = bm.bounds;
     ///Any out of bounds portion is pushed to the rectangles to render
     RectI intersection;
 
@@ -251,7 +380,7 @@ minimalNonMarkedRects_internal(const RectI & roi,
         return;
     }
 
-    RectI bboxM = minimalNonMarkedBbox_internal<trimap>(intersection, _bounds, _map, isBeingRenderedElsewhere);
+    RectI bboxM = minimalNonMarkedBbox_internal<trimap>(intersection, bm, isBeingRenderedElsewhere);
     assert( (trimap && isBeingRenderedElsewhere) || (!trimap && !isBeingRenderedElsewhere) );
 
     //#define NATRON_BITMAP_DISABLE_OPTIMIZATION
@@ -285,44 +414,25 @@ minimalNonMarkedRects_internal(const RectI & roi,
     // CXXXXXXXXXXDDD
     // AAAAAAAAAAAAAA
 
+    // The rectangles end on the first pixel that is rendered. With the trimap, they also end on the first
+    // pixel being rendered elsewhere, in which case the caller is told to wait for it.
+    const BitmapTestEnum rendered = trimap ? eBitmapTestNonZero : eBitmapTestOne;
+
     // First, find if there's an "A" rectangle, and push it to the result
     //find bottom
     RectI bboxX = bboxM;
     RectI bboxA = bboxX;
     bboxA.set_top( bboxX.bottom() );
     for (int i = bboxX.bottom(); i < bboxX.top(); ++i) {
-        const char* buf = BM_GET( i, bboxX.left() );
-        if (trimap) {
-            const char* lineEnd = buf + bboxX.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (*buf == 1) {
-                    buf = 0;
-                    break;
-                } else if ( (*buf == PIXEL_UNAVAILABLE) && trimap ) {
-                    buf = 0;
-                    metUnavailablePixel = true;
-                    break;
-                }
-                ++buf;
-            }
-            if (buf) {
-                ++bboxX.y1;
-                bboxA.y2 = bboxX.y1;
-            } else {
-                if (metUnavailablePixel) {
-                    *isBeingRenderedElsewhere = true;
-                }
-                break;
-            }
-        } else {
-            if ( !memchr( buf, 1, bboxX.width() ) ) {
-                ++bboxX.y1;
-                bboxA.y2 = bboxX.y1;
-            } else {
-                break;
+        int x = bm.findFirst(i, bboxX.left(), bboxX.right(), rendered);
+        if ( x < bboxX.right() ) {
+            if ( trimap && (bm.pixel(x, i) == PIXEL_UNAVAILABLE) ) {
+                *isBeingRenderedElsewhere = true;
             }
+            break;
         }
+        ++bboxX.y1;
+        bboxA.y2 = bboxX.y1;
     }
     if ( !bboxA.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxA);
@@ -333,72 +443,39 @@ minimalNonMarkedRects_internal(const RectI & roi,
     RectI bboxB = bboxX;
     bboxB.set_bottom( bboxX.top() );
     for (int i = bboxX.top() - 1; i >= bboxX.bottom(); --i) {
-        const char* buf = BM_GET( i, bboxX.left() );
-
-        if (trimap) {
-            const char* lineEnd = buf + bboxX.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (*buf == 1) {
-                    buf = 0;
-                    break;
-                } else if ( (*buf == PIXEL_UNAVAILABLE) && trimap ) {
-                    buf = 0;
-                    metUnavailablePixel = true;
-                    break;
-                }
-                ++buf;
-            }
-            if (buf) {
-                --bboxX.y2;
-                bboxB.y1 = bboxX.y2;
-            } else {
-                if (metUnavailablePixel) {
-                    *isBeingRenderedElsewhere = true;
-                }
-                break;
-            }
-        } else {
-            if ( !memchr( buf, 1, bboxX.width() ) ) {
-                --bboxX.y2;
-                bboxB.y1 = bboxX.y2;
-            } else {
-                break;
+        int x = bm.findFirst(i, bboxX.left(), bboxX.right(), rendered);
+        if ( x < bboxX.right() ) {
+            if ( trimap && (bm.pixel(x, i) == PIXEL_UNAVAILABLE) ) {
+                *isBeingRenderedElsewhere = true;
             }
+            break;
         }
+        --bboxX.y2;
+        bboxB.y1 = bboxX.y2;
     }
     if ( !bboxB.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxB);
     }
 
-    //find left
+    //find left: the first column with a rendered pixel. Columns are scanned from the bottom, so on ties the
+    //lowest row tells whether the pixel ending the rectangle is being rendered elsewhere.
     RectI bboxC = bboxX;
     bboxC.set_right( bboxX.left() );
     if ( bboxX.bottom() < bboxX.top() ) {
-        for (int j = bboxX.left(); j < bboxX.right(); ++j) {
-            const char* pix = BM_GET(bboxX.bottom(), j);
-            bool metUnavailablePixel = false;
-
-            for ( int i = bboxX.bottom(); i < bboxX.top(); ++i, pix += _bounds.width() ) {
-                if (*pix == 1) {
-                    pix = 0;
-                    break;
-                } else if ( trimap && (*pix == PIXEL_UNAVAILABLE) ) {
-                    pix = 0;
-                    metUnavailablePixel = true;
-                    break;
-                }
-            }
-            if (pix) {
-                ++bboxX.x1;
-                bboxC.x2 = bboxX.x1;
-            } else {
-                if (metUnavailablePixel) {
-                    *isBeingRenderedElsewhere = true;
-                }
-                break;
+        int left = bboxX.right();
+        int leftRow = bboxX.bottom();
+        for (int i = bboxX.bottom(); i < bboxX.top(); ++i) {
+            int x = bm.findFirst(i, bboxX.left(), left, rendered);
+            if (x < left) {
+                left = x;
+                leftRow = i;
             }
         }
+        if ( trimap && ( left < bboxX.right() ) && (bm.pixel(left, leftRow) == PIXEL_UNAVAILABLE) ) {
+            *isBeingRenderedElsewhere = true;
+        }
+        bboxX.x1 = left;
+        bboxC.x2 = bboxX.x1;
     }
     if ( !bboxC.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxC);
@@ -408,30 +485,20 @@ minimalNonMarkedRects_internal(const RectI & roi,
     RectI bboxD = bboxX;
     bboxD.set_left( bboxX.right() );
     if ( bboxX.bottom() < bboxX.top() ) {
-        for (int j = bboxX.right() - 1; j >= bboxX.left(); --j) {
-            const char* pix = BM_GET(bboxX.bottom(), j);
-            bool metUnavailablePixel = false;
-
-            for ( int i = bboxX.bottom(); i < bboxX.top(); ++i, pix += _bounds.width() ) {
-                if (*pix == 1) {
-                    pix = 0;
-                    break;
-                } else if ( trimap && (*pix == PIXEL_UNAVAILABLE) ) {
-                    pix = 0;
-                    metUnavailablePixel = true;
-                    break;
-                }
-            }
-            if (pix) {
-                --bboxX.x2;
-                bboxD.x1 = bboxX.x2;
-            } else {
-                if (metUnavailablePixel) {
-                    *isBeingRenderedElsewhere = true;
-                }
-                break;
+        int right = bboxX.left() - 1;
+        int rightRow = bboxX.bottom();
+        for (int i = bboxX.bottom(); i < bboxX.top(); ++i) {
+            int x = bm.findLast(i, right + 1, bboxX.right(), rendered);
+            if (x > right) {
+                right = x;
+                rightRow = i;
             }
         }
+        if ( trimap && ( right >= bboxX.left() ) && (bm.pixel(right, rightRow) == PIXEL_UNAVAILABLE) ) {
+            *isBeingRenderedElsewhere = true;
+        }
+        bboxX.x2 = right + 1;
+        bboxD.x1 = bboxX.x2;
     }
     if ( !bboxD.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxD);
@@ -458,7 +525,7 @@ minimalNonMarkedRects_internal(const RectI & roi,
     assert( bboxD.bottom() == bboxX.bottom() );
 
     // get the bounding box of what's left (the X rectangle in the drawing above)
-    bboxX = minimalNonMarkedBbox_internal<trimap>(bboxX, _bounds, _map, isBeingRenderedElsewhere);
+    bboxX = minimalNonMarkedBbox_internal<trimap>(bboxX, bm, isBeingRenderedElsewhere);
 
     if ( !bboxX.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxX);
@@ -467,18 +534,39 @@ minimalNonMarkedRects_internal(const RectI & roi,
 #endif // NATRON_BITMAP_DISABLE_OPTIMIZATION
 } // minimalNonMarkedRects
 
+void
+Bitmap::initialize(const RectI & bounds)
+{
+    _bounds = bounds;
+    if ( _bounds.isNull() ) {
+        _rowWords = 0;
+        _map.clear();
+    } else {
+        _rowWords = (_bounds.width() + BITMAP_PIXELS_PER_WORD - 1) / BITMAP_PIXELS_PER_WORD;
+        _map.assign( (std::size_t)_rowWords * _bounds.height(), 0 );
+    }
+}
+
+void
+Bitmap::setTo1()
+{
+    std::fill( _map.begin(), _map.end(), (U64)BITMAP_LOW_BITS );
+}
+
 RectI
 Bitmap::minimalNonMarkedBbox(const RectI & roi) const
 {
+    BitmapRows bm(_map, _rowWords, _bounds);
+
     if (_dirtyZoneSet) {
         RectI realRoi;
         if ( !roi.intersect(_dirtyZone, &realRoi) ) {
             return RectI();
         }
 
-        return minimalNonMarkedBbox_internal<0>(realRoi, _bounds, _map, NULL);
+        return minimalNonMarkedBbox_internal<0>(realRoi, bm, NULL);
     } else {
-        return minimalNonMarkedBbox_internal<0>(roi, _bounds, _map, NULL);
+        return minimalNonMarkedBbox_internal<0>(roi, bm, NULL);
     }
 }
 
@@ -486,14 +574,16 @@ void
 Bitmap::minimalNonMarkedRects(const RectI & roi,
                               std::list<RectI>& ret) const
 {
+    BitmapRows bm(_map, _rowWords, _bounds);
+
     if (_dirtyZoneSet) {
         RectI realRoi;
         if ( !roi.intersect(_dirtyZone, &realRoi) ) {
             return;
         }
-        minimalNonMarkedRects_internal<0>(realRoi, _bounds, _map, ret, NULL);
+        minimalNonMarkedRects_internal<0>(realRoi, bm, ret, NULL);
     } else {
-        minimalNonMarkedRects_internal<0>(roi, _bounds, _map, ret, NULL);
+        minimalNonMarkedRects_internal<0>(roi, bm, ret, NULL);
     }
 }
 
@@ -502,6 +592,8 @@ RectI
 Bitmap::minimalNonMarkedBbox_trimap(const RectI & roi,
                                     bool* isBeingRenderedElsewhere) const
 {
+    BitmapRows bm(_map, _rowWords, _bounds);
+
     if (_dirtyZoneSet) {
         RectI realRoi;
         if ( !roi.intersect(_dirtyZone, &realRoi) ) {
@@ -510,9 +602,9 @@ Bitmap::minimalNonMarkedBbox_trimap(const RectI & roi,
             return RectI();
         }
 
-        return minimalNonMarkedBbox_internal<1>(realRoi, _bounds, _map, isBeingRenderedElsewhere);
+        return minimalNonMarkedBbox_internal<1>(realRoi, bm, isBeingRenderedElsewhere);
     } else {
-        return minimalNonMarkedBbox_internal<1>(roi, _bounds, _map, isBeingRenderedElsewhere);
+        return minimalNonMarkedBbox_internal<1>(roi, bm, isBeingRenderedElsewhere);
     }
 }
 
@@ -521,6 +613,8 @@ Bitmap::minimalNonMarkedRects_trimap(const RectI & roi,
                                      std::list<RectI>& ret,
                                      bool* isBeingRenderedElsewhere) const
 {
+    BitmapRows bm(_map, _rowWords, _bounds);
+
     if (_dirtyZoneSet) {
         RectI realRoi;
         if ( !roi.intersect(_dirtyZone, &realRoi) ) {
@@ -528,9 +622,9 @@ Bitmap::minimalNonMarkedRects_trimap(const RectI & roi,
 
             return;
         }
-        minimalNonMarkedRects_internal<1>(realRoi, _bounds, _map, ret, isBeingRenderedElsewhere);
+        minimalNonMarkedRects_internal<1>(realRoi, bm, ret, isBeingRenderedElsewhere);
     } else {
-        minimalNonMarkedRects_internal<1>(roi, _bounds, _map, ret, isBeingRenderedElsewhere);
+        minimalNonMarkedRects_internal<1>(roi, bm, ret, isBeingRenderedElsewhere);
     }
 }
 
@@ -544,12 +638,26 @@ Bitmap::markFor(const RectI & roi, char value)
     int x2 = std::min(roi.x2, _bounds.x2);
     int y2 = std::min(roi.y2, _bounds.y2);
 
-    char* buf = BM_GET(y1, x1);
-    int w = _bounds.width();
-    int roiw = x2 - x1;
+    if ( (x1 >= x2) || (y1 >= y2) ) {
+        return;
+    }
 
-    for (int i = y1; i < y2; ++i, buf += w) {
-        std::memset( buf, value, roiw);
+    const U64 pattern = (U64)BITMAP_LOW_BITS * (U64)value;
+    const int c1 = x1 - _bounds.x1;
+    const int c2 = x2 - _bounds.x1;
+    const int firstWord = c1 / BITMAP_PIXELS_PER_WORD;
+    const int lastWord = (c2 - 1) / BITMAP_PIXELS_PER_WORD;
+    const U64 firstMask = bitmapPixelsMask( c1 - firstWord * BITMAP_PIXELS_PER_WORD,
+                                            (firstWord == lastWord) ? (c2 - firstWord * BITMAP_PIXELS_PER_WORD) : BITMAP_PIXELS_PER_WORD );
+    const U64 lastMask = bitmapPixelsMask(0, c2 - lastWord * BITMAP_PIXELS_PER_WORD);
+    U64* row = &_map[(y1 - _bounds.y1) * _rowWords];
+
+    for (int i = y1; i < y2; ++i, row += _rowWords) {
+        row[firstWord] = (row[firstWord] & ~firstMask) | (pattern & firstMask);
+        if (lastWord > firstWord) {
+            std::fill(row + firstWord + 1, row + lastWord, pattern);
+            row[lastWord] = (row[lastWord] & ~lastMask) | (pattern & lastMask);
+        }
     }
 }
 
@@ -560,18 +668,14 @@ Bitmap::isNonMarked(const RectI & roi) const
     int y1 = std::max(roi.y1, _bounds.y1);
     int x2 = std::min(roi.x2, _bounds.x2);
     int y2 = std::min(roi.y2, _bounds.y2);
+    BitmapRows bm(_map, _rowWords, _bounds);
 
-    const char* buf = BM_GET(y1, x1);
-    int w = _bounds.width();
-    int roiw = x2 - x1;
-
-    for (int i = y1; i < y2; ++i, buf += w) {
-        for (int j = 0; j < roiw; ++j) {
-            if (buf[j]) {
-                return false;
-            }
+    for (int i = y1; i < y2; ++i) {
+        if ( bm.contains(i, x1, x2, eBitmapTestNonZero) ) {
+            return false;
         }
     }
+
     return true;
 }
 
@@ -589,32 +693,11 @@ Bitmap::swap(Bitmap& other)
 {
     _map.swap(other._map);
     _bounds = other._bounds;
+    _rowWords = other._rowWords;
     _dirtyZone.clear(); //merge(other._dirtyZone);
     _dirtyZoneSet = false;
 }
 
-const char*
-Bitmap::getBitmapAt(int x,
-                    int y) const
-{
-    if ( ( x >= _bounds.left() ) && ( x < _bounds.right() ) && ( y >= _bounds.bottom() ) && ( y < _bounds.top() ) ) {
-        return BM_GET(y, x);
-    } else {
-        return NULL;
-    }
-}
-
-char*
-Bitmap::getBitmapAt(int x,
-                    int y)
-{
-    if ( ( x >= _bounds.left() ) && ( x < _bounds.right() ) && ( y >= _bounds.bottom() ) && ( y < _bounds.top() ) ) {
-        return BM_GET(y, x);
-    } else {
-        return NULL;
-    }
-}
-
 #ifdef DEBUG
 void
 Image::printUnrenderedPixels(const RectI& roi) const
@@ -623,9 +706,6 @@ Image::printUnrenderedPixels(const RectI& roi) const
         return;
     }
     QReadLocker k(&_entryLock);
-    const char* bm = _bitmap.getBitmapAt(roi.x1, roi.y1);
-    int roiw = roi.x2 - roi.x1;
-    int boundsW = _bitmap.getBounds().width();
     RectD bboxUnrendered;
     bboxUnrendered.setupInfinity();
     RectD bboxUnavailable;
@@ -634,10 +714,10 @@ Image::printUnrenderedPixels(const RectI& roi) const
     bool hasUnrendered = false;
     bool hasUnavailable = false;
 
-    for ( int y = roi.y1; y < roi.y2; ++y,
-          bm += (boundsW - roiw) ) {
-        for (int x = roi.x1; x < roi.x2; ++x, ++bm) {
-            if (*bm == 0) {
+    for (int y = roi.y1; y < roi.y2; ++y) {
+        for (int x = roi.x1; x < roi.x2; ++x) {
+            char bm = _bitmap.getPixel(x, y);
+            if (bm == 0) {
                 if (x < bboxUnrendered.x1) {
                     bboxUnrendered.x1 = x;
                 }
@@ -651,7 +731,7 @@ Image::printUnrenderedPixels(const RectI& roi) const
                     bboxUnrendered.y2 = y;
                 }
                 hasUnrendered = true;
-            } else if (*bm == PIXEL_UNAVAILABLE) {
+            } else if (bm == PIXEL_UNAVAILABLE) {
                 if (x < bboxUnavailable.x1) {
                     bboxUnavailable.x1 = x;
                 }
@@ -1051,9 +1131,7 @@ Image::resizeInternal(const Image* srcImg,
             std::size_t memsize = a * pixelSize;
             std::memset(pix, 0, memsize);
             if ( setBitmapTo1 && (*outputImage)->usesBitMap() ) {
-                char* bm = wacc.bitmapAt(aRect.x1, aRect.y1);
-                assert(bm);
-                std::memset(bm, 1, a);
+                (*outputImage)->_bitmap.markForRendered(aRect);
             }
         }
         if ( !cRect.isNull() ) {
@@ -1063,9 +1141,7 @@ Image::resizeInternal(const Image* srcImg,
             std::size_t memsize = a * pixelSize;
             std::memset(pix, 0, memsize);
             if ( setBitmapTo1 && (*outputImage)->usesBitMap() ) {
-                char* bm = (char*)wacc.bitmapAt(cRect.x1, cRect.y1);
-                assert(bm);
-                std::memset(bm, 1, a);
+                (*outputImage)->_bitmap.markForRendered(cRect);
             }
         }
         if ( !bRect.isNull() ) {
@@ -1075,13 +1151,11 @@ Image::resizeInternal(const Image* srcImg,
             std::size_t rowsize = mw * pixelSize;
             int bw = bRect.width();
             std::size_t rectRowSize = bw * pixelSize;
-            char* bm = ( setBitmapTo1 && (*outputImage)->usesBitMap() ) ? wacc.bitmapAt(bRect.x1, bRect.y1) : 0;
             for (int y = bRect.y1; y < bRect.y2; ++y, pix += rowsize) {
                 std::memset(pix, 0, rectRowSize);
-                if (bm) {
-                    std::memset(bm, 1, bw);
-                    bm += mw;
-                }
+            }
+            if ( setBitmapTo1 && (*outputImage)->usesBitMap() ) {
+                (*outputImage)->_bitmap.markForRendered(bRect);
             }
         }
         if ( !dRect.isNull() ) {
@@ -1091,13 +1165,11 @@ Image::resizeInternal(const Image* srcImg,
             std::size_t rowsize = mw * pixelSize;
             int dw = dRect.width();
             std::size_t rectRowSize = dw * pixelSize;
-            char* bm = ( setBitmapTo1 && (*outputImage)->usesBitMap() ) ? wacc.bitmapAt(dRect.x1, dRect.y1) : 0;
             for (int y = dRect.y1; y < dRect.y2; ++y, pix += rowsize) {
                 std::memset(pix, 0, rectRowSize);
-                if (bm) {
-                    std::memset(bm, 1, dw);
-                    bm += mw;
-                }
+            }
+            if ( setBitmapTo1 && (*outputImage)->usesBitMap() ) {
+                (*outputImage)->_bitmap.markForRendered(dRect);
             }
         }
     } // fillWithBlackAndTransparent
@@ -1834,10 +1906,8 @@ Image::halveRoIForDepth(const RectI & roi,
     ///The source rectangle, intersected to this image region of definition in pixels
     const RectI &srcBounds = _bounds;
     const RectI &dstBounds = output->_bounds;
-    const RectI &srcBmBounds = _bitmap.getBounds();
-    const RectI &dstBmBounds = output->_bitmap.getBounds();
     assert( !copyBitMap || usesBitMap() );
-    assert( !usesBitMap() || (srcBmBounds == srcBounds && dstBmBounds == dstBounds) );
+    assert( !usesBitMap() || (_bitmap.getBounds() == srcBounds && output->_bitmap.getBounds() == dstBounds) );
 
     // the srcRoD of the output should be enclosed in half the roi.
     // It does not have to be exactly half of the input.
@@ -1860,25 +1930,17 @@ Image::halveRoIForDepth(const RectI & roi,
 
 
     const PIX* const srcPixels      = (const PIX*)pixelAt(srcBounds.x1,   srcBounds.y1);
-    const char* const srcBmPixels   = _bitmap.getBitmapAt(srcBmBounds.x1, srcBmBounds.y1);
     PIX* const dstPixels          = (PIX*)output->pixelAt(dstBounds.x1,   dstBounds.y1);
-    char* const dstBmPixels = output->_bitmap.getBitmapAt(dstBmBounds.x1, dstBmBounds.y1);
     int srcRowSize = srcBounds.width() * _nbComponents;
     int dstRowSize = dstBounds.width() * _nbComponents;
 
     // offset pointers so that srcData and dstData correspond to pixel (0,0)
     const PIX* const srcData = srcPixels - (srcBounds.x1 * _nbComponents + srcRowSize * srcBounds.y1);
     PIX* const dstData       = dstPixels - (dstBounds.x1 * _nbComponents + dstRowSize * dstBounds.y1);
-    const int srcBmRowSize = srcBmBounds.width();
-    const int dstBmRowSize = dstBmBounds.width();
-    const char* const srcBmData = srcBmPixels - (srcBmBounds.x1 + srcBmRowSize * srcBmBounds.y1);
-    char* const dstBmData       = dstBmPixels - (dstBmBounds.x1 + dstBmRowSize * dstBmBounds.y1);
 
     for (int y = dstRoI.y1; y < dstRoI.y2; ++y) {
         const PIX* const srcLineStart    = srcData + y * 2 * srcRowSize;
         PIX* const dstLineStart          = dstData + y     * dstRowSize;
-        const char* const srcBmLineStart = srcBmData + y * 2 * srcBmRowSize;
-        char* const dstBmLineStart       = dstBmData + y     * dstBmRowSize;
 
         // The current dst row, at y, covers the src rows y*2 (thisRow) and y*2+1 (nextRow).
         // Check that if are within srcBounds.
@@ -1888,11 +1950,30 @@ Image::halveRoIForDepth(const RectI & roi,
         int sumH = (int)pickNextRow + (int)pickThisRow;
         assert(sumH == 1 || sumH == 2);
 
+        // The dst cols whose 4 src pixels are all within srcBounds are computed by the vectorized row kernel,
+        // which gives the same result as the loop below
+        int xFastBegin = dstRoI.x2;
+        int xFastEnd = dstRoI.x2;
+        if (sumH == 2) {
+            xFastBegin = std::max( dstRoI.x1, ceilHalf(srcBounds.x1) );
+            xFastEnd = std::min( dstRoI.x2, floorHalf(srcBounds.x2) );
+            if (xFastEnd > xFastBegin) {
+                MipMapKernels::halveRows(srcLineStart + xFastBegin * 2 * _nbComponents,
+                                         srcLineStart + xFastBegin * 2 * _nbComponents + srcRowSize,
+                                         xFastEnd - xFastBegin,
+                                         _nbComponents,
+                                         dstLineStart + xFastBegin * _nbComponents);
+            }
+        }
+
         for (int x = dstRoI.x1; x < dstRoI.x2; ++x) {
+            if ( (xFastEnd > xFastBegin) && (x == xFastBegin) ) {
+                x = xFastEnd - 1;
+                continue;
+            }
+
             const PIX* const srcPixStart    = srcLineStart   + x * 2 * _nbComponents;
-            const char* const srcBmPixStart = srcBmLineStart + x * 2;
             PIX* const dstPixStart          = dstLineStart   + x * _nbComponents;
-            char* const dstBmPixStart       = dstBmLineStart + x;
 
             // The current dst col, at y, covers the src cols x*2 (thisCol) and x*2+1 (nextCol).
             // Check that if are within srcBounds.
@@ -1908,9 +1989,6 @@ Image::halveRoIForDepth(const RectI & roi,
                 for (int k = 0; k < _nbComponents; ++k) {
                     dstPixStart[k] = 0;
                 }
-                if (copyBitMap) {
-                    dstBmPixStart[0] = 0;
-                }
                 continue;
             }
 
@@ -1927,15 +2005,28 @@ Image::halveRoIForDepth(const RectI & roi,
                 assert( sumH == 2 || ( sumH == 1 && ( (a == 0 && b == 0) || (c == 0 && d == 0) ) ) );
                 dstPixStart[k] = (a + b + c + d) / sum;
             }
+        }
+
+        if (copyBitMap) {
+            for (int x = dstRoI.x1; x < dstRoI.x2; ++x) {
+                int srcx = x * 2;
+                bool pickThisCol = srcBounds.x1 <= (srcx + 0) && (srcx + 0) < srcBounds.x2;
+                bool pickNextCol = srcBounds.x1 <= (srcx + 1) && (srcx + 1) < srcBounds.x2;
+                int sumW = (int)pickThisCol + (int)pickNextCol;
+                const int sum = sumW * sumH;
+
+                if (sum == 0) { // never happens
+                    output->_bitmap.setPixel(x, y, 0);
+                    continue;
+                }
 
-            if (copyBitMap) {
                 ///a b
                 ///c d
 
-                char a = (pickThisCol && pickThisRow) ? *(srcBmPixStart) : 0;
-                char b = (pickNextCol && pickThisRow) ? *(srcBmPixStart + 1) : 0;
-                char c = (pickThisCol && pickNextRow) ? *(srcBmPixStart + srcBmRowSize) : 0;
-                char d = (pickNextCol && pickNextRow) ? *(srcBmPixStart + srcBmRowSize  + 1)  : 0;
+                char a = (pickThisCol && pickThisRow) ? _bitmap.getPixel(srcx, srcy) : 0;
+                char b = (pickNextCol && pickThisRow) ? _bitmap.getPixel(srcx + 1, srcy) : 0;
+                char c = (pickThisCol && pickNextRow) ? _bitmap.getPixel(srcx, srcy + 1) : 0;
+                char d = (pickNextCol && pickNextRow) ? _bitmap.getPixel(srcx + 1, srcy + 1) : 0;
 #if NATRON_ENABLE_TRIMAP
                 /*
                    The only correct solution is to convert pixels being rendered to 0 otherwise the caller
@@ -1958,8 +2049,9 @@ Image::halveRoIForDepth(const RectI & roi,
                 assert( sumH == 2 || ( sumH == 1 && ( (a == 0 && b == 0) || (c == 0 && d == 0) ) ) );
                 assert(a + b + c + d <= sum); // bitmaps are 0 or 1
                 // the following is an integer division, the result can be 0 or 1
-                dstBmPixStart[0] = (a + b + c + d) / sum;
-                assert(dstBmPixStart[0] == 0 || dstBmPixStart[0] == 1);
+                char dstBm = (a + b + c + d) / sum;
+                assert(dstBm == 0 || dstBm == 1);
+                output->_bitmap.setPixel(x, y, dstBm);
             }
         }
     }
@@ -2029,15 +2121,18 @@ Image::halve1DImageForDepth(const RectI & roi,
         }
     } else if (width == 1) {
         int rowSize = srcBounds.width() * _nbComponents;
+        int dstRowSize = dstBounds.width() * _nbComponents;
         const PIX* src = (const PIX*)pixelAt(roi.x1, roi.y1);
         PIX* dst = (PIX*)output->pixelAt(dstBounds.x1, dstBounds.y1);
         assert(src && dst);
         for (int y = 0; y < halfHeight; ++y) {
             for (int k = 0; k < _nbComponents; ++k) {
-                *dst++ = PIX( (float)( *src + (*src + rowSize) ) / 2. );
+                *dst++ = PIX( (float)( *src + *(src + rowSize) ) / 2. );
                 ++src;
             }
-            src += rowSize;
+            // next pixel is 2 rows below
+            src += 2 * rowSize - _nbComponents;
+            dst += dstRowSize - _nbComponents;
         }
     }
 }
@@ -2074,6 +2169,8 @@ Image::downscaleMipMap(const RectD& dstRod,
                        bool copyBitMap,
                        Image* output) const
 {
+    RenderTraceScope trace("downscaleMipMap", kRenderTraceCategoryConversion);
+
     assert(getStorageMode() != eStorageModeGLTex);
 
     ///You should not call this function with a level equal to 0.
@@ -2088,7 +2185,7 @@ Image::downscaleMipMap(const RectD& dstRod,
 //    roiCanonical.toPixelEnclosing(toLevel, par , &dstRoI);
     unsigned int downscaleLvls = toLevel - fromLevel;
 
-    assert( !copyBitMap || _bitmap.getBitmap() );
+    assert( !copyBitMap || usesBitMap() );
 
     RectI dstRoI  = roi.downscalePowerOfTwoSmallestEnclosing(downscaleLvls);
     ImagePtr tmpImg = boost::make_shared<Image>( getComponents(), dstRod, dstRoI, toLevel, par, getBitDepth(), getPremultiplication(), getFieldingOrder(), true);
@@ -2339,15 +2436,7 @@ Bitmap::copyRowPortion(int x1,
                        int y,
                        const Bitmap& other)
 {
-    const char* srcBitmap = other.getBitmapAt(x1, y);
-    char* dstBitmap = getBitmapAt(x1, y);
-    const char* end = dstBitmap + (x2 - x1);
-
-    while (dstBitmap < end) {
-        *dstBitmap = /**srcBitmap == PIXEL_UNAVAILABLE ? 0 : */ *srcBitmap;
-        ++dstBitmap;
-        ++srcBitmap;
-    }
+    copyBitmapPortion(RectI(x1, y, x2, y + 1), other);
 }
 
 void
@@ -2364,21 +2453,24 @@ Bitmap::copyBitmapPortion(const RectI& roi,
     assert(roi.x1 >= _bounds.x1 && roi.x2 <= _bounds.x2 && roi.y1 >= _bounds.y1 && roi.y2 <= _bounds.y2);
     assert(roi.x1 >= other._bounds.x1 && roi.x2 <= other._bounds.x2 && roi.y1 >= other._bounds.y1 && roi.y2 <= other._bounds.y2);
 
-    int srcRowSize = other._bounds.width();
-    int dstRowSize = _bounds.width();
-    const char* srcBitmap = other.getBitmapAt(roi.x1, roi.y1);
-    char* dstBitmap = getBitmapAt(roi.x1, roi.y1);
-
-    for (int y = roi.y1; y < roi.y2; ++y,
-         srcBitmap += srcRowSize,
-         dstBitmap += dstRowSize) {
-        const char* srcCur = srcBitmap;
-        const char* srcEnd = srcBitmap + roi.width();
-        char* dstCur = dstBitmap;
-        while (srcCur < srcEnd) {
-            *dstCur = /**srcCur == PIXEL_UNAVAILABLE ? 0 : */ *srcCur;
-            ++srcCur;
-            ++dstCur;
+    if ( roi.isNull() ) {
+        return;
+    }
+
+    // Copy up to a word of pixels at a time: the pixels of the source are realigned on the words of the destination
+    for (int y = roi.y1; y < roi.y2; ++y) {
+        const U64* srcRow = &other._map[(y - other._bounds.y1) * other._rowWords];
+        U64* dstRow = &_map[(y - _bounds.y1) * _rowWords];
+        int x = roi.x1;
+        while (x < roi.x2) {
+            const int dstCol = x - _bounds.x1;
+            const int dstWord = dstCol / BITMAP_PIXELS_PER_WORD;
+            const int offset = dstCol % BITMAP_PIXELS_PER_WORD;
+            const int n = std::min(BITMAP_PIXELS_PER_WORD - offset, roi.x2 - x);
+            const U64 pixels = bitmapReadPixels(srcRow, other._rowWords, x - other._bounds.x1);
+            const U64 mask = bitmapPixelsMask(offset, offset + n);
+            dstRow[dstWord] = (dstRow[dstWord] & ~mask) | ( (pixels << (offset * 2) ) & mask );
+            x += n;
         }
     }
 }
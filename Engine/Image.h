@@ -30,8 +30,10 @@
 
 #include <list>
 #include <map>
+#include <vector>
 #include <algorithm> // min, max
 #include <bitset>
+#include <cassert>
 
 #include "Global/GlobalDefines.h"
 
@@ -64,12 +66,19 @@ public:
     }
 };
 
+/**
+ * @brief The render state of each pixel of an image: 0 if it is not rendered, 1 if it is rendered and
+ * 2 if it is being rendered by another thread (only with NATRON_ENABLE_TRIMAP).
+ * The states are packed on 2 bits, 32 pixels per 64-bit word, and each row starts on a new word:
+ * marking or scanning a rectangle processes 32 pixels at a time.
+ **/
 class Bitmap
 {
 public:
     Bitmap(const RectI & bounds)
-        : _bounds(bounds)
-        , _map( bounds.area() )
+        : _bounds()
+        , _rowWords(0)
+        , _map()
         , _dirtyZone()
         , _dirtyZoneSet(false)
     {
@@ -77,39 +86,39 @@ public:
         // "identities" images (i.e: images that are just a link to another image). See EffectInstance :
         // "!!!Note that if isIdentity is true it will allocate an empty image object with 0 bytes of data."
         //assert(!rod.isNull());
-        std::fill(_map.begin(), _map.end(), 0);
+        initialize(bounds);
     }
 
     Bitmap()
         : _bounds()
+        , _rowWords(0)
         , _map()
         , _dirtyZone()
         , _dirtyZoneSet(false)
     {
     }
 
-    void initialize(const RectI & bounds)
-    {
-        _bounds = bounds;
-        _map.resize( _bounds.area() );
-
-        std::fill(_map.begin(), _map.end(), 0);
-    }
+    void initialize(const RectI & bounds);
 
     ~Bitmap()
     {
     }
 
-    void setTo1()
-    {
-        std::fill(_map.begin(), _map.end(), 1);
-    }
+    void setTo1();
 
     const RectI & getBounds() const
     {
         return _bounds;
     }
 
+    /**
+     * @brief Returns the memory used by the pixels states
+     **/
+    std::size_t getSizeInBytes() const
+    {
+        return _map.size() * sizeof(U64);
+    }
+
 #if NATRON_ENABLE_TRIMAP
     void minimalNonMarkedRects_trimap(const RectI & roi, std::list<RectI>& ret, bool* isBeingRenderedElsewhere) const;
     RectI minimalNonMarkedBbox_trimap(const RectI & roi, bool* isBeingRenderedElsewhere) const;
@@ -133,18 +142,26 @@ public:
 
     void swap(Bitmap& other);
 
-    const char* getBitmap() const
+    /**
+     * @brief Returns the state of the pixel at (x,y), which must be within the bounds
+     **/
+    char getPixel(int x, int y) const
     {
-        return &_map.front();
+        assert( x >= _bounds.x1 && x < _bounds.x2 && y >= _bounds.y1 && y < _bounds.y2 );
+        int col = x - _bounds.x1;
+
+        return (char)( ( _map[(y - _bounds.y1) * _rowWords + (col >> 5)] >> ( (col & 31) * 2 ) ) & 3 );
     }
 
-    char* getBitmap()
+    void setPixel(int x, int y, char value)
     {
-        return &_map.front();
-    }
+        assert( x >= _bounds.x1 && x < _bounds.x2 && y >= _bounds.y1 && y < _bounds.y2 );
+        int col = x - _bounds.x1;
+        U64& word = _map[(y - _bounds.y1) * _rowWords + (col >> 5)];
+        int shift = (col & 31) * 2;
 
-    const char* getBitmapAt(int x, int y) const;
-    char* getBitmapAt(int x, int y);
+        word = ( word & ~( (U64)3 << shift ) ) | ( (U64)value << shift );
+    }
 
     void copyRowPortion(int x1, int x2, int y, const Bitmap& other);
 
@@ -161,7 +178,10 @@ private:
 
 private:
     RectI _bounds;
-    std::vector<char> _map;
+
+    // Number of words of a row
+    int _rowWords;
+    std::vector<U64> _map;
 
     /**
      * This represents the zone that has potentially something to render. In minimalNonMarkedRects
@@ -303,7 +323,7 @@ public:
         std::size_t dt = dataSize();
         bool got = _entryLock.tryLockForRead();
 
-        dt += _bitmap.getBounds().area();
+        dt += _bitmap.getSizeInBytes();
         if (got) {
             _entryLock.unlock();
         }
@@ -410,14 +430,6 @@ public:
 
             return img->pixelAt(x, y);
         }
-
-        const char* bitmapAt(int x,
-                             int y) const
-        {
-            assert(img);
-
-            return img->getBitmapAt(x, y);
-        }
     };
 
     typedef boost::shared_ptr<ReadAccess> ReadAccessPtr;
@@ -462,14 +474,6 @@ public:
         {
             return img->pixelAt(x, y);
         }
-
-        char* bitmapAt(int x,
-                       int y) const
-        {
-            assert(img);
-
-            return img->getBitmapAt(x, y);
-        }
     };
 
     typedef boost::shared_ptr<WriteAccess> WriteAccessPtr;
@@ -496,18 +500,6 @@ private:
      * of an image.
      **/
 
-    const char* getBitmapAt(int x,
-                            int y) const
-    {
-        return this->_bitmap.getBitmapAt(x, y);
-    }
-
-    char* getBitmapAt(int x,
-                      int y)
-    {
-        return this->_bitmap.getBitmapAt(x, y);
-    }
-
     /**
      * @brief Access pixels. The pointer must be cast to the appropriate type afterwards.
      **/
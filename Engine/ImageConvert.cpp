@@ -28,6 +28,7 @@
 #include <algorithm> // min, max
 #include <cassert>
 #include <stdexcept>
+#include <vector>
 
 #ifndef Q_MOC_RUN
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
@@ -39,6 +40,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
 #include "Engine/AppManager.h"
 #include "Engine/Lut.h"
+#include "Engine/RenderTrace.h"
 
 NATRON_NAMESPACE_ENTER
 
@@ -133,6 +135,127 @@ lutFromColorspace(ViewerColorSpaceEnum cs)
     return lut;
 }
 
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+///Converts n values read every inDelta elements of from to values written every outDelta elements of to
+template <typename SRCPIX, typename DSTPIX>
+void
+convertRowDepth(const SRCPIX* from,
+                DSTPIX* to,
+                int n,
+                int inDelta,
+                int outDelta)
+{
+    for (int i = 0; i < n; ++i, from += inDelta, to += outDelta) {
+#     ifdef DEBUG
+        assert( !(boost::math::isnan)(*from) ); // check for NaN
+#     endif
+        *to = Image::convertPixelDepth<SRCPIX, DSTPIX>(*from);
+    }
+}
+
+///Converts n values read every inDelta elements of from to contiguous linear values, with the lut if any
+void
+convertRowToLinear(const Color::Lut* lut,
+                   const unsigned char* from,
+                   float* to,
+                   int n,
+                   int inDelta)
+{
+    if (lut) {
+        lut->fromColorSpaceUint8ToLinearFloatFast(from, to, n, inDelta);
+    } else {
+        convertRowDepth(from, to, n, inDelta, 1);
+    }
+}
+
+void
+convertRowToLinear(const Color::Lut* lut,
+                   const unsigned short* from,
+                   float* to,
+                   int n,
+                   int inDelta)
+{
+    if (lut) {
+        lut->fromColorSpaceUint16ToLinearFloatFast(from, to, n, inDelta);
+    } else {
+        convertRowDepth(from, to, n, inDelta, 1);
+    }
+}
+
+void
+convertRowToLinear(const Color::Lut* lut,
+                   const float* from,
+                   float* to,
+                   int n,
+                   int inDelta)
+{
+    if (lut) {
+        lut->fromColorSpaceFloatToLinearFloat(from, to, n, inDelta);
+    } else {
+        convertRowDepth(from, to, n, inDelta, 1);
+    }
+}
+
+///Converts n contiguous linear values to values written every outDelta elements of to, with the lut if any.
+///Bytes are dithered by diffusing the error from the index start.
+void
+convertRowFromLinear(const Color::Lut* lut,
+                     const float* from,
+                     unsigned char* to,
+                     int n,
+                     int start,
+                     int outDelta)
+{
+    if (lut) {
+        lut->toColorSpaceUint8FromLinearFloatFast(from, to, n, start, 1, outDelta);
+
+        return;
+    }
+    unsigned error = 0x80;
+    for (int i = start; i < n; ++i) {
+        error = (error & 0xff) + Color::floatToInt<0xff01>(from[i]);
+        to[i * outDelta] = (unsigned char)(error >> 8);
+    }
+    error = 0x80;
+    for (int i = start - 1; i >= 0; --i) {
+        error = (error & 0xff) + Color::floatToInt<0xff01>(from[i]);
+        to[i * outDelta] = (unsigned char)(error >> 8);
+    }
+}
+
+void
+convertRowFromLinear(const Color::Lut* lut,
+                     const float* from,
+                     unsigned short* to,
+                     int n,
+                     int /*start*/,
+                     int outDelta)
+{
+    if (lut) {
+        lut->toColorSpaceUint16FromLinearFloatFast(from, to, n, 1, outDelta);
+    } else {
+        convertRowDepth(from, to, n, 1, outDelta);
+    }
+}
+
+void
+convertRowFromLinear(const Color::Lut* lut,
+                     const float* from,
+                     float* to,
+                     int n,
+                     int /*start*/,
+                     int outDelta)
+{
+    if (lut) {
+        lut->toColorSpaceFloatFromLinearFloat(from, to, n, 1, outDelta);
+    } else {
+        convertRowDepth(from, to, n, 1, outDelta);
+    }
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
 ///Fast version when components are the same
 template <typename SRCPIX, typename DSTPIX, int srcMaxValue, int dstMaxValue>
 void
@@ -150,8 +273,6 @@ Image::convertToFormatInternal_sameComps(const RectI & renderWindow,
         return;
     }
 
-    ImageBitDepthEnum dstDepth = dstImg.getBitDepth();
-    ImageBitDepthEnum srcDepth = srcImg.getBitDepth();
     int nComp = (int)srcImg.getComponentsCount();
     const Color::Lut* const srcLut_ = lutFromColorspace(srcColorSpace);
     const Color::Lut* const dstLut_ = lutFromColorspace(dstColorSpace);
@@ -163,77 +284,31 @@ Image::convertToFormatInternal_sameComps(const RectI & renderWindow,
     if ( intersection.isNull() ) {
         return;
     }
-    for (int y = 0; y < intersection.height(); ++y) {
-        // coverity[dont_call]
-        int start = rand() % intersection.width();
-        const SRCPIX* srcPixels = (const SRCPIX*)srcImg.pixelAt(intersection.x1 + start, intersection.y1 + y);
-        DSTPIX* dstPixels = (DSTPIX*)dstImg.pixelAt(intersection.x1 + start, intersection.y1 + y);
-        const SRCPIX* srcStart = srcPixels;
-        DSTPIX* dstStart = dstPixels;
-
-        for (int backward = 0; backward < 2; ++backward) {
-            int x = backward ? start - 1 : start;
-            int end = backward ? -1 : intersection.width();
-            unsigned error[3] = {
-                0x80, 0x80, 0x80
-            };
-
-            while ( x != end && x >= 0 && x < intersection.width() ) {
-                for (int k = 0; k < nComp; ++k) {
-#                 ifdef DEBUG
-                    assert( !(boost::math::isnan)(srcPixels[k]) ); // check for NaN
-#                 endif
-                    DSTPIX pix;
-                    if ( (k == 3) || (!srcLut && !dstLut) ) {
-                        pix = convertPixelDepth<SRCPIX, DSTPIX>(srcPixels[k]);
-                    } else {
-                        float pixFloat;
 
-                        if (srcLut) {
-                            if (srcDepth == eImageBitDepthByte) {
-                                pixFloat = srcLut->fromColorSpaceUint8ToLinearFloatFast(srcPixels[k]);
-                            } else if (srcDepth == eImageBitDepthShort) {
-                                pixFloat = srcLut->fromColorSpaceUint16ToLinearFloatFast(srcPixels[k]);
-                            } else {
-                                pixFloat = srcLut->fromColorSpaceFloatToLinearFloat(srcPixels[k]);
-                            }
-                        } else {
-                            pixFloat = convertPixelDepth<SRCPIX, float>(srcPixels[k]);
-                        }
+    // Each channel of a row is converted to linear in this buffer, then to the destination: the rows are independent
+    // from each other and the LUTs are applied in batches
+    const int width = intersection.width();
+    std::vector<float> linearRow(width);
 
-                        if (dstDepth == eImageBitDepthByte) {
-                            ///small increase in perf we use Luts. This should be anyway the most used case.
-                            error[k] = (error[k] & 0xff) + ( dstLut ? dstLut->toColorSpaceUint8xxFromLinearFloatFast(pixFloat) :
-                                                             Color::floatToInt<0xff01>(pixFloat) );
-                            pix = error[k] >> 8;
-                        } else if (dstDepth == eImageBitDepthShort) {
-                            pix = dstLut ? dstLut->toColorSpaceUint16FromLinearFloatFast(pixFloat) :
-                                  convertPixelDepth<float, DSTPIX>(pixFloat);
-                        } else {
-                            if (dstLut) {
-                                pixFloat = dstLut->toColorSpaceFloatFromLinearFloat(pixFloat);
-                            }
-                            pix = convertPixelDepth<float, DSTPIX>(pixFloat);
-                        }
-                    }
-                    dstPixels[k] =  pix;
-#                 ifdef DEBUG
-                    assert( !(boost::math::isnan)(dstPixels[k]) ); // check for NaN
-#                 endif
-                }
+    for (int y = 0; y < intersection.height(); ++y) {
+        const SRCPIX* srcPixels = (const SRCPIX*)srcImg.pixelAt(intersection.x1, intersection.y1 + y);
+        DSTPIX* dstPixels = (DSTPIX*)dstImg.pixelAt(intersection.x1, intersection.y1 + y);
 
-                if (backward) {
-                    --x;
-                    srcPixels -= nComp;
-                    dstPixels -= nComp;
-                } else {
-                    ++x;
-                    srcPixels += nComp;
-                    dstPixels += nComp;
-                }
+        ///Start of the line for error diffusion
+        const int start = Color::errorDiffusionStart(intersection.y1 + y, width);
+
+        for (int k = 0; k < nComp; ++k) {
+            if ( (k == 3) || (!srcLut && !dstLut) ) {
+                convertRowDepth(srcPixels + k, dstPixels + k, width, nComp, nComp);
+            } else {
+                convertRowToLinear(srcLut, srcPixels + k, &linearRow[0], width, nComp);
+                convertRowFromLinear(dstLut, &linearRow[0], dstPixels + k, width, start, nComp);
+            }
+#         ifdef DEBUG
+            for (int x = 0; x < width; ++x) {
+                assert( !(boost::math::isnan)(dstPixels[x * nComp + k]) ); // check for NaN
             }
-            srcPixels = srcStart - nComp;
-            dstPixels = dstStart - nComp;
+#         endif
         }
 
         if (copyBitmap) {
@@ -309,8 +384,7 @@ Image::convertToFormatInternalForColorSpace(const RectI & renderWindow,
 
     for (int y = 0; y < renderWindow.height(); ++y) {
         ///Start of the line for error diffusion
-        // coverity[dont_call]
-        int start = rand() % renderWindow.width();
+        int start = Color::errorDiffusionStart(renderWindow.y1 + y, renderWindow.width());
         const SRCPIX* srcPixels = (const SRCPIX*)srcImg.pixelAt(renderWindow.x1 + start, renderWindow.y1 + y);
         DSTPIX* dstPixels = (DSTPIX*)dstImg.pixelAt(renderWindow.x1 + start, renderWindow.y1 + y);
         const SRCPIX* srcStart = srcPixels;
@@ -679,6 +753,7 @@ Image::convertToFormatCommon(const RectI & renderWindow,
                              bool requiresUnpremult,
                              Image* dstImg) const
 {
+    RenderTraceScope trace("convertToFormat", kRenderTraceCategoryConversion);
     QWriteLocker k(&dstImg->_entryLock);
     QReadLocker k2(&_entryLock);
 
@@ -50,6 +50,31 @@ double interpolate(double tcur, const double vcur, //start control point
                    KeyframeTypeEnum interp,
                    KeyframeTypeEnum interpNext) WARN_UNUSED_RETURN;
 
+/**
+ * @brief Computes the cubic used by interpolate() between tcur and tnext, so that it can be evaluated
+ * many times without recomputing it: the value at currentTime is evaluateCubic(c, (currentTime - *tStart) / *tLength).
+ **/
+void cubicCoefficients(double tcur, const double vcur, //start control point
+                       const double vcurDerivRight, //being the derivative dv/dt at tcur
+                       const double vnextDerivLeft, //being the derivative dv/dt at tnext
+                       double tnext, const double vnext, //end control point
+                       KeyframeTypeEnum interp,
+                       KeyframeTypeEnum interpNext,
+                       double* tStart,
+                       double* tLength,
+                       double c[4]);
+
+/// evaluate at x the cubic computed by cubicCoefficients()
+inline double
+evaluateCubic(const double c[4],
+              double x)
+{
+    const double x2 = x * x;
+    const double x3 = x2 * x;
+
+    return c[0] + (c[1] ? c[1] * x : 0.) + (c[2] ? c[2] * x2 : 0.) + (c[3] ? c[3] * x3 : 0.);
+}
+
 /// derive at currentTime. The derivative is with respect to currentTime
 double derive(double tcur, const double vcur, //start control point
               const double vcurDerivRight, //being the derivative dv/dt at tcur
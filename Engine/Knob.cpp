@@ -51,6 +51,7 @@
 #include "Engine/KnobSerialization.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/LibraryBinary.h"
+#include "Engine/NativeExpression.h"
 #include "Engine/Node.h"
 #include "Engine/Project.h"
 #include "Engine/StringAnimationManager.h"
@@ -227,6 +228,10 @@ struct Expr
     ///The list of pair<knob, dimension> dpendencies for an expression
     std::list<std::pair<KnobIWPtr, int> > dependencies;
 
+    ///The expression compiled by NativeExpression, or NULL if it must be evaluated by Python.
+    ///Always accessed with boost::atomic_load/atomic_store so that the render threads do not lock.
+    NativeExpressionPtr native;
+
     //PyObject* code;
 
     Expr()
@@ -2714,6 +2719,12 @@ KnobHelper::setExpressionInternal(int dimension,
         //NATRON_PYTHON_NAMESPACE::compilePyScript(exprCpy, &_imp->expressions[dimension].code);
     }
 
+    ///Compile the expression natively if possible so that it can be evaluated without the GIL.
+    ///Expressions with a "ret" variable are full Python scripts and are always left to Python.
+    if ( exprInvalid.empty() && !hasRetVariable && !dynamic_cast<KnobStringBase*>(this) ) {
+        boost::atomic_store( &_imp->expressions[dimension].native, NativeExpression::compile(expression, this, dimension) );
+    }
+
     if ( getHolder() ) {
         //Parse listeners of the expression, to keep track of dependencies to indicate them to the user.
 
@@ -2766,6 +2777,14 @@ KnobHelper::replaceNodeNameInExpression(int dimension,
     isEffect->endChanges(true);
 }
 
+NativeExpressionPtr
+KnobHelper::getNativeExpression(int dimension) const
+{
+    assert( dimension >= 0 && dimension < _imp->dimension );
+
+    return boost::atomic_load( &_imp->expressions[dimension].native );
+}
+
 bool
 KnobHelper::isExpressionUsingRetVariable(int dimension) const
 {
@@ -2801,6 +2820,7 @@ KnobHelper::clearExpression(int dimension,
         _imp->expressions[dimension].expression.clear();
         _imp->expressions[dimension].originalExpression.clear();
         _imp->expressions[dimension].exprInvalid.clear();
+        boost::atomic_store( &_imp->expressions[dimension].native, NativeExpressionPtr() );
         //Py_XDECREF(_imp->expressions[dimension].code); //< new ref
         //_imp->expressions[dimension].code = 0;
     }
@@ -4221,9 +4241,17 @@ KnobHelper::random(double min,
 {
     QMutexLocker k(&_imp->lastRandomHashMutex);
 
-    _imp->lastRandomHash = hashFunction(_imp->lastRandomHash);
+    return randomFromState(&_imp->lastRandomHash, min, max);
+}
+
+double
+KnobHelper::randomFromState(U32* state,
+                            double min,
+                            double max)
+{
+    *state = hashFunction(*state);
 
-    return ( (double)_imp->lastRandomHash / (double)0x100000000LL ) * (max - min)  + min;
+    return ( (double)*state / (double)0x100000000LL ) * (max - min)  + min;
 }
 
 int
@@ -4261,6 +4289,23 @@ struct alias_cast_float
 void
 KnobHelper::randomSeed(double time,
                        unsigned int seed) const
+{
+    U32 hash32 = getRandomSeed(time, seed);
+
+    QMutexLocker k(&_imp->lastRandomHashMutex);
+    _imp->lastRandomHash = hash32;
+}
+
+U32
+KnobHelper::getExpressionRandomSeed(double time,
+                                    int dimension) const
+{
+    return getRandomSeed( time, hashFunction(dimension) );
+}
+
+U32
+KnobHelper::getRandomSeed(double time,
+                          unsigned int seed) const
 {
     U64 hash = 0;
     KnobHolder* holder = getHolder();
@@ -4278,8 +4323,7 @@ KnobHelper::randomSeed(double time,
     ac.data = (float)time;
     hash32 += ac.raw;
 
-    QMutexLocker k(&_imp->lastRandomHashMutex);
-    _imp->lastRandomHash = hash32;
+    return hash32;
 }
 
 bool
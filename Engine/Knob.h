@@ -790,6 +790,16 @@ public:
      **/
     virtual const std::vector<boost::shared_ptr<Curve>  > & getCurves() const = 0;
 
+    /**
+     * @brief Appends the content of the knob to the given hash: the value of each dimension, or its animation
+     * curve if animated. Slaved dimensions hash their master and expressions hash the expression
+     * along with the knobs it depends on, so that 2 knobs producing the same values produce the same hash.
+     * visitedKnobs holds the knobs already appended: they only append their name again, so that expressions
+     * referencing each other in a cycle do not recurse forever.
+     * Used to compute content-based node hashes, see Node::computeHashInternal()
+     **/
+    virtual void appendToHash(Hash64* hash, std::set<KnobI*>* visitedKnobs) = 0;
+
     /**
      * @brief Activates or deactivates the animation for this parameter. On the GUI side that means
      * the user can never interact with the animation curves nor can he/she set any keyframe.
@@ -1455,6 +1465,13 @@ protected:
     template <typename T>
     static T pyObjectToType(PyObject* o);
 
+    /**
+     * @brief Converts the result of a native expression the same way pyObjectToType would have converted the
+     * Python object. Returns false if the result must be left to Python.
+     **/
+    template <typename T>
+    static bool nativeExpressionResultToType(double value, bool isInt, T* ret);
+
     virtual void refreshListenersAfterValueChange(ViewSpec view, ValueChangedReasonEnum reason, int dimension) OVERRIDE FINAL;
 
 public:
@@ -1595,6 +1612,28 @@ public:
     /// The expression must put its result in the Python variable named "ret"
     static bool executeExpression(const std::string& expr, PyObject** ret, std::string* error);
 
+    /**
+     * @brief Returns the natively compiled version of the expression of the given dimension, or NULL if the
+     * expression could not be compiled and must be evaluated by Python. This does not lock any mutex.
+     **/
+    NativeExpressionPtr getNativeExpression(int dimension) const WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Returns the random state that randomSeed(time, hashFunction(dimension)) sets before the evaluation
+     * of an expression, without modifying the random state of the knob.
+     **/
+    U32 getExpressionRandomSeed(double time, int dimension) const WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Returns the random state that randomSeed(time, seed) sets, without modifying the random state of the knob.
+     **/
+    U32 getRandomSeed(double time, unsigned int seed) const WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Advances the given random state the same way random() does and returns a value in [min, max[
+     **/
+    static double randomFromState(U32* state, double min, double max) WARN_UNUSED_RETURN;
+
     virtual std::pair<int, KnobIPtr> getMaster(int dimension) const OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual bool isSlave(int dimension) const OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual AnimationLevelEnum getAnimationLevel(int dimension) const OVERRIDE FINAL WARN_UNUSED_RETURN;
@@ -1956,6 +1995,17 @@ public:
                          ViewSpec view,
                          ValueChangedReasonEnum reason);
 
+    /**
+     * @brief Sets a keyframe for each of the given times with the corresponding value in the given dimension.
+     * Unlike calling setValueAtTime for each keyframe, the curve is updated in one go and the change
+     * is notified (GUI refresh, hash, render) only once, which is what should be used to bake many keyframes.
+     **/
+    void setValuesAtTimes(const std::vector<double>& times,
+                          const std::vector<T>& values,
+                          ViewSpec view,
+                          int dimension,
+                          ValueChangedReasonEnum reason);
+
     /**
      * @brief Unlike getValueAtTime this function doesn't interpolate the values.
      * Instead the true value of the keyframe at the given index will be returned.
@@ -2031,6 +2081,7 @@ public:
     virtual void cloneDefaultValues(KnobI* other) OVERRIDE FINAL;
     virtual bool cloneAndCheckIfChanged(KnobI* other, int dimension = -1, int otherDimension = -1) OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual bool dequeueValuesSet(bool disableEvaluation) OVERRIDE FINAL;
+    virtual void appendToHash(Hash64* hash, std::set<KnobI*>* visitedKnobs) OVERRIDE;
 
     ///MT-safe
     void setMinimum(const T& mini, int dimension = 0);
@@ -2080,6 +2131,10 @@ private:
 
     T clampToMinMax(const T& value, int dimension) const;
 
+    void appendValueToHash(const T& value, Hash64* hash) const;
+
+    void appendAnimationToHash(int dimension, const boost::shared_ptr<Curve>& curve, Hash64* hash);
+
     void signalMinMaxChanged(const T& mini, const T& maxi, int dimension);
     void signalDisplayMinMaxChanged(const T& mini, const T& maxi, int dimension);
 
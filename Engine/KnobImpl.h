@@ -34,6 +34,7 @@
 #include <stdexcept>
 #include <string>
 #include <algorithm> // min, max
+#include <limits>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
@@ -56,7 +57,9 @@ GCC_DIAG_ON(unused-parameter)
 #include "Engine/AppInstance.h"
 #include "Engine/Project.h"
 #include "Engine/EffectInstance.h"
+#include "Engine/Hash64.h"
 #include "Engine/KnobTypes.h"
+#include "Engine/NativeExpression.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/EngineFwd.h"
 
@@ -369,6 +372,71 @@ KnobHelper::pyObjectToType(PyObject* o)
     return (double)PyFloat_AsDouble(o);
 }
 
+/**
+ * @brief Returns true if the value truncated towards zero fits in an int. Beyond, the conversion done by
+ * pyObjectToType is left to Python (which raises or wraps around depending on the size of a long).
+ **/
+inline bool
+nativeExpressionResultFitsInInt(double value)
+{
+    // Also false for NaN
+    return value > (double)std::numeric_limits<int>::min() - 1. && value < (double)std::numeric_limits<int>::max() + 1.;
+}
+
+template <>
+bool
+KnobHelper::nativeExpressionResultToType(double value,
+                                         bool isInt,
+                                         int* ret)
+{
+#if PY_MAJOR_VERSION >= 3
+    // PyLong_AsLong does not accept floats
+    if (!isInt) {
+        return false;
+    }
+#endif
+    (void)isInt;
+    if ( !nativeExpressionResultFitsInInt(value) ) {
+        return false;
+    }
+    // PyInt_AsLong truncates floats
+    *ret = (int)value;
+
+    return true;
+}
+
+template <>
+bool
+KnobHelper::nativeExpressionResultToType(double value,
+                                         bool /*isInt*/,
+                                         bool* ret)
+{
+    *ret = value != 0.;
+
+    return true;
+}
+
+template <>
+bool
+KnobHelper::nativeExpressionResultToType(double value,
+                                         bool /*isInt*/,
+                                         double* ret)
+{
+    *ret = value;
+
+    return true;
+}
+
+template <>
+bool
+KnobHelper::nativeExpressionResultToType(double /*value*/,
+                                         bool /*isInt*/,
+                                         std::string* /*ret*/)
+{
+    // string expressions are never compiled natively
+    return false;
+}
+
 template <>
 std::string
 KnobHelper::pyObjectToType(PyObject* o)
@@ -428,6 +496,16 @@ Knob<T>::evaluateExpression(double time,
                             T* value,
                             std::string* error)
 {
+    ///Arithmetic expressions are evaluated natively, without taking the GIL
+    NativeExpressionPtr native = getNativeExpression(dimension);
+    if (native) {
+        double result;
+        bool isInt;
+        if ( native->evaluate(this, time, view, &result, &isInt) && nativeExpressionResultToType<T>(result, isInt, value) ) {
+            return true;
+        }
+    }
+
     PythonGILLocker pgl;
     PyObject *ret;
 
@@ -450,6 +528,19 @@ Knob<T>::evaluateExpression_pod(double time,
                                 double* value,
                                 std::string* error)
 {
+    ///Arithmetic expressions are evaluated natively, without taking the GIL
+    NativeExpressionPtr native = getNativeExpression(dimension);
+    if (native) {
+        double result;
+        bool isInt;
+        if ( native->evaluate(this, time, view, &result, &isInt) && ( !isInt || nativeExpressionResultFitsInInt(result) ) ) {
+            // same conversion as below: ints are truncated to int, floats are kept as is
+            *value = isInt ? (double)(int)result : result;
+
+            return true;
+        }
+    }
+
     PythonGILLocker pgl;
     PyObject *ret;
 
@@ -1605,6 +1696,59 @@ Knob<T>::setValueAtTime(double time,
     return ret;
 } // setValueAtTime
 
+template<typename T>
+void
+Knob<T>::setValuesAtTimes(const std::vector<double>& times,
+                          const std::vector<T>& values,
+                          ViewSpec view,
+                          int dimension,
+                          ValueChangedReasonEnum reason)
+{
+    assert( times.size() == values.size() );
+    if ( (dimension < 0) || ( dimension >= (int)_values.size() ) || times.empty() || ( times.size() != values.size() ) ) {
+        return;
+    }
+
+    KnobHolder* holder =  getHolder();
+    bool isPluginEditOnUndoStack = ( holder && (reason == eValueChangedReasonPluginEdited) && getKnobGuiPointer() &&
+                                     (holder->getMultipleParamsEditLevel() != KnobHolder::eMultipleParamsEditOff) );
+    if ( !canAnimate() || !isAnimationEnabled() || isPluginEditOnUndoStack || ( holder && !holder->isSetValueCurrentlyPossible() ) ) {
+        // The values are either not keyframes, recorded on the undo stack or queued: let setValueAtTime handle them
+        KeyFrame newKey;
+        beginChanges();
+        for (std::size_t i = 0; i < times.size(); ++i) {
+            setValueAtTime(times[i], values[i], view, dimension, reason, &newKey);
+        }
+        endChanges();
+
+        return;
+    }
+
+    ///There might be stuff in the queue that must be processed first
+    dequeueValuesSet(true);
+
+    CurvePtr curve = getCurve(view, dimension, true);
+    assert(curve);
+
+    std::vector<KeyFrame> keys( times.size() );
+    std::list<double> keysList;
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        makeKeyFrame(curve.get(), times[i], view, values[i], &keys[i]);
+        keysList.push_back( keys[i].getTime() );
+    }
+    curve->addKeyFrames(keys);
+
+    if (holder) {
+        holder->setHasAnimation(true);
+    }
+    guiCurveCloneInternalCurve(eCurveChangeReasonInternal, view, dimension, reason);
+
+    if (_signalSlotHandler) {
+        _signalSlotHandler->s_multipleKeyFramesSet(keysList, view, dimension, (int)reason);
+    }
+    evaluateValueChange(dimension, getCurrentTime(), view, reason);
+} // setValuesAtTimes
+
 template<typename T>
 void
 Knob<T>::setValuesAtTime(double time,
@@ -3020,6 +3164,100 @@ Knob<T>::copyValuesFromCurve(int dim)
 
 }
 
+template <typename T>
+void
+Knob<T>::appendValueToHash(const T& value,
+                           Hash64* hash) const
+{
+    hash->append(value);
+}
+
+template <>
+void
+KnobStringBase::appendValueToHash(const std::string& value,
+                                  Hash64* hash) const
+{
+    Hash64_appendQString( hash, QString::fromUtf8( value.c_str() ) );
+}
+
+template <typename T>
+void
+Knob<T>::appendAnimationToHash(int /*dimension*/,
+                               const CurvePtr& curve,
+                               Hash64* hash)
+{
+    curve->appendToHash(hash);
+}
+
+template <>
+void
+KnobStringBase::appendAnimationToHash(int dimension,
+                                      const CurvePtr& curve,
+                                      Hash64* hash)
+{
+    curve->appendToHash(hash);
+
+    // The curve only holds indexes into the string animation, also hash the strings themselves
+    int nKeys = curve->getKeyFramesCount();
+    for (int i = 0; i < nKeys; ++i) {
+        bool ok;
+        std::string value = getKeyFrameValueByIndex(ViewIdx(0), dimension, i, &ok);
+        if (ok) {
+            appendValueToHash(value, hash);
+        }
+    }
+}
+
+template <typename T>
+void
+Knob<T>::appendToHash(Hash64* hash,
+                      std::set<KnobI*>* visitedKnobs)
+{
+    if ( !visitedKnobs->insert(this).second ) {
+        Hash64_appendQString( hash, QString::fromUtf8( getName().c_str() ) );
+
+        return;
+    }
+
+    // Knobs hold a single curve per dimension, shared by all views
+    const std::vector<CurvePtr>& curves = getCurves();
+    int dims = getDimension();
+
+    for (int i = 0; i < dims; ++i) {
+        std::string expr = getExpression(i);
+        if ( !expr.empty() ) {
+            // The result of the expression only depends on the knobs it references (and the time, which
+            // is part of the ImageKey for animated effects)
+            Hash64_appendQString( hash, QString::fromUtf8( expr.c_str() ) );
+            std::list<std::pair<KnobIWPtr, int> > dependencies;
+            if ( getExpressionDependencies(i, dependencies) ) {
+                for (std::list<std::pair<KnobIWPtr, int> >::iterator it = dependencies.begin(); it != dependencies.end(); ++it) {
+                    KnobIPtr dep = it->first.lock();
+                    if (dep) {
+                        dep->appendToHash(hash, visitedKnobs);
+                        hash->append(it->second);
+                    }
+                }
+            }
+            continue;
+        }
+
+        std::pair<int, KnobIPtr> master = getMaster(i);
+        if (master.second) {
+            master.second->appendToHash(hash, visitedKnobs);
+            hash->append(master.first);
+            continue;
+        }
+
+        const CurvePtr& curve = curves[i];
+        if ( curve && curve->isAnimated() ) {
+            appendAnimationToHash(i, curve, hash);
+        } else {
+            appendValueToHash(getRawValue(i), hash);
+        }
+    }
+} // appendToHash
+
 NATRON_NAMESPACE_EXIT
 
 #endif // KNOBIMPL_H
@@ -53,6 +53,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/Curve.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/Format.h"
+#include "Engine/Hash64.h"
 #include "Engine/Image.h"
 #include "Engine/KnobFile.h"
 #include "Engine/KnobSerialization.h"
@@ -2285,6 +2286,23 @@ KnobParametric::loadParametricCurves(const std::list<Curve > & curves)
     }
 }
 
+void
+KnobParametric::appendToHash(Hash64* hash,
+                             std::set<KnobI*>* visitedKnobs)
+{
+    if ( visitedKnobs->find(this) != visitedKnobs->end() ) {
+        Hash64_appendQString( hash, QString::fromUtf8( getName().c_str() ) );
+
+        return;
+    }
+    KnobDoubleBase::appendToHash(hash, visitedKnobs);
+
+    ///Mt-safe as Curve is MT-safe
+    for (U32 i = 0; i < _curves.size(); ++i) {
+        _curves[i]->appendToHash(hash);
+    }
+}
+
 void
 KnobParametric::resetExtraToDefaultValue(int dimension)
 {
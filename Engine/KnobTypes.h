@@ -1052,6 +1052,8 @@ public:
 
     void loadParametricCurves(const std::list<Curve > & curves);
 
+    virtual void appendToHash(Hash64* hash, std::set<KnobI*>* visitedKnobs) OVERRIDE FINAL;
+
 Q_SIGNALS:
 
 
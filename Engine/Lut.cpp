@@ -32,6 +32,12 @@
 
 #include "Engine/RectI.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && (_M_IX86_FP >= 2) )
+#define NATRON_LUT_SSE2
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif
+
 /*
  * The to_byte* and from_byte* functions implement and generalize the algorithm
  * described in:
@@ -94,6 +100,99 @@ hipart(const float f)
     }
 }
 
+#ifdef NATRON_LUT_SSE2
+// SSE2 has no gather instruction: the batch conversions below compute the table indices and interpolate
+// four values at a time, only the table look-ups are done one value at a time.
+// SSE2 is only available on x86, which is little-endian, so hipart() is the upper half of each float.
+
+static inline __m128
+load4(const float* from,
+      int delta)
+{
+    if (delta == 1) {
+        return _mm_loadu_ps(from);
+    }
+
+    return _mm_setr_ps(from[0], from[delta], from[2 * delta], from[3 * delta]);
+}
+
+static inline __m128i
+load4(const unsigned short* from,
+      int delta)
+{
+    if (delta == 1) {
+        return _mm_unpacklo_epi16( _mm_loadl_epi64( (const __m128i*)from ), _mm_setzero_si128() );
+    }
+
+    return _mm_setr_epi32(from[0], from[delta], from[2 * delta], from[3 * delta]);
+}
+
+static inline void
+store4(__m128 v,
+       float* to,
+       int delta)
+{
+    if (delta == 1) {
+        _mm_storeu_ps(to, v);
+
+        return;
+    }
+    float tmp[4];
+    _mm_storeu_ps(tmp, v);
+    for (int k = 0; k < 4; ++k) {
+        to[k * delta] = tmp[k];
+    }
+}
+
+// stores the lower 16 bits of each 32-bit integer, as a conversion to unsigned short does
+static inline void
+store4(__m128i v,
+       unsigned short* to,
+       int delta)
+{
+    v = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+    v = _mm_packs_epi32(v, v);
+    if (delta == 1) {
+        _mm_storel_epi64( (__m128i*)to, v );
+
+        return;
+    }
+    to[0] = (unsigned short)_mm_extract_epi16(v, 0);
+    to[delta] = (unsigned short)_mm_extract_epi16(v, 1);
+    to[2 * delta] = (unsigned short)_mm_extract_epi16(v, 2);
+    to[3 * delta] = (unsigned short)_mm_extract_epi16(v, 3);
+}
+
+static inline __m128
+gatherFloat(const float* table,
+            __m128i i)
+{
+    int idx[4];
+
+    _mm_storeu_si128( (__m128i*)idx, i );
+
+    return _mm_setr_ps(table[idx[0]], table[idx[1]], table[idx[2]], table[idx[3]]);
+}
+
+static inline __m128i
+gatherInt(const unsigned short* table,
+          __m128i i)
+{
+    int idx[4];
+
+    _mm_storeu_si128( (__m128i*)idx, i );
+
+    return _mm_setr_epi32(table[idx[0]], table[idx[1]], table[idx[2]], table[idx[3]]);
+}
+
+static inline __m128i
+hipart4(__m128 v)
+{
+    return _mm_srli_epi32(_mm_castps_si128(v), 16);
+}
+
+#endif // NATRON_LUT_SSE2
+
 static float
 index_to_float(const unsigned short i)
 {
@@ -228,7 +327,7 @@ getOffsetsForPacking(PixelPackingEnum format,
 float
 Lut::fromColorSpaceUint8ToLinearFloatFast(unsigned char v) const
 {
-    assert(init_);
+    assert( QtCompat::loadAcquire(_initialized) );
 
     return fromFunc_uint8_to_float[v];
 }
@@ -239,7 +338,7 @@ Lut::fromColorSpaceUint8ToLinearFloatFast(unsigned char v) const
 float
 Lut::toColorSpaceFloatFromLinearFloatFast(float v) const
 {
-    assert(init_);
+    assert( QtCompat::loadAcquire(_initialized) );
 
     return Color::intToFloat<0xff01>(toFunc_hipart_to_uint8xx[hipart(v)]);
 }
@@ -249,7 +348,7 @@ Lut::toColorSpaceFloatFromLinearFloatFast(float v) const
 unsigned char
 Lut::toColorSpaceUint8FromLinearFloatFast(float v) const
 {
-    assert(init_);
+    assert( QtCompat::loadAcquire(_initialized) );
 
     return Color::uint8xxToChar(toFunc_hipart_to_uint8xx[hipart(v)]);
 }
@@ -257,7 +356,7 @@ Lut::toColorSpaceUint8FromLinearFloatFast(float v) const
 unsigned short
 Lut::toColorSpaceUint8xxFromLinearFloatFast(float v) const
 {
-    assert(init_);
+    assert( QtCompat::loadAcquire(_initialized) );
 
     return toFunc_hipart_to_uint8xx[hipart(v)];
 }
@@ -266,7 +365,7 @@ Lut::toColorSpaceUint8xxFromLinearFloatFast(float v) const
 unsigned short
 Lut::toColorSpaceUint16FromLinearFloatFast(float v) const
 {
-    assert(init_);
+    assert( QtCompat::loadAcquire(_initialized) );
     // algorithm:
     // - convert to 8 bits -> val8u
     // - convert val8u-1, val8u and val8u+1 to float
@@ -307,7 +406,7 @@ Lut::toColorSpaceUint16FromLinearFloatFast(float v) const
 float
 Lut::fromColorSpaceUint16ToLinearFloatFast(unsigned short v) const
 {
-    assert(init_);
+    assert( QtCompat::loadAcquire(_initialized) );
     // the following is from ImageMagick's quantum.h
     unsigned char v8u_prev = ( v - (v >> 8) ) >> 8;
     unsigned char v8u_next = v8u_prev + 1;
@@ -320,10 +419,159 @@ Lut::fromColorSpaceUint16ToLinearFloatFast(unsigned short v) const
     return v32f_prev + (v - v16u_prev) * (v32f_next - v32f_prev) / (v16u_next - v16u_prev);
 }
 
+void
+Lut::fromColorSpaceUint8ToLinearFloatFast(const unsigned char* from,
+                                          float* to,
+                                          int n,
+                                          int inDelta,
+                                          int outDelta) const
+{
+    assert( QtCompat::loadAcquire(_initialized) );
+    for (int i = 0; i < n; ++i, from += inDelta, to += outDelta) {
+        *to = fromFunc_uint8_to_float[*from];
+    }
+}
+
+void
+Lut::fromColorSpaceUint16ToLinearFloatFast(const unsigned short* from,
+                                           float* to,
+                                           int n,
+                                           int inDelta,
+                                           int outDelta) const
+{
+    assert( QtCompat::loadAcquire(_initialized) );
+    int i = 0;
+#ifdef NATRON_LUT_SSE2
+    // same computation as fromColorSpaceUint16ToLinearFloatFast(unsigned short), where v16u_next - v16u_prev is 257,
+    // except for 0xffff, which is a byte value and does not need the next one
+    const __m128i byteMax = _mm_set1_epi32(255);
+    const __m128 step = _mm_set1_ps(257.f);
+    for (; i + 4 <= n; i += 4, from += 4 * inDelta, to += 4 * outDelta) {
+        __m128i v = load4(from, inDelta);
+        __m128i v8u_prev = _mm_srli_epi32(_mm_sub_epi32(v, _mm_srli_epi32(v, 8) ), 8);
+        __m128i v8u_next = _mm_add_epi32( v8u_prev, _mm_andnot_si128( _mm_cmpeq_epi32(v8u_prev, byteMax), _mm_set1_epi32(1) ) );
+        __m128i v16u_prev = _mm_add_epi32(_mm_slli_epi32(v8u_prev, 8), v8u_prev);
+        __m128 v32f_prev = gatherFloat(fromFunc_uint8_to_float, v8u_prev);
+        __m128 v32f_next = gatherFloat(fromFunc_uint8_to_float, v8u_next);
+        __m128 d = _mm_mul_ps( _mm_cvtepi32_ps( _mm_sub_epi32(v, v16u_prev) ), _mm_sub_ps(v32f_next, v32f_prev) );
+        store4(_mm_add_ps( v32f_prev, _mm_div_ps(d, step) ), to, outDelta);
+    }
+#endif
+    for (; i < n; ++i, from += inDelta, to += outDelta) {
+        *to = fromColorSpaceUint16ToLinearFloatFast(*from);
+    }
+}
+
+void
+Lut::fromColorSpaceFloatToLinearFloat(const float* from,
+                                      float* to,
+                                      int n,
+                                      int inDelta,
+                                      int outDelta) const
+{
+    for (int i = 0; i < n; ++i, from += inDelta, to += outDelta) {
+        *to = _fromFunc(*from);
+    }
+}
+
+void
+Lut::toColorSpaceUint8xxFromLinearFloatFast(const float* from,
+                                            unsigned short* to,
+                                            int n,
+                                            int inDelta,
+                                            int outDelta) const
+{
+    assert( QtCompat::loadAcquire(_initialized) );
+    int i = 0;
+#ifdef NATRON_LUT_SSE2
+    for (; i + 4 <= n; i += 4, from += 4 * inDelta, to += 4 * outDelta) {
+        store4(gatherInt( toFunc_hipart_to_uint8xx, hipart4( load4(from, inDelta) ) ), to, outDelta);
+    }
+#endif
+    for (; i < n; ++i, from += inDelta, to += outDelta) {
+        *to = toFunc_hipart_to_uint8xx[hipart(*from)];
+    }
+}
+
+void
+Lut::toColorSpaceUint16FromLinearFloatFast(const float* from,
+                                           unsigned short* to,
+                                           int n,
+                                           int inDelta,
+                                           int outDelta) const
+{
+    assert( QtCompat::loadAcquire(_initialized) );
+    int i = 0;
+#ifdef NATRON_LUT_SSE2
+    // same computation as toColorSpaceUint16FromLinearFloatFast(float): the interval is chosen without branches,
+    // and the final rounding is done in double precision as in the scalar version
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i maxPrev = _mm_set1_epi32(254);
+    const __m128d half = _mm_set1_pd(0.5);
+    for (; i + 4 <= n; i += 4, from += 4 * inDelta, to += 4 * outDelta) {
+        __m128 v = load4(from, inDelta);
+        __m128i v8u = _mm_srli_epi32(_mm_add_epi32( gatherInt( toFunc_hipart_to_uint8xx, hipart4(v) ), _mm_set1_epi32(0x80) ), 8);
+        __m128 v32f = gatherFloat(fromFunc_uint8_to_float, v8u);
+        // v8u - 1 if v < v32f, clamped to [0,254]: the values fit in 16 bits, so the 16-bit min and max are enough
+        __m128i v8u_prev = _mm_add_epi32( v8u, _mm_castps_si128( _mm_cmplt_ps(v, v32f) ) );
+        v8u_prev = _mm_min_epi16(_mm_max_epi16(v8u_prev, zero), maxPrev);
+        __m128i v8u_next = _mm_add_epi32( v8u_prev, _mm_set1_epi32(1) );
+        __m128 v32f_prev = gatherFloat(fromFunc_uint8_to_float, v8u_prev);
+        __m128 v32f_next = gatherFloat(fromFunc_uint8_to_float, v8u_next);
+        __m128i scale = _mm_add_epi32( _mm_slli_epi32(_mm_sub_epi32(v8u_next, v8u_prev), 8), _mm_add_epi32(v8u_next, v8u_prev) );
+        __m128 interp = _mm_div_ps( _mm_mul_ps( _mm_sub_ps(v, v32f_prev), _mm_cvtepi32_ps(scale) ), _mm_sub_ps(v32f_next, v32f_prev) );
+        __m128 r = _mm_add_ps( _mm_cvtepi32_ps( _mm_add_epi32(_mm_slli_epi32(v8u_prev, 8), v8u_prev) ), interp );
+        __m128i lo = _mm_cvttpd_epi32( _mm_add_pd(_mm_cvtps_pd(r), half) );
+        __m128i hi = _mm_cvttpd_epi32( _mm_add_pd(_mm_cvtps_pd( _mm_movehl_ps(r, r) ), half) );
+        store4(_mm_unpacklo_epi64(lo, hi), to, outDelta);
+    }
+#endif
+    for (; i < n; ++i, from += inDelta, to += outDelta) {
+        *to = toColorSpaceUint16FromLinearFloatFast(*from);
+    }
+}
+
+void
+Lut::toColorSpaceFloatFromLinearFloat(const float* from,
+                                      float* to,
+                                      int n,
+                                      int inDelta,
+                                      int outDelta) const
+{
+    for (int i = 0; i < n; ++i, from += inDelta, to += outDelta) {
+        *to = _toFunc(*from);
+    }
+}
+
+void
+Lut::toColorSpaceUint8FromLinearFloatFast(const float* from,
+                                          unsigned char* to,
+                                          int n,
+                                          int start,
+                                          int inDelta,
+                                          int outDelta) const
+{
+    assert( QtCompat::loadAcquire(_initialized) );
+    assert(n == 0 || (start >= 0 && start < n));
+
+    /* go forwards from starting point to end of line: */
+    unsigned error = 0x80;
+    for (int i = start; i < n; ++i) {
+        error = (error & 0xff) + toFunc_hipart_to_uint8xx[hipart(from[i * inDelta])];
+        to[i * outDelta] = (unsigned char)(error >> 8);
+    }
+    /* go backwards from starting point to start of line: */
+    error = 0x80;
+    for (int i = start - 1; i >= 0; --i) {
+        error = (error & 0xff) + toFunc_hipart_to_uint8xx[hipart(from[i * inDelta])];
+        to[i * outDelta] = (unsigned char)(error >> 8);
+    }
+}
+
 void
 Lut::fillTables() const
 {
-    if (init_) {
+    if ( QtCompat::loadAcquire(_initialized) ) {
         return;
     }
     // fill all
@@ -466,8 +714,7 @@ Lut::to_byte_packed(unsigned char* to,
     validate();
 
     for (int y = rect.y1; y < rect.y2; ++y) {
-        // coverity[dont_call]
-        int start = rand() % (rect.x2 - rect.x1) + rect.x1;
+        int start = errorDiffusionStart(y, rect.x2 - rect.x1) + rect.x1;
         unsigned error_r, error_g, error_b;
         error_r = error_g = error_b = 0x80;
         int srcY = y;
@@ -39,8 +39,11 @@
 
 CLANG_DIAG_OFF(deprecated)
 #include <QtCore/QMutex>
+#include <QtCore/QAtomicInt>
 CLANG_DIAG_ON(deprecated)
 
+#include "Global/QtCompat.h"
+
 #include "Engine/EngineFwd.h"
 
 #define NATRON_COLOR_HUE_CIRCLE 1. // if hue should be between 0 and 1
@@ -140,8 +143,8 @@ class Lut
     /// and never change afterwards
     mutable unsigned short toFunc_hipart_to_uint8xx[0x10000];         /// contains  2^16 = 65536 values between 0-255
     mutable float fromFunc_uint8_to_float[256];         /// values between 0-1.f
-    mutable bool init_;         ///< false if the tables are not yet initialized
-    mutable QMutex _lock;         ///< protects init_
+    mutable QAtomicInt _initialized;         ///< 0 if the tables are not yet initialized, they never change once it is set
+    mutable QMutex _lock;         ///< serializes the initialization of the tables
 
     friend class LutManager;
     ///private constructor, used by LutManager
@@ -151,7 +154,7 @@ class Lut
         : _name(name)
         , _fromFunc(fromFunc)
         , _toFunc(toFunc)
-        , init_(false)
+        , _initialized(0)
         , _lock()
     {
     }
@@ -181,16 +184,20 @@ public:
         return _toFunc(v);
     }
 
-    //Called by all public members
+    //Called by all public members. Once the tables are initialized, this does not lock.
     void validate() const
     {
+        if ( QtCompat::loadAcquire(_initialized) ) {
+            return;
+        }
+
         QMutexLocker g(&_lock);
 
-        if (init_) {
+        if ( QtCompat::loadAcquire(_initialized) ) {
             return;
         }
         fillTables();
-        init_ = true;
+        _initialized.fetchAndStoreRelease(1);
     }
 
     const std::string & getName() const
@@ -231,6 +238,27 @@ public:
      */
     float fromColorSpaceUint16ToLinearFloatFast(unsigned short v) const;
 
+    /**
+     * @brief Batch versions of the conversions above: they convert n values read every inDelta elements of from
+     * and write them every outDelta elements of to, with the same results as the functions converting one value.
+     * They do not lock: validate() must have been called before.
+     * The short conversions compute four values at a time with SSE2 when it is available.
+     **/
+    void fromColorSpaceUint8ToLinearFloatFast(const unsigned char* from, float* to, int n, int inDelta = 1, int outDelta = 1) const;
+    void fromColorSpaceUint16ToLinearFloatFast(const unsigned short* from, float* to, int n, int inDelta = 1, int outDelta = 1) const;
+    void fromColorSpaceFloatToLinearFloat(const float* from, float* to, int n, int inDelta = 1, int outDelta = 1) const;
+    void toColorSpaceUint8xxFromLinearFloatFast(const float* from, unsigned short* to, int n, int inDelta = 1, int outDelta = 1) const;
+    void toColorSpaceUint16FromLinearFloatFast(const float* from, unsigned short* to, int n, int inDelta = 1, int outDelta = 1) const;
+    void toColorSpaceFloatFromLinearFloat(const float* from, float* to, int n, int inDelta = 1, int outDelta = 1) const;
+
+    /**
+     * @brief Converts a row of n linear values to bytes in the destination color-space, with error diffusion to avoid
+     * posterizing artifacts: the error is diffused from the value at index start to the end of the row, then from
+     * start-1 to the beginning of the row.
+     * @see errorDiffusionStart()
+     **/
+    void toColorSpaceUint8FromLinearFloatFast(const float* from, unsigned char* to, int n, int start, int inDelta = 1, int outDelta = 1) const;
+
 
     /////@TODO the following functions expects a float input buffer, one could extend it to cover all bitdepths.
 
@@ -496,6 +524,27 @@ to_func_srgb(float v)
     }
 }
 
+/**
+ * @brief Returns the index in a row of width pixels from which the quantization error is diffused when converting
+ * the row y to bytes. It varies pseudo-randomly with y to avoid vertical patterns, but only depends on y and width
+ * so that rows can be converted concurrently and always give the same result.
+ **/
+inline int
+errorDiffusionStart(int y,
+                    int width)
+{
+    // 32-bit integer hash with a low bias, see https://nullprogram.com/blog/2018/07/31/
+    unsigned int h = (unsigned int)y;
+
+    h ^= h >> 16;
+    h *= 0x7feb352dU;
+    h ^= h >> 15;
+    h *= 0x846ca68bU;
+    h ^= h >> 16;
+
+    return width <= 0 ? 0 : (int)(h % (unsigned int)width);
+}
+
 // r,g,b values are from 0 to 1
 // h = [0,NATRON_COLOR_HUE_CIRCLE], s = [0,1], v = [0,1]
 //		if s == 0, then h = 0 (undefined)
@@ -241,7 +241,6 @@ getPeakRSS( )
 }
 #endif // 0
 
-#if 0 // not used for now
 /**
  * Returns the current resident set size (physical memory use) measured
  * in bytes, or zero if the value cannot be determined on this OS.
@@ -298,7 +297,45 @@ getCurrentRSS( )
     return (size_t)0L;          /* Unsupported. */
 #endif
 } // getCurrentRSS
-#endif // 0
+
+/**
+ * Returns the user and system CPU time used so far by all threads
+ * of the process, in seconds, or zero if the value cannot be
+ * determined on this OS.
+ */
+double
+getProcessCPUTime()
+{
+#if defined(_WIN32)
+    /* Windows -------------------------------------------------- */
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if ( !GetProcessTimes( GetCurrentProcess( ), &creationTime, &exitTime, &kernelTime, &userTime ) ) {
+        return 0.;
+    }
+    ULARGE_INTEGER kernel, user;
+    kernel.LowPart = kernelTime.dwLowDateTime;
+    kernel.HighPart = kernelTime.dwHighDateTime;
+    user.LowPart = userTime.dwLowDateTime;
+    user.HighPart = userTime.dwHighDateTime;
+
+    // FILETIME is in 100 nanoseconds units
+    return (double)(kernel.QuadPart + user.QuadPart) * 1e-7;
+
+#elif defined(__unix__) || defined(__unix) || defined(unix) || (defined(__APPLE__) && defined(__MACH__ ) )
+    /* BSD, Linux, and OSX -------------------------------------- */
+    struct rusage rusage;
+    if (getrusage( RUSAGE_SELF, &rusage ) != 0) {
+        return 0.;
+    }
+
+    return (double)(rusage.ru_utime.tv_sec + rusage.ru_stime.tv_sec) + (double)(rusage.ru_utime.tv_usec + rusage.ru_stime.tv_usec) * 1e-6;
+
+#else
+
+    /* Unknown OS ----------------------------------------------- */
+    return 0.;                  /* Unsupported. */
+#endif
+}
 
 
 std::size_t
@@ -57,13 +57,20 @@ QString printAsRAM(U64 bytes);
  * determined on this OS.
  */
 std::size_t getPeakRSS( );
+#endif // 0
 
 /**
  * Returns the current resident set size (physical memory use) measured
  * in bytes, or zero if the value cannot be determined on this OS.
  */
 std::size_t getCurrentRSS( );
-#endif // 0
+
+/**
+ * Returns the user and system CPU time used so far by all threads
+ * of the process, in seconds, or zero if the value cannot be
+ * determined on this OS.
+ */
+double getProcessCPUTime();
 
 std::size_t getAmountFreePhysicalRAM();
 
@@ -0,0 +1,343 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "MipMapKernels.h"
+
+#include <cassert>
+#include <cstring> // memcpy
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && (_M_IX86_FP >= 2) )
+#define NATRON_MIPMAP_KERNELS_SSE2
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif
+
+NATRON_NAMESPACE_ENTER
+namespace MipMapKernels {
+////////////////////////////////////////// Scalar //////////////////////////////////////////
+
+namespace Scalar {
+template <typename PIX>
+static void
+halveRowsForDepth(const PIX* row0,
+                  const PIX* row1,
+                  int dstWidth,
+                  int nComps,
+                  PIX* dst)
+{
+    for (int x = 0; x < dstWidth; ++x, row0 += 2 * nComps, row1 += 2 * nComps, dst += nComps) {
+        for (int k = 0; k < nComps; ++k) {
+            ///a b
+            ///c d
+            dst[k] = (row0[k] + row0[k + nComps] + row1[k] + row1[k + nComps]) / 4;
+        }
+    }
+}
+
+void
+halveRows(const unsigned char* row0,
+          const unsigned char* row1,
+          int dstWidth,
+          int nComps,
+          unsigned char* dst)
+{
+    halveRowsForDepth(row0, row1, dstWidth, nComps, dst);
+}
+
+void
+halveRows(const unsigned short* row0,
+          const unsigned short* row1,
+          int dstWidth,
+          int nComps,
+          unsigned short* dst)
+{
+    halveRowsForDepth(row0, row1, dstWidth, nComps, dst);
+}
+
+void
+halveRows(const float* row0,
+          const float* row1,
+          int dstWidth,
+          int nComps,
+          float* dst)
+{
+    halveRowsForDepth(row0, row1, dstWidth, nComps, dst);
+}
+} // namespace Scalar
+
+////////////////////////////////////////// SSE2 //////////////////////////////////////////
+
+namespace SSE2 {
+#ifdef NATRON_MIPMAP_KERNELS_SSE2
+
+// All depths are summed as floats: the sum of 4 bytes or shorts is exact in a float, and so is its product by 0.25,
+// which truncated gives the same result as the integer division of the scalar code.
+
+// Loads 4 consecutive values as floats
+static inline __m128
+load4(const float* p)
+{
+    return _mm_loadu_ps(p);
+}
+
+static inline __m128
+load4(const unsigned short* p)
+{
+    __m128i v = _mm_loadl_epi64( (const __m128i*)p );
+
+    return _mm_cvtepi32_ps( _mm_unpacklo_epi16( v, _mm_setzero_si128() ) );
+}
+
+static inline __m128
+load4(const unsigned char* p)
+{
+    int i;
+
+    std::memcpy( &i, p, sizeof(i) );
+    __m128i v = _mm_unpacklo_epi8( _mm_cvtsi32_si128(i), _mm_setzero_si128() );
+
+    return _mm_cvtepi32_ps( _mm_unpacklo_epi16( v, _mm_setzero_si128() ) );
+}
+
+// Stores the 4 averages of the given sums
+static inline void
+storeAverage4(float* p,
+              __m128 sum)
+{
+    _mm_storeu_ps( p, _mm_mul_ps( sum, _mm_set1_ps(0.25f) ) );
+}
+
+static inline void
+storeAverage4(unsigned short* p,
+              __m128 sum)
+{
+    __m128i v = _mm_cvttps_epi32( _mm_mul_ps( sum, _mm_set1_ps(0.25f) ) );
+
+    // There is no unsigned saturating pack of 32-bit integers in SSE2: shift to the signed range and back
+    v = _mm_packs_epi32( _mm_sub_epi32( v, _mm_set1_epi32(32768) ), _mm_setzero_si128() );
+    v = _mm_xor_si128( v, _mm_set1_epi16( (short)0x8000 ) );
+    _mm_storel_epi64( (__m128i*)p, v );
+}
+
+static inline void
+storeAverage4(unsigned char* p,
+              __m128 sum)
+{
+    __m128i v = _mm_cvttps_epi32( _mm_mul_ps( sum, _mm_set1_ps(0.25f) ) );
+
+    v = _mm_packus_epi16( _mm_packs_epi32( v, _mm_setzero_si128() ), _mm_setzero_si128() );
+    int i = _mm_cvtsi128_si32(v);
+    std::memcpy( p, &i, sizeof(i) );
+}
+
+// Sums in the same order as the scalar code
+static inline __m128
+sum4(__m128 a,
+     __m128 b,
+     __m128 c,
+     __m128 d)
+{
+    return _mm_add_ps( _mm_add_ps( _mm_add_ps(a, b), c ), d );
+}
+
+template <typename PIX>
+static void
+halveRowsForDepth(const PIX* row0,
+                  const PIX* row1,
+                  int dstWidth,
+                  int nComps,
+                  PIX* dst)
+{
+    int x = 0;
+
+    switch (nComps) {
+    case 1:
+        // 4 pixels at a time, the left and right source pixels are deinterleaved
+        for (; x + 4 <= dstWidth; x += 4) {
+            __m128 r0a = load4(row0 + 2 * x);
+            __m128 r0b = load4(row0 + 2 * x + 4);
+            __m128 r1a = load4(row1 + 2 * x);
+            __m128 r1b = load4(row1 + 2 * x + 4);
+            __m128 a = _mm_shuffle_ps( r0a, r0b, _MM_SHUFFLE(2, 0, 2, 0) );
+            __m128 b = _mm_shuffle_ps( r0a, r0b, _MM_SHUFFLE(3, 1, 3, 1) );
+            __m128 c = _mm_shuffle_ps( r1a, r1b, _MM_SHUFFLE(2, 0, 2, 0) );
+            __m128 d = _mm_shuffle_ps( r1a, r1b, _MM_SHUFFLE(3, 1, 3, 1) );
+            storeAverage4( dst + x, sum4(a, b, c, d) );
+        }
+        break;
+    case 2:
+        // 2 pixels at a time
+        for (; x + 2 <= dstWidth; x += 2) {
+            __m128 r0a = load4(row0 + 4 * x);
+            __m128 r0b = load4(row0 + 4 * x + 4);
+            __m128 r1a = load4(row1 + 4 * x);
+            __m128 r1b = load4(row1 + 4 * x + 4);
+            __m128 a = _mm_shuffle_ps( r0a, r0b, _MM_SHUFFLE(1, 0, 1, 0) );
+            __m128 b = _mm_shuffle_ps( r0a, r0b, _MM_SHUFFLE(3, 2, 3, 2) );
+            __m128 c = _mm_shuffle_ps( r1a, r1b, _MM_SHUFFLE(1, 0, 1, 0) );
+            __m128 d = _mm_shuffle_ps( r1a, r1b, _MM_SHUFFLE(3, 2, 3, 2) );
+            storeAverage4( dst + 2 * x, sum4(a, b, c, d) );
+        }
+        break;
+    case 3:
+        // 1 pixel at a time: the 4th value stored is garbage but is overwritten by the next pixel,
+        // the last pixel is left to the scalar code so that nothing is read nor written past the rows
+        for (; x + 1 < dstWidth; ++x) {
+            __m128 a = load4(row0 + 6 * x);
+            __m128 b = load4(row0 + 6 * x + 3);
+            __m128 c = load4(row1 + 6 * x);
+            __m128 d = load4(row1 + 6 * x + 3);
+            storeAverage4( dst + 3 * x, sum4(a, b, c, d) );
+        }
+        break;
+    case 4:
+        for (; x < dstWidth; ++x) {
+            __m128 a = load4(row0 + 8 * x);
+            __m128 b = load4(row0 + 8 * x + 4);
+            __m128 c = load4(row1 + 8 * x);
+            __m128 d = load4(row1 + 8 * x + 4);
+            storeAverage4( dst + 4 * x, sum4(a, b, c, d) );
+        }
+        break;
+    default:
+        break;
+    }
+    Scalar::halveRows(row0 + 2 * x * nComps, row1 + 2 * x * nComps, dstWidth - x, nComps, dst + x * nComps);
+} // halveRowsForDepth
+
+bool
+isAvailable()
+{
+    return true;
+}
+
+void
+halveRows(const unsigned char* row0,
+          const unsigned char* row1,
+          int dstWidth,
+          int nComps,
+          unsigned char* dst)
+{
+    halveRowsForDepth(row0, row1, dstWidth, nComps, dst);
+}
+
+void
+halveRows(const unsigned short* row0,
+          const unsigned short* row1,
+          int dstWidth,
+          int nComps,
+          unsigned short* dst)
+{
+    halveRowsForDepth(row0, row1, dstWidth, nComps, dst);
+}
+
+void
+halveRows(const float* row0,
+          const float* row1,
+          int dstWidth,
+          int nComps,
+          float* dst)
+{
+    halveRowsForDepth(row0, row1, dstWidth, nComps, dst);
+}
+
+#else // !NATRON_MIPMAP_KERNELS_SSE2
+
+bool
+isAvailable()
+{
+    return false;
+}
+
+void
+halveRows(const unsigned char* row0,
+          const unsigned char* row1,
+          int dstWidth,
+          int nComps,
+          unsigned char* dst)
+{
+    Scalar::halveRows(row0, row1, dstWidth, nComps, dst);
+}
+
+void
+halveRows(const unsigned short* row0,
+          const unsigned short* row1,
+          int dstWidth,
+          int nComps,
+          unsigned short* dst)
+{
+    Scalar::halveRows(row0, row1, dstWidth, nComps, dst);
+}
+
+void
+halveRows(const float* row0,
+          const float* row1,
+          int dstWidth,
+          int nComps,
+          float* dst)
+{
+    Scalar::halveRows(row0, row1, dstWidth, nComps, dst);
+}
+
+#endif // NATRON_MIPMAP_KERNELS_SSE2
+} // namespace SSE2
+
+////////////////////////////////////////// Dispatch //////////////////////////////////////////
+
+void
+halveRows(const unsigned char* row0,
+          const unsigned char* row1,
+          int dstWidth,
+          int nComps,
+          unsigned char* dst)
+{
+    assert(row0 && row1 && dst && dstWidth >= 0);
+    SSE2::halveRows(row0, row1, dstWidth, nComps, dst);
+}
+
+void
+halveRows(const unsigned short* row0,
+          const unsigned short* row1,
+          int dstWidth,
+          int nComps,
+          unsigned short* dst)
+{
+    assert(row0 && row1 && dst && dstWidth >= 0);
+    SSE2::halveRows(row0, row1, dstWidth, nComps, dst);
+}
+
+void
+halveRows(const float* row0,
+          const float* row1,
+          int dstWidth,
+          int nComps,
+          float* dst)
+{
+    assert(row0 && row1 && dst && dstWidth >= 0);
+    SSE2::halveRows(row0, row1, dstWidth, nComps, dst);
+}
+} // namespace MipMapKernels
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,67 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_MIPMAPKERNELS_H
+#define NATRON_ENGINE_MIPMAPKERNELS_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+#include "Global/GlobalDefines.h"
+
+///
+/// Row kernels used by Image::halveRoI to build the mipmap levels of an image with a 2x2 box filter, for the pixels
+/// whose 4 source pixels are all inside the source image.
+/// They compute exactly what the generic per-pixel code computes: the 4 values are summed in the same order and
+/// divided by 4, the result being truncated for integer depths, so that the vectorized versions give the same output bit for bit.
+///
+
+NATRON_NAMESPACE_ENTER
+namespace MipMapKernels {
+/**
+ * @brief Halves two consecutive rows of pixels with nComps interleaved components:
+ * dst[x*nComps+k] = (row0[2x*nComps+k] + row0[(2x+1)*nComps+k] + row1[2x*nComps+k] + row1[(2x+1)*nComps+k]) / 4
+ * for x in [0, dstWidth). row0 and row1 must have at least 2*dstWidth pixels.
+ **/
+void halveRows(const unsigned char* row0, const unsigned char* row1, int dstWidth, int nComps, unsigned char* dst);
+void halveRows(const unsigned short* row0, const unsigned short* row1, int dstWidth, int nComps, unsigned short* dst);
+void halveRows(const float* row0, const float* row1, int dstWidth, int nComps, float* dst);
+
+///The functions above dispatch at run-time to the fastest of the implementations below available on the CPU.
+namespace Scalar {
+void halveRows(const unsigned char* row0, const unsigned char* row1, int dstWidth, int nComps, unsigned char* dst);
+void halveRows(const unsigned short* row0, const unsigned short* row1, int dstWidth, int nComps, unsigned short* dst);
+void halveRows(const float* row0, const float* row1, int dstWidth, int nComps, float* dst);
+}
+
+namespace SSE2 {
+bool isAvailable();
+void halveRows(const unsigned char* row0, const unsigned char* row1, int dstWidth, int nComps, unsigned char* dst);
+void halveRows(const unsigned short* row0, const unsigned short* row1, int dstWidth, int nComps, unsigned short* dst);
+void halveRows(const float* row0, const float* row1, int dstWidth, int nComps, float* dst);
+}
+} // namespace MipMapKernels
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_MIPMAPKERNELS_H
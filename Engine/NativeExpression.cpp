@@ -0,0 +1,1116 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "NativeExpression.h"
+
+#include <cassert>
+#include <cctype> // isdigit, isalpha
+#include <cmath>
+#include <cstdlib> // strtod
+#include <cstring>
+#include <set>
+#include <stdexcept>
+
+#include <boost/math/special_functions/fpclassify.hpp>
+
+#include "Engine/EffectInstance.h"
+#include "Engine/Knob.h"
+#include "Engine/Node.h"
+#include "Engine/NodeGroup.h"
+
+// Python ints are arbitrary precision: beyond 2^53 the doubles we use would not be exact anymore, leave that to Python
+#define NATIVE_EXPRESSION_MAX_INT 9007199254740992.
+
+#ifndef M_PI
+#define M_PI        3.14159265358979323846264338327950288   /* pi             */
+#endif
+#ifndef M_E
+#define M_E         2.71828182845904523536028747135266250   /* e              */
+#endif
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+enum FunctionEnum
+{
+    eFunctionSin = 0,
+    eFunctionCos,
+    eFunctionTan,
+    eFunctionAsin,
+    eFunctionAcos,
+    eFunctionAtan,
+    eFunctionAtan2,
+    eFunctionSinh,
+    eFunctionCosh,
+    eFunctionTanh,
+    eFunctionExp,
+    eFunctionLog,
+    eFunctionLog10,
+    eFunctionSqrt,
+    eFunctionPow,
+    eFunctionFabs,
+    eFunctionFloor,
+    eFunctionCeil,
+    eFunctionFmod,
+    eFunctionHypot,
+    eFunctionDegrees,
+    eFunctionRadians,
+    eFunctionAbs,
+    eFunctionMin,
+    eFunctionMax,
+    eFunctionInt,
+    eFunctionFloat
+};
+
+struct FunctionDef
+{
+    const char* name;
+    FunctionEnum function;
+    int minArgs;
+    int maxArgs; // -1: unbounded
+};
+
+// The functions of the math module (imported with "from math import *" in the main module) and the builtins we handle
+const FunctionDef functionDefs[] = {
+    { "sin", eFunctionSin, 1, 1 },
+    { "cos", eFunctionCos, 1, 1 },
+    { "tan", eFunctionTan, 1, 1 },
+    { "asin", eFunctionAsin, 1, 1 },
+    { "acos", eFunctionAcos, 1, 1 },
+    { "atan", eFunctionAtan, 1, 1 },
+    { "atan2", eFunctionAtan2, 2, 2 },
+    { "sinh", eFunctionSinh, 1, 1 },
+    { "cosh", eFunctionCosh, 1, 1 },
+    { "tanh", eFunctionTanh, 1, 1 },
+    { "exp", eFunctionExp, 1, 1 },
+    { "log", eFunctionLog, 1, 2 },
+    { "log10", eFunctionLog10, 1, 1 },
+    { "sqrt", eFunctionSqrt, 1, 1 },
+    { "pow", eFunctionPow, 2, 2 },
+    { "fabs", eFunctionFabs, 1, 1 },
+    { "floor", eFunctionFloor, 1, 1 },
+    { "ceil", eFunctionCeil, 1, 1 },
+    { "fmod", eFunctionFmod, 2, 2 },
+    { "hypot", eFunctionHypot, 2, 2 },
+    { "degrees", eFunctionDegrees, 1, 1 },
+    { "radians", eFunctionRadians, 1, 1 },
+    { "abs", eFunctionAbs, 1, 1 },
+    { "min", eFunctionMin, 2, -1 },
+    { "max", eFunctionMax, 2, -1 },
+    { "int", eFunctionInt, 1, 1 },
+    { "float", eFunctionFloat, 1, 1 },
+    { 0, eFunctionSin, 0, 0 }
+};
+
+const FunctionDef*
+findFunction(const std::string& name)
+{
+    for (const FunctionDef* f = functionDefs; f->name; ++f) {
+        if (name == f->name) {
+            return f;
+        }
+    }
+
+    return 0;
+}
+
+struct ExprValue
+{
+    double v;
+    bool isInt; // true if Python would hold an int (or a bool)
+};
+
+enum TokenTypeEnum
+{
+    eTokenTypeNumber = 0,
+    eTokenTypeName,
+    eTokenTypeOperator,
+    eTokenTypeEnd
+};
+
+struct Token
+{
+    TokenTypeEnum type;
+    std::string text;
+    double number;
+    bool isInt;
+};
+
+/**
+ * @brief Splits the expression in tokens. Returns false if it contains anything we do not handle (strings,
+ * comparisons, brackets, octal or hexadecimal literals...)
+ **/
+bool
+tokenize(const std::string& expr,
+         std::vector<Token>* tokens)
+{
+    std::size_t i = 0;
+    const std::size_t n = expr.size();
+
+    while (i < n) {
+        char c = expr[i];
+        if ( (c == ' ') || (c == '\t') ) {
+            ++i;
+            continue;
+        }
+        Token t;
+        t.number = 0.;
+        t.isInt = false;
+        if ( std::isdigit( (unsigned char)c ) || ( (c == '.') && (i + 1 < n) && std::isdigit( (unsigned char)expr[i + 1] ) ) ) {
+            std::size_t start = i;
+            bool isInt = true;
+            while ( i < n && std::isdigit( (unsigned char)expr[i] ) ) {
+                ++i;
+            }
+            if ( (i < n) && (expr[i] == '.') ) {
+                isInt = false;
+                ++i;
+                while ( i < n && std::isdigit( (unsigned char)expr[i] ) ) {
+                    ++i;
+                }
+            }
+            if ( (i < n) && ( (expr[i] == 'e') || (expr[i] == 'E') ) ) {
+                std::size_t expStart = i;
+                ++i;
+                if ( (i < n) && ( (expr[i] == '+') || (expr[i] == '-') ) ) {
+                    ++i;
+                }
+                if ( (i >= n) || !std::isdigit( (unsigned char)expr[i] ) ) {
+                    i = expStart;
+                } else {
+                    isInt = false;
+                    while ( i < n && std::isdigit( (unsigned char)expr[i] ) ) {
+                        ++i;
+                    }
+                }
+            }
+            t.type = eTokenTypeNumber;
+            t.text = expr.substr(start, i - start);
+            // 012 is an octal literal in Python 2 and a syntax error in Python 3
+            if ( isInt && (t.text.size() > 1) && (t.text[0] == '0') ) {
+                return false;
+            }
+            t.number = std::strtod(t.text.c_str(), 0);
+            t.isInt = isInt;
+            if ( isInt && (t.number > NATIVE_EXPRESSION_MAX_INT) ) {
+                return false;
+            }
+        } else if ( std::isalpha( (unsigned char)c ) || (c == '_') ) {
+            std::size_t start = i;
+            while ( i < n && ( std::isalnum( (unsigned char)expr[i] ) || (expr[i] == '_') ) ) {
+                ++i;
+            }
+            t.type = eTokenTypeName;
+            t.text = expr.substr(start, i - start);
+        } else if ( (i + 1 < n) && ( ( (c == '*') && (expr[i + 1] == '*') ) || ( (c == '/') && (expr[i + 1] == '/') ) ) ) {
+            t.type = eTokenTypeOperator;
+            t.text = expr.substr(i, 2);
+            i += 2;
+        } else if ( (c != '\0') && std::strchr("+-*/%(),.", c) ) {
+            t.type = eTokenTypeOperator;
+            t.text = std::string(1, c);
+            ++i;
+        } else {
+            return false;
+        }
+        tokens->push_back(t);
+    }
+
+    Token end;
+    end.type = eTokenTypeEnd;
+    end.number = 0.;
+    end.isInt = false;
+    tokens->push_back(end);
+
+    return true;
+} // tokenize
+
+inline bool
+isValidResult(const ExprValue& v)
+{
+    // Python raises on most operations producing an infinity or a NaN: let it report the error
+    if ( !(boost::math::isfinite)(v.v) ) {
+        return false;
+    }
+
+    return !v.isInt || std::fabs(v.v) <= NATIVE_EXPRESSION_MAX_INT;
+}
+
+inline bool
+isIntegral(double v)
+{
+    return std::floor(v) == v;
+}
+
+/// Python's float_divmod: returns the floor division, mod receives the modulo which has the sign of b
+double
+pythonFloorDiv(double a,
+               double b,
+               double* mod)
+{
+    assert(b != 0.);
+    double m = std::fmod(a, b);
+    double div = (a - m) / b;
+    if (m != 0.) {
+        if ( (b < 0.) != (m < 0.) ) {
+            m += b;
+            div -= 1.;
+        }
+    } else {
+        m = b < 0. ? -0. : 0.;
+    }
+    double floordiv;
+    if (div != 0.) {
+        floordiv = std::floor(div);
+        if (div - floordiv > 0.5) {
+            floordiv += 1.;
+        }
+    } else {
+        floordiv = a / b < 0. ? -0. : 0.;
+    }
+    if (mod) {
+        *mod = m;
+    }
+
+    return floordiv;
+}
+
+bool
+callFunction(int function,
+             const ExprValue* args,
+             int nArgs,
+             ExprValue* ret)
+{
+    // math functions convert their arguments to float and return a float
+    ret->isInt = false;
+    switch ( (FunctionEnum)function ) {
+    case eFunctionSin:
+        ret->v = std::sin(args[0].v);
+        break;
+    case eFunctionCos:
+        ret->v = std::cos(args[0].v);
+        break;
+    case eFunctionTan:
+        ret->v = std::tan(args[0].v);
+        break;
+    case eFunctionAsin:
+        if (std::fabs(args[0].v) > 1.) {
+            return false;
+        }
+        ret->v = std::asin(args[0].v);
+        break;
+    case eFunctionAcos:
+        if (std::fabs(args[0].v) > 1.) {
+            return false;
+        }
+        ret->v = std::acos(args[0].v);
+        break;
+    case eFunctionAtan:
+        ret->v = std::atan(args[0].v);
+        break;
+    case eFunctionAtan2:
+        ret->v = std::atan2(args[0].v, args[1].v);
+        break;
+    case eFunctionSinh:
+        ret->v = std::sinh(args[0].v);
+        break;
+    case eFunctionCosh:
+        ret->v = std::cosh(args[0].v);
+        break;
+    case eFunctionTanh:
+        ret->v = std::tanh(args[0].v);
+        break;
+    case eFunctionExp:
+        ret->v = std::exp(args[0].v);
+        break;
+    case eFunctionLog:
+        if ( (args[0].v <= 0.) || ( (nArgs == 2) && ( (args[1].v <= 0.) || (args[1].v == 1.) ) ) ) {
+            return false;
+        }
+        ret->v = nArgs == 2 ? std::log(args[0].v) / std::log(args[1].v) : std::log(args[0].v);
+        break;
+    case eFunctionLog10:
+        if (args[0].v <= 0.) {
+            return false;
+        }
+        ret->v = std::log10(args[0].v);
+        break;
+    case eFunctionSqrt:
+        if (args[0].v < 0.) {
+            return false;
+        }
+        ret->v = std::sqrt(args[0].v);
+        break;
+    case eFunctionPow:
+        if ( ( (args[0].v < 0.) && !isIntegral(args[1].v) ) || ( (args[0].v == 0.) && (args[1].v < 0.) ) ) {
+            return false;
+        }
+        ret->v = std::pow(args[0].v, args[1].v);
+        break;
+    case eFunctionFabs:
+        ret->v = std::fabs(args[0].v);
+        break;
+    case eFunctionFloor:
+        ret->v = std::floor(args[0].v);
+#if PY_MAJOR_VERSION >= 3
+        ret->isInt = true;
+#endif
+        break;
+    case eFunctionCeil:
+        ret->v = std::ceil(args[0].v);
+#if PY_MAJOR_VERSION >= 3
+        ret->isInt = true;
+#endif
+        break;
+    case eFunctionFmod:
+        if (args[1].v == 0.) {
+            return false;
+        }
+        ret->v = std::fmod(args[0].v, args[1].v);
+        break;
+    case eFunctionHypot:
+        ret->v = ::hypot(args[0].v, args[1].v);
+        break;
+    case eFunctionDegrees:
+        ret->v = args[0].v * (180. / M_PI);
+        break;
+    case eFunctionRadians:
+        ret->v = args[0].v * (M_PI / 180.);
+        break;
+    case eFunctionAbs:
+        ret->v = std::fabs(args[0].v);
+        ret->isInt = args[0].isInt;
+        break;
+    case eFunctionMin:
+    case eFunctionMax: {
+        // Python returns the first extremum, with its type
+        *ret = args[0];
+        for (int i = 1; i < nArgs; ++i) {
+            if ( (function == eFunctionMin) ? (args[i].v < ret->v) : (args[i].v > ret->v) ) {
+                *ret = args[i];
+            }
+        }
+        break;
+    }
+    case eFunctionInt:
+        ret->v = args[0].v < 0. ? std::ceil(args[0].v) : std::floor(args[0].v);
+        ret->isInt = true;
+        break;
+    case eFunctionFloat:
+        ret->v = args[0].v;
+        break;
+    }
+
+    return isValidResult(*ret);
+} // callFunction
+
+bool
+getKnobValue(const KnobIPtr& knob,
+             int dimension,
+             bool atTime,
+             double time,
+             ExprValue* ret)
+{
+    if ( (dimension < 0) || ( dimension >= knob->getDimension() ) ) {
+        return false;
+    }
+    // Same calls as the Python Param classes
+    if ( KnobDoubleBase* isDouble = dynamic_cast<KnobDoubleBase*>( knob.get() ) ) {
+        ret->v = atTime ? isDouble->getValueAtTime(time, dimension) : isDouble->getValue(dimension);
+        ret->isInt = false;
+    } else if ( KnobIntBase* isInt = dynamic_cast<KnobIntBase*>( knob.get() ) ) {
+        ret->v = atTime ? isInt->getValueAtTime(time, dimension) : isInt->getValue(dimension);
+        ret->isInt = true;
+    } else if ( KnobBoolBase* isBool = dynamic_cast<KnobBoolBase*>( knob.get() ) ) {
+        ret->v = ( atTime ? isBool->getValueAtTime(time, dimension) : isBool->getValue(dimension) ) ? 1. : 0.;
+        ret->isInt = true;
+    } else {
+        return false;
+    }
+
+    return isValidResult(*ret);
+}
+
+/// Converts a value used as a dimension index, Python would raise if it is not an int
+inline bool
+toDimension(const ExprValue& v,
+            int* dimension)
+{
+    if (!v.isInt) {
+        return false;
+    }
+    *dimension = (int)v.v;
+
+    return true;
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+
+/**
+ * @brief Recursive descent parser of the subset of the Python grammar handled by NativeExpression.
+ * Instructions are emitted in reverse polish notation as the expression is parsed.
+ **/
+struct NativeExpressionParser
+{
+    NativeExpression* expr;
+    KnobHelper* knob;
+    std::vector<Token> tokens;
+    std::size_t pos;
+    int stackDepth;
+    int maxStackDepth;
+
+    // The nodes reachable by their script-name from the expression, as declared by declarePythonVariables()
+    NodesList siblings;
+    std::set<std::string> siblingNames;
+    NodePtr thisNode;
+
+    NativeExpressionParser(NativeExpression* expr,
+                           KnobHelper* knob)
+        : expr(expr)
+        , knob(knob)
+        , tokens()
+        , pos(0)
+        , stackDepth(0)
+        , maxStackDepth(0)
+        , siblings()
+        , siblingNames()
+        , thisNode()
+    {
+        EffectInstance* effect = knob ? dynamic_cast<EffectInstance*>( knob->getHolder() ) : 0;
+
+        if (effect) {
+            thisNode = effect->getNode();
+        }
+        NodeCollectionPtr collection = thisNode ? thisNode->getGroup() : NodeCollectionPtr();
+        if (collection) {
+            NodesList nodes = collection->getNodes();
+            for (NodesList::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+                if ( (*it)->isActivated() && !(*it)->getParentMultiInstance() ) {
+                    siblings.push_back(*it);
+                    siblingNames.insert( (*it)->getScriptName_mt_safe() );
+                }
+            }
+        }
+    }
+
+    const Token& peek() const
+    {
+        return tokens[pos];
+    }
+
+    bool peekOperator(const char* op) const
+    {
+        return tokens[pos].type == eTokenTypeOperator && tokens[pos].text == op;
+    }
+
+    bool acceptOperator(const char* op)
+    {
+        if ( peekOperator(op) ) {
+            ++pos;
+
+            return true;
+        }
+
+        return false;
+    }
+
+    void emit(const NativeExpression::Instruction& instr,
+              int stackDelta)
+    {
+        expr->_code.push_back(instr);
+        stackDepth += stackDelta;
+        if (stackDepth > maxStackDepth) {
+            maxStackDepth = stackDepth;
+        }
+    }
+
+    void emitOp(NativeExpression::OpCodeEnum op,
+                int nArgs,
+                int nPushed = 1)
+    {
+        NativeExpression::Instruction instr;
+
+        instr.op = op;
+        instr.nArgs = nArgs;
+        emit(instr, nPushed - nArgs);
+    }
+
+    void emitConstant(double value,
+                      bool isInt)
+    {
+        NativeExpression::Instruction instr;
+
+        instr.op = NativeExpression::eOpCodeConstant;
+        instr.value = value;
+        instr.isInt = isInt;
+        emit(instr, 1);
+    }
+
+    bool parse()
+    {
+        if ( !parseExpression() ) {
+            return false;
+        }
+
+        return peek().type == eTokenTypeEnd && maxStackDepth <= NATRON_NATIVE_EXPRESSION_MAX_STACK;
+    }
+
+    // arith := term (('+'|'-') term)*
+    bool parseExpression()
+    {
+        if ( !parseTerm() ) {
+            return false;
+        }
+        for (;;) {
+            NativeExpression::OpCodeEnum op;
+            if ( acceptOperator("+") ) {
+                op = NativeExpression::eOpCodeAdd;
+            } else if ( acceptOperator("-") ) {
+                op = NativeExpression::eOpCodeSub;
+            } else {
+                return true;
+            }
+            if ( !parseTerm() ) {
+                return false;
+            }
+            emitOp(op, 2);
+        }
+    }
+
+    // term := factor (('*'|'/'|'//'|'%') factor)*
+    bool parseTerm()
+    {
+        if ( !parseFactor() ) {
+            return false;
+        }
+        for (;;) {
+            NativeExpression::OpCodeEnum op;
+            if ( acceptOperator("*") ) {
+                op = NativeExpression::eOpCodeMul;
+            } else if ( acceptOperator("/") ) {
+                op = NativeExpression::eOpCodeDiv;
+            } else if ( acceptOperator("//") ) {
+                op = NativeExpression::eOpCodeFloorDiv;
+            } else if ( acceptOperator("%") ) {
+                op = NativeExpression::eOpCodeMod;
+            } else {
+                return true;
+            }
+            if ( !parseFactor() ) {
+                return false;
+            }
+            emitOp(op, 2);
+        }
+    }
+
+    // factor := ('+'|'-') factor | power
+    bool parseFactor()
+    {
+        if ( acceptOperator("-") ) {
+            if ( !parseFactor() ) {
+                return false;
+            }
+            emitOp(NativeExpression::eOpCodeNeg, 1);
+
+            return true;
+        } else if ( acceptOperator("+") ) {
+            return parseFactor();
+        }
+
+        return parsePower();
+    }
+
+    // power := primary ['**' factor], so that -2**2 == -4 as in Python
+    bool parsePower()
+    {
+        if ( !parsePrimary() ) {
+            return false;
+        }
+        if ( acceptOperator("**") ) {
+            if ( !parseFactor() ) {
+                return false;
+            }
+            emitOp(NativeExpression::eOpCodePow, 2);
+        }
+
+        return true;
+    }
+
+    // primary := NUMBER | '(' arith ')' | name
+    bool parsePrimary()
+    {
+        const Token& t = peek();
+
+        if (t.type == eTokenTypeNumber) {
+            ++pos;
+            emitConstant(t.number, t.isInt);
+
+            return true;
+        } else if ( acceptOperator("(") ) {
+            return parseExpression() && acceptOperator(")");
+        } else if (t.type == eTokenTypeName) {
+            return parseName();
+        }
+
+        return false;
+    }
+
+    // Parses the arguments of a call, the opening parenthesis was already read
+    bool parseArguments(int* nArgs)
+    {
+        *nArgs = 0;
+        if ( acceptOperator(")") ) {
+            return true;
+        }
+        for (;;) {
+            if ( !parseExpression() ) {
+                return false;
+            }
+            ++*nArgs;
+            if ( acceptOperator(")") ) {
+                return true;
+            }
+            if ( !acceptOperator(",") ) {
+                return false;
+            }
+        }
+    }
+
+    // name := NAME ('.' NAME)* ['(' arguments ')' ['.' NAME]]
+    bool parseName()
+    {
+        std::vector<std::string> path;
+
+        path.push_back(peek().text);
+        ++pos;
+        while ( acceptOperator(".") ) {
+            if (peek().type != eTokenTypeName) {
+                return false;
+            }
+            path.push_back(peek().text);
+            ++pos;
+        }
+
+        if ( !acceptOperator("(") ) {
+            return path.size() == 1 && parseVariable(path[0]);
+        }
+
+        int nArgs;
+        if ( !parseArguments(&nArgs) ) {
+            return false;
+        }
+
+        std::string method = path.back();
+        path.pop_back();
+
+        // random, randomInt and curve are bound to thisParam
+        if ( path.empty() || ( (path.size() == 1) && (path[0] == "thisParam") ) ) {
+            if ( (method == "random") && ( (nArgs == 0) || (nArgs == 2) || (nArgs == 4) ) ) {
+                emitOp(NativeExpression::eOpCodeRandom, nArgs);
+
+                return knob != 0;
+            } else if ( (method == "randomInt") && ( (nArgs == 2) || (nArgs == 4) ) ) {
+                emitOp(NativeExpression::eOpCodeRandomInt, nArgs);
+
+                return knob != 0;
+            } else if ( (method == "curve") && ( (nArgs == 1) || (nArgs == 2) ) ) {
+                emitOp(NativeExpression::eOpCodeCurve, nArgs);
+
+                return knob != 0;
+            }
+        }
+
+        if ( path.empty() ) {
+            const FunctionDef* f = findFunction(method);
+            if ( !f || isShadowed(method) || (nArgs < f->minArgs) || ( (f->maxArgs != -1) && (nArgs > f->maxArgs) ) ) {
+                return false;
+            }
+            NativeExpression::Instruction instr;
+            instr.op = NativeExpression::eOpCodeFunction;
+            instr.function = (int)f->function;
+            instr.nArgs = nArgs;
+            emit(instr, 1 - nArgs);
+
+            return true;
+        }
+
+        NativeExpression::KnobReference ref;
+        ref.knob = resolveParam(path, &ref.node, &ref.nodeName);
+        KnobIPtr param = ref.knob.lock();
+        if (!param) {
+            return false;
+        }
+
+        NativeExpression::Instruction instr;
+        instr.nArgs = nArgs;
+        instr.knob = (int)expr->_knobs.size();
+        if ( (method == "get") && (nArgs <= 1) ) {
+            instr.op = NativeExpression::eOpCodeKnobGet;
+            // Multi-dimensional parameters return a tuple of which we need one member
+            if (param->getDimension() > 1) {
+                if ( !acceptOperator(".") || (peek().type != eTokenTypeName) ) {
+                    return false;
+                }
+                const std::string& member = peek().text;
+                ++pos;
+                if ( (member == "x") || (member == "r") ) {
+                    instr.dimension = 0;
+                } else if ( (member == "y") || (member == "g") ) {
+                    instr.dimension = 1;
+                } else if ( (member == "z") || (member == "b") ) {
+                    instr.dimension = 2;
+                } else if ( (member == "w") || (member == "a") ) {
+                    instr.dimension = 3;
+                } else {
+                    return false;
+                }
+                if ( instr.dimension >= param->getDimension() ) {
+                    return false;
+                }
+            }
+        } else if ( (method == "getValue") && (nArgs <= 1) ) {
+            instr.op = NativeExpression::eOpCodeKnobGetValue;
+        } else if ( (method == "getValueAtTime") && (nArgs >= 1) && (nArgs <= 2) ) {
+            instr.op = NativeExpression::eOpCodeKnobGetValueAtTime;
+        } else {
+            return false;
+        }
+        expr->_knobs.push_back(ref);
+        emit(instr, 1 - nArgs);
+
+        return true;
+    } // parseName
+
+    // Returns true if the name is declared as a node in the scope of the Python expression function
+    bool isShadowed(const std::string& name) const
+    {
+        return siblingNames.find(name) != siblingNames.end();
+    }
+
+    bool parseVariable(const std::string& name)
+    {
+        // frame and view are the arguments of the expression function, but the nodes declared in the function shadow them
+        if ( isShadowed(name) ) {
+            return false;
+        }
+        if (name == "frame") {
+            emitOp(NativeExpression::eOpCodeFrame, 0);
+        } else if (name == "view") {
+            emitOp(NativeExpression::eOpCodeView, 0);
+        } else if (name == "dimension") {
+            emitConstant(expr->_dimension, true);
+        } else if (name == "pi") {
+            emitConstant(M_PI, false);
+        } else if (name == "e") {
+            emitConstant(M_E, false);
+        } else {
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Returns the parameter designated by path, which may be thisParam, thisNode.<param>, <node>.<param> or
+     * thisGroup.<node>.<param>. Only parameters holding numbers are returned.
+     * The node referenced by its script-name, if any, is returned in siblingNode and siblingName.
+     **/
+    KnobIPtr resolveParam(const std::vector<std::string>& path,
+                          NodeWPtr* siblingNode,
+                          std::string* siblingName) const
+    {
+        if (!knob) {
+            return KnobIPtr();
+        }
+        KnobIPtr param;
+        if ( (path.size() == 1) && (path[0] == "thisParam") ) {
+            param = knob->shared_from_this();
+        } else {
+            NodePtr node;
+            std::string paramName;
+            if ( (path.size() == 2) && (path[0] == "thisNode") ) {
+                node = thisNode;
+                paramName = path[1];
+            } else if ( (path.size() == 3) && (path[0] == "thisGroup") ) {
+                node = findSibling(path[1]);
+                paramName = path[2];
+                *siblingNode = node;
+                *siblingName = path[1];
+            } else if ( (path.size() == 2) && (path[0] != "thisGroup") && (path[0] != "thisParam") ) {
+                node = findSibling(path[0]);
+                paramName = path[1];
+                *siblingNode = node;
+                *siblingName = path[0];
+            }
+            if (!node) {
+                return KnobIPtr();
+            }
+            param = node->getKnobByName(paramName);
+        }
+        if ( !param || ( !dynamic_cast<KnobDoubleBase*>( param.get() ) && !dynamic_cast<KnobIntBase*>( param.get() ) &&
+                         !dynamic_cast<KnobBoolBase*>( param.get() ) ) ) {
+            return KnobIPtr();
+        }
+
+        return param;
+    }
+
+    NodePtr findSibling(const std::string& name) const
+    {
+        for (NodesList::const_iterator it = siblings.begin(); it != siblings.end(); ++it) {
+            if ( (*it)->getScriptName_mt_safe() == name ) {
+                return *it;
+            }
+        }
+
+        return NodePtr();
+    }
+};
+
+NativeExpression::NativeExpression(int dimension)
+    : _dimension(dimension)
+    , _code()
+    , _knobs()
+{
+}
+
+NativeExpression::~NativeExpression()
+{
+}
+
+NativeExpressionPtr
+NativeExpression::compile(const std::string& expression,
+                          KnobHelper* knob,
+                          int dimension)
+{
+    boost::shared_ptr<NativeExpression> ret( new NativeExpression(dimension) );
+
+    try {
+        NativeExpressionParser parser(ret.get(), knob);
+        if ( !tokenize(expression, &parser.tokens) || !parser.parse() ) {
+            return NativeExpressionPtr();
+        }
+    } catch (const std::exception& /*e*/) {
+        // e.g boost::bad_weak_ptr if the knob is not owned by a shared_ptr yet
+        return NativeExpressionPtr();
+    }
+
+    return ret;
+}
+
+bool
+NativeExpression::evaluate(KnobHelper* knob,
+                           double time,
+                           ViewIdx view,
+                           double* value,
+                           bool* isInt) const
+{
+    ExprValue stack[NATRON_NATIVE_EXPRESSION_MAX_STACK];
+    int sp = 0;
+    // The random state is local to the evaluation: the knob is reseeded before each Python evaluation anyway
+    U32 randomState = 0;
+    bool randomSeeded = false;
+
+    for (std::vector<Instruction>::const_iterator it = _code.begin(); it != _code.end(); ++it) {
+        ExprValue* args = stack + sp - it->nArgs;
+        ExprValue res;
+        assert(args >= stack);
+        switch (it->op) {
+        case eOpCodeConstant:
+            res.v = it->value;
+            res.isInt = it->isInt;
+            break;
+        case eOpCodeFrame:
+            res.v = time;
+            // the time is passed to Python as a literal, which is an int for integer frames
+            res.isInt = isIntegral(time);
+            break;
+        case eOpCodeView:
+            res.v = (double)view;
+            res.isInt = true;
+            break;
+        case eOpCodeAdd:
+            res.v = args[0].v + args[1].v;
+            res.isInt = args[0].isInt && args[1].isInt;
+            break;
+        case eOpCodeSub:
+            res.v = args[0].v - args[1].v;
+            res.isInt = args[0].isInt && args[1].isInt;
+            break;
+        case eOpCodeMul:
+            res.v = args[0].v * args[1].v;
+            res.isInt = args[0].isInt && args[1].isInt;
+            break;
+        case eOpCodeDiv:
+            if (args[1].v == 0.) {
+                return false;
+            }
+#if PY_MAJOR_VERSION < 3
+            if (args[0].isInt && args[1].isInt) {
+                // Python 2 divides integers with floor division
+                res.v = pythonFloorDiv(args[0].v, args[1].v, 0);
+                res.isInt = true;
+                break;
+            }
+#endif
+            res.v = args[0].v / args[1].v;
+            res.isInt = false;
+            break;
+        case eOpCodeFloorDiv:
+            if (args[1].v == 0.) {
+                return false;
+            }
+            res.v = pythonFloorDiv(args[0].v, args[1].v, 0);
+            res.isInt = args[0].isInt && args[1].isInt;
+            break;
+        case eOpCodeMod:
+            if (args[1].v == 0.) {
+                return false;
+            }
+            (void)pythonFloorDiv(args[0].v, args[1].v, &res.v);
+            res.isInt = args[0].isInt && args[1].isInt;
+            break;
+        case eOpCodePow:
+            if ( (args[0].v == 0.) && (args[1].v < 0.) ) {
+                return false;
+            }
+            if ( (args[0].v < 0.) && !isIntegral(args[1].v) ) {
+                return false;
+            }
+            res.v = std::pow(args[0].v, args[1].v);
+            res.isInt = args[0].isInt && args[1].isInt && args[1].v >= 0.;
+            break;
+        case eOpCodeNeg:
+            res.v = -args[0].v;
+            res.isInt = args[0].isInt;
+            break;
+        case eOpCodeFunction:
+            if ( !callFunction(it->function, args, it->nArgs, &res) ) {
+                return false;
+            }
+            break;
+        case eOpCodeRandom:
+        case eOpCodeRandomInt: {
+            double min = 0., max = 1.;
+            if (it->nArgs >= 2) {
+                min = args[0].v;
+                max = args[1].v;
+            }
+            if (it->op == eOpCodeRandomInt) {
+                if (!args[0].isInt || !args[1].isInt) {
+                    return false;
+                }
+            }
+            if (it->nArgs == 4) {
+                if ( !args[3].isInt || (args[3].v < 0.) ) {
+                    return false;
+                }
+                randomState = knob->getRandomSeed(args[2].v, (unsigned int)args[3].v);
+                randomSeeded = true;
+            } else if (!randomSeeded) {
+                randomState = knob->getExpressionRandomSeed(time, _dimension);
+                randomSeeded = true;
+            }
+            res.v = KnobHelper::randomFromState(&randomState, min, max);
+            res.isInt = false;
+            if (it->op == eOpCodeRandomInt) {
+                res.v = (int)res.v;
+                res.isInt = true;
+            }
+            break;
+        }
+        case eOpCodeCurve: {
+            int dim = 0;
+            if ( (it->nArgs == 2) && !toDimension(args[1], &dim) ) {
+                return false;
+            }
+            if ( (dim < 0) || ( dim >= knob->getDimension() ) ) {
+                return false;
+            }
+            res.v = knob->getRawCurveValueAt(args[0].v, view, dim);
+            res.isInt = false;
+            break;
+        }
+        case eOpCodeKnobGet:
+        case eOpCodeKnobGetValue:
+        case eOpCodeKnobGetValueAtTime: {
+            const KnobReference& ref = _knobs[it->knob];
+            KnobIPtr other = ref.knob.lock();
+            if (!other) {
+                return false;
+            }
+            if ( !ref.nodeName.empty() ) {
+                // Python looks the node up by its script-name on each evaluation
+                NodePtr node = ref.node.lock();
+                if ( !node || !node->isActivated() || (node->getScriptName_mt_safe() != ref.nodeName) ) {
+                    return false;
+                }
+            }
+            bool atTime = false;
+            double t = 0.;
+            int dim = 0;
+            if (it->op == eOpCodeKnobGet) {
+                dim = it->dimension;
+                atTime = it->nArgs == 1;
+                t = atTime ? args[0].v : 0.;
+            } else if (it->op == eOpCodeKnobGetValue) {
+                if ( (it->nArgs == 1) && !toDimension(args[0], &dim) ) {
+                    return false;
+                }
+            } else {
+                atTime = true;
+                t = args[0].v;
+                if ( (it->nArgs == 2) && !toDimension(args[1], &dim) ) {
+                    return false;
+                }
+            }
+            if ( !getKnobValue(other, dim, atTime, t, &res) ) {
+                return false;
+            }
+            break;
+        }
+        } // switch
+
+        if ( !isValidResult(res) ) {
+            return false;
+        }
+        sp -= it->nArgs;
+        assert(sp >= 0 && sp < NATRON_NATIVE_EXPRESSION_MAX_STACK);
+        stack[sp++] = res;
+    }
+
+    assert(sp == 1);
+    if (sp != 1) {
+        return false;
+    }
+    *value = stack[0].v;
+    *isInt = stack[0].isInt;
+
+    return true;
+} // NativeExpression::evaluate
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,159 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_NATIVEEXPRESSION_H
+#define NATRON_ENGINE_NATIVEEXPRESSION_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+#include <vector>
+
+#include "Engine/ViewIdx.h"
+#include "Engine/EngineFwd.h"
+
+/// Maximum depth of the evaluation stack of a native expression. Expressions needing more are left to Python.
+#define NATRON_NATIVE_EXPRESSION_MAX_STACK 32
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief A knob expression compiled to a small stack program, so that it can be evaluated without Python.
+ * Only single-line expressions made of the following are handled:
+ * - numbers, + - * / // % ** and parenthesis, with the semantics of the Python version Natron is built with
+ * - frame, view, dimension, pi, e
+ * - the functions of the math module exposed to expressions (sin, cos, exp, log, sqrt, pow, floor...) and abs, min, max, int, float
+ * - random() and randomInt() with the same seeding as the Python functions
+ * - curve(frame[, dimension]) on this parameter
+ * - get(), get(frame), getValue([dimension]), getValueAtTime(frame[, dimension]) on this parameter or on the parameters of
+ *   thisNode or of the nodes of the same group, referenced by their script-name, optionally through thisGroup.
+ * Anything else is left to Python.
+ *
+ * As in the Python expression function, the names of the nodes of the group are bound when the expression is compiled
+ * and the nodes are looked-up by script-name when it is evaluated: if a referenced node was deactivated or renamed,
+ * the evaluation is left to Python.
+ *
+ * A compiled expression is immutable: evaluate() may be called concurrently from any thread and does not take any lock
+ * besides those taken to read the value of the referenced parameters.
+ **/
+class NativeExpression
+{
+public:
+
+    enum OpCodeEnum
+    {
+        eOpCodeConstant = 0,
+        eOpCodeFrame,
+        eOpCodeView,
+        eOpCodeAdd,
+        eOpCodeSub,
+        eOpCodeMul,
+        eOpCodeDiv,
+        eOpCodeFloorDiv,
+        eOpCodeMod,
+        eOpCodePow,
+        eOpCodeNeg,
+        eOpCodeFunction,
+        eOpCodeRandom,
+        eOpCodeRandomInt,
+        eOpCodeCurve,
+        eOpCodeKnobGet,
+        eOpCodeKnobGetValue,
+        eOpCodeKnobGetValueAtTime
+    };
+
+    struct Instruction
+    {
+        OpCodeEnum op;
+        double value; // eOpCodeConstant
+        bool isInt; // eOpCodeConstant
+        int function; // eOpCodeFunction
+        int nArgs; // number of values popped from the stack
+        int knob; // index in _knobs for the eOpCodeKnob* instructions
+        int dimension; // eOpCodeKnobGet: the dimension of the tuple returned by get() that is used
+
+        Instruction()
+            : op(eOpCodeConstant)
+            , value(0.)
+            , isInt(false)
+            , function(-1)
+            , nArgs(0)
+            , knob(-1)
+            , dimension(0)
+        {
+        }
+    };
+
+private:
+
+    NativeExpression(int dimension);
+
+public:
+
+    ~NativeExpression();
+
+    /**
+     * @brief Compiles the given expression, as it was entered by the user.
+     * The knob is the parameter holding the expression, it is used to resolve thisParam, thisNode, thisGroup and the
+     * node names. It may be NULL in which case only the expressions not referencing any parameter compile.
+     * Returns NULL if the expression cannot be compiled, it must then be evaluated by Python.
+     * Must be called on the main-thread as it reads the node graph.
+     **/
+    static NativeExpressionPtr compile(const std::string& expression, KnobHelper* knob, int dimension);
+
+    /**
+     * @brief Evaluates the expression at the given time and view. The knob must be the one passed to compile().
+     * isInt is set to true if Python would have returned an int (or a bool), false if it would have returned a float.
+     * Returns false if the result could not be computed natively (e.g a referenced parameter was removed, or Python
+     * would raise an exception such as a division by zero): in that case the expression must be evaluated by Python,
+     * which will produce the same result or the error to report to the user.
+     **/
+    bool evaluate(KnobHelper* knob, double time, ViewIdx view, double* value, bool* isInt) const WARN_UNUSED_RETURN;
+
+    int getDimension() const
+    {
+        return _dimension;
+    }
+
+private:
+
+    friend struct NativeExpressionParser;
+
+    struct KnobReference
+    {
+        KnobIWPtr knob;
+        // The node referenced by its script-name in the expression, NULL for thisParam and thisNode
+        NodeWPtr node;
+        std::string nodeName;
+    };
+
+    int _dimension;
+    std::vector<Instruction> _code;
+    std::vector<KnobReference> _knobs;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_NATIVEEXPRESSION_H
@@ -32,6 +32,8 @@
 #include <cassert>
 #include <stdexcept>
 #include <sstream> // stringstream
+#include <set>
+#include <vector>
 
 #include "Global/Macros.h"
 
@@ -49,6 +51,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include <QtCore/QWaitCondition>
 #include <QtCore/QTextStream>
 #include <QtCore/QFile>
+#include <QtCore/QFileInfo>
 #include <QtCore/QRegExp>
 
 #include <ofxNatron.h>
@@ -69,6 +72,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/GroupOutput.h"
 #include "Engine/GenericSchedulerThreadWatcher.h"
 #include "Engine/Hash64.h"
+#include "Engine/HashCone.h"
 #include "Engine/Image.h"
 #include "Engine/ImageParams.h"
 #include "Engine/Knob.h"
@@ -796,6 +800,16 @@ Node::computeHashInternal()
         qDebug() << "Node::computeHash(): inputs not initialized";
     }
 
+    // When content-based, the hash only depends on what the node renders so that it remains the same across sessions
+    // and 2 identical branches of the graph produce the same hash.
+    // Roto shapes are not knobs, so nodes with a roto context keep relying on the knobs age.
+    const bool contentBased = appPTR->getCurrentSettings()->isContentBasedNodeHashEnabled() && canUseContentBasedHash();
+    Hash64 contentHash;
+    if (contentBased) {
+        // Computed before taking the lock since knobs with expressions may query other nodes
+        appendContentToHash(&contentHash);
+    }
+
     U64 oldHash, newHash;
     {
         QWriteLocker l(&_imp->knobsAgeMutex);
@@ -805,8 +819,14 @@ Node::computeHashInternal()
         ///reset the hash value
         _imp->hash.reset();
 
-        ///append the effect's own age
-        _imp->hash.append(_imp->knobsAge);
+        if (contentBased) {
+            contentHash.computeHash();
+            _imp->hash.append( contentHash.value() );
+            _imp->hash.append(_imp->contentHashAge);
+        } else {
+            ///append the effect's own age
+            _imp->hash.append(_imp->knobsAge);
+        }
 
         ///append all inputs hash
         RotoDrawableItemPtr attachedStroke = _imp->paintStroke.lock();
@@ -854,13 +874,15 @@ Node::computeHashInternal()
         //            _imp->hash.append(rotoAge);
         //        }
 
-        ///Also append the effect's label to distinguish 2 instances with the same parameters
-        Hash64_appendQString( &_imp->hash, QString::fromUtf8( getScriptName().c_str() ) );
+        if (!contentBased) {
+            ///Also append the effect's label to distinguish 2 instances with the same parameters
+            Hash64_appendQString( &_imp->hash, QString::fromUtf8( getScriptName().c_str() ) );
 
-        ///Also append the project's creation time in the hash because 2 projects opened concurrently
-        ///could reproduce the same (especially simple graphs like Viewer-Reader)
-        qint64 creationTime =  getApp()->getProject()->getProjectCreationTime();
-        _imp->hash.append(creationTime);
+            ///Also append the project's creation time in the hash because 2 projects opened concurrently
+            ///could reproduce the same (especially simple graphs like Viewer-Reader)
+            qint64 creationTime =  getApp()->getProject()->getProjectCreationTime();
+            _imp->hash.append(creationTime);
+        }
 
         _imp->hash.computeHash();
 
@@ -870,10 +892,12 @@ Node::computeHashInternal()
 
     if (hashChanged) {
         _imp->effect->onNodeHashChanged(newHash);
-        if ( _imp->nodeCreated && !getApp()->getProject()->isProjectClosing() ) {
+        if ( !contentBased && _imp->nodeCreated && !getApp()->getProject()->isProjectClosing() ) {
             /*
              * We changed the node hash. That means all cache entries for this node with a different hash
              * are impossible to re-create again. Just discard them all. This is done in a separate thread.
+             * With a content-based hash, an older hash is produced again as soon as the knobs get back to their
+             * older values and entries may be shared with other nodes: leave them to the LRU eviction.
              */
             removeAllImagesFromCacheWithMatchingIDAndDifferentKey(newHash);
         }
@@ -882,25 +906,85 @@ Node::computeHashInternal()
     return hashChanged;
 } // Node::computeHashInternal
 
+bool
+Node::canUseContentBasedHash() const
+{
+    // The shapes of a roto context are not knobs and their changes are only reflected by the knobs age
+    if ( _imp->rotoContext || _imp->paintStroke.lock() ) {
+        return false;
+    }
+
+    return !_imp->effect->isRotoPaintNode();
+}
+
 void
-Node::computeHashRecursive(std::list<Node*>& marked)
+Node::appendContentToHash(Hash64* hash) const
 {
-    if ( std::find(marked.begin(), marked.end(), this) != marked.end() ) {
-        return;
+    ///Always called in the main thread
+    assert( QThread::currentThread() == qApp->thread() );
+
+    // The plug-in and its version, so that 2 plug-ins with the same parameters do not collide and so that
+    // updating a plug-in invalidates its images
+    Hash64_appendQString( hash, QString::fromUtf8( getPluginID().c_str() ) );
+    hash->append( getMajorVersion() );
+    hash->append( getMinorVersion() );
+
+    // Knobs that do not trigger a render when changed do not change the output of the node
+    const std::vector<KnobIPtr> & knobs = getKnobs();
+    for (std::vector<KnobIPtr>::const_iterator it = knobs.begin(); it != knobs.end(); ++it) {
+        if ( !(*it)->getEvaluateOnChange() ) {
+            continue;
+        }
+        Hash64_appendQString( hash, QString::fromUtf8( (*it)->getName().c_str() ) );
+        std::set<KnobI*> visitedKnobs;
+        (*it)->appendToHash(hash, &visitedKnobs);
+
+        // The content of the files read by the node is not held by the knob: also hash the size and the
+        // modification date of each file of the sequence, so that a file changed on disk is not read from the cache
+        KnobFile* isFile = dynamic_cast<KnobFile*>( it->get() );
+        if ( isFile && isFile->isInputImageFile() ) {
+            std::string pattern = isFile->getValue();
+            getApp()->getProject()->canonicalizePath(pattern);
+            SequenceParsing::SequenceFromPattern files;
+            FileSystemModel::filesListFromPattern(pattern, &files);
+            for (SequenceParsing::SequenceFromPattern::const_iterator it2 = files.begin(); it2 != files.end(); ++it2) {
+                for (std::map<int, std::string>::const_iterator it3 = it2->second.begin(); it3 != it2->second.end(); ++it3) {
+                    QFileInfo info( QString::fromUtf8( it3->second.c_str() ) );
+                    hash->append( info.size() );
+                    hash->append( info.lastModified().toMSecsSinceEpoch() );
+                }
+            }
+        }
     }
 
-    bool hasChanged = computeHashInternal();
-    marked.push_back(this);
-    if (!hasChanged) {
-        //Nothing changed, no need to recurse on outputs
-        return;
+    {
+        QMutexLocker k(&_imp->createdComponentsMutex);
+        for (std::list<ImagePlaneDesc>::const_iterator it = _imp->createdComponents.begin(); it != _imp->createdComponents.end(); ++it) {
+            Hash64_appendQString( hash, QString::fromUtf8( it->getPlaneID().c_str() ) );
+            const std::vector<std::string>& channels = it->getChannels();
+            for (std::size_t c = 0; c < channels.size(); ++c) {
+                Hash64_appendQString( hash, QString::fromUtf8( channels[c].c_str() ) );
+            }
+        }
     }
 
+    // Some effects depend on the project format, which was previously reflected by incrementing the knobs age
+    // of all nodes
+    Format projectFormat;
+    getApp()->getProject()->getProjectDefaultFormat(&projectFormat);
+    hash->append(projectFormat.x1);
+    hash->append(projectFormat.y1);
+    hash->append(projectFormat.x2);
+    hash->append(projectFormat.y2);
+    hash->append( projectFormat.getPixelAspectRatio() );
+} // Node::appendContentToHash
 
+void
+Node::getHashDependents(std::vector<NodePtr>* dependents) const
+{
     bool isRotoPaint = _imp->effect->isRotoPaintNode();
-
-    ///call it on all the outputs
     NodesList outputs;
+
     getOutputsWithGroupRedirection(outputs);
     for (NodesList::iterator it = outputs.begin(); it != outputs.end(); ++it) {
         assert(*it);
@@ -910,20 +994,55 @@ Node::computeHashRecursive(std::list<Node*>& marked)
         if ( isRotoPaint && attachedStroke && (attachedStroke->getContext()->getNode().get() == this) ) {
             continue;
         }
-        (*it)->computeHashRecursive(marked);
+        dependents->push_back(*it);
     }
 
-
-    ///If the node has a rotopaint tree, compute the hash of the nodes in the tree
+    ///If the node has a rotopaint tree, the nodes in the tree depend on it
     if (_imp->rotoContext) {
         NodesList allItems;
         _imp->rotoContext->getRotoPaintTreeNodes(&allItems);
-        for (NodesList::iterator it = allItems.begin(); it != allItems.end(); ++it) {
-            (*it)->computeHashRecursive(marked);
-        }
+        dependents->insert( dependents->end(), allItems.begin(), allItems.end() );
     }
 }
 
+void
+Node::HashDependentsFunctor::operator()(Node* node,
+                                        std::vector<Node*>* dependents) const
+{
+    std::vector<NodePtr> nodes;
+
+    node->getHashDependents(&nodes);
+    for (std::vector<NodePtr>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        dependents->push_back( it->get() );
+    }
+}
+
+bool
+Node::ComputeHashFunctor::operator()(Node* node) const
+{
+    return node->computeHashInternal();
+}
+
+void
+Node::computeHashOfDirtyCone(const std::vector<Node*>& nodes)
+{
+    // Compute the hash of the given nodes first: the nodes downstream only need to be visited if it changed
+    std::vector<Node*> changedNodes;
+    {
+        std::set<Node*> computed;
+        for (std::vector<Node*>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+            if ( computed.insert(*it).second && (*it)->computeHashInternal() ) {
+                changedNodes.push_back(*it);
+            }
+        }
+    }
+    if ( changedNodes.empty() ) {
+        return;
+    }
+
+    HashCone<Node*>::propagate( changedNodes, HashDependentsFunctor(), ComputeHashFunctor() );
+} // Node::computeHashOfDirtyCone
+
 void
 Node::removeAllImagesFromCacheWithMatchingIDAndDifferentKey(U64 nodeHashKey)
 {
@@ -977,8 +1096,7 @@ Node::computeHash()
 
         return;
     }
-    std::list<Node*> marked;
-    computeHashRecursive(marked);
+    computeHashOfDirtyCone( std::vector<Node*>(1, this) );
 } // computeHash
 
 
@@ -1301,6 +1419,14 @@ Node::incrementKnobsAge()
     computeHash();
 }
 
+void
+Node::incrementContentHashAge()
+{
+    QWriteLocker l(&_imp->knobsAgeMutex);
+
+    ++_imp->contentHashAge;
+}
+
 U64
 Node::getKnobsAge() const
 {
@@ -4917,12 +5043,13 @@ Node::onEffectKnobValueChanged(KnobI* what,
             ///When a group is disabled we have to force a hash change of all nodes inside otherwise the image will stay cached
 
             NodesList nodes = isGroup->getNodes();
-            std::list<Node*> markedNodes;
+            std::vector<Node*> groupNodes;
             for (NodesList::iterator it = nodes.begin(); it != nodes.end(); ++it) {
                 //This will not trigger a hash recomputation
                 (*it)->incrementKnobsAge_internal();
-                (*it)->computeHashRecursive(markedNodes);
+                groupNodes.push_back( it->get() );
             }
+            computeHashOfDirtyCone(groupNodes);
         }
     } else if ( what == _imp->nodeLabelKnob.lock().get() ) {
         Q_EMIT nodeExtraLabelChanged( QString::fromUtf8( _imp->nodeLabelKnob.lock()->getValue().c_str() ) );
@@ -873,6 +873,13 @@ public:
 
     void incrementKnobsAge_internal();
 
+    /**
+     * @brief When the content-based hash is used, the knobs age is not part of the hash.
+     * Call this when the node must render again even though none of its knobs values changed
+     * (e.g: a button was pressed).
+     **/
+    void incrementContentHashAge();
+
 public:
 
 
@@ -1333,7 +1340,27 @@ private:
 
     bool setStreamWarningInternal(StreamWarningEnum warning, const QString& message);
 
-    void computeHashRecursive(std::list<Node*>& marked);
+    /**
+     * @brief Refreshes the hash of the given nodes, then of the nodes downstream of the ones whose hash changed,
+     * in topological order and stopping wherever the hash remains the same.
+     **/
+    static void computeHashOfDirtyCone(const std::vector<Node*>& nodes);
+
+    /**
+     * @brief Returns the nodes whose hash depends on the hash of this node
+     **/
+    void getHashDependents(std::vector<NodePtr>* dependents) const;
+
+    ///Adapt Node to HashCone in computeHashOfDirtyCone
+    struct HashDependentsFunctor
+    {
+        void operator()(Node* node, std::vector<Node*>* dependents) const;
+    };
+
+    struct ComputeHashFunctor
+    {
+        bool operator()(Node* node) const;
+    };
 
     /**
      * @brief Refreshes the node hash depending on its context (knobs age, inputs etc...)
@@ -1341,6 +1368,10 @@ private:
      **/
     bool computeHashInternal() WARN_UNUSED_RETURN;
 
+    bool canUseContentBasedHash() const WARN_UNUSED_RETURN;
+
+    void appendContentToHash(Hash64* hash) const;
+
     void refreshCreatedViews(KnobI* knob, bool silent);
 
     void refreshInputRelatedDataRecursiveInternal(std::set<Node*>& markedNodes);
@@ -1499,8 +1530,9 @@ Q_SIGNALS:
 protected:
 
     /**
-     * @brief Recompute the hash value of this node and notify all the clone effects that the values they store in their
-     * knobs is dirty and that they should refresh it by cloning the live instance.
+     * @brief Recompute the hash value of this node and of the nodes downstream whose hash depends on it and
+     * notify all the clone effects that the values they store in their knobs is dirty and that they should refresh
+     * it by cloning the live instance.
      **/
     void computeHash();
 
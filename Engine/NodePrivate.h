@@ -175,6 +175,7 @@ public:
         , mustQuitPreviewCond()
         , renderInstancesSharedMutex(QMutex::Recursive)
         , knobsAge(0)
+        , contentHashAge(0)
         , knobsAgeMutex()
         , masterNodeMutex()
         , masterNode()
@@ -358,7 +359,8 @@ public:
     QMutex renderInstancesSharedMutex; //< see eRenderSafetyInstanceSafe in EffectInstance::renderRoI
     //only 1 clone can render at any time
     U64 knobsAge; //< the age of the knobs in this effect. It gets incremented every times the effect has its evaluate() function called.
-    mutable QReadWriteLock knobsAgeMutex; //< protects knobsAge and hash
+    U64 contentHashAge; //< replaces knobsAge in the content-based hash, only incremented when a render is needed without any knob value change
+    mutable QReadWriteLock knobsAgeMutex; //< protects knobsAge, contentHashAge and hash
     Hash64 hash; //< recomputed every time knobsAge is changed.
     mutable QMutex masterNodeMutex; //< protects masterNode and nodeLinks
     NodeWPtr masterNode; //< this points to the master when the node is a clone
@@ -34,6 +34,7 @@
 #include <cctype> // tolower
 #include <algorithm> // transform, min, max
 #include <string>
+#include <vector>
 #include <cstring> // for std::memcpy, std::memset, std::strcmp
 
 CLANG_DIAG_OFF(deprecated)
@@ -160,6 +161,9 @@ struct OfxHostPrivate
     int loadingPluginVersionMajor;
     int loadingPluginVersionMinor;
 
+    // Runs the multiThread() calls when the thread pool is used, the calling thread being part of the team
+    boost::scoped_ptr<ThreadTeam> multiThreadTeam;
+
     OfxHostPrivate()
         : imageEffectPluginCache()
         , tlsData( new TLSHolder<OfxHost::OfxHostTLSData>() )
@@ -170,6 +174,7 @@ struct OfxHostPrivate
         , loadingPluginID()
         , loadingPluginVersionMajor(0)
         , loadingPluginVersionMinor(0)
+        , multiThreadTeam( new ThreadTeam() )
     {
     }
 };
@@ -1249,6 +1254,17 @@ threadFunctionWrapper(OfxThreadFunctionV1 func,
     return ret;
 }
 
+static void
+teamFunctionWrapper(OfxThreadFunctionV1 func,
+                    int threadIndex,
+                    unsigned int threadMax,
+                    QThread* spawnerThread,
+                    void *customArg,
+                    std::vector<OfxStatus>* status)
+{
+    (*status)[threadIndex] = threadFunctionWrapper(func, (unsigned int)threadIndex, threadMax, spawnerThread, customArg);
+}
+
 class OfxThread
     : public QThread
       , public AbortableThread
@@ -1352,9 +1368,45 @@ OfxHost::multiThread(OfxThreadFunctionV1 func,
     }
 
     QThread* spawnerThread = QThread::currentThread();
+
+    // The spec forbids recursive calls but some plug-ins make them anyway: run them in the calling thread, which is
+    // already one of the threads of the outer call
+    if ( multiThreadIsSpawnedThread() ) {
+        OfxStatus ret = kOfxStatOK;
+        for (unsigned int i = 0; i < nThreads; ++i) {
+            OfxStatus stat = threadFunctionWrapper(func, i, nThreads, spawnerThread, customArg);
+            if ( (stat != kOfxStatOK) && (ret == kOfxStatOK) ) {
+                ret = stat;
+            }
+        }
+
+        return ret;
+    }
+
     bool useThreadPool = appPTR->getUseThreadPool();
 
     if (useThreadPool) {
+        // Plug-ins may call multiThread() for each block of rows: the persistent team avoids dispatching to the thread
+        // pool each time. The team serves one render thread at a time, the others use the thread pool.
+        {
+            // maxConcurrentThread follows the number of render threads set in the preferences
+            int nTeamThreads = (int)std::min(nThreads, maxConcurrentThread);
+
+            std::vector<OfxStatus> status(nThreads, kOfxStatOK);
+            appPTR->fetchAndAddNRunningThreads(nTeamThreads - 1);
+            bool ranOnTeam = _imp->multiThreadTeam->tryRun( nThreads, nTeamThreads, boost::bind(teamFunctionWrapper, func, _1, nThreads, spawnerThread, customArg, &status) );
+            appPTR->fetchAndAddNRunningThreads(1 - nTeamThreads);
+            if (ranOnTeam) {
+                for (std::vector<OfxStatus>::const_iterator it = status.begin(); it != status.end(); ++it) {
+                    if (*it != kOfxStatOK) {
+                        return *it;
+                    }
+                }
+
+                return kOfxStatOK;
+            }
+        }
+
         std::vector<unsigned int> threadIndexes(nThreads);
         for (unsigned int i = 0; i < nThreads; ++i) {
             threadIndexes[i] = i;
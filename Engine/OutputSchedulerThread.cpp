@@ -29,6 +29,7 @@
 #include <set>
 #include <list>
 #include <algorithm> // min, max
+#include <cmath>
 #include <cassert>
 #include <stdexcept>
 #include <sstream> // stringstream
@@ -55,6 +56,7 @@
 #include "Engine/EffectInstance.h"
 #include "Engine/Image.h"
 #include "Engine/KnobFile.h"
+#include "Engine/MemoryInfo.h"
 #include "Engine/Node.h"
 #include "Engine/OpenGLViewerI.h"
 #include "Engine/GenericSchedulerThreadWatcher.h"
@@ -77,6 +79,12 @@
 
 #define NATRON_FPS_REFRESH_RATE_SECONDS 1.5
 
+///Minimum time between two measures of the CPU time and memory used by the parallel renders
+#define NATRON_PARALLEL_RENDERS_LOAD_SAMPLE_PERIOD_SECONDS 0.5
+
+///When the number of parallel renders is automatic, at most this many renders per core are launched
+#define NATRON_PARALLEL_RENDERS_MAX_PER_CORE 2
+
 /*
    When defined, parallel frame renders are spawned from a timer so that the frames
    appear to be rendered all at the same speed.
@@ -91,6 +99,12 @@
 
 #define NATRON_SCHEDULER_ABORT_AFTER_X_UNSUCCESSFUL_ITERATIONS 5000
 
+///The frames around the current frame are pre-rendered once the viewer has been idle for this long
+#define NATRON_SPECULATIVE_RENDER_IDLE_DELAY_MS 250
+
+///Interval at which the pre-rendering thread checks whether the viewer is idle
+#define NATRON_SPECULATIVE_RENDER_POLL_MS 20
+
 NATRON_NAMESPACE_ENTER
 
 
@@ -243,6 +257,15 @@ struct OutputSchedulerThreadPrivate
     QMutex bufferedOutputMutex;
     int lastBufferedOutputSize;
 
+    ///Measures of the resources used by the parallel renders since the render started, used to compute the number
+    ///of parallel renders when it is automatic. Protected by loadMutex
+    QMutex loadMutex;
+    double lastLoadSampleTime; // time since the render started of the last sample
+    double lastLoadSampleCPUTime; // CPU time of the process at the last sample
+    std::size_t renderStartRSS;
+    double cpuPerRender; // number of cores kept busy by each parallel render, 0 until measured
+    double memoryPerRender; // bytes used by each parallel render, 0 until measured
+
 
     OutputSchedulerThreadPrivate(RenderEngine* engine,
                                  const OutputEffectInstancePtr& effect,
@@ -282,9 +305,71 @@ struct OutputSchedulerThreadPrivate
 #endif
         , bufferedOutputMutex()
         , lastBufferedOutputSize(0)
+        , loadMutex()
+        , lastLoadSampleTime(0)
+        , lastLoadSampleCPUTime(0)
+        , renderStartRSS(0)
+        , cpuPerRender(0)
+        , memoryPerRender(0)
+    {
+    }
+
+    void resetLoadMeasures()
     {
+        QMutexLocker k(&loadMutex);
+
+        lastLoadSampleTime = 0;
+        lastLoadSampleCPUTime = getProcessCPUTime();
+        renderStartRSS = getCurrentRSS();
+        cpuPerRender = 0;
+        memoryPerRender = 0;
     }
 
+    /**
+     * @brief Returns how many frames should be rendered in parallel, out of the CPU time and memory used by the
+     * currentParallelRenders renders so far. Before anything was measured, this is the number of cores.
+     * A render that keeps less than a core busy, e.g because it waits for a file to be read or an encoder, leaves
+     * room for more renders in parallel, while a render whose plug-ins are multi-threaded needs fewer of them.
+     * Renders are only added if the memory each one used so far is still available.
+     **/
+    int getOptimalNumberOfParallelRenders(int currentParallelRenders)
+    {
+        int nCores = appPTR->getHardwareIdealThreadCount();
+        QMutexLocker k(&loadMutex);
+
+        double now = renderTimer ? renderTimer->getTimeSinceCreation() : 0.;
+        double elapsed = now - lastLoadSampleTime;
+        if ( (currentParallelRenders > 0) && (elapsed >= NATRON_PARALLEL_RENDERS_LOAD_SAMPLE_PERIOD_SECONDS) ) {
+            double cpuTime = getProcessCPUTime();
+            double cpu = (cpuTime - lastLoadSampleCPUTime) / elapsed / currentParallelRenders;
+            if (cpu > 0) {
+                // Smooth the measures, frames do not all cost the same
+                cpuPerRender = cpuPerRender > 0 ? (cpuPerRender + cpu) / 2. : cpu;
+            }
+            std::size_t rss = getCurrentRSS();
+            if (rss > renderStartRSS) {
+                double memory = (double)(rss - renderStartRSS) / currentParallelRenders;
+                memoryPerRender = memoryPerRender > 0 ? (memoryPerRender + memory) / 2. : memory;
+            }
+            lastLoadSampleTime = now;
+            lastLoadSampleCPUTime = cpuTime;
+        }
+
+        int optimalNThreads = nCores;
+        if (cpuPerRender > 0) {
+            optimalNThreads = std::min( (int)std::ceil(nCores / cpuPerRender), nCores * NATRON_PARALLEL_RENDERS_MAX_PER_CORE );
+        }
+        if ( (memoryPerRender > 0) && (optimalNThreads > currentParallelRenders) ) {
+            // Never stop renders because of memory: the caches are bounded and free memory older renders as needed
+            double systemRAMToKeepFree = getSystemTotalRAM() * appPTR->getCurrentSettings()->getUnreachableRamPercent();
+            double freeRAM = (double)getAmountFreePhysicalRAM() - systemRAMToKeepFree;
+            int nRendersFitting = freeRAM > 0 ? (int)(freeRAM / memoryPerRender) : 0;
+            optimalNThreads = std::min(optimalNThreads, currentParallelRenders + nRendersFitting);
+        }
+
+        return std::max(1, optimalNThreads);
+    } // getOptimalNumberOfParallelRenders
+
     void appendBufferedFrame(double time,
                              ViewIdx view,
                              const RenderStatsPtr& stats,
@@ -1035,6 +1120,7 @@ OutputSchedulerThread::startRender()
 
     // Start measuring
     _imp->renderTimer.reset(new TimeLapse);
+    _imp->resetLoadMeasures();
 
     ///We will push frame to renders starting at startingFrame.
     ///They will be in the range determined by firstFrame-lastFrame
@@ -1521,9 +1607,9 @@ OutputSchedulerThread::adjustNumberOfThreads(int* newNThreads,
     *lastNThreads = currentParallelRenders;
 
     if (userSettingParallelThreads == 0) {
-        ///User wants it to be automatically computed, do a simple heuristic: launch as many parallel renders
-        ///as there are cores
-        optimalNThreads = appPTR->getHardwareIdealThreadCount();
+        ///User wants it to be automatically computed: launch as many parallel renders as the cores and the memory
+        ///used by the renders so far allow
+        optimalNThreads = _imp->getOptimalNumberOfParallelRenders(currentParallelRenders);
     } else {
         optimalNThreads = userSettingParallelThreads;
     }
@@ -2946,6 +3032,7 @@ struct RenderEnginePrivate
     mutable QMutex pbModeMutex;
     PlaybackModeEnum pbMode;
     ViewerCurrentFrameRequestScheduler* currentFrameScheduler;
+    ViewerSpeculativeRenderer* speculativeRenderer;
 
     // Only used on the main-thread
     boost::scoped_ptr<RenderEngineWatcher> engineWatcher;
@@ -2971,6 +3058,7 @@ struct RenderEnginePrivate
         , pbModeMutex()
         , pbMode(ePlaybackModeLoop)
         , currentFrameScheduler(0)
+        , speculativeRenderer(0)
         , refreshQueue()
     {
     }
@@ -2984,6 +3072,8 @@ RenderEngine::RenderEngine(const OutputEffectInstancePtr& output)
 
 RenderEngine::~RenderEngine()
 {
+    delete _imp->speculativeRenderer;
+    _imp->speculativeRenderer = 0;
     delete _imp->currentFrameScheduler;
     _imp->currentFrameScheduler = 0;
     delete _imp->scheduler;
@@ -3011,6 +3101,10 @@ RenderEngine::renderFrameRange(bool isBlocking,
                                const std::vector<ViewIdx>& viewsToRender,
                                RenderDirectionEnum forward)
 {
+    // Playback needs all the threads
+    if (_imp->speculativeRenderer) {
+        _imp->speculativeRenderer->abortThreadedTask();
+    }
     setPlaybackAutoRestartEnabled(true);
 
     {
@@ -3028,6 +3122,10 @@ RenderEngine::renderFromCurrentFrame(bool enableRenderStats,
                                      const std::vector<ViewIdx>& viewsToRender,
                                      RenderDirectionEnum forward)
 {
+    // Playback needs all the threads
+    if (_imp->speculativeRenderer) {
+        _imp->speculativeRenderer->abortThreadedTask();
+    }
     setPlaybackAutoRestartEnabled(true);
 
     {
@@ -3078,6 +3176,11 @@ RenderEngine::renderCurrentFrameInternal(bool enableRenderStats,
     }
 
 
+    // The frames being pre-rendered are no longer the priority
+    if (_imp->speculativeRenderer) {
+        _imp->speculativeRenderer->abortThreadedTask();
+    }
+
     ///If the scheduler is already doing playback, continue it
     if (_imp->scheduler) {
         bool working = _imp->scheduler->isWorking();
@@ -3107,6 +3210,13 @@ RenderEngine::renderCurrentFrameInternal(bool enableRenderStats,
     }
 
     _imp->currentFrameScheduler->renderCurrentFrame(enableRenderStats, canAbort);
+
+    if ( appPTR->getCurrentSettings()->getSpeculativeRenderFrames() > 0 ) {
+        if (!_imp->speculativeRenderer) {
+            _imp->speculativeRenderer = new ViewerSpeculativeRenderer(this, isViewer);
+        }
+        _imp->speculativeRenderer->renderAroundFrame( isViewer->getTimeline()->currentFrame() );
+    }
 }
 
 void
@@ -3147,6 +3257,10 @@ RenderEngine::quitEngine(bool allowRestarts)
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->quitThread(allowRestarts);
     }
+
+    if (_imp->speculativeRenderer) {
+        _imp->speculativeRenderer->quitThread(allowRestarts);
+    }
 }
 
 void
@@ -3159,6 +3273,10 @@ RenderEngine::waitForEngineToQuit_not_main_thread()
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->waitForThreadToQuit_not_main_thread();
     }
+
+    if (_imp->speculativeRenderer) {
+        _imp->speculativeRenderer->waitForThreadToQuit_not_main_thread();
+    }
 }
 
 void
@@ -3181,6 +3299,10 @@ RenderEngine::waitForEngineToQuit_enforce_blocking()
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->waitForThreadToQuit_enforce_blocking();
     }
+
+    if (_imp->speculativeRenderer) {
+        _imp->speculativeRenderer->waitForThreadToQuit_enforce_blocking();
+    }
 }
 
 bool
@@ -3188,6 +3310,10 @@ RenderEngine::abortRenderingInternal(bool keepOldestRender)
 {
     bool ret = false;
 
+    if (_imp->speculativeRenderer) {
+        ret |= _imp->speculativeRenderer->abortThreadedTask();
+    }
+
     if (_imp->currentFrameScheduler) {
         ret |= _imp->currentFrameScheduler->abortThreadedTask(keepOldestRender);
     }
@@ -3225,6 +3351,9 @@ RenderEngine::abortRenderingAutoRestart()
 void
 RenderEngine::waitForAbortToComplete_not_main_thread()
 {
+    if (_imp->speculativeRenderer) {
+        _imp->speculativeRenderer->waitForAbortToComplete_not_main_thread();
+    }
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->waitForAbortToComplete_not_main_thread();
     }
@@ -3243,6 +3372,10 @@ RenderEngine::waitForAbortToComplete_enforce_blocking()
     if (_imp->currentFrameScheduler) {
         _imp->currentFrameScheduler->waitForAbortToComplete_enforce_blocking();
     }
+
+    if (_imp->speculativeRenderer) {
+        _imp->speculativeRenderer->waitForAbortToComplete_enforce_blocking();
+    }
 }
 
 void
@@ -3299,8 +3432,12 @@ RenderEngine::hasThreadsAlive() const
     if (_imp->currentFrameScheduler) {
         currentFrameSchedulerRunning = _imp->currentFrameScheduler->isRunning();
     }
+    bool speculativeRendererRunning = false;
+    if (_imp->speculativeRenderer) {
+        speculativeRendererRunning = _imp->speculativeRenderer->isRunning();
+    }
 
-    return schedulerRunning || currentFrameSchedulerRunning;
+    return schedulerRunning || currentFrameSchedulerRunning || speculativeRendererRunning;
 }
 
 bool
@@ -4018,6 +4155,197 @@ ViewerCurrentFrameRequestRendererBackup::threadLoopOnce(const GenericThreadStart
     return eThreadStateActive;
 }
 
+////////////////////////ViewerSpeculativeRenderer////////////////////////
+class SpeculativeRenderArgs
+    : public GenericThreadStartArgs
+{
+public:
+
+    int time;
+    int direction;
+    int nFrames;
+    double cacheShare;
+
+    SpeculativeRenderArgs()
+        : GenericThreadStartArgs()
+        , time(0)
+        , direction(0)
+        , nFrames(0)
+        , cacheShare(0)
+    {
+    }
+};
+
+typedef boost::shared_ptr<SpeculativeRenderArgs> SpeculativeRenderArgsPtr;
+
+struct ViewerSpeculativeRendererPrivate
+{
+    RenderEngine* engine;
+    ViewerInstance* viewer;
+
+    // The time and direction of the last request, only used on the main thread
+    int lastTime;
+    bool lastTimeSet;
+    int direction;
+
+    ViewerSpeculativeRendererPrivate(RenderEngine* engine,
+                                     ViewerInstance* viewer)
+        : engine(engine)
+        , viewer(viewer)
+        , lastTime(0)
+        , lastTimeSet(false)
+        , direction(0)
+    {
+    }
+};
+
+ViewerSpeculativeRenderer::ViewerSpeculativeRenderer(RenderEngine* engine,
+                                                     ViewerInstance* viewer)
+    : GenericSchedulerThread()
+    , _imp( new ViewerSpeculativeRendererPrivate(engine, viewer) )
+{
+    setThreadName("ViewerSpeculativeRenderer");
+}
+
+ViewerSpeculativeRenderer::~ViewerSpeculativeRenderer()
+{
+}
+
+void
+ViewerSpeculativeRenderer::renderAroundFrame(int time)
+{
+    assert( QThread::currentThread() == qApp->thread() );
+
+    // Keep the direction of the last move of the current frame: a refresh of the same frame does not change it
+    if ( _imp->lastTimeSet && (time != _imp->lastTime) ) {
+        _imp->direction = time > _imp->lastTime ? 1 : -1;
+    }
+    _imp->lastTime = time;
+    _imp->lastTimeSet = true;
+
+    SpeculativeRenderArgsPtr args = boost::make_shared<SpeculativeRenderArgs>();
+    args->time = time;
+    args->direction = _imp->direction;
+    args->nFrames = appPTR->getCurrentSettings()->getSpeculativeRenderFrames();
+    args->cacheShare = appPTR->getCurrentSettings()->getSpeculativeRenderCacheShare();
+    if ( (args->nFrames <= 0) || (args->cacheShare <= 0) ) {
+        return;
+    }
+    startTask(args);
+}
+
+void
+ViewerSpeculativeRenderer::getFramesToRender(int time,
+                                             int direction,
+                                             int nFrames,
+                                             int first,
+                                             int last,
+                                             std::vector<int>* frames)
+{
+    frames->clear();
+
+    const int ahead = direction >= 0 ? 1 : -1;
+    const int nAheadPerBehind = direction == 0 ? 1 : 2;
+    int aheadDistance = 0;
+    int behindDistance = 0;
+    bool aheadDone = false;
+    bool behindDone = false;
+    while ( (int)frames->size() < nFrames && (!aheadDone || !behindDone) ) {
+        for (int i = 0; i < nAheadPerBehind && !aheadDone && (int)frames->size() < nFrames; ++i) {
+            int frame = time + ahead * ++aheadDistance;
+            if ( (frame < first) || (frame > last) ) {
+                aheadDone = true;
+            } else {
+                frames->push_back(frame);
+            }
+        }
+        if ( !behindDone && ( (int)frames->size() < nFrames ) ) {
+            int frame = time - ahead * ++behindDistance;
+            if ( (frame < first) || (frame > last) ) {
+                behindDone = true;
+            } else {
+                frames->push_back(frame);
+            }
+        }
+    }
+}
+
+void
+ViewerSpeculativeRenderer::onAbortRequested(bool /*keepOldestRender*/)
+{
+    // Flag the render of this thread so that the nodes being rendered return as soon as possible
+    bool userInteraction;
+    AbortableRenderInfoPtr abortInfo;
+    EffectInstancePtr treeRoot;
+
+    getAbortInfo(&userInteraction, &abortInfo, &treeRoot);
+    if (abortInfo) {
+        abortInfo->setAborted();
+    }
+}
+
+GenericSchedulerThread::ThreadStateEnum
+ViewerSpeculativeRenderer::waitForIdleEngine(int delayMS)
+{
+    QThreadPool* threadPool = QThreadPool::globalInstance();
+
+    for (int waitedMS = 0;; waitedMS += NATRON_SPECULATIVE_RENDER_POLL_MS) {
+        ThreadStateEnum state = resolveState();
+        if (state != eThreadStateActive) {
+            return state;
+        }
+        if ( (waitedMS >= delayMS) && !_imp->engine->hasThreadsWorking() && ( threadPool->activeThreadCount() < threadPool->maxThreadCount() ) ) {
+            return eThreadStateActive;
+        }
+        msleep(NATRON_SPECULATIVE_RENDER_POLL_MS);
+    }
+}
+
+GenericSchedulerThread::ThreadStateEnum
+ViewerSpeculativeRenderer::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
+{
+    SpeculativeRenderArgsPtr args = boost::dynamic_pointer_cast<SpeculativeRenderArgs>(inArgs);
+
+    assert(args);
+
+    // Do not slow down the threads that render what the user is looking at. The threads of the thread pool which
+    // help this render inherit this priority while they do, see AppTLS::copyTLS
+    setPriority(QThread::LowestPriority);
+
+    int first, last;
+    _imp->viewer->getTimelineBounds(&first, &last);
+    std::vector<int> frames;
+    getFramesToRender(args->time, args->direction, args->nFrames, first, last, &frames);
+
+    // The frames rendered may fill only a share of the caches. Once the caches are full they evict their least recently used
+    // entries to make room for new ones and their size no longer grows, so count the bytes allocated by these renders instead.
+    std::size_t cacheSize, maximumCacheSize;
+    appPTR->getRenderCachesUsage(&cacheSize, &maximumCacheSize);
+    const std::size_t cacheBudget = (std::size_t)(maximumCacheSize * args->cacheShare);
+    std::size_t cacheBytes = 0;
+
+    const ViewIdx view = _imp->viewer->getViewerCurrentView();
+    for (std::size_t i = 0; i < frames.size() && cacheBytes < cacheBudget; ++i) {
+        ThreadStateEnum state = waitForIdleEngine(i == 0 ? NATRON_SPECULATIVE_RENDER_IDLE_DELAY_MS : 0);
+        if (state != eThreadStateActive) {
+            return state;
+        }
+
+        std::size_t frameCacheBytes = 0;
+        try {
+            _imp->viewer->renderViewerInCache(frames[i], view, &frameCacheBytes);
+        } catch (...) {
+            // Errors are reported when the frame is displayed
+        }
+        cacheBytes += frameCacheBytes;
+
+        ///This frame is done, clean-up the TLS
+        appPTR->getAppTLS()->cleanupTLSForThread();
+    }
+
+    return eThreadStateActive;
+} // ViewerSpeculativeRenderer::threadLoopOnce
+
 NATRON_NAMESPACE_EXIT
 
 NATRON_NAMESPACE_USING
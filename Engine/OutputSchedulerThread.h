@@ -623,6 +623,55 @@ private:
     virtual ThreadStateEnum threadLoopOnce(const GenericThreadStartArgsPtr& inArgs) OVERRIDE FINAL WARN_UNUSED_RETURN;
 };
 
+/**
+ * @brief Renders in the caches the frames around the current frame of a viewer while it is idle, so that scrubbing the
+ * timeline displays them immediately. The frames in the direction of the last move of the current frame are rendered first.
+ * A frame is only rendered when no other render of the engine is running and the global thread pool has spare threads,
+ * and any new render of the viewer aborts it.
+ **/
+struct ViewerSpeculativeRendererPrivate;
+class ViewerSpeculativeRenderer
+    : public GenericSchedulerThread
+{
+public:
+
+    ViewerSpeculativeRenderer(RenderEngine* engine,
+                              ViewerInstance* viewer);
+
+    virtual ~ViewerSpeculativeRenderer();
+
+    /**
+     * @brief Starts rendering the frames around the given time once the viewer is idle. Must be called on the main thread.
+     **/
+    void renderAroundFrame(int time);
+
+    /**
+     * @brief Returns the frames to render around time, in the order they are rendered: at most nFrames frames within
+     * [first, last], the closest first, with 2 frames in the given direction (-1 or 1) for each frame in the other direction.
+     * If direction is 0, frames are taken alternately after and before time.
+     **/
+    static void getFramesToRender(int time, int direction, int nFrames, int first, int last, std::vector<int>* frames);
+
+private:
+
+    virtual TaskQueueBehaviorEnum tasksQueueBehaviour() const OVERRIDE FINAL
+    {
+        return eTaskQueueBehaviorSkipToMostRecent;
+    }
+
+    virtual void onAbortRequested(bool keepOldestRender) OVERRIDE FINAL;
+
+    virtual ThreadStateEnum threadLoopOnce(const GenericThreadStartArgsPtr& inArgs) OVERRIDE FINAL WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Waits until no other render of the engine is running and the thread pool has spare threads, for at least delayMS.
+     * Returns eThreadStateActive if the frame can be rendered.
+     **/
+    ThreadStateEnum waitForIdleEngine(int delayMS);
+
+    boost::scoped_ptr<ViewerSpeculativeRendererPrivate> _imp;
+};
+
 
 /**
  * @brief This class manages multiple OutputThreadScheduler so that each render request gets processed as soon as possible.
@@ -580,6 +580,54 @@ EffectInstance::computeRequestPass(double time,
     return eStatusOK;
 }
 
+SharedFrameRequest::SharedFrameRequest(double time,
+                                       ViewIdx view,
+                                       unsigned int mipMapLevel,
+                                       const NodePtr& treeRoot)
+    : _time(time)
+    , _view(view)
+    , _mipMapLevel(mipMapLevel)
+    , _treeRoot(treeRoot)
+    , _renderWindows()
+    , _request()
+    , _requestComputed(false)
+    , _requestStatus(eStatusOK)
+{
+}
+
+bool
+SharedFrameRequest::isSameFrame(double time,
+                                ViewIdx view,
+                                unsigned int mipMapLevel) const
+{
+    return time == _time && view == _view && mipMapLevel == _mipMapLevel;
+}
+
+void
+SharedFrameRequest::addRenderWindow(const RectD& canonicalRenderWindow)
+{
+    assert(!_requestComputed);
+    _renderWindows.push_back(canonicalRenderWindow);
+}
+
+StatusEnum
+SharedFrameRequest::getRequest(const FrameRequestMap** request)
+{
+    if (!_requestComputed) {
+        _requestComputed = true;
+        // Successive request passes in the same map merge the RoIs and do not recurse where nothing new is requested
+        for (std::size_t i = 0; i < _renderWindows.size(); ++i) {
+            _requestStatus = EffectInstance::computeRequestPass(_time, _view, _mipMapLevel, _renderWindows[i], _treeRoot, _request);
+            if (_requestStatus == eStatusFailed) {
+                break;
+            }
+        }
+    }
+    *request = &_request;
+
+    return _requestStatus;
+}
+
 const FrameViewRequest*
 NodeFrameRequest::getFrameViewRequest(double time,
                                       ViewIdx view) const
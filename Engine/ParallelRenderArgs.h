@@ -31,6 +31,7 @@
 #include <set>
 #include <map>
 #include <list>
+#include <vector>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
@@ -219,7 +220,7 @@ struct FrameView_compare_less
             if (lhs.view < rhs.view) {
                 return true;
             } else if (lhs.view > rhs.view) {
-                return true;
+                return false;
             } else {
                 return false;
             }
@@ -245,6 +246,46 @@ public:
 
 typedef std::map<NodePtr, NodeFrameRequestPtr> FrameRequestMap;
 
+/**
+ * @brief The request pass of a frame rendered several times from the same tree root at the same time, view and
+ * mipmap level, e.g. for the A and B inputs of the viewer when comparing them.
+ * The render windows of all the renders are requested in a single FrameRequestMap, so that each node frame/view
+ * upstream is rendered once with the union of the RoIs that all the renders need: the renders following the first
+ * one then find the images in the cache instead of rendering the parts they miss again.
+ * The renders sharing the request must be done one after another.
+ **/
+class SharedFrameRequest
+{
+public:
+
+    SharedFrameRequest(double time,
+                       ViewIdx view,
+                       unsigned int mipMapLevel,
+                       const NodePtr& treeRoot);
+
+    bool isSameFrame(double time, ViewIdx view, unsigned int mipMapLevel) const;
+
+    ///Adds the render window of one of the renders, must be called before getRequest()
+    void addRenderWindow(const RectD& canonicalRenderWindow);
+
+    /**
+     * @brief Returns in request the request of all the render windows added. It is computed by the first
+     * render calling it, which must have set the thread-local storage for the frame beforehand.
+     **/
+    StatusEnum getRequest(const FrameRequestMap** request);
+
+private:
+
+    double _time;
+    ViewIdx _view;
+    unsigned int _mipMapLevel;
+    NodePtr _treeRoot;
+    std::vector<RectD> _renderWindows;
+    FrameRequestMap _request;
+    bool _requestComputed;
+    StatusEnum _requestStatus;
+};
+
 
 class ParallelRenderArgsSetter
 {
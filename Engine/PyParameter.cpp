@@ -26,6 +26,7 @@
 #include "PyParameter.h"
 
 #include <cassert>
+#include <cmath> // floor
 #include <stdexcept>
 
 #include "Engine/EffectInstance.h"
@@ -581,6 +582,50 @@ AnimatedParam::setInterpolationAtTime(double time,
     return knob->setInterpolationAtTime(eCurveChangeReasonInternal, ViewSpec::current(), dimension, time, interpolation, &newKey);
 }
 
+bool
+AnimatedParam::setValuesAtTimes(const std::vector<double>& times,
+                                const std::vector<double>& values,
+                                int dimension)
+{
+    KnobIPtr knob = getInternalKnob();
+
+    if ( !knob || ( times.size() != values.size() ) ) {
+        return false;
+    }
+    if ( times.empty() ) {
+        return true;
+    }
+
+    KnobDoubleBase* isDouble = dynamic_cast<KnobDoubleBase*>( knob.get() );
+    if (isDouble) {
+        isDouble->setValuesAtTimes(times, values, ViewSpec::current(), dimension, eValueChangedReasonNatronInternalEdited);
+
+        return true;
+    }
+    KnobIntBase* isInt = dynamic_cast<KnobIntBase*>( knob.get() );
+    if (isInt) {
+        std::vector<int> intValues( values.size() );
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            intValues[i] = (int)std::floor(values[i] + 0.5);
+        }
+        isInt->setValuesAtTimes(times, intValues, ViewSpec::current(), dimension, eValueChangedReasonNatronInternalEdited);
+
+        return true;
+    }
+    KnobBoolBase* isBool = dynamic_cast<KnobBoolBase*>( knob.get() );
+    if (isBool) {
+        std::vector<bool> boolValues( values.size() );
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            boolValues[i] = (values[i] != 0.);
+        }
+        isBool->setValuesAtTimes(times, boolValues, ViewSpec::current(), dimension, eValueChangedReasonNatronInternalEdited);
+
+        return true;
+    }
+
+    return false;
+}
+
 void
 Param::_addAsDependencyOf(int fromExprDimension,
                           Param* param,
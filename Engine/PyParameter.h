@@ -270,6 +270,13 @@ public:
     QString getExpression(int dimension, bool* hasRetVariable) const;
 
     bool setInterpolationAtTime(double time, NATRON_NAMESPACE::KeyframeTypeEnum interpolation, int dimension = 0);
+
+    /**
+     * @brief Set a keyframe for each time in times with the value at the same index in values, for the given dimension.
+     * This is much faster than calling setValueAtTime for each keyframe, because the parameter change is notified only once.
+     * Returns false if times and values do not have the same size or if the parameter is not an int, double or boolean parameter.
+     **/
+    bool setValuesAtTimes(const std::vector<double>& times, const std::vector<double>& values, int dimension = 0);
 };
 
 /**
@@ -0,0 +1,285 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "PyPlugCache.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTextStream>
+#include <QtCore/QThreadPool>
+#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
+
+///Written at the start of the cache file
+#define NATRON_PYPLUG_CACHE_MAGIC "NatronPyPlugCache"
+
+NATRON_NAMESPACE_ENTER
+
+struct PyPlugCache::ScanArgs
+{
+    const EntriesMap* cache;
+    Entry entry;
+    bool readable;
+};
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+bool
+entriesEqual(const PyPlugCache::Entry& a,
+             const PyPlugCache::Entry& b)
+{
+    return a.scriptPath == b.scriptPath &&
+           a.modificationTime == b.modificationTime &&
+           a.fileSize == b.fileSize &&
+           a.isPyPlug == b.isPyPlug &&
+           a.importsNatronGui == b.importsNatronGui &&
+           a.hasInfos == b.hasInfos &&
+           a.pluginID == b.pluginID &&
+           a.pluginLabel == b.pluginLabel &&
+           a.iconFilePath == b.iconFilePath &&
+           a.grouping == b.grouping &&
+           a.isToolset == b.isToolset &&
+           a.version == b.version;
+}
+
+void
+writeString(QDataStream& stream,
+            const std::string& str)
+{
+    stream << QString::fromUtf8( str.c_str() );
+}
+
+std::string
+readString(QDataStream& stream)
+{
+    QString str;
+
+    stream >> str;
+
+    return str.toStdString();
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+
+PyPlugCache::PyPlugCache()
+    : _readEntries()
+    , _entries()
+    , _dirty(false)
+{
+}
+
+bool
+PyPlugCache::read(const QString& filePath)
+{
+    _readEntries.clear();
+
+    QFile file(filePath);
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_8);
+
+    QString magic;
+    quint32 version = 0;
+    quint32 nEntries = 0;
+    stream >> magic >> version >> nEntries;
+    if ( (stream.status() != QDataStream::Ok) || ( magic != QString::fromUtf8(NATRON_PYPLUG_CACHE_MAGIC) ) || (version != NATRON_PYPLUG_CACHE_VERSION) ) {
+        return false;
+    }
+
+    EntriesMap entries;
+    for (quint32 i = 0; i < nEntries; ++i) {
+        Entry e;
+        quint32 pluginVersion = 0;
+        stream >> e.scriptPath >> e.modificationTime >> e.fileSize >> e.isPyPlug >> e.importsNatronGui >> e.hasInfos;
+        e.pluginID = readString(stream);
+        e.pluginLabel = readString(stream);
+        e.iconFilePath = readString(stream);
+        e.grouping = readString(stream);
+        stream >> e.isToolset >> pluginVersion;
+        e.version = pluginVersion;
+        if (stream.status() != QDataStream::Ok) {
+            // A truncated cache is discarded altogether
+            return false;
+        }
+        entries[e.scriptPath] = e;
+    }
+    _readEntries.swap(entries);
+
+    return true;
+}
+
+bool
+PyPlugCache::write(const QString& filePath) const
+{
+    QDir().mkpath( QFileInfo(filePath).absolutePath() );
+
+    // Write to a temporary file first so that a concurrent launch never reads a partial cache
+    QString tmpFilePath = filePath + QString::fromUtf8(".tmp");
+    {
+        QFile file(tmpFilePath);
+        if ( !file.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+            return false;
+        }
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_4_8);
+        stream << QString::fromUtf8(NATRON_PYPLUG_CACHE_MAGIC) << (quint32)NATRON_PYPLUG_CACHE_VERSION << (quint32)_entries.size();
+        for (EntriesMap::const_iterator it = _entries.begin(); it != _entries.end(); ++it) {
+            const Entry& e = it->second;
+            stream << e.scriptPath << e.modificationTime << e.fileSize << e.isPyPlug << e.importsNatronGui << e.hasInfos;
+            writeString(stream, e.pluginID);
+            writeString(stream, e.pluginLabel);
+            writeString(stream, e.iconFilePath);
+            writeString(stream, e.grouping);
+            stream << e.isToolset << (quint32)e.version;
+        }
+        if (stream.status() != QDataStream::Ok) {
+            file.close();
+            QFile::remove(tmpFilePath);
+
+            return false;
+        }
+    }
+    if ( QFile::exists(filePath) ) {
+        QFile::remove(filePath);
+    }
+
+    return QFile::rename(tmpFilePath, filePath);
+}
+
+void
+PyPlugCache::scanScript(ScanArgs& args)
+{
+    Entry& e = args.entry;
+    QFileInfo info(e.scriptPath);
+
+    args.readable = info.isReadable();
+    if (!args.readable) {
+        return;
+    }
+    e.modificationTime = info.lastModified().toMSecsSinceEpoch();
+    e.fileSize = info.size();
+
+    EntriesMap::const_iterator found = args.cache->find(e.scriptPath);
+    if ( ( found != args.cache->end() ) && (found->second.modificationTime == e.modificationTime) && (found->second.fileSize == e.fileSize) ) {
+        e = found->second;
+
+        return;
+    }
+
+    // Open the file and check for a line that imports NatronGui, and for a line telling that this is a PyPlug
+    QFile file(e.scriptPath);
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        args.readable = false;
+
+        return;
+    }
+    QTextStream ts(&file);
+    const QString importGui = QString::fromUtf8("import %1").arg( QLatin1String(NATRON_GUI_PYTHON_MODULE_NAME) );
+    const QString fromGui = QString::fromUtf8("from %1 import").arg( QLatin1String(NATRON_GUI_PYTHON_MODULE_NAME) );
+    while ( !ts.atEnd() ) {
+        QString line = ts.readLine();
+        if ( line.startsWith(importGui) || line.startsWith(fromGui) ) {
+            e.importsNatronGui = true;
+        }
+        // We have to find a way to tell PyPlugs from other python files.
+        // We could check if the file was created by Natron...
+        if ( line.startsWith( QString::fromUtf8(NATRON_PYPLUG_GENERATED) ) ) {
+            e.isPyPlug = true;
+        }
+        // Or we could check if createInstance(app,group) is defined
+        if ( line.startsWith( QString::fromUtf8("def createInstance(") ) ) {
+            e.isPyPlug = true;
+        }
+        // Or we could check if it implements getIsToolSet()
+        if ( line.startsWith( QString::fromUtf8("def getIsToolSet(") ) ) {
+            e.isPyPlug = true;
+        }
+        // Or we could check for the magic line that is in the doc.
+        // See https://natron.readthedocs.io/en/master/devel/groups.html#creating-a-group-by-hand
+        // and https://natron.readthedocs.io/en/master/devel/groups.html#toolsets
+        if ( line.startsWith( QString::fromUtf8(NATRON_PYPLUG_MAGIC) ) ) {
+            e.isPyPlug = true;
+        }
+    }
+} // PyPlugCache::scanScript
+
+void
+PyPlugCache::scanScripts(const QStringList& scripts,
+                         std::vector<Entry>* entries,
+                         bool multiThreaded) const
+{
+    std::vector<ScanArgs> args( scripts.size() );
+
+    for (int i = 0; i < scripts.size(); ++i) {
+        args[i].cache = &_readEntries;
+        args[i].entry.scriptPath = scripts[i];
+        args[i].readable = false;
+    }
+
+    // Scanning only reads files and the entries read from the cache, which are not modified until insert() is called
+    bool runInCurrentThread = !multiThreaded || args.size() <= 1;
+    if (!runInCurrentThread) {
+        runInCurrentThread = QThreadPool::globalInstance()->activeThreadCount() >= QThreadPool::globalInstance()->maxThreadCount();
+    }
+    if (runInCurrentThread) {
+        for (std::size_t i = 0; i < args.size(); ++i) {
+            scanScript(args[i]);
+        }
+    } else {
+        QtConcurrent::map(args, &PyPlugCache::scanScript).waitForFinished();
+    }
+
+    entries->clear();
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        if (args[i].readable) {
+            entries->push_back(args[i].entry);
+        }
+    }
+} // PyPlugCache::scanScripts
+
+void
+PyPlugCache::insert(const Entry& entry)
+{
+    EntriesMap::const_iterator found = _readEntries.find(entry.scriptPath);
+
+    if ( ( found == _readEntries.end() ) || !entriesEqual(found->second, entry) ) {
+        _dirty = true;
+    }
+    _entries[entry.scriptPath] = entry;
+}
+
+bool
+PyPlugCache::isDirty() const
+{
+    // Scripts that were removed since the cache was written are not inserted
+    return _dirty || _entries.size() != _readEntries.size();
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,144 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_PYPLUGCACHE_H
+#define NATRON_ENGINE_PYPLUGCACHE_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+///Bump this whenever the layout of the PyPlug cache file changes
+#define NATRON_PYPLUG_CACHE_VERSION 1
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Remembers, for each Python script found in the plug-in search paths, whether it is a PyPlug and the
+ * informations its getLabel(), getPluginID()... functions returned, so that PyPlugs can be registered at launch
+ * without reading nor importing them. The module is then only imported when the PyPlug is first instantiated.
+ * An entry is only valid as long as the modification time and the size of its script do not change: a script
+ * that was edited or added is scanned again, the others are not.
+ * The informations are returned by the script itself: if they depend on another module, the cache must be
+ * cleared with AppManager::clearPluginsLoadedCache() for a change of that module to be seen.
+ **/
+class PyPlugCache
+{
+public:
+
+    struct Entry
+    {
+        QString scriptPath;
+        qint64 modificationTime; // msecs since epoch
+        qint64 fileSize;
+
+        // Whether the script has one of the lines telling a PyPlug from another script
+        bool isPyPlug;
+
+        // Whether the script imports NatronGui, in which case it is not loaded in background mode
+        bool importsNatronGui;
+
+        // Whether the informations below were returned by the script
+        bool hasInfos;
+        std::string pluginID;
+        std::string pluginLabel;
+        std::string iconFilePath;
+        std::string grouping;
+        bool isToolset;
+        unsigned int version;
+
+        Entry()
+            : scriptPath()
+            , modificationTime(0)
+            , fileSize(0)
+            , isPyPlug(false)
+            , importsNatronGui(false)
+            , hasInfos(false)
+            , pluginID()
+            , pluginLabel()
+            , iconFilePath()
+            , grouping()
+            , isToolset(false)
+            , version(1)
+        {
+        }
+    };
+
+    PyPlugCache();
+
+    /**
+     * @brief Reads the entries of the cache at the given path. Returns false if there is no cache or if it was
+     * written by a different version, in which case all scripts will be scanned.
+     **/
+    bool read(const QString& filePath);
+
+    /**
+     * @brief Writes the entries added with insert() since the cache was read, replacing the file atomically.
+     **/
+    bool write(const QString& filePath) const;
+
+    /**
+     * @brief Returns for each script its entry from the cache if the script did not change, or the result of scanning
+     * its lines otherwise, in which case the entry has no infos yet. Scripts that cannot be read are left out.
+     * The scripts are scanned concurrently unless multiThreaded is false.
+     **/
+    void scanScripts(const QStringList& scripts, std::vector<Entry>* entries, bool multiThreaded = true) const;
+
+    /**
+     * @brief Adds an entry to the cache written by write(). Entries of scripts that were not inserted since the cache
+     * was read are dropped.
+     **/
+    void insert(const Entry& entry);
+
+    /**
+     * @brief Returns true if the entries inserted differ from the entries read, i.e if the cache should be written.
+     **/
+    bool isDirty() const;
+
+private:
+
+    struct ScanArgs;
+
+    static void scanScript(ScanArgs& args);
+
+    typedef std::map<QString, Entry> EntriesMap;
+
+    EntriesMap _readEntries;
+    EntriesMap _entries;
+    bool _dirty;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_PYPLUGCACHE_H
@@ -0,0 +1,326 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RenderTrace.h"
+
+#include <algorithm> // min, max
+#include <cstdio> // snprintf
+#include <cstring> // strncpy
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QThreadStorage>
+
+#include "Global/FStreamsSupport.h"
+#include "Global/QtCompat.h"
+
+#include "Engine/EffectInstance.h"
+#include "Engine/ThreadPool.h"
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+const int kEventsPerThread = 1 << NATRON_RENDER_TRACE_EVENTS_PER_THREAD_LOG2;
+
+struct TraceEvent
+{
+    const char* name;
+    const char* category;
+    char nodeName[NATRON_RENDER_TRACE_NODE_NAME_MAX_LENGTH + 1];
+    qint64 startTime;
+    qint64 endTime;
+};
+
+struct ThreadTraceBuffer
+{
+    int threadIndex;
+    std::string threadName;
+    std::vector<TraceEvent> events;
+
+    // Number of events written since the last clear(), only incremented by the thread owning the buffer.
+    // The event is written before the count is incremented, with release ordering.
+    QAtomicInt nEventsWritten;
+
+    ThreadTraceBuffer(int threadIndex,
+                      const std::string& threadName)
+        : threadIndex(threadIndex)
+        , threadName(threadName)
+        , events(kEventsPerThread)
+        , nEventsWritten(0)
+    {
+    }
+};
+
+typedef boost::shared_ptr<ThreadTraceBuffer> ThreadTraceBufferPtr;
+
+struct RenderTraceData
+{
+    // Protects buffers
+    QMutex lock;
+
+    // The buffers of all threads that recorded events, kept after their thread exits until clear().
+    // Once its thread exited, a buffer is only referenced here.
+    std::vector<ThreadTraceBufferPtr> buffers;
+
+    // The buffer of the current thread
+    QThreadStorage<ThreadTraceBufferPtr> threadBuffer;
+
+    // The trace thread index of the next buffer
+    int nextThreadIndex;
+
+    QElapsedTimer timer;
+
+    RenderTraceData()
+        : lock()
+        , buffers()
+        , threadBuffer()
+        , nextThreadIndex(1)
+        , timer()
+    {
+        timer.start();
+    }
+};
+
+// Never destroyed, so that threads tracing while the application exits do not reach a destroyed object
+RenderTraceData* data = new RenderTraceData;
+
+ThreadTraceBuffer*
+getThreadBuffer()
+{
+    if ( data->threadBuffer.hasLocalData() ) {
+        return data->threadBuffer.localData().get();
+    }
+
+    QThread* thread = QThread::currentThread();
+    std::string threadName;
+    AbortableThread* isAbortable = dynamic_cast<AbortableThread*>(thread);
+    if (isAbortable) {
+        threadName = isAbortable->getThreadName();
+    }
+    if ( threadName.empty() && thread ) {
+        threadName = thread->objectName().toStdString();
+    }
+
+    QMutexLocker k(&data->lock);
+    // Threads may be short-lived, as those of the multi-thread suite when the thread pool is disabled: rather than
+    // allocating a buffer per thread, take over the buffer of a finished thread of the same name, keeping its events.
+    ThreadTraceBufferPtr buffer;
+    for (std::size_t i = 0; i < data->buffers.size(); ++i) {
+        if ( (data->buffers[i].use_count() == 1) && (data->buffers[i]->threadName == threadName) ) {
+            buffer = data->buffers[i];
+            break;
+        }
+    }
+    if (!buffer) {
+        buffer.reset( new ThreadTraceBuffer(data->nextThreadIndex++, threadName) );
+        data->buffers.push_back(buffer);
+    }
+    data->threadBuffer.setLocalData(buffer);
+
+    return buffer.get();
+}
+
+void
+writeJSONString(std::ostream& stream,
+                const char* str)
+{
+    stream << '"';
+    for (const char* c = str; *c; ++c) {
+        switch (*c) {
+        case '"':
+            stream << "\\\"";
+            break;
+        case '\\':
+            stream << "\\\\";
+            break;
+        default:
+            if ( (unsigned char)*c < 0x20 ) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned int)(unsigned char)*c);
+                stream << escaped;
+            } else {
+                stream << *c;
+            }
+            break;
+        }
+    }
+    stream << '"';
+}
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+QAtomicInt RenderTrace::_enabled(0);
+
+void
+RenderTrace::setEnabled(bool enabled)
+{
+    _enabled.fetchAndStoreRelease(enabled ? 1 : 0);
+}
+
+void
+RenderTrace::clear()
+{
+    QMutexLocker k(&data->lock);
+
+    // Free the buffers of the threads that exited, the others are reused
+    std::vector<ThreadTraceBufferPtr> buffers;
+    for (std::size_t i = 0; i < data->buffers.size(); ++i) {
+        if (data->buffers[i].use_count() == 1) {
+            continue;
+        }
+        data->buffers[i]->nEventsWritten.fetchAndStoreRelease(0);
+        buffers.push_back(data->buffers[i]);
+    }
+    data->buffers.swap(buffers);
+}
+
+qint64
+RenderTrace::getTime()
+{
+    return data->timer.nsecsElapsed();
+}
+
+void
+RenderTrace::addEvent(const char* name,
+                      const char* category,
+                      const std::string& nodeName,
+                      qint64 startTime,
+                      qint64 endTime)
+{
+    ThreadTraceBuffer* buffer = getThreadBuffer();
+
+    // Only this thread writes to the buffer
+    int n = (int)buffer->nEventsWritten;
+    TraceEvent& e = buffer->events[n & (kEventsPerThread - 1)];
+
+    e.name = name;
+    e.category = category;
+    strncpy(e.nodeName, nodeName.c_str(), NATRON_RENDER_TRACE_NODE_NAME_MAX_LENGTH);
+    e.nodeName[NATRON_RENDER_TRACE_NODE_NAME_MAX_LENGTH] = '\0';
+    e.startTime = startTime;
+    e.endTime = endTime;
+    buffer->nEventsWritten.fetchAndStoreRelease(n + 1);
+}
+
+int
+RenderTrace::getNumEvents()
+{
+    QMutexLocker k(&data->lock);
+    int ret = 0;
+
+    for (std::size_t i = 0; i < data->buffers.size(); ++i) {
+        // The slot of the oldest event of a full buffer is the one written next, it is not read
+        ret += std::min( QtCompat::loadAcquire(data->buffers[i]->nEventsWritten), kEventsPerThread - 1 );
+    }
+
+    return ret;
+}
+
+void
+RenderTrace::writeChromeTrace(std::ostream& stream)
+{
+    QMutexLocker k(&data->lock);
+    bool first = true;
+    std::vector<TraceEvent> events;
+
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (std::size_t i = 0; i < data->buffers.size(); ++i) {
+        const ThreadTraceBuffer& buffer = *data->buffers[i];
+
+        // The thread may be recording while its events are read: the slot of event nWritten, which is the slot of the
+        // oldest event, may be being written. Copy the other events, then drop those the thread overwrote meanwhile.
+        const int nWritten = QtCompat::loadAcquire(buffer.nEventsWritten);
+        const int firstEvent = std::max(0, nWritten - kEventsPerThread + 1);
+        events.clear();
+        for (int j = firstEvent; j < nWritten; ++j) {
+            events.push_back(buffer.events[j & (kEventsPerThread - 1)]);
+        }
+        const int nWrittenAfter = QtCompat::loadAcquire(buffer.nEventsWritten);
+        const int nOverwritten = std::max(0, nWrittenAfter - kEventsPerThread + 1 - firstEvent);
+        if ( nOverwritten >= (int)events.size() ) {
+            continue;
+        }
+
+        // Name the thread in the viewer
+        if (!first) {
+            stream << ",";
+        }
+        first = false;
+        stream << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.threadIndex << ",\"args\":{\"name\":";
+        writeJSONString( stream, buffer.threadName.empty() ? "Thread" : buffer.threadName.c_str() );
+        stream << "}}";
+
+        // Events are written in the order they were recorded, the oldest ones having been overwritten
+        for (std::size_t j = nOverwritten; j < events.size(); ++j) {
+            const TraceEvent& e = events[j];
+            char times[64];
+            snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f", e.startTime / 1000., (e.endTime - e.startTime) / 1000.);
+            stream << ",\n{\"name\":";
+            writeJSONString(stream, e.name);
+            stream << ",\"cat\":";
+            writeJSONString(stream, e.category);
+            stream << ",\"ph\":\"X\"," << times << ",\"pid\":1,\"tid\":" << buffer.threadIndex;
+            if (e.nodeName[0] != '\0') {
+                stream << ",\"args\":{\"node\":";
+                writeJSONString(stream, e.nodeName);
+                stream << "}";
+            }
+            stream << "}";
+        }
+    }
+    stream << "\n]}\n";
+} // RenderTrace::writeChromeTrace
+
+bool
+RenderTrace::writeChromeTraceFile(const std::string& filePath)
+{
+    FStreamsSupport::ofstream ofile;
+
+    FStreamsSupport::open(&ofile, filePath);
+    if (!ofile) {
+        return false;
+    }
+    writeChromeTrace(ofile);
+
+    return !ofile.fail();
+}
+
+void
+RenderTraceScope::begin(const EffectInstance* effect)
+{
+    if (effect) {
+        _nodeName = effect->getScriptName_mt_safe();
+    }
+    _startTime = RenderTrace::getTime();
+}
+
+NATRON_NAMESPACE_EXIT
@@ -0,0 +1,155 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_RENDERTRACE_H
+#define NATRON_ENGINE_RENDERTRACE_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <ostream>
+#include <string>
+
+#include <QtCore/QAtomicInt>
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/EngineFwd.h"
+
+///Number of events kept for each thread, minus one: older events are overwritten
+#define NATRON_RENDER_TRACE_EVENTS_PER_THREAD_LOG2 14
+
+///Node names longer than this are truncated in the trace
+#define NATRON_RENDER_TRACE_NODE_NAME_MAX_LENGTH 47
+
+///Categories of the traced events
+#define kRenderTraceCategoryRender "render"
+#define kRenderTraceCategoryAction "action"
+#define kRenderTraceCategoryCache "cache"
+#define kRenderTraceCategoryConversion "conversion"
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Records timed events of the render pipeline for each thread, to be exported as a Chrome trace-event JSON
+ * file that can be opened in chrome://tracing, Perfetto or speedscope (which also shows it as a flame graph).
+ * Each thread writes its events to its own ring buffer without taking any lock: only the first event of a thread
+ * registers its buffer, reusing the buffer of a finished thread of the same name if there is one.
+ * When tracing is disabled, a traced scope costs one atomic read.
+ **/
+class RenderTrace
+{
+public:
+
+    static bool isEnabled()
+    {
+        return (int)_enabled != 0;
+    }
+
+    /**
+     * @brief Starts or stops recording events. The events recorded so far are kept until clear() is called.
+     **/
+    static void setEnabled(bool enabled);
+
+    /**
+     * @brief Removes all recorded events and frees the buffers of the threads that exited. Should not be called while
+     * rendering, otherwise events of the scopes that are running may remain.
+     **/
+    static void clear();
+
+    /**
+     * @brief Returns the time in nanoseconds since tracing was first enabled.
+     **/
+    static qint64 getTime();
+
+    /**
+     * @brief Records an event of the calling thread. name and category must be string literals: only their
+     * address is stored.
+     **/
+    static void addEvent(const char* name, const char* category, const std::string& nodeName, qint64 startTime, qint64 endTime);
+
+    /**
+     * @brief Returns the number of events currently recorded, for all threads.
+     **/
+    static int getNumEvents();
+
+    /**
+     * @brief Writes the recorded events in the Chrome trace-event JSON format. It may be called while rendering: the
+     * events being recorded or overwritten while the ring buffers are read are not written.
+     **/
+    static void writeChromeTrace(std::ostream& stream);
+
+    /**
+     * @brief Same as writeChromeTrace() to the given file, returns false if the file could not be written.
+     **/
+    static bool writeChromeTraceFile(const std::string& filePath);
+
+private:
+
+    static QAtomicInt _enabled;
+};
+
+/**
+ * @brief Records an event from its construction to its destruction, when tracing is enabled.
+ * The name of the node is only fetched when tracing is enabled.
+ **/
+class RenderTraceScope
+{
+public:
+
+    RenderTraceScope(const char* name,
+                     const char* category,
+                     const EffectInstance* effect = 0)
+        : _name(name)
+        , _category(category)
+        , _nodeName()
+        , _startTime(0)
+        , _enabled( RenderTrace::isEnabled() )
+    {
+        if (_enabled) {
+            begin(effect);
+        }
+    }
+
+    ~RenderTraceScope()
+    {
+        if (_enabled) {
+            RenderTrace::addEvent( _name, _category, _nodeName, _startTime, RenderTrace::getTime() );
+        }
+    }
+
+private:
+
+    void begin(const EffectInstance* effect);
+
+    const char* _name;
+    const char* _category;
+    std::string _nodeName;
+    qint64 _startTime;
+    bool _enabled;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_RENDERTRACE_H
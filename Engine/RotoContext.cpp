@@ -44,9 +44,14 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
 #include <QtCore/QLineF>
 #include <QtCore/QDebug>
+#include <QtCore/QThreadPool>
+#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
 
 //#define ROTO_RENDER_TRIANGLES_ONLY
 
+// Uncomment to render the closed beziers with cairo mesh patterns instead of the RotoRasterizer
+//#define ROTO_RENDER_BEZIER_WITH_CAIRO
+
 #include "libtess.h"
 
 #include "Engine/RotoContextPrivate.h"
@@ -64,10 +69,12 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/MemoryInfo.h" // printAsRAM
 #include "Engine/NodeSerialization.h"
 #include "Engine/Interpolation.h"
+#include "Engine/Project.h"
 #include "Engine/RenderStats.h"
 #include "Engine/RotoContextSerialization.h"
 #include "Engine/RotoDrawableItem.h"
 #include "Engine/RotoLayer.h"
+#include "Engine/RotoRasterizer.h"
 #include "Engine/RotoStrokeItem.h"
 #include "Engine/Settings.h"
 #include "Engine/TimeLine.h"
@@ -102,6 +109,10 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 // http://www.davidrevoy.com/article182/calibrating-wacom-stylus-pressure-on-krita
 #define ROTO_PRESSURE_LEVELS 512
 
+// Movements of a paint stroke covering at least this many pixels are rendered in horizontal bands, concurrently
+#define ROTO_STROKE_PARALLEL_MIN_PIXELS (256 * 256)
+#define ROTO_STROKE_BAND_HEIGHT 64
+
 #ifndef M_PI
 #define M_PI        3.14159265358979323846264338327950288   /* pi             */
 #endif
@@ -2173,7 +2184,7 @@ adjustToPointToScale(unsigned int mipmapLevel,
 template <typename PIX, int maxValue, int dstNComps, int srcNComps, bool useOpacity, bool inverted>
 static void
 convertCairoImageToNatronImageForInverted_noColor(cairo_surface_t* cairoImg,
-                                                  Image* image,
+                                                  Image::WriteAccess* acc,
                                                   const RectI & pixelRod,
                                                   double shapeColor[3],
                                                   double opacity)
@@ -2181,7 +2192,6 @@ convertCairoImageToNatronImageForInverted_noColor(cairo_surface_t* cairoImg,
     unsigned char* cdata = cairo_image_surface_get_data(cairoImg);
     unsigned char* srcPix = cdata;
     int stride = cairo_image_surface_get_stride(cairoImg);
-    Image::WriteAccess acc = image->getWriteRights();
     double r = useOpacity ? shapeColor[0] * opacity : shapeColor[0];
     double g = useOpacity ? shapeColor[1] * opacity : shapeColor[1];
     double b = useOpacity ? shapeColor[2] * opacity : shapeColor[2];
@@ -2190,7 +2200,7 @@ convertCairoImageToNatronImageForInverted_noColor(cairo_surface_t* cairoImg,
 
     for ( int y = 0; y < pixelRod.height(); ++y,
           srcPix += (stride - srcNElements) ) {
-        PIX* dstPix = (PIX*)acc.pixelAt(pixelRod.x1, pixelRod.y1 + y);
+        PIX* dstPix = (PIX*)acc->pixelAt(pixelRod.x1, pixelRod.y1 + y);
         assert(dstPix);
 
         for (int x = 0; x < width; ++x,
@@ -2232,23 +2242,23 @@ convertCairoImageToNatronImageForInverted_noColor(cairo_surface_t* cairoImg,
 template <typename PIX, int maxValue, int dstNComps, int srcNComps, bool useOpacity>
 static void
 convertCairoImageToNatronImageForDstComponents_noColor(cairo_surface_t* cairoImg,
-                                                       Image* image,
+                                                       Image::WriteAccess* acc,
                                                        const RectI & pixelRod,
                                                        double shapeColor[3],
                                                        bool inverted,
                                                        double opacity)
 {
     if (inverted) {
-        convertCairoImageToNatronImageForInverted_noColor<PIX, maxValue, dstNComps, srcNComps, useOpacity, true>(cairoImg, image, pixelRod, shapeColor, opacity);
+        convertCairoImageToNatronImageForInverted_noColor<PIX, maxValue, dstNComps, srcNComps, useOpacity, true>(cairoImg, acc, pixelRod, shapeColor, opacity);
     } else {
-        convertCairoImageToNatronImageForInverted_noColor<PIX, maxValue, dstNComps, srcNComps, useOpacity, false>(cairoImg, image, pixelRod, shapeColor, opacity);
+        convertCairoImageToNatronImageForInverted_noColor<PIX, maxValue, dstNComps, srcNComps, useOpacity, false>(cairoImg, acc, pixelRod, shapeColor, opacity);
     }
 }
 
 template <typename PIX, int maxValue, int dstNComps, int srcNComps>
 static void
 convertCairoImageToNatronImageForOpacity(cairo_surface_t* cairoImg,
-                                         Image* image,
+                                         Image::WriteAccess* acc,
                                          const RectI & pixelRod,
                                          double shapeColor[3],
                                          double opacity,
@@ -2256,9 +2266,9 @@ convertCairoImageToNatronImageForOpacity(cairo_surface_t* cairoImg,
                                          bool useOpacity)
 {
     if (useOpacity) {
-        convertCairoImageToNatronImageForDstComponents_noColor<PIX, maxValue, dstNComps, srcNComps, true>(cairoImg, image, pixelRod, shapeColor, inverted, opacity);
+        convertCairoImageToNatronImageForDstComponents_noColor<PIX, maxValue, dstNComps, srcNComps, true>(cairoImg, acc, pixelRod, shapeColor, inverted, opacity);
     } else {
-        convertCairoImageToNatronImageForDstComponents_noColor<PIX, maxValue, dstNComps, srcNComps, false>(cairoImg, image, pixelRod, shapeColor, inverted, opacity);
+        convertCairoImageToNatronImageForDstComponents_noColor<PIX, maxValue, dstNComps, srcNComps, false>(cairoImg, acc, pixelRod, shapeColor, inverted, opacity);
     }
 }
 
@@ -2266,7 +2276,7 @@ template <typename PIX, int maxValue, int dstNComps>
 static void
 convertCairoImageToNatronImageForSrcComponents_noColor(cairo_surface_t* cairoImg,
                                                        int srcNComps,
-                                                       Image* image,
+                                                       Image::WriteAccess* acc,
                                                        const RectI & pixelRod,
                                                        double shapeColor[3],
                                                        double opacity,
@@ -2274,9 +2284,9 @@ convertCairoImageToNatronImageForSrcComponents_noColor(cairo_surface_t* cairoImg
                                                        bool useOpacity)
 {
     if (srcNComps == 1) {
-        convertCairoImageToNatronImageForOpacity<PIX, maxValue, dstNComps, 1>(cairoImg, image, pixelRod, shapeColor, opacity, inverted, useOpacity);
+        convertCairoImageToNatronImageForOpacity<PIX, maxValue, dstNComps, 1>(cairoImg, acc, pixelRod, shapeColor, opacity, inverted, useOpacity);
     } else if (srcNComps == 4) {
-        convertCairoImageToNatronImageForOpacity<PIX, maxValue, dstNComps, 4>(cairoImg, image, pixelRod, shapeColor, opacity, inverted, useOpacity);
+        convertCairoImageToNatronImageForOpacity<PIX, maxValue, dstNComps, 4>(cairoImg, acc, pixelRod, shapeColor, opacity, inverted, useOpacity);
     } else {
         assert(false);
     }
@@ -2287,6 +2297,7 @@ static void
 convertCairoImageToNatronImage_noColor(cairo_surface_t* cairoImg,
                                        int srcNComps,
                                        Image* image,
+                                       Image::WriteAccess* acc,
                                        const RectI & pixelRod,
                                        double shapeColor[3],
                                        double opacity,
@@ -2297,22 +2308,121 @@ convertCairoImageToNatronImage_noColor(cairo_surface_t* cairoImg,
 
     switch (comps) {
     case 1:
-        convertCairoImageToNatronImageForSrcComponents_noColor<PIX, maxValue, 1>(cairoImg, srcNComps, image, pixelRod, shapeColor, opacity, inverted, useOpacity);
+        convertCairoImageToNatronImageForSrcComponents_noColor<PIX, maxValue, 1>(cairoImg, srcNComps, acc, pixelRod, shapeColor, opacity, inverted, useOpacity);
+        break;
+    case 2:
+        convertCairoImageToNatronImageForSrcComponents_noColor<PIX, maxValue, 2>(cairoImg, srcNComps, acc, pixelRod, shapeColor, opacity, inverted, useOpacity);
+        break;
+    case 3:
+        convertCairoImageToNatronImageForSrcComponents_noColor<PIX, maxValue, 3>(cairoImg, srcNComps, acc, pixelRod, shapeColor, opacity, inverted, useOpacity);
+        break;
+    case 4:
+        convertCairoImageToNatronImageForSrcComponents_noColor<PIX, maxValue, 4>(cairoImg, srcNComps, acc, pixelRod, shapeColor, opacity, inverted, useOpacity);
+        break;
+    default:
+        break;
+    }
+}
+
+#ifndef ROTO_RENDER_BEZIER_WITH_CAIRO
+template <typename PIX, int maxValue, int dstNComps, bool inverted>
+static void
+convertCoverageToNatronImageForInverted(const RotoRasterizer& rasterizer,
+                                        Image* image,
+                                        double shapeColor[3],
+                                        double opacity)
+{
+    // The rasterizer only rendered a part of the image
+    const RectI& bounds = rasterizer.getBounds();
+    const float* coverage = rasterizer.getCoverage();
+    Image::WriteAccess acc = image->getWriteRights();
+    double r = shapeColor[0] * opacity;
+    double g = shapeColor[1] * opacity;
+    double b = shapeColor[2] * opacity;
+    int width = bounds.width();
+
+    assert( image->getBounds().contains(bounds) );
+    for (int y = 0; y < bounds.height(); ++y) {
+        const float* srcPix = coverage + (std::size_t)y * width;
+        PIX* dstPix = (PIX*)acc.pixelAt(bounds.x1, bounds.y1 + y);
+        assert(dstPix);
+
+        for (int x = 0; x < width; ++x,
+             dstPix += dstNComps,
+             ++srcPix) {
+            float pixel = !inverted ? *srcPix * maxValue : (1.f - *srcPix) * maxValue;
+            switch (dstNComps) {
+            case 4:
+                dstPix[0] = PIX(pixel * r);
+                dstPix[1] = PIX(pixel * g);
+                dstPix[2] = PIX(pixel * b);
+                dstPix[3] = PIX(pixel * opacity);
+                break;
+            case 1:
+                dstPix[0] = PIX(pixel * opacity);
+                break;
+            case 3:
+                dstPix[0] = PIX(pixel * r);
+                dstPix[1] = PIX(pixel * g);
+                dstPix[2] = PIX(pixel * b);
+                break;
+            case 2:
+                dstPix[0] = PIX(pixel * r);
+                dstPix[1] = PIX(pixel * g);
+                break;
+
+            default:
+                break;
+            }
+        }
+    }
+} // convertCoverageToNatronImageForInverted
+
+template <typename PIX, int maxValue, int dstNComps>
+static void
+convertCoverageToNatronImageForDstComponents(const RotoRasterizer& rasterizer,
+                                             Image* image,
+                                             double shapeColor[3],
+                                             double opacity,
+                                             bool inverted)
+{
+    if (inverted) {
+        convertCoverageToNatronImageForInverted<PIX, maxValue, dstNComps, true>(rasterizer, image, shapeColor, opacity);
+    } else {
+        convertCoverageToNatronImageForInverted<PIX, maxValue, dstNComps, false>(rasterizer, image, shapeColor, opacity);
+    }
+}
+
+template <typename PIX, int maxValue>
+static void
+convertCoverageToNatronImage(const RotoRasterizer& rasterizer,
+                             Image* image,
+                             double shapeColor[3],
+                             double opacity,
+                             bool inverted)
+{
+    int comps = (int)image->getComponentsCount();
+
+    switch (comps) {
+    case 1:
+        convertCoverageToNatronImageForDstComponents<PIX, maxValue, 1>(rasterizer, image, shapeColor, opacity, inverted);
         break;
     case 2:
-        convertCairoImageToNatronImageForSrcComponents_noColor<PIX, maxValue, 2>(cairoImg, srcNComps, image, pixelRod, shapeColor, opacity, inverted, useOpacity);
+        convertCoverageToNatronImageForDstComponents<PIX, maxValue, 2>(rasterizer, image, shapeColor, opacity, inverted);
         break;
     case 3:
-        convertCairoImageToNatronImageForSrcComponents_noColor<PIX, maxValue, 3>(cairoImg, srcNComps, image, pixelRod, shapeColor, opacity, inverted, useOpacity);
+        convertCoverageToNatronImageForDstComponents<PIX, maxValue, 3>(rasterizer, image, shapeColor, opacity, inverted);
         break;
     case 4:
-        convertCairoImageToNatronImageForSrcComponents_noColor<PIX, maxValue, 4>(cairoImg, srcNComps, image, pixelRod, shapeColor, opacity, inverted, useOpacity);
+        convertCoverageToNatronImageForDstComponents<PIX, maxValue, 4>(rasterizer, image, shapeColor, opacity, inverted);
         break;
     default:
         break;
     }
 }
 
+#endif // ROTO_RENDER_BEZIER_WITH_CAIRO
+
 #if 0
 template <typename PIX, int maxValue, int srcNComps, int dstNComps>
 static void
@@ -2425,7 +2535,7 @@ template <typename PIX, int maxValue, int srcNComps, int dstNComps>
 static void
 convertNatronImageToCairoImageForComponents(unsigned char* cairoImg,
                                             std::size_t stride,
-                                            Image* image,
+                                            Image::WriteAccess* acc,
                                             const RectI& roi,
                                             const RectI& dstBounds,
                                             double shapeColor[3])
@@ -2434,10 +2544,8 @@ convertNatronImageToCairoImageForComponents(unsigned char* cairoImg,
 
     dstPix += ( (roi.y1 - dstBounds.y1) * stride + (roi.x1 - dstBounds.x1) );
 
-    Image::ReadAccess acc = image->getReadRights();
-
     for (int y = 0; y < roi.height(); ++y, dstPix += stride) {
-        const PIX* srcPix = (const PIX*)acc.pixelAt(roi.x1, roi.y1 + y);
+        const PIX* srcPix = (const PIX*)acc->pixelAt(roi.x1, roi.y1 + y);
         assert(srcPix);
 
         for (int x = 0; x < roi.width(); ++x) {
@@ -2474,15 +2582,15 @@ static void
 convertNatronImageToCairoImageForSrcComponents(unsigned char* cairoImg,
                                                int dstNComps,
                                                std::size_t stride,
-                                               Image* image,
+                                               Image::WriteAccess* acc,
                                                const RectI& roi,
                                                const RectI& dstBounds,
                                                double shapeColor[3])
 {
     if (dstNComps == 1) {
-        convertNatronImageToCairoImageForComponents<PIX, maxValue, srcComps, 1>(cairoImg, stride, image, roi, dstBounds, shapeColor);
+        convertNatronImageToCairoImageForComponents<PIX, maxValue, srcComps, 1>(cairoImg, stride, acc, roi, dstBounds, shapeColor);
     } else if (dstNComps == 4) {
-        convertNatronImageToCairoImageForComponents<PIX, maxValue, srcComps, 4>(cairoImg, stride, image, roi, dstBounds, shapeColor);
+        convertNatronImageToCairoImageForComponents<PIX, maxValue, srcComps, 4>(cairoImg, stride, acc, roi, dstBounds, shapeColor);
     } else {
         assert(false);
     }
@@ -2494,6 +2602,7 @@ convertNatronImageToCairoImage(unsigned char* cairoImg,
                                int dstNComps,
                                std::size_t stride,
                                Image* image,
+                               Image::WriteAccess* acc,
                                const RectI& roi,
                                const RectI& dstBounds,
                                double shapeColor[3])
@@ -2502,22 +2611,203 @@ convertNatronImageToCairoImage(unsigned char* cairoImg,
 
     switch (numComps) {
     case 1:
-        convertNatronImageToCairoImageForSrcComponents<PIX, maxValue, 1>(cairoImg, dstNComps, stride, image, roi, dstBounds, shapeColor);
+        convertNatronImageToCairoImageForSrcComponents<PIX, maxValue, 1>(cairoImg, dstNComps, stride, acc, roi, dstBounds, shapeColor);
         break;
     case 2:
-        convertNatronImageToCairoImageForSrcComponents<PIX, maxValue, 2>(cairoImg, dstNComps, stride, image, roi, dstBounds, shapeColor);
+        convertNatronImageToCairoImageForSrcComponents<PIX, maxValue, 2>(cairoImg, dstNComps, stride, acc, roi, dstBounds, shapeColor);
         break;
     case 3:
-        convertNatronImageToCairoImageForSrcComponents<PIX, maxValue, 3>(cairoImg, dstNComps, stride, image, roi, dstBounds, shapeColor);
+        convertNatronImageToCairoImageForSrcComponents<PIX, maxValue, 3>(cairoImg, dstNComps, stride, acc, roi, dstBounds, shapeColor);
         break;
     case 4:
-        convertNatronImageToCairoImageForSrcComponents<PIX, maxValue, 4>(cairoImg, dstNComps, stride, image, roi, dstBounds, shapeColor);
+        convertNatronImageToCairoImageForSrcComponents<PIX, maxValue, 4>(cairoImg, dstNComps, stride, acc, roi, dstBounds, shapeColor);
         break;
     default:
         break;
     }
 }
 
+#ifdef DEBUG
+//Make sure the dots we are about to render fall inside the given bounds, otherwise the bounds of the image are mis-calculated.
+static void
+checkDotsInsideBounds(const std::vector<RotoContextPrivate::StrokeDot>& dots,
+                      const RectI& bounds)
+{
+    for (std::vector<RotoContextPrivate::StrokeDot>::const_iterator it = dots.begin(); it != dots.end(); ++it) {
+        assert(std::floor(it->center.x - it->externalRadius) >= bounds.x1 && std::floor(it->center.x + it->externalRadius) < bounds.x2 &&
+               std::floor(it->center.y - it->externalRadius) >= bounds.y1 && std::floor(it->center.y + it->externalRadius) < bounds.y2);
+    }
+}
+
+#endif
+
+/**
+ * @brief Returns the bounds the image of a paint stroke must be grown to in order to contain newBounds.
+ * Growing the image copies it: it is grown ahead of the stroke by half its size on the sides it grows on, within the
+ * format, so that a long stroke is not copied again at each movement.
+ **/
+static RectI
+getGrownStrokeImageBounds(const RectI& bounds,
+                          const RectI& newBounds,
+                          const RectI& formatBounds)
+{
+    RectI ret = bounds;
+
+    ret.merge(newBounds);
+    if ( bounds.isNull() ) {
+        return ret;
+    }
+    int marginX = bounds.width() / 2;
+    int marginY = bounds.height() / 2;
+    if (newBounds.x1 < bounds.x1) {
+        ret.x1 = std::min( ret.x1, std::max(newBounds.x1 - marginX, formatBounds.x1) );
+    }
+    if (newBounds.x2 > bounds.x2) {
+        ret.x2 = std::max( ret.x2, std::min(newBounds.x2 + marginX, formatBounds.x2) );
+    }
+    if (newBounds.y1 < bounds.y1) {
+        ret.y1 = std::min( ret.y1, std::max(newBounds.y1 - marginY, formatBounds.y1) );
+    }
+    if (newBounds.y2 > bounds.y2) {
+        ret.y2 = std::max( ret.y2, std::min(newBounds.y2 + marginY, formatBounds.y2) );
+    }
+
+    return ret;
+}
+
+struct StrokeBandArgs
+{
+    // The rows of the image rendered, and the start of the cairo buffer of these rows
+    RectI band;
+    unsigned char* data;
+    std::size_t stride;
+    cairo_format_t format;
+    int srcNComps;
+    const std::vector<RotoContextPrivate::StrokeDot>* dots;
+
+    // Null when bands are rendered concurrently
+    std::vector<cairo_pattern_t*>* dotPatterns;
+    Image* image;
+
+    // The write access to image is held by the caller while all the bands are rendered: taking it in each band
+    // would serialize them
+    Image::WriteAccess* imageAccess;
+    bool copyFromImage;
+    bool doBuildUp;
+    double opacity;
+    double shapeColor[3];
+};
+
+/**
+ * @brief Composites the dots overlapping the band over the content of the image in the band
+ **/
+static void
+renderStrokeBand(const StrokeBandArgs& args)
+{
+    const RectI& band = args.band;
+    double shapeColor[3] = {args.shapeColor[0], args.shapeColor[1], args.shapeColor[2]};
+
+    if (args.copyFromImage) {
+        convertNatronImageToCairoImage<float, 1>(args.data, args.srcNComps, args.stride, args.image, args.imageAccess, band, band, shapeColor);
+    }
+
+    CairoImageWrapper imgWrapper;
+    imgWrapper.cairoImg = cairo_image_surface_create_for_data(args.data, args.format, band.width(), band.height(), args.stride);
+    if (cairo_surface_status(imgWrapper.cairoImg) != CAIRO_STATUS_SUCCESS) {
+        return;
+    }
+    cairo_surface_set_device_offset(imgWrapper.cairoImg, -band.x1, -band.y1);
+    imgWrapper.ctx = cairo_create(imgWrapper.cairoImg);
+    //cairo_set_fill_rule(cr, CAIRO_FILL_RULE_EVEN_ODD); // creates holes on self-overlapping shapes
+    cairo_set_fill_rule(imgWrapper.ctx, CAIRO_FILL_RULE_WINDING);
+
+    // these Roto shapes must be rendered WITHOUT antialias, or the junction between the inner
+    // polygon and the feather zone will have artifacts. This is partly due to the fact that cairo
+    // meshes are not antialiased.
+    // Use a default feather distance of 1 pixel instead!
+    // UPDATE: unfortunately, this produces less artifacts, but there are still some remaining (use opacity=0.5 to test)
+    // maybe the inner polygon should be made of mesh patterns too?
+    cairo_set_antialias(imgWrapper.ctx, CAIRO_ANTIALIAS_NONE);
+    cairo_set_operator(imgWrapper.ctx, args.doBuildUp ? CAIRO_OPERATOR_OVER : CAIRO_OPERATOR_LIGHTEN);
+
+    for (std::vector<RotoContextPrivate::StrokeDot>::const_iterator it = args.dots->begin(); it != args.dots->end(); ++it) {
+        if ( (it->center.y + it->externalRadius < band.y1) || (it->center.y - it->externalRadius >= band.y2) ) {
+            continue;
+        }
+        RotoContextPrivate::renderDot(imgWrapper.ctx, args.dotPatterns, it->center, it->internalRadius, it->externalRadius, it->pressure, args.doBuildUp, it->opacityStops, args.opacity);
+    }
+
+    assert(cairo_surface_status(imgWrapper.cairoImg) == CAIRO_STATUS_SUCCESS);
+
+    ///A call to cairo_surface_flush() is required before accessing the pixel data
+    ///to ensure that all pending drawing operations are finished.
+    cairo_surface_flush(imgWrapper.cairoImg);
+
+    //Never use invert while drawing
+    const bool inverted = false;
+    convertCairoImageToNatronImage_noColor<float, 1>(imgWrapper.cairoImg, args.srcNComps, args.image, args.imageAccess, band, shapeColor, 1., inverted, false);
+} // renderStrokeBand
+
+void
+RotoContextPrivate::renderStrokeDots(const std::vector<StrokeDot>& dots,
+                                     const RectI& bounds,
+                                     int bandHeight,
+                                     bool doBuildUp,
+                                     double opacity,
+                                     const double shapeColor[3],
+                                     bool copyFromImage,
+                                     std::vector<cairo_pattern_t*>* dotPatterns,
+                                     Image* image)
+{
+    cairo_format_t cairoImgFormat;
+    int srcNComps;
+
+    //For the non build-up case, we use the LIGHTEN compositing operator, which only works on colors
+    if ( !doBuildUp || (image->getComponentsCount() > 1) ) {
+        cairoImgFormat = CAIRO_FORMAT_ARGB32;
+        srcNComps = 4;
+    } else {
+        cairoImgFormat = CAIRO_FORMAT_A8;
+        srcNComps = 1;
+    }
+
+    ////Allocate the cairo temporary buffer
+    std::size_t stride = cairo_format_stride_for_width( cairoImgFormat, bounds.width() );
+    std::vector<unsigned char> buf(stride * bounds.height(), 0);
+
+    // The dots are composited in order in each band, so that the result does not depend on the number of bands.
+    std::vector<StrokeBandArgs> bands;
+    Image::WriteAccess imageAccess = image->getWriteRights();
+    for (int y = bounds.y1; y < bounds.y2; y += bandHeight) {
+        StrokeBandArgs args;
+        args.band.x1 = bounds.x1;
+        args.band.y1 = y;
+        args.band.x2 = bounds.x2;
+        args.band.y2 = std::min(y + bandHeight, bounds.y2);
+        args.dots = &dots;
+        args.dotPatterns = 0;
+        args.data = &buf.front() + (std::size_t)(y - bounds.y1) * stride;
+        args.stride = stride;
+        args.format = cairoImgFormat;
+        args.srcNComps = srcNComps;
+        args.image = image;
+        args.imageAccess = &imageAccess;
+        args.copyFromImage = copyFromImage;
+        args.doBuildUp = doBuildUp;
+        args.opacity = opacity;
+        for (int i = 0; i < 3; ++i) {
+            args.shapeColor[i] = shapeColor[i];
+        }
+        bands.push_back(args);
+    }
+    if (bands.size() > 1) {
+        QtConcurrent::map(bands, &renderStrokeBand).waitForFinished();
+    } else if ( !bands.empty() ) {
+        bands.front().dotPatterns = dotPatterns;
+        renderStrokeBand( bands.front() );
+    }
+} // RotoContextPrivate::renderStrokeDots
+
 double
 RotoStrokeItem::renderSingleStroke(const RectD& pointsBbox,
                                    const std::list<std::pair<Point, double> >& points,
@@ -2609,56 +2899,27 @@ RotoStrokeItem::renderSingleStroke(const RectD& pointsBbox,
             RectI oldBounds = (*image)->getBounds();
             RectD mergeRoD = pointsBbox;
             mergeRoD.merge(otherRoD);
-            source->setRoD(mergeRoD);
-            source->ensureBounds(pixelPointsBbox, true);
+            if ( !oldBounds.contains(pixelPointsBbox) ) {
+                Format projectFormat;
+                node->getApp()->getProject()->getProjectDefaultFormat(&projectFormat);
+                RectI formatBounds;
+                projectFormat.toCanonicalFormat().toPixelEnclosing(mipmapLevel, par, &formatBounds);
+                RectI newBounds = getGrownStrokeImageBounds(oldBounds, pixelPointsBbox, formatBounds);
+                RectD newBoundsCanonical;
+                newBounds.toCanonical_noClipping(mipmapLevel, par, &newBoundsCanonical);
+                mergeRoD.merge(newBoundsCanonical);
+                source->setRoD(mergeRoD);
+                source->ensureBounds(newBounds, true);
+            } else {
+                source->setRoD(mergeRoD);
+            }
         }
         copyFromImage = true;
     }
 
     bool doBuildUp = getBuildupKnob()->getValueAtTime(time);
-    cairo_format_t cairoImgFormat;
-    int srcNComps;
-    //For the non build-up case, we use the LIGHTEN compositing operator, which only works on colors
-    if ( !doBuildUp || (components.getNumComponents() > 1) ) {
-        cairoImgFormat = CAIRO_FORMAT_ARGB32;
-        srcNComps = 4;
-    } else {
-        cairoImgFormat = CAIRO_FORMAT_A8;
-        srcNComps = 1;
-    }
 
-
-    ////Allocate the cairo temporary buffer
-    CairoImageWrapper imgWrapper;
     double opacity = getOpacity(time);
-    std::vector<unsigned char> buf;
-    if (copyFromImage) {
-        std::size_t stride = cairo_format_stride_for_width( cairoImgFormat, pixelPointsBbox.width() );
-        std::size_t memSize = stride * pixelPointsBbox.height();
-        buf.resize(memSize);
-        std::memset(&buf.front(), 0, sizeof(unsigned char) * memSize);
-        convertNatronImageToCairoImage<float, 1>(&buf.front(), srcNComps, stride, source.get(), pixelPointsBbox, pixelPointsBbox, shapeColor);
-        imgWrapper.cairoImg = cairo_image_surface_create_for_data(&buf.front(), cairoImgFormat, pixelPointsBbox.width(), pixelPointsBbox.height(),
-                                                                  stride);
-    } else {
-        imgWrapper.cairoImg = cairo_image_surface_create( cairoImgFormat, pixelPointsBbox.width(), pixelPointsBbox.height() );
-        cairo_surface_set_device_offset(imgWrapper.cairoImg, -pixelPointsBbox.x1, -pixelPointsBbox.y1);
-    }
-    if (cairo_surface_status(imgWrapper.cairoImg) != CAIRO_STATUS_SUCCESS) {
-        return 0;
-    }
-    cairo_surface_set_device_offset(imgWrapper.cairoImg, -pixelPointsBbox.x1, -pixelPointsBbox.y1);
-    imgWrapper.ctx = cairo_create(imgWrapper.cairoImg);
-    //cairo_set_fill_rule(cr, CAIRO_FILL_RULE_EVEN_ODD); // creates holes on self-overlapping shapes
-    cairo_set_fill_rule(imgWrapper.ctx, CAIRO_FILL_RULE_WINDING);
-
-    // these Roto shapes must be rendered WITHOUT antialias, or the junction between the inner
-    // polygon and the feather zone will have artifacts. This is partly due to the fact that cairo
-    // meshes are not antialiased.
-    // Use a default feather distance of 1 pixel instead!
-    // UPDATE: unfortunately, this produces less artifacts, but there are still some remaining (use opacity=0.5 to test)
-    // maybe the inner polygon should be made of mesh patterns too?
-    cairo_set_antialias(imgWrapper.ctx, CAIRO_ANTIALIAS_NONE);
 
     std::list<std::list<std::pair<Point, double> > > strokes;
     std::list<std::pair<Point, double> > toScalePoints;
@@ -2675,6 +2936,19 @@ RotoStrokeItem::renderSingleStroke(const RectD& pointsBbox,
     }
     strokes.push_back(toScalePoints);
 
+    std::vector<RotoContextPrivate::StrokeDot> dots;
+    distToNext = RotoContextPrivate::computeStrokeDots(strokes, distToNext, this, opacity, time, mipmapLevel, &dots);
+    if ( dots.empty() ) {
+        if (!copyFromImage) {
+            source->fillZero(pixelPointsBbox);
+        }
+
+        return distToNext;
+    }
+#ifdef DEBUG
+    checkDotsInsideBounds(dots, pixelPointsBbox);
+#endif
+
     QMutexLocker k(&_imp->strokeDotPatternsMutex);
     std::vector<cairo_pattern_t*> dotPatterns = getPatternCache();
     if (mipMapLevelChanged) {
@@ -2693,20 +2967,15 @@ RotoStrokeItem::renderSingleStroke(const RectD& pointsBbox,
         }
     }
 
-    distToNext = RotoContextPrivate::renderStroke(imgWrapper.ctx, dotPatterns, strokes, distToNext, this, doBuildUp, opacity, time, mipmapLevel);
+    // Large movements of large brushes are rendered in bands, concurrently
+    bool multiThreaded = (std::size_t)pixelPointsBbox.width() * pixelPointsBbox.height() >= ROTO_STROKE_PARALLEL_MIN_PIXELS &&
+                         pixelPointsBbox.height() > ROTO_STROKE_BAND_HEIGHT &&
+                         QThreadPool::globalInstance()->activeThreadCount() < QThreadPool::globalInstance()->maxThreadCount();
+    RotoContextPrivate::renderStrokeDots(dots, pixelPointsBbox, multiThreaded ? ROTO_STROKE_BAND_HEIGHT : pixelPointsBbox.height(),
+                                         doBuildUp, opacity, shapeColor, copyFromImage, &dotPatterns, source.get() );
 
     updatePatternCache(dotPatterns);
 
-    assert(cairo_surface_status(imgWrapper.cairoImg) == CAIRO_STATUS_SUCCESS);
-
-    ///A call to cairo_surface_flush() is required before accessing the pixel data
-    ///to ensure that all pending drawing operations are finished.
-    cairo_surface_flush(imgWrapper.cairoImg);
-
-    //Never use invert while drawing
-    const bool inverted = false;
-    convertCairoImageToNatronImage_noColor<float, 1>(imgWrapper.cairoImg, srcNComps, source.get(), pixelPointsBbox, shapeColor, 1., inverted, false);
-
     return distToNext;
 } // RotoStrokeItem::renderSingleStroke
 
@@ -2716,10 +2985,19 @@ RotoDrawableItem::renderMaskFromStroke(const ImagePlaneDesc& components,
                                        const ViewIdx view,
                                        const ImageBitDepthEnum depth,
                                        const unsigned int mipmapLevel,
-                                       const RectD& rotoNodeSrcRod)
+                                       const RectD& rotoNodeSrcRod,
+                                       const RectI& roi)
 {
     NodePtr node = getContext()->getNode();
     ImagePtr image; // = stroke->getStrokeTimePreview();
+    RotoStrokeItem* isStroke = dynamic_cast<RotoStrokeItem*>(this);
+    Bezier* isBezier = dynamic_cast<Bezier*>(this);
+#ifndef ROTO_RENDER_BEZIER_WITH_CAIRO
+    // Only the RoI of the masks of closed beziers is rendered
+    const bool renderRoIOnly = !isStroke && isBezier && !isBezier->isOpenBezier();
+#else
+    const bool renderRoIOnly = false;
+#endif
 
     ///compute an enhanced hash different from the one of the merge node of the item in order to differentiate within the cache
     ///the output image of the node and the mask image.
@@ -2746,13 +3024,10 @@ RotoDrawableItem::renderMaskFromStroke(const ImagePlaneDesc& components,
         node->getEffectInstance()->getImageFromCacheAndConvertIfNeeded(true, eStorageModeRAM, eStorageModeRAM, *key, mipmapLevel, NULL, NULL, RectI(), depth, components, EffectInstance::InputImagesMap(), RenderStatsPtr(), OSGLContextAttacherPtr(), &image);
     }
 
-    if (image) {
+    if (image && !renderRoIOnly) {
         return image;
     }
 
-
-    RotoStrokeItem* isStroke = dynamic_cast<RotoStrokeItem*>(this);
-    Bezier* isBezier = dynamic_cast<Bezier*>(this);
     double startTime = time, mbFrameStep = 1., endTime = time;
 #ifdef NATRON_ROTO_ENABLE_MOTION_BLUR
     if (isBezier) {
@@ -2770,6 +3045,14 @@ RotoDrawableItem::renderMaskFromStroke(const ImagePlaneDesc& components,
     const bool inverted = false;
 #endif
 
+    if (image) {
+        // The mask is cached, render the parts of the RoI that were not rendered yet
+        QWriteLocker k(&_imp->cacheAccessMutex);
+        renderBezierMaskRoI(isBezier, roi, startTime, endTime, mbFrameStep, time, inverted, depth, mipmapLevel, image);
+
+        return image;
+    }
+
     RectD rotoBbox;
     std::list<std::list<std::pair<Point, double> > > strokes;
 
@@ -2842,12 +3125,93 @@ RotoDrawableItem::renderMaskFromStroke(const ImagePlaneDesc& components,
     ///Does nothing if image is already alloc
     image->allocateMemory();
 
+    if (renderRoIOnly) {
+        renderBezierMaskRoI(isBezier, roi, startTime, endTime, mbFrameStep, time, inverted, depth, mipmapLevel, image);
+
+        return image;
+    }
 
     image = renderMaskInternal(pixelRod, components, startTime, endTime, mbFrameStep, time, inverted, depth, mipmapLevel, strokes, image);
 
     return image;
 } // RotoDrawableItem::renderMaskFromStroke
 
+void
+RotoDrawableItem::renderBezierMaskRoI(const Bezier* bezier,
+                                      const RectI & roi,
+                                      const double startTime,
+                                      const double endTime,
+                                      const double timeStep,
+                                      const double time,
+                                      const bool inverted,
+                                      const ImageBitDepthEnum depth,
+                                      const unsigned int mipmapLevel,
+                                      const ImagePtr &image)
+{
+#ifndef ROTO_RENDER_BEZIER_WITH_CAIRO
+    RectI roiInBounds;
+    if ( roi.isNull() ) {
+        roiInBounds = image->getBounds();
+    } else if ( !roi.intersect(image->getBounds(), &roiInBounds) ) {
+        return;
+    }
+
+    std::list<RectI> rectsToRender;
+    if ( image->usesBitMap() ) {
+        image->getRestToRender(roiInBounds, rectsToRender);
+    } else {
+        rectsToRender.push_back(roiInBounds);
+    }
+    if ( rectsToRender.empty() ) {
+        return;
+    }
+
+    double shapeColor[3];
+    getColor(time, shapeColor);
+
+    double opacity = getOpacity(time);
+
+    // One shape per motion blur sample
+    std::vector<RotoRasterizer::Shape> shapes;
+    RotoContextPrivate::computeBezierShapes(bezier, time, startTime, endTime, timeStep, mipmapLevel, &shapes);
+
+    for (std::list<RectI>::const_iterator it = rectsToRender.begin(); it != rectsToRender.end(); ++it) {
+        RotoRasterizer rasterizer(*it);
+        for (std::size_t i = 0; i < shapes.size(); ++i) {
+            rasterizer.addShape(shapes[i]);
+        }
+
+        switch (depth) {
+        case eImageBitDepthFloat:
+            convertCoverageToNatronImage<float, 1>(rasterizer, image.get(), shapeColor, opacity, inverted);
+            break;
+        case eImageBitDepthByte:
+            convertCoverageToNatronImage<unsigned char, 255>(rasterizer, image.get(), shapeColor, opacity, inverted);
+            break;
+        case eImageBitDepthShort:
+            convertCoverageToNatronImage<unsigned short, 65535>(rasterizer, image.get(), shapeColor, opacity, inverted);
+            break;
+        case eImageBitDepthHalf:
+        case eImageBitDepthNone:
+            assert(false);
+            break;
+        }
+        image->markForRendered(*it);
+    }
+#else
+    Q_UNUSED(bezier);
+    Q_UNUSED(roi);
+    Q_UNUSED(startTime);
+    Q_UNUSED(endTime);
+    Q_UNUSED(timeStep);
+    Q_UNUSED(time);
+    Q_UNUSED(inverted);
+    Q_UNUSED(depth);
+    Q_UNUSED(mipmapLevel);
+    Q_UNUSED(image);
+#endif
+} // RotoDrawableItem::renderBezierMaskRoI
+
 ImagePtr
 RotoDrawableItem::renderMaskInternal(const RectI & roi,
                                      const ImagePlaneDesc& components,
@@ -2867,6 +3231,7 @@ RotoDrawableItem::renderMaskInternal(const RectI & roi,
     NodePtr node = getContext()->getNode();
     RotoStrokeItem* isStroke = dynamic_cast<RotoStrokeItem*>(this);
     Bezier* isBezier = dynamic_cast<Bezier*>(this);
+
     cairo_format_t cairoImgFormat;
     int srcNComps;
     bool doBuildUp = true;
@@ -2935,17 +3300,18 @@ RotoDrawableItem::renderMaskInternal(const RectI & roi,
     }
 
     bool useOpacityToConvert = (isBezier != 0);
+    Image::WriteAccess acc = image->getWriteRights();
 
 
     switch (depth) {
     case eImageBitDepthFloat:
-        convertCairoImageToNatronImage_noColor<float, 1>(imgWrapper.cairoImg, srcNComps, image.get(), roi, shapeColor, opacity, inverted, useOpacityToConvert);
+        convertCairoImageToNatronImage_noColor<float, 1>(imgWrapper.cairoImg, srcNComps, image.get(), &acc, roi, shapeColor, opacity, inverted, useOpacityToConvert);
         break;
     case eImageBitDepthByte:
-        convertCairoImageToNatronImage_noColor<unsigned char, 255>(imgWrapper.cairoImg, srcNComps,  image.get(), roi, shapeColor, opacity, inverted,  useOpacityToConvert);
+        convertCairoImageToNatronImage_noColor<unsigned char, 255>(imgWrapper.cairoImg, srcNComps,  image.get(), &acc, roi, shapeColor, opacity, inverted,  useOpacityToConvert);
         break;
     case eImageBitDepthShort:
-        convertCairoImageToNatronImage_noColor<unsigned short, 65535>(imgWrapper.cairoImg, srcNComps, image.get(), roi, shapeColor, opacity, inverted, useOpacityToConvert);
+        convertCairoImageToNatronImage_noColor<unsigned short, 65535>(imgWrapper.cairoImg, srcNComps, image.get(), &acc, roi, shapeColor, opacity, inverted, useOpacityToConvert);
         break;
     case eImageBitDepthHalf:
     case eImageBitDepthNone:
@@ -3014,6 +3380,10 @@ RotoContextPrivate::renderDot(cairo_t* cr,
         cairo_translate(cr, center.x, center.y);
         cairo_set_source(cr, pattern);
         cairo_translate(cr, -center.x, -center.y);
+        if ( !dotPatterns || ( (*dotPatterns)[pressureInt] != pattern ) ) {
+            // The context holds its own reference on its source
+            cairo_pattern_destroy(pattern);
+        }
     } else {
         if (doBuildUp) {
             cairo_set_source_rgba(cr, 1., 1., 1., opacity);
@@ -3021,16 +3391,6 @@ RotoContextPrivate::renderDot(cairo_t* cr,
             cairo_set_source_rgba(cr, opacity, opacity, opacity, 1.);
         }
     }
-#ifdef DEBUG
-    //Make sure the dot we are about to render falls inside the clip region, otherwise the bounds of the image are mis-calculated.
-    cairo_surface_t* target = cairo_get_target(cr);
-    int w = cairo_image_surface_get_width(target);
-    int h = cairo_image_surface_get_height(target);
-    double x1, y1;
-    cairo_surface_get_device_offset(target, &x1, &y1);
-    assert(std::floor(center.x - externalDotRadius) >= -x1 && std::floor(center.x + externalDotRadius) < -x1 + w &&
-           std::floor(center.y - externalDotRadius) >= -y1 && std::floor(center.y + externalDotRadius) < -y1 + h);
-#endif
     cairo_arc(cr, center.x, center.y, externalDotRadius, 0, M_PI * 2);
     cairo_fill(cr);
 }
@@ -3079,15 +3439,13 @@ getRenderDotParams(double alpha,
 }
 
 double
-RotoContextPrivate::renderStroke(cairo_t* cr,
-                                 std::vector<cairo_pattern_t*>& dotPatterns,
-                                 const std::list<std::list<std::pair<Point, double> > >& strokes,
-                                 double distToNext,
-                                 const RotoDrawableItem* stroke,
-                                 bool doBuildup,
-                                 double alpha,
-                                 double time,
-                                 unsigned int mipmapLevel)
+RotoContextPrivate::computeStrokeDots(const std::list<std::list<std::pair<Point, double> > >& strokes,
+                                      double distToNext,
+                                      const RotoDrawableItem* stroke,
+                                      double alpha,
+                                      double time,
+                                      unsigned int mipmapLevel,
+                                      std::vector<StrokeDot>* dots)
 {
     if ( strokes.empty() ) {
         return distToNext;
@@ -3097,8 +3455,6 @@ RotoContextPrivate::renderStroke(cairo_t* cr,
         return distToNext;
     }
 
-    assert(dotPatterns.size() == ROTO_PRESSURE_LEVELS);
-
     KnobDoublePtr brushSizeKnob = stroke->getBrushSizeKnob();
     double brushSize = brushSizeKnob->getValueAtTime(time);
     KnobDoublePtr brushSpacingKnob = stroke->getBrushSpacingKnob();
@@ -3129,7 +3485,6 @@ RotoContextPrivate::renderStroke(cairo_t* cr,
     if (mipmapLevel != 0) {
         brushSizePixel = std::max( 1., brushSizePixel / (1 << mipmapLevel) );
     }
-    cairo_set_operator(cr, doBuildup ? CAIRO_OPERATOR_OVER : CAIRO_OPERATOR_LIGHTEN);
 
 
     for (std::list<std::list<std::pair<Point, double> > >::const_iterator strokeIt = strokes.begin(); strokeIt != strokes.end(); ++strokeIt) {
@@ -3154,10 +3509,12 @@ RotoContextPrivate::renderStroke(cairo_t* cr,
         std::list<std::pair<Point, double> >::iterator it = visiblePortion.begin();
 
         if (visiblePortion.size() == 1) {
-            double internalDotRadius, externalDotRadius, spacing;
-            std::vector<std::pair<double, double> > opacityStops;
-            getRenderDotParams(alpha, brushSizePixel, brushHardness, brushSpacing, it->second, pressureAffectsOpacity, pressureAffectsSize, pressureAffectsHardness, &internalDotRadius, &externalDotRadius, &spacing, &opacityStops);
-            renderDot(cr, &dotPatterns, it->first, internalDotRadius, externalDotRadius, it->second, doBuildup, opacityStops, alpha);
+            StrokeDot dot;
+            double spacing;
+            dot.center = it->first;
+            dot.pressure = it->second;
+            getRenderDotParams(alpha, brushSizePixel, brushHardness, brushSpacing, it->second, pressureAffectsOpacity, pressureAffectsSize, pressureAffectsHardness, &dot.internalRadius, &dot.externalRadius, &spacing, &dot.opacityStops);
+            dots->push_back(dot);
             continue;
         }
 
@@ -3174,17 +3531,15 @@ RotoContextPrivate::renderStroke(cairo_t* cr,
             // while the next point can be drawn on this segment, draw a point and advance
             while (distToNext <= dist) {
                 double a = dist == 0. ? 0. : distToNext / dist;
-                Point center = {
-                    it->first.x * (1 - a) + next->first.x * a,
-                    it->first.y * (1 - a) + next->first.y * a
-                };
-                double pressure = it->second * (1 - a) + next->second * a;
-
-                // draw the dot
-                double internalDotRadius, externalDotRadius, spacing;
-                std::vector<std::pair<double, double> > opacityStops;
-                getRenderDotParams(alpha, brushSizePixel, brushHardness, brushSpacing, pressure, pressureAffectsOpacity, pressureAffectsSize, pressureAffectsHardness, &internalDotRadius, &externalDotRadius, &spacing, &opacityStops);
-                renderDot(cr, &dotPatterns, center, internalDotRadius, externalDotRadius, pressure, doBuildup, opacityStops, alpha);
+                StrokeDot dot;
+                dot.center.x = it->first.x * (1 - a) + next->first.x * a;
+                dot.center.y = it->first.y * (1 - a) + next->first.y * a;
+                dot.pressure = it->second * (1 - a) + next->second * a;
+
+                // the dot to draw
+                double spacing;
+                getRenderDotParams(alpha, brushSizePixel, brushHardness, brushSpacing, dot.pressure, pressureAffectsOpacity, pressureAffectsSize, pressureAffectsHardness, &dot.internalRadius, &dot.externalRadius, &spacing, &dot.opacityStops);
+                dots->push_back(dot);
 
                 distToNext += spacing;
             }
@@ -3197,6 +3552,43 @@ RotoContextPrivate::renderStroke(cairo_t* cr,
     }
 
 
+    return distToNext;
+} // RotoContextPrivate::computeStrokeDots
+
+double
+RotoContextPrivate::renderStroke(cairo_t* cr,
+                                 std::vector<cairo_pattern_t*>& dotPatterns,
+                                 const std::list<std::list<std::pair<Point, double> > >& strokes,
+                                 double distToNext,
+                                 const RotoDrawableItem* stroke,
+                                 bool doBuildup,
+                                 double alpha,
+                                 double time,
+                                 unsigned int mipmapLevel)
+{
+    assert(dotPatterns.size() == ROTO_PRESSURE_LEVELS);
+
+    std::vector<StrokeDot> dots;
+    distToNext = computeStrokeDots(strokes, distToNext, stroke, alpha, time, mipmapLevel, &dots);
+    if ( dots.empty() ) {
+        return distToNext;
+    }
+
+#ifdef DEBUG
+    //Make sure the dots we are about to render fall inside the clip region, otherwise the bounds of the image are mis-calculated.
+    cairo_surface_t* target = cairo_get_target(cr);
+    int w = cairo_image_surface_get_width(target);
+    int h = cairo_image_surface_get_height(target);
+    double x1, y1;
+    cairo_surface_get_device_offset(target, &x1, &y1);
+    checkDotsInsideBounds( dots, RectI( (int)-x1, (int)-y1, (int)-x1 + w, (int)-y1 + h ) );
+#endif
+
+    cairo_set_operator(cr, doBuildup ? CAIRO_OPERATOR_OVER : CAIRO_OPERATOR_LIGHTEN);
+    for (std::vector<StrokeDot>::const_iterator it = dots.begin(); it != dots.end(); ++it) {
+        renderDot(cr, &dotPatterns, it->center, it->internalRadius, it->externalRadius, it->pressure, doBuildup, it->opacityStops, alpha);
+    }
+
     return distToNext;
 } // RotoContextPrivate::renderStroke
 
@@ -3309,19 +3701,55 @@ RotoContextPrivate::renderBezier(cairo_t* cr,
 } // RotoContextPrivate::renderBezier
 
 void
-RotoContextPrivate::renderFeather(const Bezier* bezier,
-                                  double time,
-                                  unsigned int mipmapLevel,
-                                  double shapeColor[3],
-                                  double /*opacity*/,
-                                  double featherDist,
-                                  double fallOff,
-                                  cairo_pattern_t* mesh)
+RotoContextPrivate::computeBezierShapes(const Bezier* bezier,
+                                        double time,
+                                        double startTime, double endTime, double mbFrameStep,
+                                        unsigned int mipmapLevel,
+                                        std::vector<RotoRasterizer::Shape>* shapes)
 {
-    ///Note that we do not use the opacity when rendering the bezier, it is rendered with correct floating point opacity/color when converting
-    ///to the Natron image.
+    ///render the bezier only if finished (closed) and activated
+    if ( !bezier->isCurveFinished() || !bezier->isActivated(time) || ( bezier->getControlPointsCount() <= 1 ) ) {
+        return;
+    }
 
-    double fallOffInverse = 1. / fallOff;
+    BezierCPs cps = bezier->getControlPoints_mt_safe();
+    std::vector<Point> curves;
+    for (double t = startTime; t <= endTime; t+=mbFrameStep) {
+        shapes->push_back( RotoRasterizer::Shape() );
+        RotoRasterizer::Shape& shape = shapes->back();
+
+        shape.fallOff = bezier->getFeatherFallOff(t);
+        double featherDist = bezier->getFeatherDistance(t);
+
+        ///Adjust the feather distance so it takes the mipmap level into account
+        if (mipmapLevel != 0) {
+            featherDist /= (1 << mipmapLevel);
+        }
+
+        Transform::Matrix3x3 transform;
+        bezier->getTransformAtTime(t, &transform);
+
+        // The same geometry as renderFeather and renderInternalShape render with cairo
+        computeFeatherPatches(bezier, t, mipmapLevel, featherDist, &shape.feather);
+
+        curves.clear();
+        computeInternalShapeCurves(t, mipmapLevel, transform, cps, &curves);
+        if ( !curves.empty() ) {
+            shape.contour.push_back(curves[0]);
+            for (std::size_t i = 1; i + 2 < curves.size(); i += 3) {
+                RotoRasterizer::appendCubicToContour(curves[i - 1], curves[i], curves[i + 1], curves[i + 2], &shape.contour);
+            }
+        }
+    }
+} // RotoContextPrivate::computeBezierShapes
+
+void
+RotoContextPrivate::computeFeatherPatches(const Bezier* bezier,
+                                          double time,
+                                          unsigned int mipmapLevel,
+                                          double featherDist,
+                                          std::vector<RotoRasterizer::FeatherPatch>* patches)
+{
     /*
      * We descretize the feather control points to obtain a polygon so that the feather distance will be of the same thickness around all the shape.
      * If we were to extend only the end points, the resulting bezier interpolation would create a feather with different thickness around the shape,
@@ -3356,8 +3784,6 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
     assert( !featherPolygon.empty() && !bezierPolygon.empty() );
 
 
-    std::list<Point> featherContour;
-
     // prepare iterators
     std::list<ParametricPoint>::iterator next = featherPolygon.begin();
     ++next;  // can only be valid since we assert the list is not empty
@@ -3389,11 +3815,7 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
     }
 
 
-    double innerOpacity = 1.;
-    double outterOpacity = 0.;
-
     Point origin = p1;
-    featherContour.push_back(p1);
 
 
     // increment for first iteration
@@ -3445,7 +3867,7 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
             continue;
         }*/
 
-        Point p0, p0p1, p1p0, p2, p2p3, p3p2, p3;
+        Point p0, p2, p3;
         p0.x = prevBez->x;
         p0.y = prevBez->y;
         p3.x = bezIT->x;
@@ -3474,7 +3896,62 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
             p2.x = origin.x;
             p2.y = origin.y;
         }
-        featherContour.push_back(p2);
+        RotoRasterizer::FeatherPatch patch;
+        patch.p[0] = p0;
+        patch.p[1] = p1;
+        patch.p[2] = p2;
+        patch.p[3] = p3;
+        patches->push_back(patch);
+
+        if (mustStop) {
+            break;
+        }
+
+        p1 = p2;
+
+        // increment for next iteration
+        // ++prev, ++next, ++bezIT, ++prevBez
+        if ( prev != featherPolygon.end() ) {
+            ++prev;
+        }
+        if ( next != featherPolygon.end() ) {
+            ++next;
+        }
+        if ( bezIT != bezierPolygon.end() ) {
+            ++bezIT;
+        }
+        if ( prevBez != bezierPolygon.end() ) {
+            ++prevBez;
+        }
+    }  // for each point in polygon
+} // RotoContextPrivate::computeFeatherPatches
+
+void
+RotoContextPrivate::renderFeather(const Bezier* bezier,
+                                  double time,
+                                  unsigned int mipmapLevel,
+                                  double shapeColor[3],
+                                  double /*opacity*/,
+                                  double featherDist,
+                                  double fallOff,
+                                  cairo_pattern_t* mesh)
+{
+    ///Note that we do not use the opacity when rendering the bezier, it is rendered with correct floating point opacity/color when converting
+    ///to the Natron image.
+
+    double fallOffInverse = 1. / fallOff;
+    double innerOpacity = 1.;
+    double outterOpacity = 0.;
+    std::vector<RotoRasterizer::FeatherPatch> patches;
+
+    computeFeatherPatches(bezier, time, mipmapLevel, featherDist, &patches);
+
+    for (std::vector<RotoRasterizer::FeatherPatch>::const_iterator it = patches.begin(); it != patches.end(); ++it) {
+        const Point& p0 = it->p[0];
+        const Point& p1 = it->p[1];
+        const Point& p2 = it->p[2];
+        const Point& p3 = it->p[3];
+        Point p0p1, p1p0, p2p3, p3p2;
 
         ///linear interpolation
         p0p1.x = (p0.x * fallOff * 2. + fallOffInverse * p1.x) / (fallOff * 2. + fallOffInverse);
@@ -3516,30 +3993,7 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,
         assert(cairo_pattern_status(mesh) == CAIRO_STATUS_SUCCESS);
 
         cairo_mesh_pattern_end_patch(mesh);
-
-        if (mustStop) {
-            break;
-        }
-
-        //std::swap(innerOpacity, outterOpacity);
-
-        p1 = p2;
-
-        // increment for next iteration
-        // ++prev, ++next, ++bezIT, ++prevBez
-        if ( prev != featherPolygon.end() ) {
-            ++prev;
-        }
-        if ( next != featherPolygon.end() ) {
-            ++next;
-        }
-        if ( bezIT != bezierPolygon.end() ) {
-            ++bezIT;
-        }
-        if ( prevBez != bezierPolygon.end() ) {
-            ++prevBez;
-        }
-    }  // for each point in polygon
+    }
 } // RotoContextPrivate::renderFeather
 
 void
@@ -4146,6 +4600,74 @@ RotoContextPrivate::renderInternalShape_cairo(const std::list<RotoTriangles>& tr
 }
 
 
+void
+RotoContextPrivate::computeInternalShapeCurves(double time,
+                                               unsigned int mipmapLevel,
+                                               const Transform::Matrix3x3& transform,
+                                               const BezierCPs & cps,
+                                               std::vector<Point>* curves)
+{
+    BezierCPs::const_iterator point = cps.begin();
+    assert( point != cps.end() );
+    if ( point == cps.end() ) {
+        return;
+    }
+    BezierCPs::const_iterator nextPoint = point;
+    if ( nextPoint != cps.end() ) {
+        ++nextPoint;
+    }
+
+
+    Transform::Point3D initCp;
+    (*point)->getPositionAtTime(false, time, ViewIdx(0), &initCp.x, &initCp.y);
+    initCp.z = 1.;
+    initCp = Transform::matApply(transform, initCp);
+
+    adjustToPointToScale(mipmapLevel, initCp.x, initCp.y);
+
+    Point p;
+    p.x = initCp.x;
+    p.y = initCp.y;
+    curves->push_back(p);
+
+    while ( point != cps.end() ) {
+        if ( nextPoint == cps.end() ) {
+            nextPoint = cps.begin();
+        }
+
+        Transform::Point3D right, nextLeft, next;
+        (*point)->getRightBezierPointAtTime(false, time, ViewIdx(0), &right.x, &right.y);
+        right.z = 1;
+        (*nextPoint)->getLeftBezierPointAtTime(false, time, ViewIdx(0), &nextLeft.x, &nextLeft.y);
+        nextLeft.z = 1;
+        (*nextPoint)->getPositionAtTime(false, time, ViewIdx(0), &next.x, &next.y);
+        next.z = 1;
+
+        right = Transform::matApply(transform, right);
+        nextLeft = Transform::matApply(transform, nextLeft);
+        next = Transform::matApply(transform, next);
+
+        adjustToPointToScale(mipmapLevel, right.x, right.y);
+        adjustToPointToScale(mipmapLevel, next.x, next.y);
+        adjustToPointToScale(mipmapLevel, nextLeft.x, nextLeft.y);
+        p.x = right.x;
+        p.y = right.y;
+        curves->push_back(p);
+        p.x = nextLeft.x;
+        p.y = nextLeft.y;
+        curves->push_back(p);
+        p.x = next.x;
+        p.y = next.y;
+        curves->push_back(p);
+
+        // increment for next iteration
+        ++point;
+        if ( nextPoint != cps.end() ) {
+            ++nextPoint;
+        }
+    } // while()
+} // RotoContextPrivate::computeInternalShapeCurves
+
 void
 RotoContextPrivate::renderInternalShape(double time,
                                         unsigned int mipmapLevel,
@@ -4290,54 +4812,16 @@ RotoContextPrivate::renderInternalShape(double time,
 
     cairo_set_source_rgba(cr, 1, 1, 1, 1);
 
-    BezierCPs::const_iterator point = cps.begin();
-    assert( point != cps.end() );
-    if ( point == cps.end() ) {
+    std::vector<Point> curves;
+    computeInternalShapeCurves(time, mipmapLevel, transform, cps, &curves);
+    if ( curves.empty() ) {
         return;
     }
-    BezierCPs::const_iterator nextPoint = point;
-    if ( nextPoint != cps.end() ) {
-        ++nextPoint;
-    }
-
-
-    Transform::Point3D initCp;
-    (*point)->getPositionAtTime(false, time, ViewIdx(0), &initCp.x, &initCp.y);
-    initCp.z = 1.;
-    initCp = Transform::matApply(transform, initCp);
-
-    adjustToPointToScale(mipmapLevel, initCp.x, initCp.y);
 
-    cairo_move_to(cr, initCp.x, initCp.y);
-
-    while ( point != cps.end() ) {
-        if ( nextPoint == cps.end() ) {
-            nextPoint = cps.begin();
-        }
-
-        Transform::Point3D right, nextLeft, next;
-        (*point)->getRightBezierPointAtTime(false, time, ViewIdx(0), &right.x, &right.y);
-        right.z = 1;
-        (*nextPoint)->getLeftBezierPointAtTime(false, time, ViewIdx(0), &nextLeft.x, &nextLeft.y);
-        nextLeft.z = 1;
-        (*nextPoint)->getPositionAtTime(false, time, ViewIdx(0), &next.x, &next.y);
-        next.z = 1;
-
-        right = Transform::matApply(transform, right);
-        nextLeft = Transform::matApply(transform, nextLeft);
-        next = Transform::matApply(transform, next);
-
-        adjustToPointToScale(mipmapLevel, right.x, right.y);
-        adjustToPointToScale(mipmapLevel, next.x, next.y);
-        adjustToPointToScale(mipmapLevel, nextLeft.x, nextLeft.y);
-        cairo_curve_to(cr, right.x, right.y, nextLeft.x, nextLeft.y, next.x, next.y);
-
-        // increment for next iteration
-        ++point;
-        if ( nextPoint != cps.end() ) {
-            ++nextPoint;
-        }
-    } // while()
+    cairo_move_to(cr, curves[0].x, curves[0].y);
+    for (std::size_t i = 1; i + 2 < curves.size(); i += 3) {
+        cairo_curve_to(cr, curves[i].x, curves[i].y, curves[i + 1].x, curves[i + 1].y, curves[i + 2].x, curves[i + 2].y);
+    }
 //    if (cairo_get_antialias(cr) != CAIRO_ANTIALIAS_NONE ) {
 //        cairo_fill_preserve(cr);
 //        // These line properties make for a nicer looking polygon mesh
@@ -66,6 +66,7 @@ CLANG_DIAG_ON(uninitialized)
 #include "Engine/Node.h"
 #include "Engine/RotoContext.h"
 #include "Engine/RotoPaint.h"
+#include "Engine/RotoRasterizer.h"
 #include "Engine/Transform.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/EngineFwd.h"
@@ -2210,6 +2211,44 @@ public:
         return minLayer;
     }
 
+    /**
+     * @brief A dot of a paint stroke, in pixel coordinates
+     **/
+    struct StrokeDot
+    {
+        Point center;
+        double pressure;
+        double internalRadius;
+        double externalRadius;
+        std::vector<std::pair<double, double> > opacityStops;
+    };
+
+    /**
+     * @brief Computes the dots of the strokes, the first one being at distToNext from the first point, and returns the
+     * distance from the last point to the next dot. The dots depend only on the points and the brush, so that they can be
+     * rendered in separate parts of the image.
+     **/
+    static double computeStrokeDots(const std::list<std::list<std::pair<Point, double> > >& strokes,
+                                    double distToNext,
+                                    const RotoDrawableItem* stroke,
+                                    double opacity,
+                                    double time,
+                                    unsigned int mipmapLevel,
+                                    std::vector<StrokeDot>* dots);
+    /**
+     * @brief Composites the dots over the content of the float image within bounds, or over black if copyFromImage is false.
+     * The image is rendered in horizontal bands of bandHeight rows, concurrently if there are several: the dots are composited
+     * in order in each band, so that the result does not depend on the number of bands. dotPatterns is only used by a single band.
+     **/
+    static void renderStrokeDots(const std::vector<StrokeDot>& dots,
+                                 const RectI& bounds,
+                                 int bandHeight,
+                                 bool doBuildUp,
+                                 double opacity,
+                                 const double shapeColor[3],
+                                 bool copyFromImage,
+                                 std::vector<cairo_pattern_t*>* dotPatterns,
+                                 Image* image);
     static void renderDot(cairo_t* cr,
                           std::vector<cairo_pattern_t*>* dotPatterns,
                           const Point &center,
@@ -2229,6 +2268,14 @@ public:
                                double time,
                                unsigned int mipmapLevel);
     static void renderBezier(cairo_t* cr, const Bezier* bezier, double opacity, double time, double startTime, double endTime, double mbFrameStep, unsigned int mipmapLevel);
+    /**
+     * @brief Computes what renderBezier renders with cairo as the shapes of the RotoRasterizer, one per motion blur sample
+     **/
+    static void computeBezierShapes(const Bezier* bezier, double time, double startTime, double endTime, double mbFrameStep, unsigned int mipmapLevel, std::vector<RotoRasterizer::Shape>* shapes);
+    /**
+     * @brief Computes the Coons patches of the feather that renderFeather renders with cairo
+     **/
+    static void computeFeatherPatches(const Bezier* bezier, double time, unsigned int mipmapLevel, double featherDist, std::vector<RotoRasterizer::FeatherPatch>* patches);
     static void renderFeather(const Bezier * bezier, double time, unsigned int mipmapLevel, double shapeColor[3], double opacity, double featherDist, double fallOff, cairo_pattern_t * mesh);
     static void renderFeather_cairo(const std::list<RotoFeatherVertex>& vertices, double shapeColor[3],  double fallOff, cairo_pattern_t * mesh);
     static void renderInternalShape_cairo(const std::list<RotoTriangles>& triangles,
@@ -2236,6 +2283,11 @@ public:
                                           const std::list<RotoTriangleStrips>& strips,
                                           double shapeColor[3],  cairo_pattern_t * mesh);
     static void computeTriangles(const Bezier * bezier, double time, unsigned int mipmapLevel,  double featherDist, std::list<RotoFeatherVertex>* featherMesh, std::list<RotoTriangleFans>* internalFans, std::list<RotoTriangles>* internalTriangles,std::list<RotoTriangleStrips>* internalStrips);
+    /**
+     * @brief Computes the cubic curves of the shape that renderInternalShape fills with cairo: the first point, then the
+     * 2 control points and the end point of each curve.
+     **/
+    static void computeInternalShapeCurves(double time, unsigned int mipmapLevel, const Transform::Matrix3x3 & transform, const BezierCPs &cps, std::vector<Point>* curves);
     static void renderInternalShape(double time, unsigned int mipmapLevel, double shapeColor[3], double opacity, const Transform::Matrix3x3 & transform, cairo_t * cr, cairo_pattern_t * mesh, const BezierCPs &cps);
     static void bezulate(double time, const BezierCPs& cps, std::list<BezierCPs>* patches);
     static void applyAndDestroyMask(cairo_t* cr, cairo_pattern_t* mesh);
@@ -207,10 +207,26 @@ public:
                                                   const ViewIdx view,
                                                   const ImageBitDepthEnum depth,
                                                   const unsigned int mipmapLevel,
-                                                  const RectD& rotoNodeSrcRod);
+                                                  const RectD& rotoNodeSrcRod,
+                                                  const RectI& roi);
 
 private:
 
+    /**
+     * @brief Renders the parts of roi that were not rendered yet in the mask of a closed bezier. If roi is null, the
+     * full mask is rendered.
+     **/
+    void renderBezierMaskRoI(const Bezier* bezier,
+                             const RectI & roi,
+                             const double startTime,
+                             const double endTime,
+                             const double timeStep,
+                             const double time,
+                             const bool inverted,
+                             const ImageBitDepthEnum depth,
+                             const unsigned int mipmapLevel,
+                             const ImagePtr &image);
+
     ImagePtr renderMaskInternal(const RectI & roi,
                                                 const ImagePlaneDesc& components,
                                                 const double startTime,
@@ -0,0 +1,447 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RotoRasterizer.h"
+
+#include <algorithm> // min, max
+#include <cassert>
+#include <cmath>
+#include <utility> // pair
+
+#include <QtCore/QThreadPool>
+#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
+
+NATRON_NAMESPACE_ENTER
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+/**
+ * @brief The sides of the cairo mesh patches going across the feather are cubic curves whose control points depend on the fall-off:
+ * they are straight, the opacity decreases linearly with the curve parameter u, while the position across the feather follows the curve.
+ * Returns the fraction of the feather crossed at the parameter u.
+ **/
+double
+fallOffCurve(double u,
+             double fallOff)
+{
+    const double fallOffInverse = 1. / fallOff;
+    const double c1 = fallOffInverse / (fallOff * 2. + fallOffInverse);
+    const double c2 = 2. * fallOffInverse / (fallOff + 2. * fallOffInverse);
+    const double v = 1. - u;
+
+    return 3. * u * v * v * c1 + 3. * u * u * v * c2 + u * u * u;
+}
+
+/**
+ * @brief Fills lut so that lut[i] is the opacity of a pixel whose opacity weight, 1 minus the fraction of the feather crossed, is i / (size - 1)
+ **/
+void
+fillFallOffLut(double fallOff,
+               std::vector<float>* lut)
+{
+    lut->resize(NATRON_ROTO_RASTERIZER_FALLOFF_LUT_SIZE);
+    for (int i = 0; i < NATRON_ROTO_RASTERIZER_FALLOFF_LUT_SIZE; ++i) {
+        // The weight is 1 on the inner edge, the fraction of the feather crossed is 1 - weight
+        const double s = 1. - (double)i / (NATRON_ROTO_RASTERIZER_FALLOFF_LUT_SIZE - 1);
+        // The curve is increasing from 0 to 1 for any positive fall-off: invert it by bisection
+        double lo = 0., hi = 1.;
+        for (int j = 0; j < 40; ++j) {
+            const double mid = (lo + hi) / 2.;
+            if (fallOffCurve(mid, fallOff) < s) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        (*lut)[i] = (float)( 1. - (lo + hi) / 2. );
+    }
+}
+
+inline float
+lookupFallOffLut(const std::vector<float>& lut,
+                 double weight)
+{
+    if (weight <= 0.) {
+        return lut[0];
+    } else if (weight >= 1.) {
+        return lut[NATRON_ROTO_RASTERIZER_FALLOFF_LUT_SIZE - 1];
+    }
+    const double pos = weight * (NATRON_ROTO_RASTERIZER_FALLOFF_LUT_SIZE - 1);
+    const int i = (int)pos;
+    const double alpha = pos - i;
+    const float a = lut[i];
+    const float b = (i < NATRON_ROTO_RASTERIZER_FALLOFF_LUT_SIZE - 1) ? lut[i + 1] : a;
+
+    return (float)(a * (1. - alpha) + b * alpha);
+}
+
+inline double
+cross(double ax,
+      double ay,
+      double bx,
+      double by)
+{
+    return ax * by - ay * bx;
+}
+
+inline bool
+isInPatch(double s,
+          double v)
+{
+    const double eps = 1e-9;
+
+    return s >= -eps && s <= 1. + eps && v >= -eps && v <= 1. + eps;
+}
+
+/**
+ * @brief Finds the fraction s of the feather crossed at the point (x,y) of the patch, such that
+ * (x,y) = (1 - v) * ((1 - s) * p[0] + s * p[1]) + v * ((1 - s) * p[3] + s * p[2]).
+ * If the patch folds over itself, the solution with the largest v is returned, the cairo mesh rasterizer draws it last.
+ * Returns false if the point is not in the patch.
+ **/
+bool
+invertFeatherPatch(const RotoRasterizer::FeatherPatch& patch,
+                   double x,
+                   double y,
+                   double* s)
+{
+    const Point& a = patch.p[0];
+    const double ex = patch.p[1].x - a.x, ey = patch.p[1].y - a.y;
+    const double fx = patch.p[3].x - a.x, fy = patch.p[3].y - a.y;
+    const double gx = a.x - patch.p[1].x + patch.p[2].x - patch.p[3].x;
+    const double gy = a.y - patch.p[1].y + patch.p[2].y - patch.p[3].y;
+    const double hx = x - a.x, hy = y - a.y;
+
+    // v is a root of k2 * v^2 + k1 * v + k0
+    const double k2 = cross(gx, gy, fx, fy);
+    const double k1 = cross(ex, ey, fx, fy) + cross(hx, hy, gx, gy);
+    const double k0 = cross(hx, hy, ex, ey);
+    double vs[2];
+    int nVs = 0;
+
+    if ( std::abs(k2) <= 1e-12 * ( std::abs(k1) + std::abs(k0) ) ) {
+        if (k1 == 0.) {
+            return false;
+        }
+        vs[nVs++] = -k0 / k1;
+    } else {
+        const double disc = k1 * k1 - 4. * k0 * k2;
+        if (disc < 0.) {
+            return false;
+        }
+        const double q = -0.5 * ( k1 + (k1 < 0. ? -1. : 1.) * std::sqrt(disc) );
+        vs[nVs++] = q / k2;
+        if (q != 0.) {
+            vs[nVs++] = k0 / q;
+        }
+    }
+
+    bool found = false;
+    double bestV = 0.;
+    for (int i = 0; i < nVs; ++i) {
+        const double v = vs[i];
+        // h - v * f = s * (e + v * g)
+        const double dx = ex + v * gx, dy = ey + v * gy;
+        const double norm2 = dx * dx + dy * dy;
+        if (norm2 == 0.) {
+            continue;
+        }
+        const double u = ( (hx - v * fx) * dx + (hy - v * fy) * dy ) / norm2;
+        if ( isInPatch(u, v) && (!found || v > bestV) ) {
+            found = true;
+            bestV = v;
+            *s = std::max( 0., std::min(u, 1.) );
+        }
+    }
+
+    return found;
+} // invertFeatherPatch
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+// An edge of the contour, going up if winding is 1
+struct RotoRasterizer::Edge
+{
+    double x1, y1, x2, y2; // y1 < y2
+    int winding;
+};
+
+struct RotoRasterizer::TileArgs
+{
+    RectI tile;
+    const Shape* shape;
+    std::vector<int> patchIndices; // the feather patches overlapping the tile, in order
+    const std::vector<Edge>* edges;
+    const std::vector<int>* edgeIndices; // the edges crossing the rows of the tile
+    const std::vector<float>* fallOffLut;
+    float* coverage;
+    RectI bounds;
+};
+
+RotoRasterizer::RotoRasterizer(const RectI& bounds)
+    : _bounds(bounds)
+    , _coverage()
+{
+    if ( !_bounds.isNull() ) {
+        _coverage.resize( (std::size_t)_bounds.width() * _bounds.height(), 0.f );
+    }
+}
+
+float
+RotoRasterizer::getCoverageAt(int x,
+                              int y) const
+{
+    if ( !_bounds.contains(x, y) ) {
+        return 0.f;
+    }
+
+    return _coverage[(std::size_t)(y - _bounds.y1) * _bounds.width() + (x - _bounds.x1)];
+}
+
+void
+RotoRasterizer::appendCubicToContour(const Point& p0,
+                                     const Point& p1,
+                                     const Point& p2,
+                                     const Point& p3,
+                                     std::vector<Point>* contour)
+{
+    // The distance between the curve and a uniform subdivision in n segments is at most max|B''| / (8 n^2),
+    // with max|B''| <= 6 max(|p0 - 2 p1 + p2|, |p1 - 2 p2 + p3|)
+    const double tolerance = 0.1;
+    const double dd = std::max( std::sqrt( (p0.x - 2. * p1.x + p2.x) * (p0.x - 2. * p1.x + p2.x) + (p0.y - 2. * p1.y + p2.y) * (p0.y - 2. * p1.y + p2.y) ),
+                                std::sqrt( (p1.x - 2. * p2.x + p3.x) * (p1.x - 2. * p2.x + p3.x) + (p1.y - 2. * p2.y + p3.y) * (p1.y - 2. * p2.y + p3.y) ) );
+    const int n = std::max( 1, std::min( (int)std::ceil( std::sqrt(6. * dd / (8. * tolerance)) ), 1024 ) );
+
+    for (int i = 1; i < n; ++i) {
+        const double t = (double)i / n;
+        const double u = 1. - t;
+        Point p;
+        p.x = u * u * u * p0.x + 3. * u * u * t * p1.x + 3. * u * t * t * p2.x + t * t * t * p3.x;
+        p.y = u * u * u * p0.y + 3. * u * u * t * p1.y + 3. * u * t * t * p2.y + t * t * t * p3.y;
+        contour->push_back(p);
+    }
+    contour->push_back(p3);
+}
+
+void
+RotoRasterizer::addShape(const Shape& shape,
+                         bool multiThreaded)
+{
+    if ( _bounds.isNull() || ( (shape.contour.size() < 3) && shape.feather.empty() ) ) {
+        return;
+    }
+
+    std::vector<float> fallOffLut;
+    fillFallOffLut(shape.fallOff > 0. ? shape.fallOff : 1., &fallOffLut);
+
+    const int nTilesX = (_bounds.width() + NATRON_ROTO_RASTERIZER_TILE_SIZE - 1) / NATRON_ROTO_RASTERIZER_TILE_SIZE;
+    const int nTilesY = (_bounds.height() + NATRON_ROTO_RASTERIZER_TILE_SIZE - 1) / NATRON_ROTO_RASTERIZER_TILE_SIZE;
+
+    // Bin the edges of the contour by row of tiles: the winding number of a pixel depends on all the edges on its left.
+    // Horizontal edges never cross the center of a row.
+    std::vector<Edge> edges;
+    std::vector<std::vector<int> > bandEdges(nTilesY);
+    double contourX1 = 0., contourX2 = 0.;
+    if (shape.contour.size() >= 3) {
+        contourX1 = contourX2 = shape.contour[0].x;
+        for (std::size_t i = 0; i < shape.contour.size(); ++i) {
+            const Point& a = shape.contour[i];
+            const Point& b = shape.contour[(i + 1) % shape.contour.size()];
+            contourX1 = std::min(contourX1, a.x);
+            contourX2 = std::max(contourX2, a.x);
+            if (a.y == b.y) {
+                continue;
+            }
+            Edge e;
+            if (a.y < b.y) {
+                e.x1 = a.x; e.y1 = a.y; e.x2 = b.x; e.y2 = b.y; e.winding = 1;
+            } else {
+                e.x1 = b.x; e.y1 = b.y; e.x2 = a.x; e.y2 = a.y; e.winding = -1;
+            }
+            const int row1 = std::max( (int)std::ceil(e.y1 - 0.5), _bounds.y1 );
+            const int row2 = std::min( (int)std::ceil(e.y2 - 0.5), _bounds.y2 );
+            if (row1 >= row2) {
+                continue;
+            }
+            edges.push_back(e);
+            for (int ty = (row1 - _bounds.y1) / NATRON_ROTO_RASTERIZER_TILE_SIZE; ty <= (row2 - 1 - _bounds.y1) / NATRON_ROTO_RASTERIZER_TILE_SIZE; ++ty) {
+                bandEdges[ty].push_back( (int)edges.size() - 1 );
+            }
+        }
+    }
+    // The columns the interior may cover
+    const int interiorX1 = (int)std::ceil(contourX1 - 0.5);
+    const int interiorX2 = (int)std::ceil(contourX2 - 0.5);
+
+    std::vector<TileArgs> tiles(nTilesX * nTilesY);
+    for (int ty = 0; ty < nTilesY; ++ty) {
+        for (int tx = 0; tx < nTilesX; ++tx) {
+            TileArgs& args = tiles[ty * nTilesX + tx];
+            args.tile.x1 = _bounds.x1 + tx * NATRON_ROTO_RASTERIZER_TILE_SIZE;
+            args.tile.y1 = _bounds.y1 + ty * NATRON_ROTO_RASTERIZER_TILE_SIZE;
+            args.tile.x2 = std::min(args.tile.x1 + NATRON_ROTO_RASTERIZER_TILE_SIZE, _bounds.x2);
+            args.tile.y2 = std::min(args.tile.y1 + NATRON_ROTO_RASTERIZER_TILE_SIZE, _bounds.y2);
+            args.shape = &shape;
+            args.edges = &edges;
+            args.edgeIndices = &bandEdges[ty];
+            args.fallOffLut = &fallOffLut;
+            args.coverage = &_coverage[0];
+            args.bounds = _bounds;
+        }
+    }
+
+    // Bin the feather patches by tile
+    for (std::size_t i = 0; i < shape.feather.size(); ++i) {
+        const FeatherPatch& patch = shape.feather[i];
+        double xMin = patch.p[0].x, xMax = patch.p[0].x, yMin = patch.p[0].y, yMax = patch.p[0].y;
+        for (int c = 1; c < 4; ++c) {
+            xMin = std::min(xMin, patch.p[c].x);
+            xMax = std::max(xMax, patch.p[c].x);
+            yMin = std::min(yMin, patch.p[c].y);
+            yMax = std::max(yMax, patch.p[c].y);
+        }
+        if ( (xMax < _bounds.x1) || (xMin >= _bounds.x2) || (yMax < _bounds.y1) || (yMin >= _bounds.y2) ) {
+            continue;
+        }
+        int tx1 = ( std::max( (int)std::floor(xMin), _bounds.x1 ) - _bounds.x1 ) / NATRON_ROTO_RASTERIZER_TILE_SIZE;
+        int tx2 = ( std::min( (int)std::ceil(xMax), _bounds.x2 - 1 ) - _bounds.x1 ) / NATRON_ROTO_RASTERIZER_TILE_SIZE;
+        int ty1 = ( std::max( (int)std::floor(yMin), _bounds.y1 ) - _bounds.y1 ) / NATRON_ROTO_RASTERIZER_TILE_SIZE;
+        int ty2 = ( std::min( (int)std::ceil(yMax), _bounds.y2 - 1 ) - _bounds.y1 ) / NATRON_ROTO_RASTERIZER_TILE_SIZE;
+        for (int ty = ty1; ty <= ty2; ++ty) {
+            for (int tx = tx1; tx <= tx2; ++tx) {
+                tiles[ty * nTilesX + tx].patchIndices.push_back( (int)i );
+            }
+        }
+    }
+
+    // Only render the tiles the shape overlaps
+    std::vector<TileArgs> nonEmptyTiles;
+    for (std::size_t i = 0; i < tiles.size(); ++i) {
+        const TileArgs& args = tiles[i];
+        bool overlapsInterior = !args.edgeIndices->empty() && (args.tile.x1 < interiorX2) && (args.tile.x2 > interiorX1);
+        if ( overlapsInterior || !args.patchIndices.empty() ) {
+            nonEmptyTiles.push_back(args);
+        }
+    }
+
+    bool runInCurrentThread = !multiThreaded || nonEmptyTiles.size() <= 1;
+    if (!runInCurrentThread) {
+        runInCurrentThread = QThreadPool::globalInstance()->activeThreadCount() >= QThreadPool::globalInstance()->maxThreadCount();
+    }
+    if (runInCurrentThread) {
+        for (std::size_t i = 0; i < nonEmptyTiles.size(); ++i) {
+            renderTile(nonEmptyTiles[i]);
+        }
+    } else {
+        QtConcurrent::map(nonEmptyTiles, &RotoRasterizer::renderTile).waitForFinished();
+    }
+} // RotoRasterizer::addShape
+
+void
+RotoRasterizer::renderTile(const TileArgs& args)
+{
+    const RectI& tile = args.tile;
+    const int tileWidth = tile.width();
+    const int boundsWidth = args.bounds.width();
+
+    if ( !args.patchIndices.empty() ) {
+        // The opacity of the feather, the patches replace the pixels of the previous ones
+        std::vector<float> feather( (std::size_t)tileWidth * tile.height(), 0.f );
+
+        for (std::vector<int>::const_iterator it = args.patchIndices.begin(); it != args.patchIndices.end(); ++it) {
+            const FeatherPatch& patch = args.shape->feather[*it];
+            double xMin = patch.p[0].x, xMax = patch.p[0].x, yMin = patch.p[0].y, yMax = patch.p[0].y;
+            for (int c = 1; c < 4; ++c) {
+                xMin = std::min(xMin, patch.p[c].x);
+                xMax = std::max(xMax, patch.p[c].x);
+                yMin = std::min(yMin, patch.p[c].y);
+                yMax = std::max(yMax, patch.p[c].y);
+            }
+
+            // Pixels are sampled at their center
+            const int x1 = std::max( (int)std::ceil(xMin - 0.5), tile.x1 );
+            const int x2 = std::min( (int)std::floor(xMax - 0.5) + 1, tile.x2 );
+            const int y1 = std::max( (int)std::ceil(yMin - 0.5), tile.y1 );
+            const int y2 = std::min( (int)std::floor(yMax - 0.5) + 1, tile.y2 );
+            for (int y = y1; y < y2; ++y) {
+                float* dst = &feather[(std::size_t)(y - tile.y1) * tileWidth + (x1 - tile.x1)];
+                for (int x = x1; x < x2; ++x, ++dst) {
+                    double s;
+                    if ( invertFeatherPatch(patch, x + 0.5, y + 0.5, &s) ) {
+                        *dst = lookupFallOffLut(*args.fallOffLut, 1. - s);
+                    }
+                }
+            }
+        }
+
+        // Composite the feather over the coverage. cairo_mask() used the mesh both as source and mask,
+        // which squares the opacity: do the same so that the masks do not change.
+        for (int y = tile.y1; y < tile.y2; ++y) {
+            const float* src = &feather[(std::size_t)(y - tile.y1) * tileWidth];
+            float* dst = args.coverage + (std::size_t)(y - args.bounds.y1) * boundsWidth + (tile.x1 - args.bounds.x1);
+            for (int x = 0; x < tileWidth; ++x) {
+                const float a = src[x] * src[x];
+                if (a > 0.f) {
+                    dst[x] = a + dst[x] * (1.f - a);
+                }
+            }
+        }
+    }
+
+    // The interior is opaque: composited under or over the feather, it covers the pixels fully
+    if ( !args.edgeIndices->empty() ) {
+        std::vector<std::pair<double, int> > crossings;
+        for (int y = tile.y1; y < tile.y2; ++y) {
+            const double yc = y + 0.5;
+            crossings.clear();
+            for (std::vector<int>::const_iterator it = args.edgeIndices->begin(); it != args.edgeIndices->end(); ++it) {
+                const Edge& e = (*args.edges)[*it];
+                if ( (e.y1 <= yc) && (yc < e.y2) ) {
+                    crossings.push_back( std::make_pair(e.x1 + (yc - e.y1) * (e.x2 - e.x1) / (e.y2 - e.y1), e.winding) );
+                }
+            }
+            if (crossings.size() < 2) {
+                continue;
+            }
+            std::sort( crossings.begin(), crossings.end() );
+
+            float* row = args.coverage + (std::size_t)(y - args.bounds.y1) * boundsWidth;
+            int winding = 0;
+            for (std::size_t i = 0; i + 1 < crossings.size(); ++i) {
+                winding += crossings[i].second;
+                if (winding == 0) {
+                    continue;
+                }
+                const int x1 = std::max( (int)std::ceil(crossings[i].first - 0.5), tile.x1 );
+                const int x2 = std::min( (int)std::ceil(crossings[i + 1].first - 0.5), tile.x2 );
+                if (x1 < x2) {
+                    std::fill(row + (x1 - args.bounds.x1), row + (x2 - args.bounds.x1), 1.f);
+                }
+            }
+        }
+    }
+} // RotoRasterizer::renderTile
+
+NATRON_NAMESPACE_EXIT
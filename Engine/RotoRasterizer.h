@@ -0,0 +1,131 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_ROTORASTERIZER_H
+#define NATRON_ENGINE_ROTORASTERIZER_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+
+#include "Engine/RectI.h"
+#include "Engine/EngineFwd.h"
+
+///The size of the square tiles rendered concurrently by the RotoRasterizer, in pixels
+#define NATRON_ROTO_RASTERIZER_TILE_SIZE 128
+
+///The number of entries of the table inverting the feather fall-off curve
+#define NATRON_ROTO_RASTERIZER_FALLOFF_LUT_SIZE 1024
+
+NATRON_NAMESPACE_ENTER
+
+/**
+ * @brief Renders the mask of closed roto shapes into a floating point coverage buffer. It computes what
+ * RotoContextPrivate::renderBezier computes with cairo with the antialiasing disabled:
+ * - the interior of the shape is the polygon flattened from its bezier curves, filled with the non-zero winding rule.
+ * A pixel belongs to it if its center does, as with cairo_fill().
+ * - the feather is made of the patches built by RotoContextPrivate::computeFeatherPatches. The sides of a patch
+ * going across the feather are straight, so the cairo Coons patch is a bilinear patch whose opacity goes from
+ * 1 on the shape to 0 on the outer edge of the feather, remapped through the fall-off curve. Patches rendered later
+ * replace the pixels of the previous ones, as in the cairo mesh rasterizer.
+ * - the feather is composited over the interior and the coverage as cairo_mask() did with the mesh as both
+ * source and mask, which squares its opacity.
+ * The bounds are split into tiles which are rendered concurrently, each tile only visiting the patches and the
+ * edges of the contour overlapping it. Tiles the shape does not overlap are left untouched.
+ **/
+class RotoRasterizer
+{
+public:
+
+    struct FeatherPatch
+    {
+        // p[0] and p[3] are on the shape, p[1] and p[2] are on the outer edge of the feather
+        Point p[4];
+    };
+
+    struct Shape
+    {
+        // The closed polygon of the interior of the shape
+        std::vector<Point> contour;
+        std::vector<FeatherPatch> feather;
+        double fallOff;
+
+        Shape()
+            : contour()
+            , feather()
+            , fallOff(1.)
+        {
+        }
+    };
+
+    /**
+     * @brief Creates a rasterizer which only renders the pixels of bounds
+     **/
+    RotoRasterizer(const RectI& bounds);
+
+    const RectI& getBounds() const
+    {
+        return _bounds;
+    }
+
+    /**
+     * @brief Returns the coverage of the pixels, in rows of getBounds().width() values starting at the row getBounds().y1
+     **/
+    const float* getCoverage() const
+    {
+        return _coverage.empty() ? 0 : &_coverage[0];
+    }
+
+    float getCoverageAt(int x, int y) const;
+
+    /**
+     * @brief Renders one sample of a shape and composites it over the coverage. Motion blur is rendered by adding the
+     * shape once per sample.
+     * If multiThreaded is true, the tiles are rendered by the global thread pool unless it is already busy.
+     **/
+    void addShape(const Shape& shape, bool multiThreaded = true);
+
+    /**
+     * @brief Appends to contour the polygon approximating the cubic bezier curve going from p0 to p3 with the control
+     * points p1 and p2, within the default tolerance of cairo (0.1 pixel). p0 is not appended.
+     **/
+    static void appendCubicToContour(const Point& p0, const Point& p1, const Point& p2, const Point& p3, std::vector<Point>* contour);
+
+private:
+
+    struct Edge;
+    struct TileArgs;
+
+    static void renderTile(const TileArgs& args);
+
+    RectI _bounds;
+    std::vector<float> _coverage;
+};
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_ROTORASTERIZER_H
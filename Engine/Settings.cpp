@@ -1212,6 +1212,15 @@ Settings::initializeKnobsCaching()
                                            "output has its settings panel opened.").arg( QString::fromUtf8(NATRON_APPLICATION_NAME) ) );
     _cachingTab->addKnob(_aggressiveCaching);
 
+    _contentBasedNodeHash = AppManager::createKnob<KnobBool>( this, tr("Content-based node hashing") );
+    _contentBasedNodeHash->setName("contentBasedNodeHash");
+    _contentBasedNodeHash->setHintToolTip( tr("When checked, the cache key of a node is computed from the values of its parameters, "
+                                              "its plug-in version and its inputs instead of the history of its modifications. "
+                                              "Cached images then remain valid after the project is re-opened or a node is renamed, "
+                                              "and duplicated branches of the node graph share the same cached images.\n"
+                                              "Nodes with Roto or RotoPaint shapes always use the history of their modifications.") );
+    _cachingTab->addKnob(_contentBasedNodeHash);
+
     _maxRAMPercent = AppManager::createKnob<KnobInt>( this, tr("Maximum amount of RAM memory used for caching (% of total RAM)") );
     _maxRAMPercent->setName("maxRAMPercent");
     _maxRAMPercent->disableSlider();
@@ -1258,6 +1267,28 @@ Settings::initializeKnobsCaching()
     _unreachableRAMLabel->setAsLabel();
     _cachingTab->addKnob(_unreachableRAMLabel);
 
+    _speculativeRenderFrames = AppManager::createKnob<KnobInt>( this, tr("Frames pre-rendered around the current frame") );
+    _speculativeRenderFrames->setName("speculativeRenderFrames");
+    _speculativeRenderFrames->disableSlider();
+    _speculativeRenderFrames->setMinimum(0);
+    _speculativeRenderFrames->setMaximum(200);
+    _speculativeRenderFrames->setHintToolTip( tr("When the viewer is idle, this many frames around the current frame are rendered "
+                                                 "in the background and kept in the cache, so that scrubbing the timeline "
+                                                 "displays them immediately. Frames in the direction of the last move of the "
+                                                 "current frame are rendered first. These renders use the threads left over by "
+                                                 "other renders and stop as soon as the viewer must render. "
+                                                 "Set to 0 to disable.") );
+    _cachingTab->addKnob(_speculativeRenderFrames);
+
+    _speculativeRenderCachePercent = AppManager::createKnob<KnobInt>( this, tr("Maximum cache used by pre-rendered frames (% of cache size)") );
+    _speculativeRenderCachePercent->setName("speculativeRenderCachePercent");
+    _speculativeRenderCachePercent->disableSlider();
+    _speculativeRenderCachePercent->setMinimum(0);
+    _speculativeRenderCachePercent->setMaximum(100);
+    _speculativeRenderCachePercent->setHintToolTip( tr("The frames pre-rendered around the current frame stop being rendered "
+                                                       "once they have filled this share of the maximum size of the caches.") );
+    _cachingTab->addKnob(_speculativeRenderCachePercent);
+
     _maxViewerDiskCacheGB = AppManager::createKnob<KnobInt>( this, tr("Maximum playback disk cache size (GiB)") );
     _maxViewerDiskCacheGB->setName("maxViewerDiskCache");
     _maxViewerDiskCacheGB->disableSlider();
@@ -1274,6 +1305,31 @@ Settings::initializeKnobsCaching()
     _maxDiskCacheNodeGB->setHintToolTip( tr("The maximum size that may be used by the DiskCache node on disk (in GiB)") );
     _cachingTab->addKnob(_maxDiskCacheNodeGB);
 
+    _diskCacheNodeCompression = AppManager::createKnob<KnobChoice>( this, tr("DiskCache node compression") );
+    _diskCacheNodeCompression->setName("diskCacheNodeCompression");
+    {
+        std::vector<ChoiceOption> entries;
+        assert(entries.size() == (int)eCacheCompressionNone);
+        entries.push_back(ChoiceOption("none",
+                                       tr("None").toStdString(),
+                                       tr("Images are written to disk uncompressed.").toStdString()));
+        assert(entries.size() == (int)eCacheCompressionLossless);
+        entries.push_back(ChoiceOption("lossless",
+                                       tr("Lossless").toStdString(),
+                                       tr("Images are compressed without loss.").toStdString()));
+        assert(entries.size() == (int)eCacheCompressionHalfFloat);
+        entries.push_back(ChoiceOption("half",
+                                       tr("Half Float").toStdString(),
+                                       tr("32-bit floating point images are converted to 16-bit floating point and compressed, which is lossy. "
+                                          "Other images are compressed without loss.").toStdString()));
+        _diskCacheNodeCompression->populateChoices(entries);
+    }
+    _diskCacheNodeCompression->setHintToolTip( tr("How the images of the DiskCache node are compressed when they are written to disk. "
+                                                  "Compressed images take less disk space and are faster to read back from a slow disk, "
+                                                  "at the cost of some CPU time to compress and decompress them. "
+                                                  "Changing this parameter only affects the images written from now on.") );
+    _cachingTab->addKnob(_diskCacheNodeCompression);
+
 
     _diskCachePath = AppManager::createKnob<KnobPath>( this, tr("Disk cache path") );
     _diskCachePath->setName("diskCachePath");
@@ -1510,10 +1566,14 @@ Settings::setDefaultValues()
 
     // Caching
     _aggressiveCaching->setDefaultValue(false);
+    _contentBasedNodeHash->setDefaultValue(false);
     _maxRAMPercent->setDefaultValue(50, 0);
     _unreachableRAMPercent->setDefaultValue(5);
+    _speculativeRenderFrames->setDefaultValue(10);
+    _speculativeRenderCachePercent->setDefaultValue(25);
     _maxViewerDiskCacheGB->setDefaultValue(5, 0);
     _maxDiskCacheNodeGB->setDefaultValue(10, 0);
+    _diskCacheNodeCompression->setDefaultValue( (int)eCacheCompressionNone );
     //_diskCachePath
     setCachingLabels();
 
@@ -2261,6 +2321,10 @@ Settings::onKnobValueChanged(KnobI* k,
         if (!_restoringSettings) {
             appPTR->setApplicationsCachesMaximumDiskSpace( getMaximumDiskCacheNodeSize() );
         }
+    } else if ( k == _diskCacheNodeCompression.get() ) {
+        if (!_restoringSettings) {
+            appPTR->setApplicationsCachesDiskCompression( getDiskCacheNodeCompression() );
+        }
     } else if ( k == _maxRAMPercent.get() ) {
         if (!_restoringSettings) {
             appPTR->setApplicationsCachesMaximumMemoryPercent( getRamMaximumPercent() );
@@ -2490,6 +2554,12 @@ Settings::isAggressiveCachingEnabled() const
     return _aggressiveCaching->getValue();
 }
 
+bool
+Settings::isContentBasedNodeHashEnabled() const
+{
+    return _contentBasedNodeHash->getValue();
+}
+
 double
 Settings::getRamMaximumPercent() const
 {
@@ -2508,6 +2578,12 @@ Settings::getMaximumDiskCacheNodeSize() const
     return (U64)( _maxDiskCacheNodeGB->getValue() ) * 1024 * 1024 * 1024;
 }
 
+CacheCompressionEnum
+Settings::getDiskCacheNodeCompression() const
+{
+    return (CacheCompressionEnum)_diskCacheNodeCompression->getValue();
+}
+
 ///////////////////////////////////////////////////
 
 double
@@ -2516,6 +2592,18 @@ Settings::getUnreachableRamPercent() const
     return (double)_unreachableRAMPercent->getValue() / 100.;
 }
 
+int
+Settings::getSpeculativeRenderFrames() const
+{
+    return _speculativeRenderFrames->getValue();
+}
+
+double
+Settings::getSpeculativeRenderCacheShare() const
+{
+    return (double)_speculativeRenderCachePercent->getValue() / 100.;
+}
+
 bool
 Settings::getColorPickerLinear() const
 {
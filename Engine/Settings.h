@@ -111,8 +111,14 @@ public:
 
     U64 getMaximumDiskCacheNodeSize() const;
 
+    CacheCompressionEnum getDiskCacheNodeCompression() const;
+
     double getUnreachableRamPercent() const;
 
+    int getSpeculativeRenderFrames() const;
+
+    double getSpeculativeRenderCacheShare() const;
+
     bool getColorPickerLinear() const;
 
     int getNumberOfThreads() const;
@@ -277,6 +283,8 @@ public:
 
     bool isAggressiveCachingEnabled() const;
 
+    bool isContentBasedNodeHashEnabled() const;
+
     bool isAutoTurboEnabled() const;
 
     void setAutoTurboModeEnabled(bool e);
@@ -499,6 +507,7 @@ private:
     // Caching
     KnobPagePtr _cachingTab;
     KnobBoolPtr _aggressiveCaching;
+    KnobBoolPtr _contentBasedNodeHash;
     ///The percentage of the value held by _maxRAMPercent to dedicate to playback cache (viewer cache's in-RAM portion) only
     KnobStringPtr _maxPlaybackLabel;
 
@@ -516,9 +525,15 @@ private:
     KnobIntPtr _unreachableRAMPercent;
     KnobStringPtr _unreachableRAMLabel;
 
+    ///The number of frames pre-rendered around the current frame when the viewer is idle,
+    ///and the share of the caches they may use
+    KnobIntPtr _speculativeRenderFrames;
+    KnobIntPtr _speculativeRenderCachePercent;
+
     ///The total disk space allowed for all Natron's caches
     KnobIntPtr _maxViewerDiskCacheGB;
     KnobIntPtr _maxDiskCacheNodeGB;
+    KnobChoicePtr _diskCacheNodeCompression;
     KnobPathPtr _diskCachePath;
     KnobButtonPtr _wipeDiskCache;
 
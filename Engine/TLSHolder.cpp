@@ -47,6 +47,8 @@ AppTLS::AppTLS()
     , _object( new GLobalTLSObject() )
     , _spawnsMutex()
     , _spawns()
+    , _loweredPrioritiesMutex()
+    , _loweredPriorities()
 {
 }
 
@@ -82,6 +84,36 @@ copyAbortInfo(QThread* fromThread,
     }
 }
 
+// InheritPriority is the priority of the threads started without one: they run at the normal priority
+static QThread::Priority
+getEffectivePriority(const QThread* thread)
+{
+    QThread::Priority priority = thread->priority();
+
+    return priority == QThread::InheritPriority ? QThread::NormalPriority : priority;
+}
+
+void
+AppTLS::inheritPriority(const QThread* fromThread,
+                        QThread* toThread)
+{
+    if ( toThread != QThread::currentThread() ) {
+        return;
+    }
+    QThread::Priority fromPriority = getEffectivePriority(fromThread);
+    QThread::Priority toPriority = getEffectivePriority(toThread);
+    if (fromPriority >= toPriority) {
+        return;
+    }
+
+    {
+        QMutexLocker k(&_loweredPrioritiesMutex);
+        // Only the first priority is restored if the thread joins several renders before cleaning up
+        _loweredPriorities.insert( std::make_pair(toThread, toPriority) );
+    }
+    toThread->setPriority(fromPriority);
+}
+
 void
 AppTLS::copyTLS(QThread* fromThread,
                 QThread* toThread)
@@ -91,6 +123,7 @@ AppTLS::copyTLS(QThread* fromThread,
     }
 
     copyAbortInfo(fromThread, toThread);
+    inheritPriority(fromThread, toThread);
 
     QReadLocker k(&_objectMutex);
     const TLSObjects& objectsCRef = _object->objects; // take a const ref, since it's a read lock
@@ -103,6 +136,29 @@ AppTLS::copyTLS(QThread* fromThread,
     }
 }
 
+void
+AppTLS::copyTLSFromSnapshot(QThread* fromThread,
+                            QThread* snapshotThread,
+                            QThread* toThread)
+{
+    if ( (snapshotThread == toThread) || !fromThread || !snapshotThread || !toThread ) {
+        return;
+    }
+
+    copyAbortInfo(fromThread, toThread);
+    inheritPriority(fromThread, toThread);
+
+    QReadLocker k(&_objectMutex);
+    const TLSObjects& objectsCRef = _object->objects; // take a const ref, since it's a read lock
+    for (TLSObjects::const_iterator it = objectsCRef.begin();
+         it != objectsCRef.end(); ++it) {
+        TLSHolderBaseConstPtr p = (*it).lock();
+        if (p) {
+            p->copyTLS(snapshotThread, toThread);
+        }
+    }
+}
+
 void
 AppTLS::softCopy(QThread* fromThread,
                  QThread* toThread)
@@ -112,6 +168,7 @@ AppTLS::softCopy(QThread* fromThread,
     }
 
     copyAbortInfo(fromThread, toThread);
+    inheritPriority(fromThread, toThread);
 
     QWriteLocker k(&_spawnsMutex);
     _spawns[toThread] = fromThread;
@@ -120,13 +177,27 @@ AppTLS::softCopy(QThread* fromThread,
 void
 AppTLS::cleanupTLSForThread()
 {
-    QThread* curThread = QThread::currentThread();
+    cleanupTLSForThread( QThread::currentThread() );
+}
+
+void
+AppTLS::cleanupTLSForThread(QThread* curThread)
+{
     AbortableThread* isAbortableThread = dynamic_cast<AbortableThread*>(curThread);
 
     if (isAbortableThread) {
         isAbortableThread->clearAbortInfo();
     }
 
+    {
+        QMutexLocker k(&_loweredPrioritiesMutex);
+        ThreadPriorityMap::iterator foundLowered = _loweredPriorities.find(curThread);
+        if ( foundLowered != _loweredPriorities.end() ) {
+            curThread->setPriority(foundLowered->second);
+            _loweredPriorities.erase(foundLowered);
+        }
+    }
+
     //Cleanup any cached data on the TLSHolder
     {
         QWriteLocker l(&_spawnsMutex);
@@ -42,6 +42,7 @@
 #include <boost/enable_shared_from_this.hpp>
 #endif
 
+#include <QtCore/QMutex>
 #include <QtCore/QReadWriteLock>
 #include <QtCore/QThread>
 
@@ -106,6 +107,9 @@ class AppTLS
     //<spawned thread, spawner thread>
     typedef std::map<const QThread*, const QThread*> ThreadSpawnMap;
 
+    //<thread, priority before inheritPriority() lowered it>
+    typedef std::map<const QThread*, QThread::Priority> ThreadPriorityMap;
+
 public:
 
     AppTLS();
@@ -146,12 +150,34 @@ public:
 
 
     /**
-     * @brief Should be called by any thread using TLS when done to cleanup its TLS
+     * @brief Same as copyTLS() except that the TLS is copied from snapshotThread: this is a QThread that is never started
+     * and only holds a copy of the TLS of fromThread, made with copyTLS() while fromThread was not modifying it.
+     * This lets threads started at any time inherit the TLS of fromThread even though fromThread has moved on
+     * and modifies its own TLS in the meantime. The abort info is still copied from fromThread.
+     * The snapshot must be cleaned up with cleanupTLSForThread(snapshotThread) when no longer needed.
+     **/
+    void copyTLSFromSnapshot(QThread* fromThread, QThread* snapshotThread, QThread* toThread);
+
+    /**
+     * @brief Should be called by any thread using TLS when done to cleanup its TLS.
+     * This also restores the priority of the thread if it was lowered when copying the TLS.
      **/
     void cleanupTLSForThread();
 
+    /**
+     * @brief Same as cleanupTLSForThread() for the given thread, which must not be using its TLS anymore
+     **/
+    void cleanupTLSForThread(QThread* thread);
+
 private:
 
+    /**
+     * @brief If toThread is the calling thread and fromThread runs at a lower priority, lowers the priority of toThread
+     * to the one of fromThread until cleanupTLSForThread() is called. This way the threads of the thread pool which help
+     * a background render do not slow down the other renders more than the thread which started it.
+     **/
+    void inheritPriority(const QThread* fromThread, QThread* toThread);
+
     template <typename T>
     boost::shared_ptr<T> copyTLSFromSpawnerThreadInternal(const TLSHolderBase* holder,
                                                           const QThread* curThread,
@@ -166,6 +192,10 @@ private:
     //of creating a new object and no longer mark it as spawned
     mutable QReadWriteLock _spawnsMutex;
     ThreadSpawnMap _spawns;
+
+    //the threads whose priority was lowered by inheritPriority()
+    QMutex _loweredPrioritiesMutex;
+    ThreadPriorityMap _loweredPriorities;
 };
 
 
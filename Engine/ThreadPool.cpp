@@ -25,16 +25,25 @@
 
 #include "ThreadPool.h"
 
+#include <algorithm> // min, max
 #include <string>
 #include <sstream> // stringstream
+#include <vector>
 
 #include <QtCore/QAtomicInt>
 #include <QtCore/QMutex>
+#include <QtCore/QRunnable>
 #include <QtCore/QThread>
 #include <QtCore/QThreadPool>
+#include <QtCore/QWaitCondition>
 
 #include "Engine/AbortableRenderInfo.h"
+#include "Engine/AppManager.h"
 #include "Engine/Node.h"
+#include "Engine/TLSHolder.h"
+
+///Number of times a thread of a ThreadTeam polls for the next call, or for the end of a call, before sleeping
+#define NATRON_THREAD_TEAM_SPIN_COUNT 2000
 
 NATRON_NAMESPACE_ENTER
 
@@ -221,5 +230,353 @@ ThreadPool::createThreadPoolThread() const
 
 #endif // ifdef QT_CUSTOM_THREADPOOL
 
+
+struct TileSchedulerPrivate
+{
+    int nTasks;
+    TileScheduler::TaskFunctor functor;
+    QThread* callingThread;
+
+    // Never started, holds the copy of the TLS of the calling thread that the helpers inherit: it is made before
+    // any helper starts and before the calling thread runs a task, since running a task modifies the TLS
+    // (e.g: the render args) while the helpers would be copying it
+    QThread tlsSnapshot;
+
+    // Index of the next task to run
+    QAtomicInt nextTask;
+
+    // Set when a task returned false
+    QAtomicInt stopped;
+
+    // Protects nRunningHelpers
+    QMutex helpersMutex;
+    QWaitCondition helpersFinished;
+    int nRunningHelpers;
+
+    TileSchedulerPrivate(int nTasks,
+                         const TileScheduler::TaskFunctor& functor)
+        : nTasks(nTasks)
+        , functor(functor)
+        , callingThread( QThread::currentThread() )
+        , tlsSnapshot()
+        , nextTask(0)
+        , stopped(0)
+        , helpersMutex()
+        , helpersFinished()
+        , nRunningHelpers(0)
+    {
+    }
+
+    /**
+     * @brief Runs tasks until there are none left or the scheduling is stopped
+     **/
+    void runTasks()
+    {
+        while ( (int)stopped == 0 ) {
+            int task = nextTask.fetchAndAddOrdered(1);
+            if (task >= nTasks) {
+                return;
+            }
+            if ( !functor(task) ) {
+                stopped.fetchAndStoreOrdered(1);
+            }
+        }
+    }
+};
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+class TileSchedulerRunnable
+    : public QRunnable
+{
+    TileSchedulerPrivate* _imp;
+
+public:
+
+    TileSchedulerRunnable(TileSchedulerPrivate* imp)
+        : QRunnable()
+        , _imp(imp)
+    {
+        setAutoDelete(true);
+    }
+
+    virtual ~TileSchedulerRunnable()
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        // The tasks are run on behalf of the calling thread which holds the render arguments in its TLS
+        appPTR->getAppTLS()->copyTLSFromSnapshot( _imp->callingThread, &_imp->tlsSnapshot, QThread::currentThread() );
+
+        _imp->runTasks();
+
+        appPTR->getAppTLS()->cleanupTLSForThread();
+
+        // The scheduler may be destroyed as soon as the mutex is released
+        QMutexLocker k(&_imp->helpersMutex);
+        --_imp->nRunningHelpers;
+        _imp->helpersFinished.wakeAll();
+    }
+};
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+TileScheduler::TileScheduler(int nTasks,
+                             const TaskFunctor& functor)
+    : _imp( new TileSchedulerPrivate(nTasks, functor) )
+{
+}
+
+TileScheduler::~TileScheduler()
+{
+}
+
+bool
+TileScheduler::run()
+{
+    assert(QThread::currentThread() == _imp->callingThread);
+
+    bool useHelpers = _imp->nTasks > 1;
+    if (useHelpers) {
+        appPTR->getAppTLS()->copyTLS(_imp->callingThread, &_imp->tlsSnapshot);
+    }
+
+    // Request one helper per task but the one run by this thread, as long as the pool has idle threads
+    QThreadPool* pool = QThreadPool::globalInstance();
+    for (int i = 1; i < _imp->nTasks; ++i) {
+        {
+            QMutexLocker k(&_imp->helpersMutex);
+            ++_imp->nRunningHelpers;
+        }
+        TileSchedulerRunnable* helper = new TileSchedulerRunnable( _imp.get() );
+        if ( !pool->tryStart(helper) ) {
+            delete helper;
+            QMutexLocker k(&_imp->helpersMutex);
+            --_imp->nRunningHelpers;
+            break;
+        }
+    }
+
+    _imp->runTasks();
+
+    // No task is left, wait for the ones still running on the helpers
+    {
+        QMutexLocker k(&_imp->helpersMutex);
+        while (_imp->nRunningHelpers > 0) {
+            _imp->helpersFinished.wait(&_imp->helpersMutex);
+        }
+    }
+    if (useHelpers) {
+        appPTR->getAppTLS()->cleanupTLSForThread(&_imp->tlsSnapshot);
+    }
+
+    return (int)_imp->stopped == 0;
+} // TileScheduler::run
+
+struct ThreadTeamPrivate
+{
+    // Started when a call needs more threads, only modified by the thread running a call
+    std::vector<QThread*> workers;
+
+    // 1 while a thread runs a call on the team
+    QAtomicInt busy;
+
+    // Incremented each time a call is published to the workers. Only written with jobMutex locked.
+    QAtomicInt generation;
+
+    // Protects the call below, quit and the wait conditions
+    QMutex jobMutex;
+    QWaitCondition jobAvailable;
+    QWaitCondition helpersFinished;
+    bool quit;
+
+    // The call of the current generation: workers whose index is lower than nHelpers take part in it
+    int nTasks;
+    int nHelpers;
+    const ThreadTeam::TaskFunctor* functor;
+
+    // Index of the next task to run
+    QAtomicInt nextTask;
+
+    // Number of workers taking part in the current call that are not done yet
+    QAtomicInt pendingHelpers;
+
+    ThreadTeamPrivate()
+        : workers()
+        , busy(0)
+        , generation(0)
+        , jobMutex()
+        , jobAvailable()
+        , helpersFinished()
+        , quit(false)
+        , nTasks(0)
+        , nHelpers(0)
+        , functor(0)
+        , nextTask(0)
+        , pendingHelpers(0)
+    {
+    }
+
+    void runTasks(int nTasksToRun,
+                  const ThreadTeam::TaskFunctor& f)
+    {
+        for (;;) {
+            int task = nextTask.fetchAndAddOrdered(1);
+            if (task >= nTasksToRun) {
+                return;
+            }
+            f(task);
+        }
+    }
+};
+
+NATRON_NAMESPACE_ANONYMOUS_ENTER
+
+class ThreadTeamWorker
+    : public QThread
+      , public AbortableThread
+{
+    ThreadTeamPrivate* _imp;
+    int _index;
+
+    // The generation of the last call published before the worker was started
+    int _startGeneration;
+
+public:
+
+    ThreadTeamWorker(ThreadTeamPrivate* imp,
+                     int index,
+                     int startGeneration)
+        : QThread()
+        , AbortableThread(this)
+        , _imp(imp)
+        , _index(index)
+        , _startGeneration(startGeneration)
+    {
+        setThreadName("Multi-thread suite (team)");
+    }
+
+    virtual ~ThreadTeamWorker()
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        int seenGeneration = _startGeneration;
+        bool tookPart = false;
+
+        for (;;) {
+            // Calls often come in bursts: poll for the next one for a while before sleeping. Workers left out of the
+            // last call go to sleep right away, calls are likely to use fewer threads than the team has.
+            for (int i = 0; tookPart && i < NATRON_THREAD_TEAM_SPIN_COUNT && (int)_imp->generation == seenGeneration; ++i) {
+                QThread::yieldCurrentThread();
+            }
+
+            int nTasks;
+            const ThreadTeam::TaskFunctor* functor;
+            {
+                QMutexLocker k(&_imp->jobMutex);
+                while ( !_imp->quit && ( (int)_imp->generation == seenGeneration ) ) {
+                    _imp->jobAvailable.wait(&_imp->jobMutex);
+                }
+                if (_imp->quit) {
+                    return;
+                }
+                seenGeneration = (int)_imp->generation;
+                tookPart = _index < _imp->nHelpers;
+                if (!tookPart) {
+                    continue;
+                }
+                nTasks = _imp->nTasks;
+                functor = _imp->functor;
+            }
+
+            _imp->runTasks(nTasks, *functor);
+
+            // The last worker done wakes the calling thread if it went to sleep
+            if (_imp->pendingHelpers.fetchAndAddOrdered(-1) == 1) {
+                QMutexLocker k(&_imp->jobMutex);
+                _imp->helpersFinished.wakeAll();
+            }
+        }
+    }
+};
+
+NATRON_NAMESPACE_ANONYMOUS_EXIT
+
+ThreadTeam::ThreadTeam()
+    : _imp( new ThreadTeamPrivate() )
+{
+}
+
+ThreadTeam::~ThreadTeam()
+{
+    {
+        QMutexLocker k(&_imp->jobMutex);
+        _imp->quit = true;
+        _imp->jobAvailable.wakeAll();
+    }
+    for (std::size_t i = 0; i < _imp->workers.size(); ++i) {
+        _imp->workers[i]->wait();
+        delete _imp->workers[i];
+    }
+}
+
+int
+ThreadTeam::getNWorkers() const
+{
+    return (int)_imp->workers.size();
+}
+
+bool
+ThreadTeam::tryRun(int nTasks,
+                   int nThreads,
+                   const TaskFunctor& functor)
+{
+    if ( !_imp->busy.testAndSetAcquire(0, 1) ) {
+        return false;
+    }
+
+    int nHelpers = std::max( 0, std::min(nThreads, nTasks) - 1 );
+    for (int i = (int)_imp->workers.size(); i < nHelpers; ++i) {
+        ThreadTeamWorker* worker = new ThreadTeamWorker( _imp.get(), i, (int)_imp->generation );
+        worker->start();
+        _imp->workers.push_back(worker);
+    }
+
+    _imp->nextTask.fetchAndStoreOrdered(0);
+    if (nHelpers > 0) {
+        QMutexLocker k(&_imp->jobMutex);
+        _imp->nTasks = nTasks;
+        _imp->nHelpers = nHelpers;
+        _imp->functor = &functor;
+        _imp->pendingHelpers.fetchAndStoreOrdered(nHelpers);
+        _imp->generation.fetchAndAddOrdered(1);
+        _imp->jobAvailable.wakeAll();
+    }
+
+    _imp->runTasks(nTasks, functor);
+
+    if (nHelpers > 0) {
+        // The remaining tasks are short: poll for the workers before sleeping
+        for (int i = 0; i < NATRON_THREAD_TEAM_SPIN_COUNT && (int)_imp->pendingHelpers > 0; ++i) {
+            QThread::yieldCurrentThread();
+        }
+        QMutexLocker k(&_imp->jobMutex);
+        while ( (int)_imp->pendingHelpers > 0 ) {
+            _imp->helpersFinished.wait(&_imp->jobMutex);
+        }
+    }
+
+    _imp->busy.fetchAndStoreRelease(0);
+
+    return true;
+} // ThreadTeam::tryRun
+
 NATRON_NAMESPACE_EXIT
 
@@ -30,6 +30,7 @@
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/scoped_ptr.hpp>
+#include <boost/function.hpp>
 #endif
 
 #include <QtCore/QThreadPool> // defines QT_CUSTOM_THREADPOOL (or not)
@@ -135,6 +136,82 @@ private:
 
 #endif // QT_CUSTOM_THREADPOOL
 
+
+/**
+ * @brief Runs a set of independent tasks, such as the tiles of an effect rendered with host frame threading,
+ * on the global thread pool.
+ * Unlike QtConcurrent::mapped() followed by waitForFinished(), the calling thread does not sleep while tasks are left:
+ * it runs them along with the pool threads and only waits for the tasks already started by other threads.
+ * Pool threads are only used if they are idle, so that nested renders cannot exhaust the pool: in the worst
+ * case the calling thread runs all the tasks itself.
+ * Each pool thread gets a copy of the TLS of the calling thread, as it was when run() was called, for as long as it runs tasks.
+ **/
+struct TileSchedulerPrivate;
+class TileScheduler
+{
+public:
+
+    /**
+     * @brief Runs the task of the given index. Returning false stops the scheduling: the tasks not started yet
+     * are not run. This is used when a tile fails or when the render is aborted.
+     **/
+    typedef boost::function<bool (int)> TaskFunctor;
+
+    TileScheduler(int nTasks,
+                  const TaskFunctor& functor);
+
+    ~TileScheduler();
+
+    /**
+     * @brief Runs all tasks, returning when they are all done or when one of them stopped the scheduling, in which
+     * case false is returned.
+     **/
+    bool run() WARN_UNUSED_RETURN;
+
+private:
+
+    boost::scoped_ptr<TileSchedulerPrivate> _imp;
+};
+
+/**
+ * @brief A team of worker threads running fork-join calls issued one after the other at a high rate, such as the
+ * calls to the OFX multi-thread suite that plug-ins make for each block of rows or each pass.
+ * Workers are started when a call needs more threads than the team has, so that the team follows the number of
+ * threads the callers are allowed to use, and live as long as the team. A call publishes its tasks to the workers,
+ * which spin for a short while after each call before sleeping, so that back-to-back calls neither create threads nor
+ * wake sleeping ones. The calling thread runs tasks as well and then spins until the workers are done.
+ * The team runs the calls of one thread at a time: tryRun() returns false if it is busy, which includes being called
+ * from one of its own tasks, and the caller should then run the tasks some other way.
+ * Workers are AbortableThread so that abort info copied to them from the calling thread is fast to query.
+ **/
+struct ThreadTeamPrivate;
+class ThreadTeam
+{
+public:
+
+    /**
+     * @brief Runs the task of the given index. It must not throw.
+     **/
+    typedef boost::function<void (int)> TaskFunctor;
+
+    ThreadTeam();
+
+    ~ThreadTeam();
+
+    ///Returns the number of workers started so far
+    int getNWorkers() const;
+
+    /**
+     * @brief Runs all tasks on at most nThreads threads, the calling thread included, and returns once they are all done.
+     * Returns false without running any task if the team is busy.
+     **/
+    bool tryRun(int nTasks, int nThreads, const TaskFunctor& functor) WARN_UNUSED_RETURN;
+
+private:
+
+    boost::scoped_ptr<ThreadTeamPrivate> _imp;
+};
+
 NATRON_NAMESPACE_EXIT
 
 #endif // Natron_Engine_ThreadPool_h
@@ -25,13 +25,17 @@
 
 #include "TrackerContext.h"
 
+#include <algorithm> // max_element
 #include <set>
+#include <cmath>
 #include <sstream> // stringstream
 
 CLANG_DIAG_OFF(deprecated)
 CLANG_DIAG_OFF(uninitialized)
 #include <QtCore/QWaitCondition>
 #include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtCore/QRunnable>
 #include <QtCore/QCoreApplication>
 CLANG_DIAG_ON(deprecated)
 CLANG_DIAG_ON(uninitialized)
@@ -1671,6 +1675,12 @@ TrackArgs::getLibMVAutoTrack() const
     return _imp->libmvAutotrack;
 }
 
+TrackerFrameAccessorPtr
+TrackArgs::getFrameAccessor() const
+{
+    return _imp->fa;
+}
+
 void
 TrackArgs::getEnabledChannels(bool* r,
                               bool* g,
@@ -1679,6 +1689,37 @@ TrackArgs::getEnabledChannels(bool* r,
     _imp->fa->getEnabledChannels(r, g, b);
 }
 
+static RectD
+getMarkerSearchWindow(const TrackMarker& marker,
+                      int time)
+{
+    KnobDoublePtr searchBtmLeft = marker.getSearchWindowBottomLeftKnob();
+    KnobDoublePtr searchTopRight = marker.getSearchWindowTopRightKnob();
+    KnobDoublePtr centerKnob = marker.getCenterKnob();
+    KnobDoublePtr offsetKnob = marker.getOffsetKnob();
+    Point offset, center, btmLeft, topRight;
+
+    offset.x = offsetKnob->getValueAtTime(time, 0);
+    offset.y = offsetKnob->getValueAtTime(time, 1);
+
+    center.x = centerKnob->getValueAtTime(time, 0);
+    center.y = centerKnob->getValueAtTime(time, 1);
+
+    btmLeft.x = searchBtmLeft->getValueAtTime(time, 0) + center.x + offset.x;
+    btmLeft.y = searchBtmLeft->getValueAtTime(time, 1) + center.y + offset.y;
+
+    topRight.x = searchTopRight->getValueAtTime(time, 0) + center.x + offset.x;
+    topRight.y = searchTopRight->getValueAtTime(time, 1) + center.y + offset.y;
+
+    RectD rect;
+    rect.x1 = btmLeft.x;
+    rect.y1 = btmLeft.y;
+    rect.x2 = topRight.x;
+    rect.y2 = topRight.y;
+
+    return rect;
+}
+
 void
 TrackArgs::getRedrawAreasNeeded(int time,
                                 std::list<RectD>* canonicalRects) const
@@ -1687,29 +1728,7 @@ TrackArgs::getRedrawAreasNeeded(int time,
         if ( !(*it)->natronMarker->isEnabled(time) ) {
             continue;
         }
-        KnobDoublePtr searchBtmLeft = (*it)->natronMarker->getSearchWindowBottomLeftKnob();
-        KnobDoublePtr searchTopRight = (*it)->natronMarker->getSearchWindowTopRightKnob();
-        KnobDoublePtr centerKnob = (*it)->natronMarker->getCenterKnob();
-        KnobDoublePtr offsetKnob = (*it)->natronMarker->getOffsetKnob();
-        Point offset, center, btmLeft, topRight;
-        offset.x = offsetKnob->getValueAtTime(time, 0);
-        offset.y = offsetKnob->getValueAtTime(time, 1);
-
-        center.x = centerKnob->getValueAtTime(time, 0);
-        center.y = centerKnob->getValueAtTime(time, 1);
-
-        btmLeft.x = searchBtmLeft->getValueAtTime(time, 0) + center.x + offset.x;
-        btmLeft.y = searchBtmLeft->getValueAtTime(time, 1) + center.y + offset.y;
-
-        topRight.x = searchTopRight->getValueAtTime(time, 0) + center.x + offset.x;
-        topRight.y = searchTopRight->getValueAtTime(time, 1) + center.y + offset.y;
-
-        RectD rect;
-        rect.x1 = btmLeft.x;
-        rect.y1 = btmLeft.y;
-        rect.x2 = topRight.x;
-        rect.y2 = topRight.y;
-        canonicalRects->push_back(rect);
+        canonicalRects->push_back( getMarkerSearchWindow(*(*it)->natronMarker, time) );
     }
 }
 
@@ -1736,6 +1755,11 @@ struct TrackSchedulerPrivate
      * @param time The time at which to track. The reference frame is held in the args and can be different for each track
      */
     static bool trackStepFunctor(int trackIndex, const TrackArgs& args, int time);
+
+    /*
+     * @brief Renders ahead of time in the frame accessor cache the image that LibMV will need to track the given track at the given time.
+     */
+    static void prefetchFunctor(int trackIndex, const TrackArgs& args, int time);
 };
 
 TrackScheduler::TrackScheduler(TrackerParamsProvider* paramsProvider,
@@ -1783,6 +1807,40 @@ TrackSchedulerPrivate::trackStepFunctor(int trackIndex,
     return ret;
 }
 
+void
+TrackSchedulerPrivate::prefetchFunctor(int trackIndex,
+                                       const TrackArgs& args,
+                                       int time)
+{
+    assert( trackIndex >= 0 && trackIndex < args.getNumTracks() );
+    const std::vector<TrackMarkerAndOptionsPtr>& tracks = args.getTracks();
+    const TrackMarkerAndOptionsPtr& track = tracks[trackIndex];
+    TrackerFrameAccessorPtr fa = args.getFrameAccessor();
+
+    // Markers tracking with TrackerPM do not use the frame accessor
+    if ( !fa || dynamic_cast<TrackMarkerPM*>( track->natronMarker.get() ) || !track->natronMarker->isEnabled(time) ) {
+        return;
+    }
+
+    // The marker is not tracked yet at this time, so its knobs return the position at the last tracked frame.
+    // Enlarge the search window by half its size so that it still encloses the region LibMV asks for if the marker moves.
+    RectD searchWindow = getMarkerSearchWindow(*track->natronMarker, time);
+    double padX = searchWindow.width() / 2.;
+    double padY = searchWindow.height() / 2.;
+    RectI roi;
+    roi.x1 = (int)std::floor(searchWindow.x1 - padX);
+    roi.y1 = (int)std::floor(searchWindow.y1 - padY);
+    roi.x2 = (int)std::ceil(searchWindow.x2 + padX);
+    roi.y2 = (int)std::ceil(searchWindow.y2 + padY);
+    if ( roi.isNull() ) {
+        return;
+    }
+
+    fa->prefetchImage(time, roi);
+
+    appPTR->getAppTLS()->cleanupTLSForThread();
+}
+
 NATRON_NAMESPACE_ANONYMOUS_ENTER
 
 class IsTrackingFlagSetter_RAII
@@ -1830,6 +1888,358 @@ public:
     }
 };
 
+class TrackPipeline;
+typedef boost::shared_ptr<TrackPipeline> TrackPipelinePtr;
+
+/*
+ * @brief Dispatches the track steps to the global thread pool without waiting for all tracks to be done with a frame
+ * before moving on to the next one: a track starts its next frame as soon as it is done with the current one,
+ * as long as it is less than TRACKER_MAX_FRAMES_AHEAD frames ahead of the last frame reported by the scheduler.
+ * While a track is tracked, the search windows of its next frames are rendered in the frame accessor cache by
+ * lower priority tasks, so that the renders of the input overlap with the tracking.
+ * Tasks never wait in the thread pool: a track that is too far ahead is parked and restarted by setFrameReported().
+ */
+class TrackPipeline
+    : public boost::enable_shared_from_this<TrackPipeline>
+{
+    struct SavedCurve
+    {
+        KnobIPtr knob;
+        int dimension;
+        CurvePtr curve;
+    };
+
+    TrackArgsPtr _args;
+    int _framesCount;
+    mutable QMutex _lock;
+    QWaitCondition _cond;
+
+    // For each track, the index of the next frame to track
+    std::vector<int> _nextFrame;
+
+    // For each track, whether it is waiting for the other tracks to catch up
+    std::vector<bool> _parked;
+
+    // For each track, the index of the last frame prefetched
+    std::vector<int> _prefetchedFrame;
+
+    // For each frame, the number of tracks done with it and the number of tracks that succeeded
+    std::vector<int> _nDone, _nSucceeded;
+
+    // For each track, the curves of the marker knobs before tracking, to roll back the frames tracked ahead of the scheduler
+    std::vector<std::vector<SavedCurve> > _savedCurves;
+
+    // Index of the last frame the scheduler is done with
+    int _reportedFrame;
+    int _nTasks;
+    bool _aborted;
+
+public:
+
+    TrackPipeline(const TrackArgsPtr& args,
+                  int framesCount)
+        : _args(args)
+        , _framesCount(framesCount)
+        , _lock()
+        , _cond()
+        , _nextFrame(args->getNumTracks(), 0)
+        , _parked(args->getNumTracks(), false)
+        , _prefetchedFrame(args->getNumTracks(), 0)
+        , _nDone(framesCount, 0)
+        , _nSucceeded(framesCount, 0)
+        , _savedCurves( args->getNumTracks() )
+        , _reportedFrame(-1)
+        , _nTasks(0)
+        , _aborted(false)
+    {
+        const std::vector<TrackMarkerAndOptionsPtr>& tracks = args->getTracks();
+
+        for (std::size_t i = 0; i < tracks.size(); ++i) {
+            const KnobsVec& knobs = tracks[i]->natronMarker->getKnobs();
+            for (KnobsVec::const_iterator it = knobs.begin(); it != knobs.end(); ++it) {
+                if ( !(*it)->canAnimate() ) {
+                    continue;
+                }
+                for (int d = 0; d < (*it)->getDimension(); ++d) {
+                    CurvePtr curve = (*it)->getCurve(ViewIdx(0), d);
+                    if (!curve) {
+                        continue;
+                    }
+                    SavedCurve saved;
+                    saved.knob = *it;
+                    saved.dimension = d;
+                    saved.curve = boost::make_shared<Curve>();
+                    saved.curve->clone(*curve);
+                    _savedCurves[i].push_back(saved);
+                }
+            }
+        }
+    }
+
+    int getFrameTime(int frameIndex) const
+    {
+        return _args->getStart() + frameIndex * _args->getStep();
+    }
+
+    void start()
+    {
+        QMutexLocker k(&_lock);
+
+        for (std::size_t i = 0; i < _nextFrame.size(); ++i) {
+            launchTrackStep(i);
+        }
+    }
+
+    /*
+     * @brief Blocks until all tracks are done with the given frame. Returns false if all tracks failed on this frame.
+     */
+    bool waitForFrame(int frameIndex)
+    {
+        assert(frameIndex >= 0 && frameIndex < _framesCount);
+        QMutexLocker k(&_lock);
+        while ( _nDone[frameIndex] < (int)_nextFrame.size() ) {
+            _cond.wait(&_lock);
+        }
+
+        return _nSucceeded[frameIndex] > 0;
+    }
+
+    /*
+     * @brief Called by the scheduler once it is done with the given frame: the tracks may go further ahead.
+     */
+    void setFrameReported(int frameIndex)
+    {
+        {
+            QMutexLocker k(&_lock);
+            _reportedFrame = frameIndex;
+            for (std::size_t i = 0; i < _parked.size(); ++i) {
+                if ( _parked[i] && canTrack(_nextFrame[i]) ) {
+                    _parked[i] = false;
+                    launchTrackStep(i);
+                }
+            }
+        }
+
+        // The images of the frame before are no longer needed as reference frame
+        if (frameIndex > 0) {
+            _args->getFrameAccessor()->releasePrefetchedImages( getFrameTime(frameIndex - 1) );
+        }
+    }
+
+    /*
+     * @brief Prevents any new task from starting and waits for the running ones
+     */
+    void abortAndWait()
+    {
+        QMutexLocker k(&_lock);
+
+        _aborted = true;
+        while (_nTasks > 0) {
+            _cond.wait(&_lock);
+        }
+    }
+
+    /*
+     * @brief Must be called after abortAndWait(). The tracks may have tracked frames after the last frame the scheduler
+     * waited for: their keyframes and disabled markers on these frames are rolled back to what they were before tracking.
+     * The images prefetched for the frames that will not be tracked are released.
+     */
+    void rollbackFramesAfter(int frameIndex)
+    {
+        std::vector<int> nextFrame;
+        int firstFrameToRelease, lastFrameToRelease;
+        {
+            QMutexLocker k(&_lock);
+            assert(_nTasks == 0);
+            nextFrame = _nextFrame;
+            firstFrameToRelease = std::max(_reportedFrame, 0);
+            lastFrameToRelease = *std::max_element( _prefetchedFrame.begin(), _prefetchedFrame.end() );
+        }
+
+        for (std::size_t i = 0; i < nextFrame.size(); ++i) {
+            int lastTrackedFrame = nextFrame[i] - 1;
+            if (lastTrackedFrame <= frameIndex) {
+                continue;
+            }
+            int firstTime = getFrameTime(frameIndex + 1);
+            int lastTime = getFrameTime(lastTrackedFrame);
+            RangeD range;
+            range.min = std::min(firstTime, lastTime);
+            range.max = std::max(firstTime, lastTime);
+            for (std::size_t c = 0; c < _savedCurves[i].size(); ++c) {
+                const SavedCurve& saved = _savedCurves[i][c];
+                CurvePtr curve = saved.knob->getCurve(ViewIdx(0), saved.dimension);
+                if (!curve) {
+                    continue;
+                }
+                Curve restored;
+                restored.clone(*curve);
+                restored.cloneRange(*saved.curve, range);
+                saved.knob->cloneCurve(ViewIdx(0), saved.dimension, restored);
+            }
+        }
+
+        TrackerFrameAccessorPtr fa = _args->getFrameAccessor();
+        if (fa) {
+            for (int i = firstFrameToRelease; i <= lastFrameToRelease; ++i) {
+                fa->releasePrefetchedImages( getFrameTime(i) );
+            }
+        }
+    }
+
+    void runTrackStep(int trackIndex,
+                      int frameIndex)
+    {
+        {
+            QMutexLocker k(&_lock);
+            if (_aborted) {
+                onTaskFinished();
+
+                return;
+            }
+
+            // Render the next frames of this track while it is tracked
+            int lastFrameToPrefetch = std::min(frameIndex + TRACKER_MAX_FRAMES_AHEAD, _framesCount - 1);
+            for (int i = std::max(_prefetchedFrame[trackIndex], frameIndex) + 1; i <= lastFrameToPrefetch; ++i) {
+                launchPrefetch(trackIndex, i);
+            }
+            _prefetchedFrame[trackIndex] = std::max(_prefetchedFrame[trackIndex], lastFrameToPrefetch);
+        }
+
+        bool ret = TrackSchedulerPrivate::trackStepFunctor( trackIndex, *_args, getFrameTime(frameIndex) );
+
+        QMutexLocker k(&_lock);
+        ++_nDone[frameIndex];
+        if (ret) {
+            ++_nSucceeded[frameIndex];
+        }
+        _nextFrame[trackIndex] = frameIndex + 1;
+        if ( !_aborted && (frameIndex + 1 < _framesCount) ) {
+            if ( canTrack(frameIndex + 1) ) {
+                launchTrackStep(trackIndex);
+            } else {
+                _parked[trackIndex] = true;
+            }
+        }
+        onTaskFinished();
+    }
+
+    void runPrefetch(int trackIndex,
+                     int frameIndex)
+    {
+        bool aborted;
+        {
+            QMutexLocker k(&_lock);
+            aborted = _aborted;
+        }
+
+        if (!aborted) {
+            TrackSchedulerPrivate::prefetchFunctor( trackIndex, *_args, getFrameTime(frameIndex) );
+        }
+
+        QMutexLocker k(&_lock);
+        onTaskFinished();
+    }
+
+private:
+
+    bool canTrack(int frameIndex) const
+    {
+        return frameIndex <= _reportedFrame + TRACKER_MAX_FRAMES_AHEAD;
+    }
+
+    void onTaskFinished()
+    {
+        assert( !_lock.tryLock() );
+        --_nTasks;
+        _cond.wakeAll();
+    }
+
+    void launchTrackStep(int trackIndex);
+
+    void launchPrefetch(int trackIndex, int frameIndex);
+};
+
+class TrackStepRunnable
+    : public QRunnable
+{
+    TrackPipelinePtr _pipeline;
+    int _trackIndex;
+    int _frameIndex;
+
+public:
+
+    TrackStepRunnable(const TrackPipelinePtr& pipeline,
+                      int trackIndex,
+                      int frameIndex)
+        : QRunnable()
+        , _pipeline(pipeline)
+        , _trackIndex(trackIndex)
+        , _frameIndex(frameIndex)
+    {
+    }
+
+    virtual ~TrackStepRunnable()
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        _pipeline->runTrackStep(_trackIndex, _frameIndex);
+    }
+};
+
+class TrackPrefetchRunnable
+    : public QRunnable
+{
+    TrackPipelinePtr _pipeline;
+    int _trackIndex;
+    int _frameIndex;
+
+public:
+
+    TrackPrefetchRunnable(const TrackPipelinePtr& pipeline,
+                          int trackIndex,
+                          int frameIndex)
+        : QRunnable()
+        , _pipeline(pipeline)
+        , _trackIndex(trackIndex)
+        , _frameIndex(frameIndex)
+    {
+    }
+
+    virtual ~TrackPrefetchRunnable()
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        _pipeline->runPrefetch(_trackIndex, _frameIndex);
+    }
+};
+
+void
+TrackPipeline::launchTrackStep(int trackIndex)
+{
+    assert( !_lock.tryLock() );
+    ++_nTasks;
+    QThreadPool::globalInstance()->start( new TrackStepRunnable(shared_from_this(), trackIndex, _nextFrame[trackIndex]) );
+}
+
+void
+TrackPipeline::launchPrefetch(int trackIndex,
+                              int frameIndex)
+{
+    assert( !_lock.tryLock() );
+    ++_nTasks;
+    // Lower priority than the track steps: prefetching should only use idle threads
+    QThreadPool::globalInstance()->start( new TrackPrefetchRunnable(shared_from_this(), trackIndex, frameIndex), -1 );
+}
+
 NATRON_NAMESPACE_ANONYMOUS_EXIT
 
 GenericSchedulerThread::ThreadStateEnum
@@ -1854,9 +2264,7 @@ TrackScheduler::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
 
     const std::vector<TrackMarkerAndOptionsPtr>& tracks = args->getTracks();
     const int numTracks = (int)tracks.size();
-    std::vector<int> trackIndexes( tracks.size() );
     for (std::size_t i = 0; i < tracks.size(); ++i) {
-        trackIndexes[i] = i;
         tracks[i]->natronMarker->notifyTrackingStarted();
         // unslave the enabled knob, since it is slaved to the gui but we may modify it
         KnobBoolPtr enabledKnob = tracks[i]->natronMarker->getEnabledKnob();
@@ -1883,37 +2291,31 @@ TrackScheduler::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
         }
 
 
-        while (cur != end) {
-            ///Launch parallel thread for each track using the global thread pool
-            QFuture<bool> future = QtConcurrent::mapped( trackIndexes,
-                                                         boost::bind(&TrackSchedulerPrivate::trackStepFunctor,
-                                                                     _1,
-                                                                     *args,
-                                                                     cur) );
-            future.waitForFinished();
-
-            allTrackFailed = true;
-            for (QFuture<bool>::const_iterator it = future.begin(); it != future.end(); ++it) {
-                if ( (*it) ) {
-                    allTrackFailed = false;
-                    break;
-                }
-            }
-
+        ///Launch the tracks using the global thread pool: each track moves on to the next frame on its own
+        TrackPipelinePtr pipeline;
+        if ( (cur != end) && (numTracks > 0) && (framesCount > 0) ) {
+            pipeline = boost::make_shared<TrackPipeline>(args, framesCount);
+            pipeline->start();
+        }
+        int frameIndex = 0;
+        // The last frame whose results are kept
+        int lastFrameIndex = -1;
 
+        while ( pipeline && (cur != end) && (frameIndex < framesCount) ) {
+            ///Wait for all tracks to be done with this frame, the fastest tracks may already be working on the next frames
+            allTrackFailed = !pipeline->waitForFrame(frameIndex);
+            lastFrameIndex = frameIndex;
 
             lastValidFrame = cur;
 
-
-
             // We don't have any successful track, stop
             if (allTrackFailed) {
                 break;
             }
 
-
-
             cur += frameStep;
+            pipeline->setFrameReported(frameIndex);
+            ++frameIndex;
 
             double progress;
             if (frameStep > 0) {
@@ -1967,6 +2369,12 @@ TrackScheduler::threadLoopOnce(const GenericThreadStartArgsPtr& inArgs)
                 break;
             }
         } // while (cur != end) {
+
+        ///Tracks that went ahead of the last reported frame are stopped as well and their results past the stop frame are discarded
+        if (pipeline) {
+            pipeline->abortAndWait();
+            pipeline->rollbackFramesAfter(lastFrameIndex);
+        }
     } // IsTrackingFlagSetter_RAII
     TrackerContext* isContext = dynamic_cast<TrackerContext*>(_imp->paramsProvider);
     if (isContext) {
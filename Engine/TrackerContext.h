@@ -476,6 +476,7 @@ public:
     int getNumTracks() const;
     const std::vector<TrackMarkerAndOptionsPtr>& getTracks() const;
     mv::AutoTrackPtr getLibMVAutoTrack() const;
+    TrackerFrameAccessorPtr getFrameAccessor() const;
 
     void getEnabledChannels(bool* r, bool* g, bool* b) const;
 
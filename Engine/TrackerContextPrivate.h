@@ -78,6 +78,10 @@ GCC_DIAG_ON(maybe-uninitialized)
 
 #define TRACKER_MAX_TRACKS_FOR_PARTIAL_VIEWER_UPDATE 8
 
+// How many frames a track may get ahead of the last frame tracked by all tracks.
+// The search windows of that many frames are also pre-rendered in the frame accessor cache.
+#define TRACKER_MAX_FRAMES_AHEAD 4
+
 /// Parameters definitions
 
 //////// Global to all tracks
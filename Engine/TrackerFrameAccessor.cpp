@@ -121,6 +121,10 @@ struct FrameAccessorCacheEntry
     // If null, this is the full image
     RectI bounds;
     unsigned int referenceCount;
+
+    // True if the image was rendered ahead by prefetchImage(): it is kept in the cache
+    // when its reference count drops to 0 until releasePrefetchedImages() is called
+    bool prefetched;
 };
 
 typedef std::multimap<FrameAccessorCacheKey, FrameAccessorCacheEntry, CacheKey_compare_less > FrameAccessorCache;
@@ -232,6 +236,17 @@ struct TrackerFrameAccessorPrivate
             this->enabledChannels[i] = enabledChannels[i];
         }
     }
+
+    /*
+     * @brief Renders the input of the tracker at the given frame and converts it to a LibMV image.
+     * If roi is NULL, the full image is rendered.
+     */
+    bool renderImage(int frame, int downscale, const RectI* roi, FrameAccessorCacheEntry* entry);
+
+    /*
+     * @brief Returns an image of the cache whose bounds enclose roi, or NULL. Must be called with cacheMutex locked.
+     */
+    FrameAccessorCacheEntry* findCachedImage(const FrameAccessorCacheKey& key, const RectI& roi);
 };
 
 TrackerFrameAccessor::TrackerFrameAccessor(const TrackerContext* context,
@@ -306,45 +321,88 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
         convertLibMVRegionToRectI(*region, _imp->formatHeight, &roi);
 
         QMutexLocker k(&_imp->cacheMutex);
-        std::pair<FrameAccessorCache::iterator, FrameAccessorCache::iterator> range = _imp->cache.equal_range(key);
-        for (FrameAccessorCache::iterator it = range.first; it != range.second; ++it) {
-            if ( (roi.x1 >= it->second.bounds.x1) && (roi.x2 <= it->second.bounds.x2) &&
-                 ( roi.y1 >= it->second.bounds.y1) && ( roi.y2 <= it->second.bounds.y2) ) {
+        FrameAccessorCacheEntry* cached = _imp->findCachedImage(key, roi);
+        if (cached) {
 #ifdef TRACE_LIB_MV
-                qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "Found cached image at frame" << frame << "with RoI x1="
-                         << region->min(0) << "y1=" << region->max(1) << "x2=" << region->max(0) << "y2=" << region->min(1);
+            qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "Found cached image at frame" << frame << "with RoI x1="
+                     << region->min(0) << "y1=" << region->max(1) << "x2=" << region->max(0) << "y2=" << region->min(1);
 #endif
-                // LibMV is kinda dumb on this we must necessarily copy the data either via CopyFrom or the
-                // assignment constructor:
-                // EDIT: fixed libmv
-                *destination = it->second.image.get();
-                //destination->CopyFrom<float>(*it->second.image);
-                ++it->second.referenceCount;
-
-                return (mv::FrameAccessor::Key)it->second.image.get();
-            }
+            // LibMV is kinda dumb on this we must necessarily copy the data either via CopyFrom or the
+            // assignment constructor:
+            // EDIT: fixed libmv
+            *destination = cached->image.get();
+            //destination->CopyFrom<float>(*cached->image);
+            ++cached->referenceCount;
+
+            return (mv::FrameAccessor::Key)cached->image.get();
+        }
+    }
+
+    // Not in accessor cache, call renderRoI
+    FrameAccessorCacheEntry entry;
+    if ( !_imp->renderImage(frame, downscale, region ? &roi : 0, &entry) ) {
+        return (mv::FrameAccessor::Key)0;
+    }
+    entry.referenceCount = 1;
+    // we ignore the transform parameter and do it in natronImageToLibMvFloatImage instead
+
+    *destination = entry.image.get();
+    //destination->CopyFrom<float>(*entry.image);
+
+    //insert into the cache
+    {
+        QMutexLocker k(&_imp->cacheMutex);
+        _imp->cache.insert( std::make_pair(key, entry) );
+    }
+
+    return (mv::FrameAccessor::Key)entry.image.get();
+} // TrackerFrameAccessor::GetImage
+
+FrameAccessorCacheEntry*
+TrackerFrameAccessorPrivate::findCachedImage(const FrameAccessorCacheKey& key,
+                                             const RectI& roi)
+{
+    assert( !cacheMutex.tryLock() );
+    std::pair<FrameAccessorCache::iterator, FrameAccessorCache::iterator> range = cache.equal_range(key);
+    for (FrameAccessorCache::iterator it = range.first; it != range.second; ++it) {
+        if ( (roi.x1 >= it->second.bounds.x1) && (roi.x2 <= it->second.bounds.x2) &&
+             ( roi.y1 >= it->second.bounds.y1) && ( roi.y2 <= it->second.bounds.y2) ) {
+            return &it->second;
         }
     }
 
+    return 0;
+}
+
+bool
+TrackerFrameAccessorPrivate::renderImage(int frame,
+                                         int downscale,
+                                         const RectI* inputRoI,
+                                         FrameAccessorCacheEntry* entry)
+{
+    RectI roi;
+    if (inputRoI) {
+        roi = *inputRoI;
+    }
+
     EffectInstancePtr effect;
-    if (_imp->trackerInput) {
-        effect = _imp->trackerInput->getEffectInstance();
+    if (trackerInput) {
+        effect = trackerInput->getEffectInstance();
     }
     if (!effect) {
-        return (mv::FrameAccessor::Key)0;
+        return false;
     }
 
-    // Not in accessor cache, call renderRoI
     RenderScale scale;
     scale.y = scale.x = Image::getScaleFromMipMapLevel( (unsigned int)downscale );
 
 
     RectD precomputedRoD;
-    if (!region) {
+    if (!inputRoI) {
         bool isProjectFormat;
-        StatusEnum stat = effect->getRegionOfDefinition_public(_imp->trackerInput->getHashValue(), frame, scale, ViewIdx(0), &precomputedRoD, &isProjectFormat);
+        StatusEnum stat = effect->getRegionOfDefinition_public(trackerInput->getHashValue(), frame, scale, ViewIdx(0), &precomputedRoD, &isProjectFormat);
         if (stat == eStatusFailed) {
-            return (mv::FrameAccessor::Key)0;
+            return false;
         }
         double par = effect->getAspectRatio(-1);
         precomputedRoD.toPixelEnclosing( (unsigned int)downscale, par, &roi );
@@ -353,7 +411,7 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
     std::list<ImagePlaneDesc> components;
     components.push_back( ImagePlaneDesc::getRGBComponents() );
 
-    NodePtr node = _imp->context->getNode();
+    NodePtr node = context->getNode();
     const bool isRenderUserInteraction = true;
     const bool isSequentialRender = false;
     AbortableRenderInfoPtr abortInfo = AbortableRenderInfo::create(false, 0);
@@ -383,7 +441,7 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
                                         components,
                                         eImageBitDepthFloat,
                                         true,
-                                        _imp->context->getNode()->getEffectInstance().get(),
+                                        node->getEffectInstance().get(),
                                         eStorageModeRAM /*returnOpenGLTex*/,
                                         frame);
     std::map<ImagePlaneDesc, ImagePtr> planes;
@@ -394,7 +452,7 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
                  << roi.x1 << "y1=" << roi.y1 << "x2=" << roi.x2 << "y2=" << roi.y2;
 #endif
 
-        return (mv::FrameAccessor::Key)0;
+        return false;
     }
 
     assert( !planes.empty() );
@@ -407,7 +465,7 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
                  << roi.x1 << "y1=" << roi.y1 << "x2=" << roi.x2 << "y2=" << roi.y2 << ")";
 #endif
 
-        return (mv::FrameAccessor::Key)0;
+        return false;
     }
 
 #ifdef TRACE_LIB_MV
@@ -418,32 +476,17 @@ TrackerFrameAccessor::GetImage(int /*clip*/,
     /*
        Copy the Natron image to the LivMV float image
      */
-    FrameAccessorCacheEntry entry;
-    entry.image = boost::make_shared<MvFloatImage>( intersectedRoI.height(), intersectedRoI.width() );
-    entry.bounds = intersectedRoI;
-    entry.referenceCount = 1;
-    natronImageToLibMvFloatImage(_imp->enabledChannels,
+    entry->image = boost::make_shared<MvFloatImage>( intersectedRoI.height(), intersectedRoI.width() );
+    entry->bounds = intersectedRoI;
+    entry->referenceCount = 0;
+    entry->prefetched = false;
+    natronImageToLibMvFloatImage(enabledChannels,
                                  sourceImage.get(),
                                  intersectedRoI,
-                                 *entry.image);
-    // we ignore the transform parameter and do it in natronImageToLibMvFloatImage instead
-
-    *destination = entry.image.get();
-    //destination->CopyFrom<float>(*entry.image);
-
-    //insert into the cache
-    {
-        QMutexLocker k(&_imp->cacheMutex);
-        _imp->cache.insert( std::make_pair(key, entry) );
-    }
-#ifdef TRACE_LIB_MV
-    qDebug() << QThread::currentThread() << "FrameAccessor::GetImage():" << "Rendered frame" << frame << "with RoI x1="
-             << intersectedRoI.x1 << "y1=" << intersectedRoI.y1 << "x2=" << intersectedRoI.x2 << "y2=" << intersectedRoI.y2;
-#endif
-
-    return (mv::FrameAccessor::Key)entry.image.get();
-} // TrackerFrameAccessor::GetImage
+                                 *entry->image);
 
+    return true;
+} // TrackerFrameAccessorPrivate::renderImage
 
 void
 TrackerFrameAccessor::ReleaseImage(Key key)
@@ -454,7 +497,7 @@ TrackerFrameAccessor::ReleaseImage(Key key)
     for (FrameAccessorCache::iterator it = _imp->cache.begin(); it != _imp->cache.end(); ++it) {
         if (it->second.image.get() == imgKey) {
             --it->second.referenceCount;
-            if (!it->second.referenceCount) {
+            if (!it->second.referenceCount && !it->second.prefetched) {
                 _imp->cache.erase(it);
 
                 return;
@@ -463,6 +506,51 @@ TrackerFrameAccessor::ReleaseImage(Key key)
     }
 }
 
+void
+TrackerFrameAccessor::prefetchImage(int frame,
+                                    const RectI& roi)
+{
+    FrameAccessorCacheKey key;
+    key.frame = frame;
+    key.mipMapLevel = 0;
+    key.mode = mv::FrameAccessor::MONO;
+
+    {
+        QMutexLocker k(&_imp->cacheMutex);
+        if ( _imp->findCachedImage(key, roi) ) {
+            return;
+        }
+    }
+
+    FrameAccessorCacheEntry entry;
+    if ( !_imp->renderImage(frame, 0, &roi, &entry) ) {
+        return;
+    }
+    entry.prefetched = true;
+
+    QMutexLocker k(&_imp->cacheMutex);
+    _imp->cache.insert( std::make_pair(key, entry) );
+}
+
+void
+TrackerFrameAccessor::releasePrefetchedImages(int frame)
+{
+    QMutexLocker k(&_imp->cacheMutex);
+    FrameAccessorCache::iterator it = _imp->cache.begin();
+
+    while ( it != _imp->cache.end() ) {
+        if ( (it->first.frame == frame) && it->second.prefetched ) {
+            if (!it->second.referenceCount) {
+                _imp->cache.erase(it++);
+                continue;
+            }
+            // Still used by LibMV: it will be removed by ReleaseImage
+            it->second.prefetched = false;
+        }
+        ++it;
+    }
+}
+
 /*
  * @brief This is called by LibMV to retrieve an the mask, which is always defined in the reference frame.
  */
@@ -93,6 +93,19 @@ public:
     // Non-caching implementation may free used memory immediately.
     virtual void ReleaseMask(mv::FrameAccessor::Key key) OVERRIDE FINAL;
 
+    /**
+     * @brief Renders the given region of the frame ahead of time so that a subsequent call to GetImage()
+     * with a region enclosed in roi does not have to render. The image is kept in the cache until
+     * releasePrefetchedImages() is called for this frame.
+     **/
+    void prefetchImage(int frame, const RectI& roi);
+
+    /**
+     * @brief Removes from the cache the images of the given frame rendered by prefetchImage().
+     * Images still in use by LibMV are removed when they are released.
+     **/
+    void releasePrefetchedImages(int frame);
+
     virtual bool GetClipDimensions(int clip, int* width, int* height) OVERRIDE FINAL;
     virtual int NumClips() OVERRIDE FINAL;
     virtual int NumFrames(int clip) OVERRIDE FINAL;
@@ -85,6 +85,11 @@ public:
         , tileSize(0)
         , nbCachedTile(0)
         , colorImage()
+        , alphaImage()
+        , channels(eDisplayChannelsRGB)
+        , alphaChannelIndex(-1)
+        , renderRoI()
+        , canRefreshDisplayTransform(false)
         , rod()
         , pixelAspectRatio(1.)
         , abortInfo()
@@ -136,6 +141,14 @@ public:
     // The image which was used to make the texture
     ImagePtr colorImage;
 
+    // The matte image, the channels and the portion of the images which were used to make the texture,
+    // so that it can be converted again when only the gain, gamma or colorspace changes
+    ImagePtr alphaImage;
+    DisplayChannelsEnum channels;
+    int alphaChannelIndex;
+    RectI renderRoI;
+    bool canRefreshDisplayTransform;
+
     // The RoD of the src image
     RectD rod;
 
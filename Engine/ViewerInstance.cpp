@@ -31,6 +31,7 @@
 #include <cassert>
 #include <cstring> // for std::memcpy
 #include <cfloat> // DBL_MAX
+#include <vector>
 
 #include <boost/shared_ptr.hpp>
 #include <boost/scoped_ptr.hpp>
@@ -73,6 +74,7 @@ CLANG_DIAG_ON(deprecated)
 #include "Engine/UpdateViewerParams.h"
 #include "Engine/Utils.h"
 #include "Engine/ViewIdx.h"
+#include "Engine/ViewerTextureKernels.h"
 
 
 #ifndef M_LN2
@@ -251,6 +253,8 @@ ViewerInstance::clearLastRenderedImage()
         QMutexLocker k(&_imp->lastRenderParamsMutex);
         _imp->lastRenderParams[0].reset();
         _imp->lastRenderParams[1].reset();
+        _imp->lastDisplayedParams[0].reset();
+        _imp->lastDisplayedParams[1].reset();
     }
 }
 
@@ -312,6 +316,10 @@ void
 ViewerInstance::executeDisconnectTextureRequestOnMainThread(int index,bool clearRoD)
 {
     assert( QThread::currentThread() == qApp->thread() );
+    {
+        QMutexLocker k(&_imp->lastRenderParamsMutex);
+        _imp->lastDisplayedParams[index].reset();
+    }
     if (_imp->uiContext) {
         _imp->uiContext->disconnectInputTexture(index, clearRoD);
     }
@@ -610,6 +618,43 @@ ViewerInstance::getViewerArgsAndRenderViewer(SequenceTime time,
     return eViewerRenderRetCodeRender;
 } // ViewerInstance::getViewerArgsAndRenderViewer
 
+/**
+ * @brief Returns the portion of the texture of inArgs that must be rendered: if some tiles are cached, only the bounding box
+ * of the tiles that are not.
+ **/
+static RectI
+getViewerRenderRoI(const ViewerArgs& inArgs,
+                   const NodePtr& rotoPaintNode)
+{
+    const bool useTextureCache = !inArgs.forceRender && !inArgs.userRoIEnabled && !inArgs.autoContrast && rotoPaintNode.get() == 0 && !inArgs.isDoingPartialUpdates;
+    RectI roi = inArgs.params->roi;
+
+    // We might already have some tiles cached, get their bounding box to see if it is less than the actual RoI
+    if (useTextureCache) {
+        RectI tilesBbox;
+        bool tilesBboxSet = false;
+        for (std::list<UpdateViewerParams::CachedTile>::const_iterator it = inArgs.params->tiles.begin(); it != inArgs.params->tiles.end(); ++it) {
+            if (it->ramBuffer) {
+                continue;
+            }
+            if (!tilesBboxSet) {
+                tilesBboxSet = true;
+                tilesBbox.x1 = it->rectRounded.x1;
+                tilesBbox.x2 = it->rectRounded.x2;
+                tilesBbox.y1 = it->rectRounded.y1;
+                tilesBbox.y2 = it->rectRounded.y2;
+            } else {
+                tilesBbox.merge(it->rectRounded.x1, it->rectRounded.y1, it->rectRounded.x2, it->rectRounded.y2);
+            }
+        }
+        if ( roi.contains(tilesBbox) ) {
+            roi = tilesBbox;
+        }
+    }
+
+    return roi;
+}
+
 ViewerInstance::ViewerRenderRetCode
 ViewerInstance::renderViewer(ViewIdx view,
                              bool singleThreaded,
@@ -635,6 +680,32 @@ ViewerInstance::renderViewer(ViewIdx view,
     ViewerInstance::ViewerRenderRetCode ret[2] = {
         eViewerRenderRetCodeRedraw, eViewerRenderRetCodeRedraw
     };
+
+    /*
+       When both inputs render the same frame, they share their request pass: the nodes upstream of both inputs
+       are rendered once by the A input with the union of the RoIs of both inputs, the B input then finding them in the cache.
+       This is only possible if the RoD of both inputs is already known.
+     */
+    if ( useTLS && args[0] && args[0]->params && args[1] && args[1]->params &&
+         (_imp->uiContext->getCompositingOperator() != eViewerCompositingOperatorNone) ) {
+        bool canShareRequest = true;
+        for (int i = 0; i < 2; ++i) {
+            if ( args[i]->mustComputeRoDAndLookupCache || ( args[i]->params->nbCachedTile == (int)args[i]->params->tiles.size() ) ) {
+                canShareRequest = false;
+            }
+        }
+        if ( canShareRequest && (args[0]->params->time == args[1]->params->time) && (args[0]->params->mipMapLevel == args[1]->params->mipMapLevel) ) {
+            SharedFrameRequestPtr sharedRequest = boost::make_shared<SharedFrameRequest>(args[0]->params->time, view, args[0]->params->mipMapLevel, getNode());
+            for (int i = 0; i < 2; ++i) {
+                RectI roi = getViewerRenderRoI(*args[i], rotoPaintNode);
+                RectD canonicalRoi;
+                roi.toCanonical(args[i]->params->mipMapLevel, args[i]->params->pixelAspectRatio, args[i]->params->rod, &canonicalRoi);
+                sharedRequest->addRenderWindow(canonicalRoi);
+                args[i]->sharedRequest = sharedRequest;
+            }
+        }
+    }
+
     for (int i = 0; i < 2; ++i) {
         if (args[i] && args[i]->params) {
             if ( (i == 1) && (_imp->uiContext->getCompositingOperator() == eViewerCompositingOperatorNone) ) {
@@ -661,6 +732,7 @@ ViewerInstance::renderViewer(ViewIdx view,
 
                 // Reset the rednering flag
                 args[i]->isRenderingFlag.reset();
+                args[i]->sharedRequest.reset();
             }
 
             if (ret[i] != eViewerRenderRetCodeRender) {
@@ -704,6 +776,53 @@ ViewerInstance::renderViewer(ViewIdx view,
     return eViewerRenderRetCodeRender;
 } // ViewerInstance::renderViewer
 
+bool
+ViewerInstance::renderViewerInCache(SequenceTime time,
+                                    ViewIdx view,
+                                    std::size_t* cacheBytes)
+{
+    *cacheBytes = 0;
+    if ( !_imp->uiContext || !isViewerUIVisible() || isDoingPartialUpdates() ) {
+        return false;
+    }
+
+    U64 viewerHash = getHash();
+    bool rendered = false;
+    for (int i = 0; i < 2; ++i) {
+        if ( (i == 1) && (_imp->uiContext->getCompositingOperator() == eViewerCompositingOperatorNone) ) {
+            break;
+        }
+
+        // This render does not take a render age: it must not be ordered with the renders that are displayed
+        AbortableRenderInfoPtr abortInfo = AbortableRenderInfo::create(true, 0);
+        ViewerArgsPtr args = boost::make_shared<ViewerArgs>();
+        ViewerRenderRetCode stat = getRenderViewerArgsAndCheckCache( time, true, view, i, viewerHash, NodePtr(), abortInfo, RenderStatsPtr(), args.get() );
+        if ( (stat != eViewerRenderRetCodeRender) || !args->params || args->params->isViewerPaused ) {
+            continue;
+        }
+        if ( !args->mustComputeRoDAndLookupCache && ( args->params->nbCachedTile == (int)args->params->tiles.size() ) ) {
+            // Already cached
+            continue;
+        }
+
+        stat = renderViewer_internal(view, false, true, viewerHash, true, NodePtr(), true, ViewerCurrentFrameRequestSchedulerStartArgsPtr(), RenderStatsPtr(), *args);
+        args->isRenderingFlag.reset();
+        // Aborted renders count as well: what they allocated stays in the caches
+        *cacheBytes += abortInfo->getCacheBytesAllocated();
+        if (stat == eViewerRenderRetCodeRender) {
+            rendered = true;
+        } else {
+            // Either failure, black or aborted: do not keep the textures
+            for (std::list<UpdateViewerParams::CachedTile>::iterator it = args->params->tiles.begin(); it != args->params->tiles.end(); ++it) {
+                it->cachedData.reset();
+            }
+            args->params->tiles.clear();
+        }
+    }
+
+    return rendered;
+} // ViewerInstance::renderViewerInCache
+
 static bool
 checkTreeCanRender_internal(Node* node,
                             std::list<Node*>& marked)
@@ -1387,30 +1506,7 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
      */
 
     const bool useTextureCache = !inArgs.forceRender && !inArgs.userRoIEnabled && !inArgs.autoContrast && rotoPaintNode.get() == 0 && !inArgs.isDoingPartialUpdates;
-    RectI roi = inArgs.params->roi;
-
-    // We might already have some tiles cached, get their bounding box to see if it is less than the actual RoI
-    if (useTextureCache) {
-        RectI tilesBbox;
-        bool tilesBboxSet = false;
-        for (std::list<UpdateViewerParams::CachedTile>::const_iterator it = inArgs.params->tiles.begin(); it != inArgs.params->tiles.end(); ++it) {
-            if (it->ramBuffer) {
-                continue;
-            }
-            if (!tilesBboxSet) {
-                tilesBboxSet = true;
-                tilesBbox.x1 = it->rectRounded.x1;
-                tilesBbox.x2 = it->rectRounded.x2;
-                tilesBbox.y1 = it->rectRounded.y1;
-                tilesBbox.y2 = it->rectRounded.y2;
-            } else {
-                tilesBbox.merge(it->rectRounded.x1, it->rectRounded.y1, it->rectRounded.x2, it->rectRounded.y2);
-            }
-        }
-        if ( roi.contains(tilesBbox) ) {
-            roi = tilesBbox;
-        }
-    }
+    RectI roi = getViewerRenderRoI(inArgs, rotoPaintNode);
 
     assert(inArgs.activeInputToRender);
 
@@ -1425,17 +1521,26 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
 
 
     if (useTLS) {
-        RectD canonicalRoi;
-        roi.toCanonical(inArgs.params->mipMapLevel, inArgs.params->pixelAspectRatio, inArgs.params->rod, &canonicalRoi);
+        if ( inArgs.sharedRequest && inArgs.sharedRequest->isSameFrame(inArgs.params->time, view, inArgs.params->mipMapLevel) ) {
+            const FrameRequestMap* requestPassData = 0;
+            StatusEnum stat = inArgs.sharedRequest->getRequest(&requestPassData);
+            if (stat == eStatusFailed) {
+                return eViewerRenderRetCodeFail;
+            }
+            frameArgs->updateNodesRequest(*requestPassData);
+        } else {
+            RectD canonicalRoi;
+            roi.toCanonical(inArgs.params->mipMapLevel, inArgs.params->pixelAspectRatio, inArgs.params->rod, &canonicalRoi);
 
-        FrameRequestMap requestPassData;
-        StatusEnum stat = EffectInstance::computeRequestPass(inArgs.params->time, view, inArgs.params->mipMapLevel, canonicalRoi, getNode(), requestPassData);
-        if (stat == eStatusFailed) {
-            return eViewerRenderRetCodeFail;
-        }
+            FrameRequestMap requestPassData;
+            StatusEnum stat = EffectInstance::computeRequestPass(inArgs.params->time, view, inArgs.params->mipMapLevel, canonicalRoi, getNode(), requestPassData);
+            if (stat == eStatusFailed) {
+                return eViewerRenderRetCodeFail;
+            }
 
 
-        frameArgs->updateNodesRequest(requestPassData);
+            frameArgs->updateNodesRequest(requestPassData);
+        }
     }
 
     const double par = inArgs.activeInputToRender->getAspectRatio(-1);
@@ -1849,6 +1954,12 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
             lastPaintBboxPixel.intersect(viewerRenderRoI, &viewerRenderRoI);
         }
 
+        updateParams->alphaImage = alphaImage;
+        updateParams->channels = inArgs.channels;
+        updateParams->alphaChannelIndex = alphaChannelIndex;
+        updateParams->renderRoI = viewerRenderRoI;
+        updateParams->canRefreshDisplayTransform = (updateParams->depth == eImageBitDepthByte) && !inArgs.autoContrast && !rotoPaintNode && !inArgs.isDoingPartialUpdates;
+
         TimeLapsePtr viewerRenderTimeRecorder;
         if (stats) {
             viewerRenderTimeRecorder = boost::make_shared<TimeLapse>();
@@ -1999,6 +2110,136 @@ ViewerInstance::renderViewer_internal(ViewIdx view,
     return eViewerRenderRetCodeRender;
 } // renderViewer_internal
 
+bool
+ViewerInstance::refreshDisplayTransform()
+{
+    // always running in the main thread
+    assert( qApp && qApp->thread() == QThread::currentThread() );
+    if (!_imp->uiContext) {
+        return false;
+    }
+
+    const int nTextures = (_imp->uiContext->getCompositingOperator() == eViewerCompositingOperatorNone) ? 1 : 2;
+    UpdateViewerParamsPtr lastParams[2];
+    {
+        QMutexLocker k(&_imp->lastRenderParamsMutex);
+        for (int i = 0; i < nTextures; ++i) {
+            lastParams[i] = _imp->lastDisplayedParams[i];
+        }
+    }
+    // Check all textures first so that they all get the same display transform
+    for (int i = 0; i < nTextures; ++i) {
+        if ( !lastParams[i] || lastParams[i]->tiles.empty() || !lastParams[i]->colorImage ) {
+            return false;
+        }
+        // If a render was requested since the texture was displayed, its source images may be outdated
+        QMutexLocker k(&_imp->renderAgeMutex);
+        if ( !_imp->currentRenderAges[i].empty() || (_imp->renderAge[i] != lastParams[i]->abortInfo->getRenderAge() + 1) ) {
+            return false;
+        }
+    }
+
+    double gain, gamma;
+    ViewerColorSpaceEnum lut;
+    {
+        QMutexLocker l(&_imp->viewerParamsMutex);
+        gain = _imp->viewerParamsGain;
+        gamma = _imp->viewerParamsGamma;
+        lut = _imp->viewerParamsLut;
+    }
+
+    for (int i = 0; i < nTextures; ++i) {
+        UpdateViewerParamsPtr params = boost::make_shared<UpdateViewerParams>(*lastParams[i]);
+        // The buffer of the last texture still belongs to it
+        params->mustFreeRamBuffer = false;
+        params->gain = gain;
+        params->gamma = gamma;
+        params->lut = lut;
+        params->nbCachedTile = 0;
+        params->recenterViewport = false;
+        params->abortInfo = _imp->createNewRenderRequest(i, false);
+
+        // If the last texture was not made of cached tiles, it has a single tile covering the RoI
+        const bool renderOnlyRoI = !params->tiles.front().cachedData;
+        {
+            FrameEntryLocker entryLocker( _imp.get() );
+            std::list<UpdateViewerParams::CachedTile> unCachedTiles;
+            if (renderOnlyRoI) {
+                assert(params->tiles.size() == 1);
+                UpdateViewerParams::CachedTile& tile = params->tiles.front();
+                tile.ramBuffer = (unsigned char*)malloc(tile.bytesCount);
+                if (!tile.ramBuffer) {
+                    return false;
+                }
+                params->mustFreeRamBuffer = true;
+                unCachedTiles.push_back(tile);
+            } else {
+                RectI bounds;
+                params->rod.toPixelEnclosing(params->mipMapLevel, params->pixelAspectRatio, &bounds);
+
+                RectI tileBounds;
+                tileBounds.x1 = tileBounds.y1 = 0;
+                tileBounds.x2 = tileBounds.y2 = params->tileSize;
+
+                for (std::list<UpdateViewerParams::CachedTile>::iterator it = params->tiles.begin(); it != params->tiles.end(); ++it) {
+                    assert(it->cachedData);
+                    FrameKey key = it->cachedData->getKey();
+                    key.setDisplayTransform(gain, gamma, (int)lut);
+                    it->cachedData.reset();
+                    it->ramBuffer = 0;
+                    it->isCached = false;
+
+                    FrameParamsPtr cachedFrameParams( new FrameParams(bounds, key.getBitDepth(), tileBounds, ImagePtr() ) );
+                    bool cached = appPTR->getTextureOrCreate(key, cachedFrameParams, &entryLocker, &it->cachedData);
+                    if (!it->cachedData) {
+                        return false;
+                    }
+                    if (cached) {
+                        // This tile was already converted with this display transform
+                        entryLocker.lock(it->cachedData);
+                        it->ramBuffer = it->cachedData->data();
+                        it->isCached = true;
+                        ++params->nbCachedTile;
+                        continue;
+                    }
+                    ///The entry has already been locked by the cache
+                    it->cachedData->allocateMemory();
+                    it->ramBuffer = it->cachedData->data();
+                    assert(it->ramBuffer);
+                    it->cachedData->setInternalImage(params->colorImage);
+                    unCachedTiles.push_back(*it);
+                }
+            }
+
+            ViewerColorSpaceEnum srcColorSpace = getApp()->getDefaultColorSpaceForBitDepth( params->colorImage->getBitDepth() );
+            const RenderViewerArgs args(params->colorImage,
+                                        params->alphaImage,
+                                        params->channels,
+                                        params->srcPremult,
+                                        params->depth,
+                                        params->gain,
+                                        params->gamma,
+                                        params->offset,
+                                        lutFromColorspace(srcColorSpace),
+                                        lutFromColorspace(params->lut),
+                                        params->alphaChannelIndex,
+                                        renderOnlyRoI,
+                                        params->tileSize); // 8bit textures are interpreted as U32
+            QReadLocker k(&_imp->gammaLookupMutex);
+            QtConcurrent::map( unCachedTiles,
+                               boost::bind(&renderFunctor,
+                                           params->renderRoI,
+                                           args,
+                                           this,
+                                           _1) ).waitForFinished();
+        } // entryLocker
+
+        _imp->updateViewer(params);
+    }
+
+    return true;
+} // refreshDisplayTransform
+
 void
 ViewerInstance::aboutToUpdateTextures()
 {
@@ -2042,6 +2283,10 @@ renderFunctor(const RectI& roi,
         // texture is stored as sRGB/Rec709 compressed 8-bit RGBA
         scaleToTexture8bits(roi, args, viewer, tile, (U32*)tile.ramBuffer);
     }
+    if (tile.cachedData) {
+        // The texture is now complete: a disk-cached texture can be restored from the journal
+        tile.cachedData->notifyDataComplete();
+    }
 }
 
 inline
@@ -2525,6 +2770,175 @@ scaleToTexture8bitsForDepth(const RectI& roi,
     }
 }
 
+/**
+ * @brief Returns true if the row kernels of ViewerTextureKernels can be used to convert the input image:
+ * this is the most common case, i.e a RGBA float image displayed in RGB with no input color-space and no matte overlay.
+ **/
+static bool
+canUseViewerTextureKernels(const RenderViewerArgs & args)
+{
+    return args.inputImage->getBitDepth() == eImageBitDepthFloat &&
+           args.inputImage->getComponents().getNumComponents() == 4 &&
+           args.channels == eDisplayChannelsRGB &&
+           !args.srcColorSpace &&
+           !(args.matteImage && args.alphaChannelIndex >= 0);
+}
+
+/**
+ * @brief Returns true if the 8-bit row kernels of ViewerTextureKernels can be used to convert the input image.
+ * In that case the channels of the input image displayed as r,g,b are returned, as chosen by scaleToTexture8bitsForPremult,
+ * and the matte channel is the alphaChannelIndex of the matte overlay or -1.
+ **/
+static bool
+canUseViewerTextureKernels8bits(const RenderViewerArgs & args,
+                                int* rOffset,
+                                int* gOffset,
+                                int* bOffset,
+                                int* matteChannel)
+{
+    if ( (args.inputImage->getBitDepth() != eImageBitDepthFloat) ||
+         (args.inputImage->getComponents().getNumComponents() != 4) ||
+         args.srcColorSpace ||
+         (args.gamma != 1.) ) {
+        return false;
+    }
+
+    *matteChannel = -1;
+    if (args.matteImage && args.alphaChannelIndex >= 0) {
+        // The matte of another image and its color-space conversion are done by the generic code
+        if ( (args.matteImage != args.inputImage) || args.colorSpace ) {
+            return false;
+        }
+        *matteChannel = args.alphaChannelIndex;
+    }
+
+    switch (args.channels) {
+    case eDisplayChannelsRGB:
+    case eDisplayChannelsMatte:
+        *rOffset = 0;
+        *gOffset = 1;
+        *bOffset = 2;
+        break;
+    case eDisplayChannelsY:
+        // The luminance is done by the generic code
+        return false;
+    case eDisplayChannelsG:
+        *rOffset = *gOffset = *bOffset = 1;
+        break;
+    case eDisplayChannelsB:
+        *rOffset = *gOffset = *bOffset = 2;
+        break;
+    case eDisplayChannelsA:
+        *rOffset = *gOffset = *bOffset = (args.alphaChannelIndex >= 0 && args.alphaChannelIndex < 3) ? args.alphaChannelIndex : 3;
+        break;
+    case eDisplayChannelsR:
+    default:
+        *rOffset = *gOffset = *bOffset = 0;
+        break;
+    }
+
+    // The color-space look-up only has a kernel for the r,g,b channels
+    if ( args.colorSpace && ( (*rOffset != 0) || (*gOffset != 1) || (*bOffset != 2) ) ) {
+        return false;
+    }
+
+    return true;
+} // canUseViewerTextureKernels8bits
+
+/**
+ * @brief Same as scaleToTexture8bits_generic<float, 1, opaque, matteOverlay, rOffset, gOffset, bOffset> with a gamma of 1, but each row
+ * is processed by the vectorized kernels. Returns false if the fast path cannot be used.
+ **/
+static bool
+scaleToTexture8bitsFast(const RectI& roi,
+                        const RenderViewerArgs & args,
+                        const UpdateViewerParams::CachedTile& tile,
+                        U32* tileBuffer)
+{
+    int rOffset, gOffset, bOffset, matteChannel;
+
+    if ( !canUseViewerTextureKernels8bits(args, &rOffset, &gOffset, &bOffset, &matteChannel) ) {
+        return false;
+    }
+
+    Image::ReadAccess acc = Image::ReadAccess( args.inputImage.get() );
+    const int y1 = args.renderOnlyRoI ? roi.y1 : tile.rect.y1;
+    const int x1 = args.renderOnlyRoI ? roi.x1 : tile.rect.x1;
+    const float* src_pixels = (const float*)acc.pixelAt(x1, y1);
+    if (!src_pixels) {
+        return false;
+    }
+
+    if ( (args.renderOnlyRoI && !tile.rect.contains(roi)) || (!args.renderOnlyRoI && !roi.contains(tile.rect)) ) {
+        return true;
+    }
+    assert(tile.rect.x2 > tile.rect.x1);
+
+    int dstRowElements;
+    U32* dst_pixels;
+    if (args.renderOnlyRoI) {
+        dstRowElements = tile.rect.width();
+        dst_pixels = tileBuffer + (roi.y1 - tile.rect.y1) * dstRowElements + (roi.x1 - tile.rect.x1);
+    } else {
+        dstRowElements = args.tileRowElements;
+        dst_pixels = tileBuffer + (tile.rect.y1 - tile.rectRounded.y1) * args.tileRowElements + (tile.rect.x1 - tile.rectRounded.x1);
+    }
+
+    const int y2 = args.renderOnlyRoI ? roi.y2 : tile.rect.y2;
+    const int x2 = args.renderOnlyRoI ? roi.x2 : tile.rect.x2;
+    const int width = x2 - x1;
+    const int srcRowElements = (int)args.inputImage->getRowElements();
+    const bool opaque = args.srcPremult == eImagePremultiplicationOpaque;
+
+    if (!args.colorSpace) {
+        const bool defaultChannels = (rOffset == 0) && (gOffset == 1) && (bOffset == 2) && (matteChannel == -1);
+        for (int y = y1; y < y2; ++y, dst_pixels += dstRowElements, src_pixels += srcRowElements) {
+            if (defaultChannels) {
+                ViewerTextureKernels::toBGRA8(src_pixels, width, args.gain, args.offset, opaque, dst_pixels);
+            } else {
+                ViewerTextureKernels::toBGRA8Channels(src_pixels, width, args.gain, args.offset, opaque,
+                                                      rOffset, gOffset, bOffset, matteChannel, dst_pixels);
+            }
+        }
+
+        return true;
+    }
+
+    // The color-space look-up and the error diffusion are serial, only the gain/offset is vectorized
+    std::vector<float> row(width * 4);
+    for (int y = y1; y < y2; ++y, dst_pixels += dstRowElements, src_pixels += srcRowElements) {
+        ViewerTextureKernels::applyGainOffsetRGBA(src_pixels, width, args.gain, args.offset, &row[0]);
+
+        // coverity[dont_call]
+        int start = (int)( rand() % width );
+
+        for (int backward = 0; backward < 2; ++backward) {
+            int index = backward ? start - 1 : start;
+            unsigned error_r = 0x80;
+            unsigned error_g = 0x80;
+            unsigned error_b = 0x80;
+
+            while (index < width && index >= 0) {
+                const float* pix = &row[index * 4];
+                error_r = (error_r & 0xff) + args.colorSpace->toColorSpaceUint8xxFromLinearFloatFast(pix[0]);
+                error_g = (error_g & 0xff) + args.colorSpace->toColorSpaceUint8xxFromLinearFloatFast(pix[1]);
+                error_b = (error_b & 0xff) + args.colorSpace->toColorSpaceUint8xxFromLinearFloatFast(pix[2]);
+                assert(error_r < 0x10000 && error_g < 0x10000 && error_b < 0x10000);
+                int uA = opaque ? 255 : Color::floatToInt<256>(pix[3]);
+                dst_pixels[index] = toBGRA( (U8)(error_r >> 8), (U8)(error_g >> 8), (U8)(error_b >> 8), uA );
+
+                if (backward) {
+                    --index;
+                } else {
+                    ++index;
+                }
+            }
+        }
+    }
+
+    return true;
+} // scaleToTexture8bitsFast
+
 void
 scaleToTexture8bits(const RectI& roi,
                     const RenderViewerArgs & args,
@@ -2533,6 +2947,9 @@ scaleToTexture8bits(const RectI& roi,
                     U32* output)
 {
     assert(output);
+    if ( scaleToTexture8bitsFast(roi, args, tile, output) ) {
+        return;
+    }
     switch ( args.inputImage->getBitDepth() ) {
     case eImageBitDepthFloat:
         scaleToTexture8bitsForDepth<float, 1>(roi, args, viewer, tile, output);
@@ -2878,6 +3295,51 @@ scaleToTexture32bitsForPremult(const RectI& roi,
     }
 }
 
+/**
+ * @brief Same as scaleToTexture32bitsGeneric<float, 1, opaque, false, 0, 1, 2>, but each row
+ * is processed by the vectorized kernels. Returns false if the fast path cannot be used.
+ **/
+static bool
+scaleToTexture32bitsFast(const RectI& roi,
+                         const RenderViewerArgs & args,
+                         const UpdateViewerParams::CachedTile& tile,
+                         float *tileBuffer)
+{
+    if ( !canUseViewerTextureKernels(args) ) {
+        return false;
+    }
+
+    Image::ReadAccess acc = Image::ReadAccess( args.inputImage.get() );
+    const int y1 = args.renderOnlyRoI ? roi.y1 : tile.rect.y1;
+    const int x1 = args.renderOnlyRoI ? roi.x1 : tile.rect.x1;
+    const float* src_pixels = (const float*)acc.pixelAt(x1, y1);
+    if (!src_pixels) {
+        return false;
+    }
+
+    assert( (args.renderOnlyRoI && roi.x1 >= tile.rect.x1 && roi.x2 <= tile.rect.x2 && roi.y1 >= tile.rect.y1 && roi.y2 <= tile.rect.y2) || (!args.renderOnlyRoI && tile.rect.x1 >= roi.x1 && tile.rect.x2 <= roi.x2 && tile.rect.y1 >= roi.y1 && tile.rect.y2 <= roi.y2) );
+    assert(tile.rect.x2 > tile.rect.x1);
+
+    const int dstRowElements = args.renderOnlyRoI ? tile.rect.width() * 4 : args.tileRowElements;
+    float* dst_pixels;
+    if (args.renderOnlyRoI) {
+        dst_pixels = tileBuffer + (roi.y1 - tile.rect.y1) * dstRowElements + (roi.x1 - tile.rect.x1) * 4;
+    } else {
+        dst_pixels = tileBuffer + (tile.rect.y1 - tile.rectRounded.y1) * dstRowElements + (tile.rect.x1 - tile.rectRounded.x1) * 4;
+    }
+
+    const int y2 = args.renderOnlyRoI ? roi.y2 : tile.rect.y2;
+    const int x2 = args.renderOnlyRoI ? roi.x2 : tile.rect.x2;
+    const int srcRowElements = (int)args.inputImage->getRowElements();
+    const bool opaque = args.srcPremult == eImagePremultiplicationOpaque;
+
+    for (int y = y1; y < y2; ++y, dst_pixels += dstRowElements, src_pixels += srcRowElements) {
+        ViewerTextureKernels::copyRGBA32(src_pixels, x2 - x1, opaque, dst_pixels);
+    }
+
+    return true;
+} // scaleToTexture32bitsFast
+
 void
 scaleToTexture32bits(const RectI& roi,
                      const RenderViewerArgs & args,
@@ -2885,6 +3347,9 @@ scaleToTexture32bits(const RectI& roi,
                      float *output)
 {
     assert(output);
+    if ( scaleToTexture32bitsFast(roi, args, tile, output) ) {
+        return;
+    }
 
     switch ( args.inputImage->getBitDepth() ) {
     case eImageBitDepthFloat:
@@ -2981,6 +3446,15 @@ ViewerInstance::ViewerInstancePrivate::updateViewer(UpdateViewerParamsPtr params
         if (!isDrawing) {
             uiContext->updateColorPicker(params->textureIndex);
         }
+
+        {
+            QMutexLocker k(&lastRenderParamsMutex);
+            if (params->canRefreshDisplayTransform && !params->isSequential) {
+                lastDisplayedParams[params->textureIndex] = params;
+            } else {
+                lastDisplayedParams[params->textureIndex].reset();
+            }
+        }
     }
 
     //
@@ -3026,7 +3500,9 @@ ViewerInstance::onGammaChanged(double value)
     if (changed) {
         if ( (_imp->uiContext->getBitDepth() == eImageBitDepthByte)
              && !getApp()->getProject()->isLoadingProject() ) {
-            renderCurrentFrame(true);
+            if ( !refreshDisplayTransform() ) {
+                renderCurrentFrame(true);
+            }
         } else {
             _imp->uiContext->redraw();
         }
@@ -3059,7 +3535,9 @@ ViewerInstance::onGainChanged(double exp)
         assert(_imp->uiContext);
         if ( ( (_imp->uiContext->getBitDepth() == eImageBitDepthByte) )
              && !getApp()->getProject()->isLoadingProject() ) {
-            renderCurrentFrame(true);
+            if ( !refreshDisplayTransform() ) {
+                renderCurrentFrame(true);
+            }
         } else {
             _imp->uiContext->redraw();
         }
@@ -3132,7 +3610,9 @@ ViewerInstance::onColorSpaceChanged(ViewerColorSpaceEnum colorspace)
     assert(_imp->uiContext);
     if ( ( (_imp->uiContext->getBitDepth() == eImageBitDepthByte) )
          && !getApp()->getProject()->isLoadingProject() ) {
-        renderCurrentFrame(true);
+        if ( !refreshDisplayTransform() ) {
+            renderCurrentFrame(true);
+        }
     } else {
         _imp->uiContext->redraw();
     }
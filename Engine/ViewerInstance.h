@@ -61,6 +61,9 @@ public:
     bool userRoIEnabled;
     bool mustComputeRoDAndLookupCache;
     bool isDoingPartialUpdates;
+
+    ///If set, the request pass shared with the render of the other input of the same frame
+    SharedFrameRequestPtr sharedRequest;
 };
 
 class ViewerInstance
@@ -182,6 +185,14 @@ private:
                                              const RenderStatsPtr& stats,
                                              ViewerArgs* outArgs);
 
+    /**
+     * @brief Converts the source images of the displayed textures again with the current gain, gamma and colorspace,
+     * without going through the render tree. Only the tiles that are not found in the texture cache are converted.
+     * Returns false if a texture cannot be refreshed this way, in which case the frame must be rendered.
+     * Must be called on the main thread.
+     **/
+    bool refreshDisplayTransform();
+
 public:
 
 
@@ -216,6 +227,15 @@ public:
                                                      ViewerArgsPtr* argsA,
                                                      ViewerArgsPtr* argsB);
 
+    /**
+     * @brief Renders the textures of the frame at the given time in the viewer cache without displaying them, nor
+     * changing the textures currently displayed. This is used to pre-render the frames around the current frame.
+     * The render can be aborted with the abort info set on the calling thread.
+     * Returns true if anything was rendered, false if the textures were already cached or there is nothing to render.
+     * cacheBytes is set to the number of bytes the render allocated in the caches.
+     **/
+    bool renderViewerInCache(SequenceTime time, ViewIdx view, std::size_t* cacheBytes);
+
     void aboutToUpdateTextures();
 
     void updateViewer(UpdateViewerParamsPtr & frame);
@@ -147,6 +147,7 @@ public:
         , gammaLookup()
         , lastRenderParamsMutex()
         , lastRenderParams()
+        , lastDisplayedParams()
         , partialUpdateRects()
         , viewportCenter()
         , viewportCenterSet(false)
@@ -402,6 +403,10 @@ public:
     mutable QMutex lastRenderParamsMutex;
     UpdateViewerParamsPtr lastRenderParams[2];
 
+    // The last texture displayed for each input, kept when it can be converted again from its source images if only
+    // the gain, gamma or colorspace changes, see ViewerInstance::refreshDisplayTransform(). Protected by lastRenderParamsMutex
+    UpdateViewerParamsPtr lastDisplayedParams[2];
+
     /*
      * @brief If this list is not empty, this is the list of canonical rectangles we should update on the viewer, completely
      * disregarding the RoI. This is protected by viewerParamsMutex
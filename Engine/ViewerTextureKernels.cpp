@@ -0,0 +1,628 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ViewerTextureKernels.h"
+
+#include <algorithm> // min
+#include <cassert>
+
+#include "Engine/Lut.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && (_M_IX86_FP >= 2) )
+#define NATRON_VIEWER_KERNELS_SSE2
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif
+
+// The AVX2 kernels are compiled with the target attribute and selected at run-time, so that the binary still runs on CPUs without AVX2
+#if defined(NATRON_VIEWER_KERNELS_SSE2) && !defined(__INTEL_COMPILER) && \
+    ( defined(__clang__) || ( defined(__GNUC__) && ( (__GNUC__ > 4) || ( (__GNUC__ == 4) && (__GNUC_MINOR__ >= 9) ) ) ) )
+#define NATRON_VIEWER_KERNELS_AVX2
+#include <immintrin.h>
+#define NATRON_TARGET_AVX2 __attribute__( ( target("avx2") ) )
+#endif
+
+NATRON_NAMESPACE_ENTER
+namespace ViewerTextureKernels {
+static inline U32
+packBGRA(U32 r,
+         U32 g,
+         U32 b,
+         U32 a)
+{
+    return ( (a & 0xff) << 24 ) | ( (r & 0xff) << 16 ) | ( (g & 0xff) << 8 ) | (b & 0xff);
+}
+
+////////////////////////////////////////// Scalar //////////////////////////////////////////
+
+namespace Scalar {
+void
+applyGainOffsetRGBA(const float* src,
+                    int width,
+                    double gain,
+                    double offset,
+                    float* dst)
+{
+    for (int x = 0; x < width; ++x, src += 4, dst += 4) {
+        for (int c = 0; c < 3; ++c) {
+            double v = src[c];
+            v = v * gain + offset;
+            dst[c] = (float)v;
+        }
+        dst[3] = src[3];
+    }
+}
+
+void
+toBGRA8(const float* src,
+        int width,
+        double gain,
+        double offset,
+        bool opaque,
+        U32* dst)
+{
+    for (int x = 0; x < width; ++x, src += 4, ++dst) {
+        double r = src[0];
+        double g = src[1];
+        double b = src[2];
+        r = r * gain + offset;
+        g = g * gain + offset;
+        b = b * gain + offset;
+        int uA = opaque ? 255 : Color::floatToInt<256>(src[3]);
+        *dst = packBGRA( Color::floatToInt<256>(r), Color::floatToInt<256>(g), Color::floatToInt<256>(b), uA );
+    }
+}
+
+void
+toBGRA8Channels(const float* src,
+                int width,
+                double gain,
+                double offset,
+                bool opaque,
+                int rOffset,
+                int gOffset,
+                int bOffset,
+                int matteChannel,
+                U32* dst)
+{
+    for (int x = 0; x < width; ++x, src += 4, ++dst) {
+        double r = src[rOffset];
+        double g = src[gOffset];
+        double b = src[bOffset];
+        r = r * gain + offset;
+        g = g * gain + offset;
+        b = b * gain + offset;
+        int u[4];
+        u[0] = Color::floatToInt<256>(r);
+        u[1] = Color::floatToInt<256>(g);
+        u[2] = Color::floatToInt<256>(b);
+        u[3] = opaque ? 255 : Color::floatToInt<256>(src[3]);
+        U32 uR = (U8)u[0];
+        if (matteChannel >= 0) {
+            // As in the generic code, the 8-bit values are truncated, which matters for NaNs
+            U8 matteA = (U8)(u[matteChannel] / 2);
+            uR = std::min(uR + matteA, (U32)255);
+        }
+        *dst = packBGRA(uR, u[1], u[2], u[3]);
+    }
+}
+
+void
+copyRGBA32(const float* src,
+           int width,
+           bool opaque,
+           float* dst)
+{
+    for (int x = 0; x < width; ++x, src += 4, dst += 4) {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst[3] = opaque ? 1.f : src[3];
+    }
+}
+} // namespace Scalar
+
+////////////////////////////////////////// SSE2 //////////////////////////////////////////
+
+namespace SSE2 {
+#ifdef NATRON_VIEWER_KERNELS_SSE2
+
+// Same as Color::floatToInt<256> on 4 values, the result is masked to 8 bits
+static inline __m128i
+floatToInt256(__m128 v)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    __m128i i = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( v, _mm_set1_ps(255.f) ), _mm_set1_ps(0.5f) ) );
+    __m128i le0 = _mm_castps_si128( _mm_cmple_ps(v, zero) );
+    __m128i ge1 = _mm_castps_si128( _mm_cmpge_ps(v, one) );
+
+    i = _mm_andnot_si128(le0, i);
+    i = _mm_or_si128( _mm_andnot_si128(ge1, i), _mm_and_si128( ge1, _mm_set1_epi32(255) ) );
+
+    return _mm_and_si128( i, _mm_set1_epi32(0xff) );
+}
+
+// Computes (float)((double)v * gain + offset) on 4 values
+static inline __m128
+gainOffset(__m128 v,
+           __m128d gain,
+           __m128d offset)
+{
+    __m128d lo = _mm_cvtps_pd(v);
+    __m128d hi = _mm_cvtps_pd( _mm_movehl_ps(v, v) );
+
+    lo = _mm_add_pd(_mm_mul_pd(lo, gain), offset);
+    hi = _mm_add_pd(_mm_mul_pd(hi, gain), offset);
+
+    return _mm_movelh_ps( _mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi) );
+}
+
+bool
+isAvailable()
+{
+    return true;
+}
+
+void
+applyGainOffsetRGBA(const float* src,
+                    int width,
+                    double gain,
+                    double offset,
+                    float* dst)
+{
+    // Alpha goes through a*1+0 to avoid spurious floating point exceptions, its exact bits are restored with alphaMask
+    const __m128d gainRG = _mm_set1_pd(gain);
+    const __m128d offsetRG = _mm_set1_pd(offset);
+    const __m128d gainBA = _mm_set_pd(1., gain);
+    const __m128d offsetBA = _mm_set_pd(0., offset);
+    const __m128 alphaMask = _mm_castsi128_ps( _mm_set_epi32(-1, 0, 0, 0) );
+
+    for (int x = 0; x < width; ++x, src += 4, dst += 4) {
+        __m128 p = _mm_loadu_ps(src);
+        __m128d rg = _mm_add_pd(_mm_mul_pd(_mm_cvtps_pd(p), gainRG), offsetRG);
+        __m128d ba = _mm_add_pd(_mm_mul_pd(_mm_cvtps_pd( _mm_movehl_ps(p, p) ), gainBA), offsetBA);
+        __m128 res = _mm_movelh_ps( _mm_cvtpd_ps(rg), _mm_cvtpd_ps(ba) );
+        res = _mm_or_ps( _mm_andnot_ps(alphaMask, res), _mm_and_ps(alphaMask, p) );
+        _mm_storeu_ps(dst, res);
+    }
+}
+
+void
+toBGRA8(const float* src,
+        int width,
+        double gain,
+        double offset,
+        bool opaque,
+        U32* dst)
+{
+    const __m128d gainv = _mm_set1_pd(gain);
+    const __m128d offsetv = _mm_set1_pd(offset);
+    const __m128i opaqueAlpha = _mm_set1_epi32(255);
+    int x = 0;
+
+    for (; x + 4 <= width; x += 4, src += 16, dst += 4) {
+        __m128 r = _mm_loadu_ps(src);
+        __m128 g = _mm_loadu_ps(src + 4);
+        __m128 b = _mm_loadu_ps(src + 8);
+        __m128 a = _mm_loadu_ps(src + 12);
+        _MM_TRANSPOSE4_PS(r, g, b, a);
+
+        __m128i uR = floatToInt256( gainOffset(r, gainv, offsetv) );
+        __m128i uG = floatToInt256( gainOffset(g, gainv, offsetv) );
+        __m128i uB = floatToInt256( gainOffset(b, gainv, offsetv) );
+        __m128i uA = opaque ? opaqueAlpha : floatToInt256(a);
+        __m128i packed = _mm_or_si128( _mm_or_si128( _mm_slli_epi32(uA, 24), _mm_slli_epi32(uR, 16) ),
+                                       _mm_or_si128( _mm_slli_epi32(uG, 8), uB ) );
+        _mm_storeu_si128( (__m128i*)dst, packed );
+    }
+    Scalar::toBGRA8(src, width - x, gain, offset, opaque, dst);
+}
+
+void
+toBGRA8Channels(const float* src,
+                int width,
+                double gain,
+                double offset,
+                bool opaque,
+                int rOffset,
+                int gOffset,
+                int bOffset,
+                int matteChannel,
+                U32* dst)
+{
+    const __m128d gainv = _mm_set1_pd(gain);
+    const __m128d offsetv = _mm_set1_pd(offset);
+    const __m128i opaqueAlpha = _mm_set1_epi32(255);
+    int x = 0;
+
+    for (; x + 4 <= width; x += 4, src += 16, dst += 4) {
+        __m128 c[4];
+        c[0] = _mm_loadu_ps(src);
+        c[1] = _mm_loadu_ps(src + 4);
+        c[2] = _mm_loadu_ps(src + 8);
+        c[3] = _mm_loadu_ps(src + 12);
+        _MM_TRANSPOSE4_PS(c[0], c[1], c[2], c[3]);
+
+        __m128i u[4];
+        u[0] = floatToInt256( gainOffset(c[rOffset], gainv, offsetv) );
+        u[1] = floatToInt256( gainOffset(c[gOffset], gainv, offsetv) );
+        u[2] = floatToInt256( gainOffset(c[bOffset], gainv, offsetv) );
+        u[3] = opaque ? opaqueAlpha : floatToInt256(c[3]);
+        if (matteChannel >= 0) {
+            // The values are below 512: the 16-bit minimum is the 32-bit minimum
+            u[0] = _mm_min_epi16( _mm_add_epi32( u[0], _mm_srli_epi32(u[matteChannel], 1) ), opaqueAlpha );
+        }
+        __m128i packed = _mm_or_si128( _mm_or_si128( _mm_slli_epi32(u[3], 24), _mm_slli_epi32(u[0], 16) ),
+                                       _mm_or_si128( _mm_slli_epi32(u[1], 8), u[2] ) );
+        _mm_storeu_si128( (__m128i*)dst, packed );
+    }
+    Scalar::toBGRA8Channels(src, width - x, gain, offset, opaque, rOffset, gOffset, bOffset, matteChannel, dst);
+}
+
+void
+copyRGBA32(const float* src,
+           int width,
+           bool opaque,
+           float* dst)
+{
+    const __m128 alphaMask = _mm_castsi128_ps( _mm_set_epi32(-1, 0, 0, 0) );
+    const __m128 opaqueAlpha = _mm_set_ps(1.f, 0.f, 0.f, 0.f);
+
+    if (!opaque) {
+        for (int x = 0; x < width; ++x, src += 4, dst += 4) {
+            _mm_storeu_ps( dst, _mm_loadu_ps(src) );
+        }
+
+        return;
+    }
+    for (int x = 0; x < width; ++x, src += 4, dst += 4) {
+        _mm_storeu_ps( dst, _mm_or_ps( _mm_andnot_ps( alphaMask, _mm_loadu_ps(src) ), opaqueAlpha ) );
+    }
+}
+
+#else // !NATRON_VIEWER_KERNELS_SSE2
+
+bool
+isAvailable()
+{
+    return false;
+}
+
+void
+applyGainOffsetRGBA(const float* src,
+                    int width,
+                    double gain,
+                    double offset,
+                    float* dst)
+{
+    Scalar::applyGainOffsetRGBA(src, width, gain, offset, dst);
+}
+
+void
+toBGRA8(const float* src,
+        int width,
+        double gain,
+        double offset,
+        bool opaque,
+        U32* dst)
+{
+    Scalar::toBGRA8(src, width, gain, offset, opaque, dst);
+}
+
+void
+toBGRA8Channels(const float* src,
+                int width,
+                double gain,
+                double offset,
+                bool opaque,
+                int rOffset,
+                int gOffset,
+                int bOffset,
+                int matteChannel,
+                U32* dst)
+{
+    Scalar::toBGRA8Channels(src, width, gain, offset, opaque, rOffset, gOffset, bOffset, matteChannel, dst);
+}
+
+void
+copyRGBA32(const float* src,
+           int width,
+           bool opaque,
+           float* dst)
+{
+    Scalar::copyRGBA32(src, width, opaque, dst);
+}
+
+#endif // NATRON_VIEWER_KERNELS_SSE2
+} // namespace SSE2
+
+////////////////////////////////////////// AVX2 //////////////////////////////////////////
+
+namespace AVX2 {
+#ifdef NATRON_VIEWER_KERNELS_AVX2
+
+static bool
+detectAVX2()
+{
+    __builtin_cpu_init();
+
+    return __builtin_cpu_supports("avx2");
+}
+
+// Same as Color::floatToInt<256> on 8 values, the result is masked to 8 bits
+static inline NATRON_TARGET_AVX2 __m256i
+floatToInt256(__m256 v)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.f);
+    __m256i i = _mm256_cvttps_epi32( _mm256_add_ps( _mm256_mul_ps( v, _mm256_set1_ps(255.f) ), _mm256_set1_ps(0.5f) ) );
+    __m256i le0 = _mm256_castps_si256( _mm256_cmp_ps(v, zero, _CMP_LE_OQ) );
+    __m256i ge1 = _mm256_castps_si256( _mm256_cmp_ps(v, one, _CMP_GE_OQ) );
+
+    i = _mm256_andnot_si256(le0, i);
+    i = _mm256_or_si256( _mm256_andnot_si256(ge1, i), _mm256_and_si256( ge1, _mm256_set1_epi32(255) ) );
+
+    return _mm256_and_si256( i, _mm256_set1_epi32(0xff) );
+}
+
+// Computes (float)((double)v * gain + offset) on 8 values
+static inline NATRON_TARGET_AVX2 __m256
+gainOffset(__m128 lo,
+           __m128 hi,
+           __m256d gain,
+           __m256d offset)
+{
+    __m256d dlo = _mm256_add_pd(_mm256_mul_pd(_mm256_cvtps_pd(lo), gain), offset);
+    __m256d dhi = _mm256_add_pd(_mm256_mul_pd(_mm256_cvtps_pd(hi), gain), offset);
+
+    return _mm256_insertf128_ps(_mm256_castps128_ps256( _mm256_cvtpd_ps(dlo) ), _mm256_cvtpd_ps(dhi), 1);
+}
+
+bool
+isAvailable()
+{
+    static const bool hasAVX2 = detectAVX2();
+
+    return hasAVX2;
+}
+
+NATRON_TARGET_AVX2
+void
+applyGainOffsetRGBA(const float* src,
+                    int width,
+                    double gain,
+                    double offset,
+                    float* dst)
+{
+    // Alpha goes through a*1+0 to avoid spurious floating point exceptions, its exact bits are restored by the blend
+    const __m256d gainv = _mm256_set_pd(1., gain, gain, gain);
+    const __m256d offsetv = _mm256_set_pd(0., offset, offset, offset);
+
+    for (int x = 0; x < width; ++x, src += 4, dst += 4) {
+        __m128 p = _mm_loadu_ps(src);
+        __m128 res = _mm256_cvtpd_ps( _mm256_add_pd(_mm256_mul_pd(_mm256_cvtps_pd(p), gainv), offsetv) );
+        _mm_storeu_ps( dst, _mm_blend_ps(res, p, 0x8) );
+    }
+}
+
+NATRON_TARGET_AVX2
+void
+toBGRA8(const float* src,
+        int width,
+        double gain,
+        double offset,
+        bool opaque,
+        U32* dst)
+{
+    const __m256d gainv = _mm256_set1_pd(gain);
+    const __m256d offsetv = _mm256_set1_pd(offset);
+    const __m256i opaqueAlpha = _mm256_set1_epi32(255);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8, src += 32, dst += 8) {
+        __m128 r0 = _mm_loadu_ps(src);
+        __m128 g0 = _mm_loadu_ps(src + 4);
+        __m128 b0 = _mm_loadu_ps(src + 8);
+        __m128 a0 = _mm_loadu_ps(src + 12);
+        _MM_TRANSPOSE4_PS(r0, g0, b0, a0);
+        __m128 r1 = _mm_loadu_ps(src + 16);
+        __m128 g1 = _mm_loadu_ps(src + 20);
+        __m128 b1 = _mm_loadu_ps(src + 24);
+        __m128 a1 = _mm_loadu_ps(src + 28);
+        _MM_TRANSPOSE4_PS(r1, g1, b1, a1);
+
+        __m256i uR = floatToInt256( gainOffset(r0, r1, gainv, offsetv) );
+        __m256i uG = floatToInt256( gainOffset(g0, g1, gainv, offsetv) );
+        __m256i uB = floatToInt256( gainOffset(b0, b1, gainv, offsetv) );
+        __m256i uA = opaque ? opaqueAlpha : floatToInt256( _mm256_insertf128_ps(_mm256_castps128_ps256(a0), a1, 1) );
+        __m256i packed = _mm256_or_si256( _mm256_or_si256( _mm256_slli_epi32(uA, 24), _mm256_slli_epi32(uR, 16) ),
+                                          _mm256_or_si256( _mm256_slli_epi32(uG, 8), uB ) );
+        _mm256_storeu_si256( (__m256i*)dst, packed );
+    }
+    SSE2::toBGRA8(src, width - x, gain, offset, opaque, dst);
+}
+
+NATRON_TARGET_AVX2
+void
+toBGRA8Channels(const float* src,
+                int width,
+                double gain,
+                double offset,
+                bool opaque,
+                int rOffset,
+                int gOffset,
+                int bOffset,
+                int matteChannel,
+                U32* dst)
+{
+    const __m256d gainv = _mm256_set1_pd(gain);
+    const __m256d offsetv = _mm256_set1_pd(offset);
+    const __m256i opaqueAlpha = _mm256_set1_epi32(255);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8, src += 32, dst += 8) {
+        __m128 c0[4], c1[4];
+        c0[0] = _mm_loadu_ps(src);
+        c0[1] = _mm_loadu_ps(src + 4);
+        c0[2] = _mm_loadu_ps(src + 8);
+        c0[3] = _mm_loadu_ps(src + 12);
+        _MM_TRANSPOSE4_PS(c0[0], c0[1], c0[2], c0[3]);
+        c1[0] = _mm_loadu_ps(src + 16);
+        c1[1] = _mm_loadu_ps(src + 20);
+        c1[2] = _mm_loadu_ps(src + 24);
+        c1[3] = _mm_loadu_ps(src + 28);
+        _MM_TRANSPOSE4_PS(c1[0], c1[1], c1[2], c1[3]);
+
+        __m256i u[4];
+        u[0] = floatToInt256( gainOffset(c0[rOffset], c1[rOffset], gainv, offsetv) );
+        u[1] = floatToInt256( gainOffset(c0[gOffset], c1[gOffset], gainv, offsetv) );
+        u[2] = floatToInt256( gainOffset(c0[bOffset], c1[bOffset], gainv, offsetv) );
+        u[3] = opaque ? opaqueAlpha : floatToInt256( _mm256_insertf128_ps(_mm256_castps128_ps256(c0[3]), c1[3], 1) );
+        if (matteChannel >= 0) {
+            u[0] = _mm256_min_epi32( _mm256_add_epi32( u[0], _mm256_srli_epi32(u[matteChannel], 1) ), opaqueAlpha );
+        }
+        __m256i packed = _mm256_or_si256( _mm256_or_si256( _mm256_slli_epi32(u[3], 24), _mm256_slli_epi32(u[0], 16) ),
+                                          _mm256_or_si256( _mm256_slli_epi32(u[1], 8), u[2] ) );
+        _mm256_storeu_si256( (__m256i*)dst, packed );
+    }
+    SSE2::toBGRA8Channels(src, width - x, gain, offset, opaque, rOffset, gOffset, bOffset, matteChannel, dst);
+}
+
+#else // !NATRON_VIEWER_KERNELS_AVX2
+
+bool
+isAvailable()
+{
+    return false;
+}
+
+void
+applyGainOffsetRGBA(const float* src,
+                    int width,
+                    double gain,
+                    double offset,
+                    float* dst)
+{
+    SSE2::applyGainOffsetRGBA(src, width, gain, offset, dst);
+}
+
+void
+toBGRA8(const float* src,
+        int width,
+        double gain,
+        double offset,
+        bool opaque,
+        U32* dst)
+{
+    SSE2::toBGRA8(src, width, gain, offset, opaque, dst);
+}
+
+void
+toBGRA8Channels(const float* src,
+                int width,
+                double gain,
+                double offset,
+                bool opaque,
+                int rOffset,
+                int gOffset,
+                int bOffset,
+                int matteChannel,
+                U32* dst)
+{
+    SSE2::toBGRA8Channels(src, width, gain, offset, opaque, rOffset, gOffset, bOffset, matteChannel, dst);
+}
+
+#endif // NATRON_VIEWER_KERNELS_AVX2
+} // namespace AVX2
+
+////////////////////////////////////////// Dispatch //////////////////////////////////////////
+
+void
+applyGainOffsetRGBA(const float* src,
+                    int width,
+                    double gain,
+                    double offset,
+                    float* dst)
+{
+    assert(src && dst && width >= 0);
+    if ( AVX2::isAvailable() ) {
+        AVX2::applyGainOffsetRGBA(src, width, gain, offset, dst);
+    } else {
+        SSE2::applyGainOffsetRGBA(src, width, gain, offset, dst);
+    }
+}
+
+void
+toBGRA8(const float* src,
+        int width,
+        double gain,
+        double offset,
+        bool opaque,
+        U32* dst)
+{
+    assert(src && dst && width >= 0);
+    if ( AVX2::isAvailable() ) {
+        AVX2::toBGRA8(src, width, gain, offset, opaque, dst);
+    } else {
+        SSE2::toBGRA8(src, width, gain, offset, opaque, dst);
+    }
+}
+
+void
+toBGRA8Channels(const float* src,
+                int width,
+                double gain,
+                double offset,
+                bool opaque,
+                int rOffset,
+                int gOffset,
+                int bOffset,
+                int matteChannel,
+                U32* dst)
+{
+    assert(src && dst && width >= 0);
+    assert(rOffset >= 0 && rOffset < 4 && gOffset >= 0 && gOffset < 4 && bOffset >= 0 && bOffset < 4);
+    assert(matteChannel >= -1 && matteChannel < 4);
+    if ( AVX2::isAvailable() ) {
+        AVX2::toBGRA8Channels(src, width, gain, offset, opaque, rOffset, gOffset, bOffset, matteChannel, dst);
+    } else {
+        SSE2::toBGRA8Channels(src, width, gain, offset, opaque, rOffset, gOffset, bOffset, matteChannel, dst);
+    }
+}
+
+void
+copyRGBA32(const float* src,
+           int width,
+           bool opaque,
+           float* dst)
+{
+    assert(src && dst && width >= 0);
+    // A copy is memory bound, AVX2 would not help here
+    SSE2::copyRGBA32(src, width, opaque, dst);
+}
+} // namespace ViewerTextureKernels
+
+NATRON_NAMESPACE_EXIT
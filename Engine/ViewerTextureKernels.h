@@ -0,0 +1,97 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_VIEWERTEXTUREKERNELS_H
+#define NATRON_ENGINE_VIEWERTEXTUREKERNELS_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+#include "Global/GlobalDefines.h"
+
+///
+/// Row kernels used by the viewer to convert RGBA float images to its textures, for the most common cases
+/// (no input color-space, no gamma, no luminance display, the matte overlay if it is a channel of the displayed image).
+/// They compute exactly what the generic per-pixel code of ViewerInstance.cpp computes: the arithmetic is
+/// done in double precision as in the generic code, so that the vectorized versions give the same output bit for bit.
+///
+
+NATRON_NAMESPACE_ENTER
+namespace ViewerTextureKernels {
+/**
+ * @brief Applies gain and offset to the r,g,b channels of a row of RGBA pixels:
+ * dst[4*x+c] = (float)(src[4*x+c] * gain + offset). Alpha is copied unchanged.
+ * This is what the 8-bit texture conversion does before the look-up in the display color-space.
+ **/
+void applyGainOffsetRGBA(const float* src, int width, double gain, double offset, float* dst);
+
+/**
+ * @brief Converts a row of RGBA pixels to BGRA 8-bit without color-space conversion:
+ * gain and offset are applied to r,g,b which are then quantized with Color::floatToInt<256>.
+ * Alpha is quantized the same way, or set to 255 if opaque is true.
+ **/
+void toBGRA8(const float* src, int width, double gain, double offset, bool opaque, U32* dst);
+
+/**
+ * @brief Same as toBGRA8, but r,g,b are read from the channels rOffset, gOffset and bOffset (0 to 3) of the source,
+ * as when a single channel is displayed. If matteChannel is not -1, the matte overlay is applied: half the
+ * 8-bit value of the output channel matteChannel (0 to 2 for r,g,b, 3 for alpha) is added to red.
+ **/
+void toBGRA8Channels(const float* src, int width, double gain, double offset, bool opaque,
+                     int rOffset, int gOffset, int bOffset, int matteChannel, U32* dst);
+
+/**
+ * @brief Copies a row of RGBA pixels to the 32-bit float texture, alpha is set to 1 if opaque is true.
+ **/
+void copyRGBA32(const float* src, int width, bool opaque, float* dst);
+
+///The functions above dispatch at run-time to the fastest of the implementations below available on the CPU.
+namespace Scalar {
+void applyGainOffsetRGBA(const float* src, int width, double gain, double offset, float* dst);
+void toBGRA8(const float* src, int width, double gain, double offset, bool opaque, U32* dst);
+void toBGRA8Channels(const float* src, int width, double gain, double offset, bool opaque,
+                     int rOffset, int gOffset, int bOffset, int matteChannel, U32* dst);
+void copyRGBA32(const float* src, int width, bool opaque, float* dst);
+}
+
+namespace SSE2 {
+bool isAvailable();
+void applyGainOffsetRGBA(const float* src, int width, double gain, double offset, float* dst);
+void toBGRA8(const float* src, int width, double gain, double offset, bool opaque, U32* dst);
+void toBGRA8Channels(const float* src, int width, double gain, double offset, bool opaque,
+                     int rOffset, int gOffset, int bOffset, int matteChannel, U32* dst);
+void copyRGBA32(const float* src, int width, bool opaque, float* dst);
+}
+
+namespace AVX2 {
+bool isAvailable();
+void applyGainOffsetRGBA(const float* src, int width, double gain, double offset, float* dst);
+void toBGRA8(const float* src, int width, double gain, double offset, bool opaque, U32* dst);
+void toBGRA8Channels(const float* src, int width, double gain, double offset, bool opaque,
+                     int rOffset, int gOffset, int bOffset, int matteChannel, U32* dst);
+}
+} // namespace ViewerTextureKernels
+
+NATRON_NAMESPACE_EXIT
+
+#endif // NATRON_ENGINE_VIEWERTEXTUREKERNELS_H
@@ -468,6 +468,13 @@ enum StorageModeEnum
     eStorageModeGLTex //< will be allocated as an OpenGL texture
 };
 
+enum CacheCompressionEnum
+{
+    eCacheCompressionNone = 0, //< entries are written to disk as they are in memory
+    eCacheCompressionLossless, //< entries are compressed without loss when written to disk
+    eCacheCompressionHalfFloat //< 32-bit floating point entries are converted to 16-bit floating point and compressed, other depths are compressed without loss
+};
+
 enum OrientationEnum
 {
     eOrientationHorizontal = 0x1,
@@ -58,6 +58,7 @@ NATRON_NAMESPACE_EXIT
 
 #endif
 
+#include <QtCore/QAtomicInt>
 #include <QtCore/QString>
 #include <QtCore/QUrl>
 #include <QtCore/QFileInfo>
@@ -92,6 +93,17 @@ inline QUrl
 toLocalFileUrlFixed(const QUrl& url) { return url; }
 
 #endif // #if defined(Q_OS_MAC) && QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+
+// QAtomicInt::loadAcquire() appeared in Qt 5, Qt 4 only has the fetch-and-op operations
+inline int
+loadAcquire(const QAtomicInt& value)
+{
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+    return const_cast<QAtomicInt&>(value).fetchAndAddAcquire(0);
+#else
+    return value.loadAcquire();
+#endif
+}
 } // namespace QtCompat
 
 NATRON_NAMESPACE_EXIT
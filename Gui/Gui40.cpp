@@ -52,6 +52,7 @@
 #include "Engine/Node.h"
 #include "Engine/Project.h"
 #include "Engine/ProcessHandler.h"
+#include "Engine/RenderTrace.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/ViewerInstance.h"
 
@@ -906,6 +907,8 @@ Gui::setRenderStatsEnabled(bool enabled)
         QMutexLocker k(&_imp->areRenderStatsEnabledMutex);
         _imp->areRenderStatsEnabled = enabled;
     }
+    // The trace is recorded as long as render statistics are enabled, and can be saved from the dialog
+    RenderTrace::setEnabled(enabled);
     _imp->enableRenderStats->setChecked(enabled);
 }
 
@@ -36,7 +36,9 @@
 #include <QItemSelectionModel>
 #include <QtCore/QRegExp>
 
+#include "Engine/AppManager.h" // Dialogs
 #include "Engine/Node.h"
+#include "Engine/RenderTrace.h"
 #include "Engine/Timer.h"
 #include "Engine/Utils.h" // convertFromPlainText
 #include "Engine/ViewIdx.h"
@@ -46,6 +48,7 @@
 #include "Gui/Label.h"
 #include "Gui/LineEdit.h"
 #include "Gui/NodeGui.h"
+#include "Gui/SequenceFileDialog.h"
 #include "Gui/TableModelView.h"
 
 
@@ -705,6 +708,7 @@ struct RenderStatsDialogPrivate
     Label* totalTimeSpentValueLabel;
     double totalSpentTime;
     Button* resetButton;
+    Button* saveTraceButton;
     QWidget* filterContainer;
     QHBoxLayout* filterLayout;
     Label* filtersLabel;
@@ -731,6 +735,7 @@ struct RenderStatsDialogPrivate
         , totalTimeSpentValueLabel(0)
         , totalSpentTime(0)
         , resetButton(0)
+        , saveTraceButton(0)
         , filterContainer(0)
         , filterLayout(0)
         , filtersLabel(0)
@@ -816,6 +821,13 @@ RenderStatsDialog::RenderStatsDialog(Gui* gui)
     QObject::connect( _imp->resetButton, SIGNAL(clicked(bool)), this, SLOT(resetStats()) );
     _imp->globalInfosLayout->addWidget(_imp->resetButton);
 
+    _imp->saveTraceButton = new Button(tr("Save Trace..."), _imp->globalInfosContainer);
+    _imp->saveTraceButton->setToolTip( NATRON_NAMESPACE::convertFromPlainText(tr("Saves the time spent by each thread in each node and action "
+                                                                                 "since the statistics were reset, in the Chrome trace-event format.\n"
+                                                                                 "It can be opened in chrome://tracing, Perfetto or speedscope."), NATRON_NAMESPACE::WhiteSpaceNormal) );
+    QObject::connect( _imp->saveTraceButton, SIGNAL(clicked(bool)), this, SLOT(saveTrace()) );
+    _imp->globalInfosLayout->addWidget(_imp->saveTraceButton);
+
     _imp->globalInfosLayout->addStretch();
 
     _imp->mainLayout->addWidget(_imp->globalInfosContainer);
@@ -973,6 +985,26 @@ RenderStatsDialog::resetStats()
     _imp->model->clearRows();
     _imp->totalTimeSpentValueLabel->setText( QString::fromUtf8("0.0 sec") );
     _imp->totalSpentTime = 0;
+    RenderTrace::clear();
+}
+
+void
+RenderStatsDialog::saveTrace()
+{
+    std::vector<std::string> filters;
+
+    filters.push_back("json");
+    SequenceFileDialog dialog(this, filters, false, SequenceFileDialog::eFileDialogModeSave, "", _imp->gui, false);
+    if ( !dialog.exec() ) {
+        return;
+    }
+    std::string filePath = dialog.filesToSave();
+    if ( filePath.empty() ) {
+        return;
+    }
+    if ( !RenderTrace::writeChromeTraceFile(filePath) ) {
+        Dialogs::errorDialog( tr("Save Trace").toStdString(), tr("Failure to write render trace file %1.").arg( QString::fromUtf8( filePath.c_str() ) ).toStdString() );
+    }
 }
 
 void
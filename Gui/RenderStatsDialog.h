@@ -67,6 +67,7 @@ public:
 public Q_SLOTS:
 
     void resetStats();
+    void saveTrace();
     void refreshAdvancedColsVisibility();
     void onSelectionChanged(const QItemSelection &selected, const QItemSelection &deselected);
 
@@ -25,11 +25,17 @@
 
 #include "Global/Macros.h"
 
+#include <algorithm> // max
 #include <cstdlib>
+#include <iostream>
+#include <set>
+#include <vector>
 
 #include "BaseTest.h"
 
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QFile>
+#include <QtCore/QThread>
 #include <QtCore/QThreadPool>
 
 // ofxhPropertySuite.h:565:37: warning: 'this' pointer cannot be null in well-defined C++ code; comparison may be assumed to always evaluate to true [-Wtautological-undefined-compare]
@@ -53,6 +59,8 @@ CLANG_DIAG_ON(unknown-pragmas)
 #include "Engine/EffectInstance.h"
 #include "Engine/Plugin.h"
 #include "Engine/Curve.h"
+#include "Engine/Hash64.h"
+#include "Engine/NativeExpression.h"
 #include "Engine/CLArgs.h"
 #include "Engine/ViewIdx.h"
 
@@ -306,6 +314,144 @@ TEST_F(BaseTest, SetValues)
     }
 }
 
+TEST_F(BaseTest, KnobHashExpressionCycle)
+{
+    NodePtr generator = createNode(_generatorPluginID);
+
+    assert(generator);
+    KnobIPtr noiseZ = generator->getKnobByName("noiseZ");
+    KnobIPtr noiseZSlope = generator->getKnobByName("noiseZSlope");
+    ASSERT_TRUE(noiseZ && noiseZSlope);
+
+    // The expressions reference each other: the content hash must not recurse forever and must be stable
+    noiseZSlope->setExpression(0, "thisNode.noiseZ.get()", false, false);
+    noiseZ->setExpression(0, "thisNode.noiseZSlope.get()", false, false);
+
+    Hash64 hash1, hash2;
+    std::set<KnobI*> visitedKnobs1, visitedKnobs2;
+    noiseZSlope->appendToHash(&hash1, &visitedKnobs1);
+    hash1.computeHash();
+    noiseZSlope->appendToHash(&hash2, &visitedKnobs2);
+    hash2.computeHash();
+    EXPECT_EQ( hash1.value(), hash2.value() );
+}
+
+TEST_F(BaseTest, NativeExpressionSibling)
+{
+    NodePtr generator = createNode(_generatorPluginID);
+    NodePtr generator2 = createNode(_generatorPluginID);
+
+    ASSERT_TRUE(generator && generator2);
+    KnobIPtr noiseZ = generator->getKnobByName("noiseZ");
+    ASSERT_TRUE(noiseZ);
+    KnobHelper* helper = dynamic_cast<KnobHelper*>( noiseZ.get() );
+    ASSERT_TRUE(helper);
+
+    noiseZ->setExpression(0, generator2->getScriptName_mt_safe() + ".noiseZ.get() + 1", false, false);
+    NativeExpressionPtr native = helper->getNativeExpression(0);
+    ASSERT_TRUE(native);
+    double value;
+    bool isInt;
+    EXPECT_TRUE( native->evaluate(helper, 0, ViewIdx(0), &value, &isInt) );
+
+    // Python no longer finds the node by its script-name: the evaluation is left to Python
+    generator2->deactivate(std::list<NodePtr>(), true, false, false, false);
+    EXPECT_FALSE( native->evaluate(helper, 0, ViewIdx(0), &value, &isInt) );
+    generator2->activate(std::list<NodePtr>(), true, false);
+    EXPECT_TRUE( native->evaluate(helper, 0, ViewIdx(0), &value, &isInt) );
+}
+
+TEST_F(BaseTest, NativeExpressionIntOverflow)
+{
+    NodePtr generator = createNode(_generatorPluginID);
+
+    ASSERT_TRUE(generator);
+    KnobIPtr noiseZ = generator->getKnobByName("noiseZ");
+    KnobIPtr noiseZSlope = generator->getKnobByName("noiseZSlope");
+    ASSERT_TRUE(noiseZ && noiseZSlope);
+
+    // An int result which does not fit in an int is converted by Python, as when the expression is not compiled
+    noiseZ->setExpression(0, "2 ** 40 + frame", false, false);
+    noiseZSlope->setExpression(0, "ret = 2 ** 40 + frame", true, false);
+    for (int frame = 0; frame < 3; ++frame) {
+        EXPECT_EQ( noiseZSlope->getValueAtWithExpression(frame, ViewIdx(0), 0), noiseZ->getValueAtWithExpression(frame, ViewIdx(0), 0) );
+    }
+}
+
+// Evaluates the expression of a knob at different frames
+class ExpressionEvaluationThread
+    : public QThread
+{
+public:
+
+    ExpressionEvaluationThread(const KnobIPtr& knob,
+                               int firstFrame,
+                               int nFrames)
+        : QThread()
+        , _knob(knob)
+        , _firstFrame(firstFrame)
+        , _nFrames(nFrames)
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        for (int i = 0; i < _nFrames; ++i) {
+            double value = _knob->getValueAtWithExpression(_firstFrame + i, ViewIdx(0), 0);
+            Q_UNUSED(value);
+        }
+        appPTR->getAppTLS()->cleanupTLSForThread();
+    }
+
+    KnobIPtr _knob;
+    int _firstFrame;
+    int _nFrames;
+};
+
+// Times the evaluation of the same expression natively and by Python from several threads
+TEST_F(BaseTest, NativeExpressionSpeed)
+{
+    NodePtr generator = createNode(_generatorPluginID);
+
+    ASSERT_TRUE(generator);
+    KnobIPtr noiseZ = generator->getKnobByName("noiseZ");
+    KnobIPtr noiseZSlope = generator->getKnobByName("noiseZSlope");
+    ASSERT_TRUE(noiseZ && noiseZSlope);
+
+    noiseZ->setExpression(0, "sin(frame * 0.1) * 2 + thisNode.noiseZSlope.getValueAtTime(frame - 1)", false, false);
+    noiseZSlope->setExpression(0, "ret = frame * 0.5", true, false);
+    ASSERT_TRUE( dynamic_cast<KnobHelper*>( noiseZ.get() )->getNativeExpression(0) );
+    ASSERT_FALSE( dynamic_cast<KnobHelper*>( noiseZSlope.get() )->getNativeExpression(0) );
+
+    const int nFramesPerThread = 2000;
+    int firstFrame = 0;
+    for (int nThreads = 1; nThreads <= 8; nThreads *= 2) {
+        qint64 elapsed[2];
+        for (int python = 0; python < 2; ++python) {
+            std::vector<ExpressionEvaluationThread*> threads;
+            for (int i = 0; i < nThreads; ++i) {
+                // Different frames each time, so that no value comes from the cache of the expression results
+                threads.push_back( new ExpressionEvaluationThread(python ? noiseZSlope : noiseZ, firstFrame, nFramesPerThread) );
+                firstFrame += nFramesPerThread;
+            }
+            QElapsedTimer timer;
+            timer.start();
+            for (int i = 0; i < nThreads; ++i) {
+                threads[i]->start();
+            }
+            for (int i = 0; i < nThreads; ++i) {
+                threads[i]->wait();
+                delete threads[i];
+            }
+            elapsed[python] = std::max( timer.nsecsElapsed(), (qint64)1 );
+        }
+        std::cout << nThreads << " threads: native " << (double)nThreads * nFramesPerThread * 1e9 / elapsed[0]
+                  << " evaluations per second, Python " << (double)nThreads * nFramesPerThread * 1e9 / elapsed[1] << std::endl;
+    }
+}
+
 ///High level test: simple node connections test
 TEST_F(BaseTest, SimpleNodeConnections) {
     ///create the generator
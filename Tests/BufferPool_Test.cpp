@@ -0,0 +1,98 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <gtest/gtest.h>
+
+#include "Engine/BufferPool.h"
+
+NATRON_NAMESPACE_USING
+
+TEST(BufferPool, SizeClasses) {
+    // Small buffers are not handled by the pool
+    EXPECT_EQ( (std::size_t)100, BufferPool::getCapacity(100) );
+    EXPECT_EQ( (std::size_t)1 << NATRON_BUFFER_POOL_MIN_SIZE_LOG2, BufferPool::getCapacity( (std::size_t)1 << NATRON_BUFFER_POOL_MIN_SIZE_LOG2 ) );
+
+    // Powers of two are size classes
+    EXPECT_EQ( (std::size_t)1 << 20, BufferPool::getCapacity( (std::size_t)1 << 20 ) );
+
+    std::size_t prev = 0;
+    for (std::size_t n = ( (std::size_t)1 << NATRON_BUFFER_POOL_MIN_SIZE_LOG2 ) + 1; n < ( (std::size_t)1 << 24 ); n += 997) {
+        std::size_t capacity = BufferPool::getCapacity(n);
+        ASSERT_GE(capacity, n);
+        ASSERT_LE(capacity, n + n / 8 + 1);
+        ASSERT_GE(capacity, prev);
+        ASSERT_EQ( capacity, BufferPool::getCapacity(capacity) );
+        prev = capacity;
+    }
+}
+
+TEST(BufferPool, Reuse) {
+    const std::size_t maxRetained = BufferPool::getMaximumRetainedSize();
+
+    BufferPool::releaseRetainedBuffers();
+    BufferPool::setMaximumRetainedSize(10 << 20);
+
+    BufferPool::Stats before;
+    BufferPool::getStats(&before);
+
+    std::size_t capacity;
+    void* buffer = BufferPool::allocate(1000000, &capacity);
+    ASSERT_TRUE(buffer != 0);
+    BufferPool::deallocate(buffer, capacity);
+
+    BufferPool::Stats stats;
+    BufferPool::getStats(&stats);
+    EXPECT_EQ(capacity, stats.retainedBytes);
+
+    // A buffer of a close size is served from the pool
+    std::size_t otherCapacity;
+    void* other = BufferPool::allocate(999000, &otherCapacity);
+    EXPECT_EQ(buffer, other);
+    EXPECT_EQ(capacity, otherCapacity);
+    BufferPool::getStats(&stats);
+    EXPECT_EQ( (std::size_t)0, stats.retainedBytes );
+    EXPECT_EQ(before.nReused + 1, stats.nReused);
+    BufferPool::deallocate(other, otherCapacity);
+
+    // Buffers beyond the maximum retained size are freed
+    void* large = BufferPool::allocate(5000000, &capacity);
+    BufferPool::deallocate(large, capacity);
+    large = BufferPool::allocate(8000000, &capacity);
+    BufferPool::deallocate(large, capacity);
+    BufferPool::getStats(&stats);
+    EXPECT_LE( stats.retainedBytes, (std::size_t)10 << 20 );
+
+    BufferPool::setMaximumRetainedSize(2 << 20);
+    BufferPool::getStats(&stats);
+    EXPECT_LE( stats.retainedBytes, (std::size_t)2 << 20 );
+
+    BufferPool::releaseRetainedBuffers();
+    BufferPool::getStats(&stats);
+    EXPECT_EQ( (std::size_t)0, stats.retainedBytes );
+
+    BufferPool::setMaximumRetainedSize(maxRetained);
+}
@@ -0,0 +1,349 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <algorithm> // max
+#include <cmath>
+#include <cstring> // memcmp, memcpy
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFileInfo>
+
+#include "Engine/CacheCompression.h"
+#include "Engine/CacheEntry.h"
+#include "Engine/StandardPaths.h"
+
+NATRON_NAMESPACE_USING
+
+// A smooth RGBA float image spanning several compression blocks
+static void
+makeFloatImage(int width,
+               int height,
+               std::vector<float>* pixels)
+{
+    pixels->resize(width * height * 4);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            float* p = &(*pixels)[(y * width + x) * 4];
+            p[0] = (float)x / width;
+            p[1] = (float)y / height;
+            p[2] = 0.5f + 0.25f * std::sin(x * 0.05f) * std::cos(y * 0.03f);
+            p[3] = 1.f;
+        }
+    }
+}
+
+TEST(CacheCompression, Lossless) {
+    std::vector<float> pixels;
+
+    makeFloatImage(400, 300, &pixels);
+    std::size_t nBytes = pixels.size() * sizeof(float);
+    ASSERT_GT( nBytes, (std::size_t)1 << NATRON_CACHE_COMPRESSION_BLOCK_SIZE_LOG2 );
+
+    std::vector<char> compressed;
+    ASSERT_TRUE( CacheCompression::compress(&pixels[0], nBytes, 4, eCacheCompressionLossless, &compressed) );
+    EXPECT_LT( compressed.size(), nBytes / 2 );
+    ASSERT_EQ( nBytes, CacheCompression::getDecompressedSize( &compressed[0], compressed.size() ) );
+
+    std::vector<float> decompressed( pixels.size() );
+    ASSERT_TRUE( CacheCompression::decompress( &compressed[0], compressed.size(), &decompressed[0] ) );
+    EXPECT_EQ( 0, std::memcmp(&pixels[0], &decompressed[0], nBytes) );
+
+    // Shorts whose size is not a multiple of the block size
+    std::vector<unsigned short> shorts(200001);
+    for (std::size_t i = 0; i < shorts.size(); ++i) {
+        shorts[i] = (unsigned short)( (i * 7) / 3 );
+    }
+    ASSERT_TRUE( CacheCompression::compress(&shorts[0], shorts.size() * 2, 2, eCacheCompressionLossless, &compressed) );
+    std::vector<unsigned short> decompressedShorts( shorts.size() );
+    ASSERT_TRUE( CacheCompression::decompress( &compressed[0], compressed.size(), &decompressedShorts[0] ) );
+    EXPECT_TRUE(shorts == decompressedShorts);
+}
+
+TEST(CacheCompression, HalfFloat) {
+    std::vector<float> pixels;
+
+    makeFloatImage(400, 300, &pixels);
+    pixels[0] = 65504.f; // largest half
+    pixels[1] = -0.f;
+    pixels[2] = std::numeric_limits<float>::infinity();
+    pixels[3] = std::numeric_limits<float>::quiet_NaN();
+    pixels[4] = 1e6f; // too large: infinity
+    pixels[5] = 3e-6f; // half denormal
+    pixels[6] = 1e-10f; // too small: zero
+    std::size_t nBytes = pixels.size() * sizeof(float);
+
+    std::vector<char> lossless;
+    ASSERT_TRUE( CacheCompression::compress(&pixels[0], nBytes, 4, eCacheCompressionLossless, &lossless) );
+    std::vector<char> compressed;
+    ASSERT_TRUE( CacheCompression::compress(&pixels[0], nBytes, 4, eCacheCompressionHalfFloat, &compressed) );
+    EXPECT_LT( compressed.size(), lossless.size() );
+
+    std::vector<float> decompressed( pixels.size() );
+    ASSERT_TRUE( CacheCompression::decompress( &compressed[0], compressed.size(), &decompressed[0] ) );
+    EXPECT_EQ(65504.f, decompressed[0]);
+    EXPECT_EQ(0.f, decompressed[1]);
+    EXPECT_TRUE( std::signbit(decompressed[1]) );
+    EXPECT_EQ(std::numeric_limits<float>::infinity(), decompressed[2]);
+    EXPECT_TRUE( decompressed[3] != decompressed[3] );
+    EXPECT_EQ(std::numeric_limits<float>::infinity(), decompressed[4]);
+    EXPECT_NEAR(3e-6f, decompressed[5], 6e-8f);
+    EXPECT_EQ(0.f, decompressed[6]);
+    for (std::size_t i = 7; i < pixels.size(); ++i) {
+        // Rounded to the nearest half: 11 significant bits
+        ASSERT_LE( std::fabs(decompressed[i] - pixels[i]), std::fabs(pixels[i]) / 2048.f ) << "at " << i;
+    }
+
+    // Values representable as halves are exact, ties are rounded to even
+    float exact[4] = { 0.5f, 1.f, 1024.f, -0.125f };
+    float ties[2] = { 1.f + 1.f / 2048.f, 1.f + 3.f / 2048.f };
+    std::vector<float> values(exact, exact + 4);
+    values.insert(values.end(), ties, ties + 2);
+    values.resize(4096, 2.f);
+    ASSERT_TRUE( CacheCompression::compress(&values[0], values.size() * 4, 4, eCacheCompressionHalfFloat, &compressed) );
+    std::vector<float> decompressedValues( values.size() );
+    ASSERT_TRUE( CacheCompression::decompress( &compressed[0], compressed.size(), &decompressedValues[0] ) );
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(exact[i], decompressedValues[i]);
+    }
+    EXPECT_EQ(1.f, decompressedValues[4]);
+    EXPECT_EQ(1.f + 4.f / 2048.f, decompressedValues[5]);
+
+    // Other depths are compressed without loss
+    std::vector<unsigned char> bytes(100000);
+    for (std::size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = (unsigned char)(i / 1000);
+    }
+    ASSERT_TRUE( CacheCompression::compress(&bytes[0], bytes.size(), 1, eCacheCompressionHalfFloat, &compressed) );
+    std::vector<unsigned char> decompressedBytes( bytes.size() );
+    ASSERT_TRUE( CacheCompression::decompress( &compressed[0], compressed.size(), &decompressedBytes[0] ) );
+    EXPECT_TRUE(bytes == decompressedBytes);
+}
+
+TEST(CacheCompression, RawAndCorruptedData) {
+    // Data that does not compress is left as is
+    std::vector<unsigned char> noise(100000);
+    unsigned int state = 12345;
+
+    for (std::size_t i = 0; i < noise.size(); ++i) {
+        state = state * 1664525u + 1013904223u;
+        noise[i] = (unsigned char)(state >> 24);
+    }
+    std::vector<char> compressed;
+    EXPECT_FALSE( CacheCompression::compress(&noise[0], noise.size(), 1, eCacheCompressionLossless, &compressed) );
+    EXPECT_TRUE( compressed.empty() );
+    EXPECT_FALSE( CacheCompression::compress(&noise[0], noise.size(), 1, eCacheCompressionNone, &compressed) );
+
+    // Uncompressed data is not recognized as compressed
+    EXPECT_EQ( (std::size_t)0, CacheCompression::getDecompressedSize( &noise[0], noise.size() ) );
+
+    std::vector<float> pixels;
+    makeFloatImage(400, 300, &pixels);
+    ASSERT_TRUE( CacheCompression::compress(&pixels[0], pixels.size() * 4, 4, eCacheCompressionLossless, &compressed) );
+
+    // Truncated data
+    EXPECT_EQ( (std::size_t)0, CacheCompression::getDecompressedSize(&compressed[0], compressed.size() - 1) );
+
+    // Corrupted block
+    std::vector<float> decompressed( pixels.size() );
+    compressed[compressed.size() - 10] ^= 0x5a;
+    EXPECT_FALSE( CacheCompression::decompress( &compressed[0], compressed.size(), &decompressed[0] ) );
+}
+
+TEST(CacheCompression, ReadBackSpeed) {
+    // Frames per second read back from a synthetic sequence of 1024x576 RGBA float frames, compared with copying
+    // the raw pixels as the uncompressed path does from a memory-mapped file already in the page cache.
+    // Disk bandwidth is not measured: reading fewer bytes from the disk is what compression gains.
+    const int nFrames = 8;
+    const int width = 1024;
+    const int height = 576;
+    std::vector<std::vector<float> > frames(nFrames);
+
+    for (int i = 0; i < nFrames; ++i) {
+        makeFloatImage(width, height, &frames[i]);
+        for (std::size_t j = 0; j < frames[i].size(); j += 4) {
+            frames[i][j] += i * 0.01f;
+        }
+    }
+    const std::size_t nBytes = frames[0].size() * sizeof(float);
+    std::vector<float> output( frames[0].size() );
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < nFrames; ++i) {
+        std::memcpy(&output[0], &frames[i][0], nBytes);
+    }
+    double rawSeconds = std::max(timer.nsecsElapsed(), (qint64)1) / 1e9;
+    std::cout << "Raw: " << nFrames / rawSeconds << " frames/s" << std::endl;
+
+    const CacheCompressionEnum codecs[2] = { eCacheCompressionLossless, eCacheCompressionHalfFloat };
+    const char* codecNames[2] = { "Lossless", "Half float" };
+    for (int c = 0; c < 2; ++c) {
+        std::vector<std::vector<char> > compressed(nFrames);
+        std::size_t compressedBytes = 0;
+        for (int i = 0; i < nFrames; ++i) {
+            ASSERT_TRUE( CacheCompression::compress(&frames[i][0], nBytes, 4, codecs[c], &compressed[i]) );
+            compressedBytes += compressed[i].size();
+        }
+        timer.start();
+        for (int i = 0; i < nFrames; ++i) {
+            ASSERT_TRUE( CacheCompression::decompress( &compressed[i][0], compressed[i].size(), &output[0] ) );
+        }
+        double seconds = std::max(timer.nsecsElapsed(), (qint64)1) / 1e9;
+        std::cout << codecNames[c] << ": " << nFrames / seconds << " frames/s, "
+                  << (double)compressedBytes / (nBytes * nFrames) * 100. << "% of the raw size on disk" << std::endl;
+        EXPECT_LT(compressedBytes, nBytes * nFrames);
+    }
+}
+
+// Creates an empty directory for the files of the cache entries of a test
+static QDir
+makeTemporaryDir()
+{
+    QDir dir( StandardPaths::writableLocation(StandardPaths::eStandardLocationTemp) );
+    QString dirName = QString::fromUtf8("NatronUnitTest") + QString::number( qrand() );
+
+    dir.mkpath( QString::fromUtf8(".") );
+    dir.mkdir(dirName);
+    dir.cd(dirName);
+
+    return dir;
+}
+
+TEST(CacheCompression, EntryRewrittenOnlyIfModified) {
+    std::vector<float> pixels;
+
+    makeFloatImage(400, 300, &pixels);
+    const std::size_t nBytes = pixels.size() * sizeof(float);
+    QDir dir = makeTemporaryDir();
+    const QString dirName = dir.dirName();
+    const std::string path = dir.absoluteFilePath( QString::fromUtf8("entry.cache") ).toStdString();
+
+    Buffer<unsigned char> buffer;
+    buffer.allocateMMAP(nBytes, path, eCacheCompressionLossless, sizeof(float));
+    std::memcpy(buffer.writable(), &pixels[0], nBytes);
+    buffer.deallocate();
+    const std::size_t sizeOnDisk = buffer.getSizeOnDisk();
+    EXPECT_LT(sizeOnDisk, nBytes);
+    EXPECT_EQ( sizeOnDisk, (std::size_t)QFileInfo( QString::fromUtf8( path.c_str() ) ).size() );
+
+    // Reading the entry decompresses it to memory and leaves the file compressed
+    buffer.reOpenFileMapping();
+    ASSERT_EQ( nBytes, buffer.size() );
+    EXPECT_EQ( 0, std::memcmp(buffer.readable(), &pixels[0], nBytes) );
+    EXPECT_EQ( sizeOnDisk, (std::size_t)QFileInfo( QString::fromUtf8( path.c_str() ) ).size() );
+    buffer.deallocate();
+    EXPECT_EQ( sizeOnDisk, buffer.getSizeOnDisk() );
+    EXPECT_FALSE( buffer.isAllocated() );
+
+    // Writing to it compresses it again to the file once deallocated
+    buffer.reOpenFileMapping();
+    float* writable = (float*)buffer.writable();
+    for (std::size_t i = 0; i < pixels.size(); i += 4) {
+        pixels[i] = 1.f - pixels[i];
+        writable[i] = pixels[i];
+    }
+    buffer.deallocate();
+    EXPECT_EQ( buffer.getSizeOnDisk(), (std::size_t)QFileInfo( QString::fromUtf8( path.c_str() ) ).size() );
+    buffer.reOpenFileMapping();
+    EXPECT_EQ( 0, std::memcmp(buffer.readable(), &pixels[0], nBytes) );
+    buffer.deallocate();
+
+    buffer.removeAnyBackingFile();
+    dir.cdUp();
+    dir.rmdir(dirName);
+}
+
+TEST(CacheCompression, EntryReadBackSpeed) {
+    // Frames per second read back through the buffers of the DiskCache entries, as when a render reads a cached image:
+    // reOpenFileMapping() opens the file of the entry, then all its pixels are read. Without compression this is the
+    // raw mmap path. The files were just written, so they are in the page cache and disk bandwidth is not measured.
+    const int nFrames = 8;
+    const int width = 1024;
+    const int height = 576;
+    std::vector<std::vector<float> > frames(nFrames);
+    double expectedSum = 0.;
+
+    for (int i = 0; i < nFrames; ++i) {
+        makeFloatImage(width, height, &frames[i]);
+        for (std::size_t j = 0; j < frames[i].size(); j += 4) {
+            frames[i][j] += i * 0.01f;
+        }
+        for (std::size_t j = 0; j < frames[i].size(); ++j) {
+            expectedSum += frames[i][j];
+        }
+    }
+    const std::size_t nBytes = frames[0].size() * sizeof(float);
+    QDir dir = makeTemporaryDir();
+    const QString dirName = dir.dirName();
+
+    const CacheCompressionEnum codecs[3] = { eCacheCompressionNone, eCacheCompressionLossless, eCacheCompressionHalfFloat };
+    const char* codecNames[3] = { "Raw mmap", "Lossless", "Half float" };
+    for (int c = 0; c < 3; ++c) {
+        std::vector<boost::shared_ptr<Buffer<unsigned char> > > buffers(nFrames);
+        std::size_t bytesOnDisk = 0;
+        for (int i = 0; i < nFrames; ++i) {
+            std::string path = dir.absoluteFilePath( QString::fromUtf8("frame_%1_%2.cache").arg(c).arg(i) ).toStdString();
+            buffers[i].reset( new Buffer<unsigned char>() );
+            buffers[i]->allocateMMAP(nBytes, path, codecs[c], sizeof(float));
+            std::memcpy(buffers[i]->writable(), &frames[i][0], nBytes);
+            buffers[i]->deallocate();
+            bytesOnDisk += buffers[i]->getSizeOnDisk();
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        double sum = 0.;
+        for (int i = 0; i < nFrames; ++i) {
+            buffers[i]->reOpenFileMapping();
+            const float* pixels = (const float*)buffers[i]->readable();
+            for (std::size_t j = 0; j < frames[i].size(); ++j) {
+                sum += pixels[j];
+            }
+        }
+        double seconds = std::max(timer.nsecsElapsed(), (qint64)1) / 1e9;
+        std::cout << codecNames[c] << ": " << nFrames / seconds << " frames/s, "
+                  << (double)bytesOnDisk / (nBytes * nFrames) * 100. << "% of the raw size on disk" << std::endl;
+        if (codecs[c] != eCacheCompressionHalfFloat) {
+            EXPECT_EQ(expectedSum, sum);
+        }
+
+        for (int i = 0; i < nFrames; ++i) {
+            buffers[i]->deallocate();
+            buffers[i]->removeAnyBackingFile();
+        }
+    }
+    dir.cdUp();
+    dir.rmdir(dirName);
+}
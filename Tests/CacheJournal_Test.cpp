@@ -0,0 +1,217 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+#include <map>
+#include <string>
+#include <gtest/gtest.h>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+
+#include "Engine/CacheJournal.h"
+
+NATRON_NAMESPACE_USING
+
+static std::string
+journalPath()
+{
+    return QDir::temp().absoluteFilePath( QString::fromUtf8("NatronCacheJournalTest.journal") ).toStdString();
+}
+
+static CacheJournal::Entry
+makeEntry(const std::string& filePath,
+          U64 dataOffset,
+          const std::string& data)
+{
+    CacheJournal::Entry e;
+
+    e.filePath = filePath;
+    e.dataOffset = dataOffset;
+    e.data = data;
+
+    return e;
+}
+
+// Returns the data of the entries read from the journal, indexed by their offset
+static bool
+readJournal(U32 version,
+            std::map<U64, std::string>* entries)
+{
+    std::list<CacheJournal::Entry> list;
+
+    if ( !CacheJournal::read(journalPath(), version, &list) ) {
+        return false;
+    }
+    for (std::list<CacheJournal::Entry>::iterator it = list.begin(); it != list.end(); ++it) {
+        EXPECT_EQ("CachePart0", it->filePath);
+        (*entries)[it->dataOffset] = it->data;
+    }
+
+    return true;
+}
+
+TEST(CacheJournal, Replay) {
+    QFile::remove( QString::fromUtf8( journalPath().c_str() ) );
+    {
+        std::list<CacheJournal::Entry> entries;
+        entries.push_back( makeEntry("CachePart0", 0, "a") );
+        entries.push_back( makeEntry("CachePart0", 100, "b") );
+
+        CacheJournal journal;
+        journal.start(journalPath(), 2, entries);
+        EXPECT_TRUE( journal.isActive() );
+        journal.appendAddition( "CachePart0", 200, std::string("c\0c", 3) );
+        journal.appendRemoval("CachePart0", 0);
+        U64 sequence = journal.appendAddition("CachePart0", 0, "d");
+        journal.appendRemoval("CachePart0", 300); // not in the journal
+        journal.sync();
+        EXPECT_GE(journal.getWrittenSequence(), sequence);
+    }
+
+    std::map<U64, std::string> entries;
+    EXPECT_TRUE( readJournal(2, &entries) );
+    EXPECT_EQ( 3, (int)entries.size() );
+    EXPECT_EQ("d", entries[0]);
+    EXPECT_EQ("b", entries[100]);
+    EXPECT_EQ(std::string("c\0c", 3), entries[200]);
+
+    // A journal written for another version of the cache is not read
+    entries.clear();
+    EXPECT_FALSE( readJournal(3, &entries) );
+    EXPECT_TRUE( entries.empty() );
+
+    QFile::remove( QString::fromUtf8( journalPath().c_str() ) );
+}
+
+TEST(CacheJournal, TornRecord) {
+    QFile::remove( QString::fromUtf8( journalPath().c_str() ) );
+    {
+        CacheJournal journal;
+        journal.start( journalPath(), 2, std::list<CacheJournal::Entry>() );
+        journal.appendAddition("CachePart0", 0, "first");
+        journal.appendAddition("CachePart0", 100, "second");
+        journal.quitThread();
+        EXPECT_FALSE( journal.isActive() );
+        // Not recorded once stopped
+        EXPECT_EQ( (U64)0, journal.appendRemoval("CachePart0", 0) );
+    }
+
+    // Simulate a crash while the last record was written
+    QFile file( QString::fromUtf8( journalPath().c_str() ) );
+    ASSERT_TRUE( file.open(QIODevice::ReadOnly) );
+    QByteArray content = file.readAll();
+    file.close();
+    ASSERT_TRUE( file.open(QIODevice::WriteOnly | QIODevice::Truncate) );
+    file.write( content.constData(), content.size() - 3 );
+    file.close();
+
+    std::map<U64, std::string> entries;
+    EXPECT_TRUE( readJournal(2, &entries) );
+    EXPECT_EQ( 1, (int)entries.size() );
+    EXPECT_EQ("first", entries[0]);
+
+    // A corrupted record is ignored as well as all records after it
+    content[content.size() - 1] = content[content.size() - 1] + 1;
+    ASSERT_TRUE( file.open(QIODevice::WriteOnly | QIODevice::Truncate) );
+    file.write( content.constData(), content.size() );
+    file.close();
+
+    entries.clear();
+    EXPECT_TRUE( readJournal(2, &entries) );
+    EXPECT_EQ( 1, (int)entries.size() );
+
+    QFile::remove( QString::fromUtf8( journalPath().c_str() ) );
+}
+
+TEST(CacheJournal, Compaction) {
+    QFile::remove( QString::fromUtf8( journalPath().c_str() ) );
+    const std::string data(1000, 'x');
+    {
+        CacheJournal journal;
+        journal.start( journalPath(), 2, std::list<CacheJournal::Entry>() );
+        journal.appendAddition("CachePart0", 0, "kept");
+        for (int i = 0; i < 5000; ++i) {
+            journal.appendAddition("CachePart0", 100, data);
+            journal.appendRemoval("CachePart0", 100);
+        }
+        journal.appendAddition("CachePart0", 200, data);
+        journal.sync();
+    }
+
+    QFile file( QString::fromUtf8( journalPath().c_str() ) );
+    EXPECT_LT( file.size(), (qint64)NATRON_CACHE_JOURNAL_COMPACTION_MIN_SIZE + 2 * (qint64)data.size() );
+
+    std::map<U64, std::string> entries;
+    EXPECT_TRUE( readJournal(2, &entries) );
+    EXPECT_EQ( 2, (int)entries.size() );
+    EXPECT_EQ("kept", entries[0]);
+    EXPECT_EQ(data, entries[200]);
+
+    QFile::remove( QString::fromUtf8( journalPath().c_str() ) );
+}
+
+TEST(CacheJournal, InterruptedCompaction) {
+    QString path = QString::fromUtf8( journalPath().c_str() );
+    QString tmpPath = path + QString::fromUtf8(".tmp");
+
+    QFile::remove(path);
+    QFile::remove(tmpPath);
+    {
+        std::list<CacheJournal::Entry> entries;
+        entries.push_back( makeEntry("CachePart0", 0, "a") );
+        CacheJournal journal;
+        journal.start(journalPath(), 2, entries);
+        journal.appendAddition("CachePart0", 100, "b");
+        journal.sync();
+    }
+
+    // A crash after the old journal was removed, before the compacted one was renamed, leaves only the compacted one
+    ASSERT_TRUE( QFile::rename(path, tmpPath) );
+    EXPECT_TRUE( CacheJournal::exists( journalPath() ) );
+    EXPECT_TRUE( QFile::exists(path) );
+    EXPECT_FALSE( QFile::exists(tmpPath) );
+
+    std::map<U64, std::string> entries;
+    EXPECT_TRUE( readJournal(2, &entries) );
+    EXPECT_EQ( 2, (int)entries.size() );
+    EXPECT_EQ("a", entries[0]);
+    EXPECT_EQ("b", entries[100]);
+
+    // A crash while the compacted journal is written leaves the old one, which is read
+    QFile tmpFile(tmpPath);
+    ASSERT_TRUE( tmpFile.open(QIODevice::WriteOnly) );
+    tmpFile.write("torn", 4);
+    tmpFile.close();
+    entries.clear();
+    EXPECT_TRUE( readJournal(2, &entries) );
+    EXPECT_EQ( 2, (int)entries.size() );
+
+    QFile::remove(path);
+    QFile::remove(tmpPath);
+    EXPECT_FALSE( CacheJournal::exists( journalPath() ) );
+}
@@ -0,0 +1,202 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <algorithm> // max
+#include <iostream>
+#include <list>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <boost/make_shared.hpp>
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QThread>
+
+#include "Engine/Cache.h"
+#include "Engine/Image.h"
+#include "Engine/ImageKey.h"
+#include "Engine/ImageParams.h"
+#include "Engine/ViewIdx.h"
+
+NATRON_NAMESPACE_USING
+
+static ImageParamsPtr
+makeParams()
+{
+    RectI bounds(0, 0, 16, 16);
+    RectD rod(0, 0, 16, 16);
+
+    return boost::make_shared<ImageParams>( rod, 1., 0, bounds, eImageBitDepthByte, eImageFieldingOrderNone,
+                                            eImagePremultiplicationPremultiplied, false, ImagePlaneDesc::getRGBAComponents(),
+                                            eStorageModeRAM, 0 );
+}
+
+static std::vector<ImageKey>
+makeKeys(int nKeys)
+{
+    std::vector<ImageKey> keys;
+
+    for (int i = 0; i < nKeys; ++i) {
+        keys.push_back( ImageKey(0, i + 1, false, 0, ViewIdx(0), 1., false, false) );
+    }
+
+    return keys;
+}
+
+// Looks-up keys of the cache in a random order, alternating get() and getOrCreate() as renders do
+class CacheLookupThread
+    : public QThread
+{
+public:
+
+    CacheLookupThread(const Cache<Image>* cache,
+                      const std::vector<ImageKey>* keys,
+                      const ImageParamsPtr& params,
+                      int nLookups,
+                      unsigned int seed)
+        : QThread()
+        , nFound(0)
+        , _cache(cache)
+        , _keys(keys)
+        , _params(params)
+        , _nLookups(nLookups)
+        , _seed(seed)
+    {
+    }
+
+    int nFound;
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        unsigned int state = _seed;
+
+        for (int i = 0; i < _nLookups; ++i) {
+            state = state * 1664525u + 1013904223u;
+            const ImageKey& key = (*_keys)[(state >> 8) % _keys->size()];
+            if (i % 2) {
+                std::list<ImagePtr> images;
+                if ( _cache->get(key, &images) ) {
+                    ++nFound;
+                }
+            } else {
+                ImagePtr image;
+                if ( _cache->getOrCreate(key, _params, 0, &image) ) {
+                    ++nFound;
+                }
+            }
+        }
+    }
+
+    const Cache<Image>* _cache;
+    const std::vector<ImageKey>* _keys;
+    ImageParamsPtr _params;
+    int _nLookups;
+    unsigned int _seed;
+};
+
+// Runs nThreads CacheLookupThread at once, returns the number of lookups that found their entry
+static int
+runLookupThreads(const Cache<Image>* cache,
+                 const std::vector<ImageKey>* keys,
+                 const ImageParamsPtr& params,
+                 int nThreads,
+                 int nLookupsPerThread)
+{
+    std::vector<CacheLookupThread*> threads;
+
+    for (int i = 0; i < nThreads; ++i) {
+        threads.push_back( new CacheLookupThread(cache, keys, params, nLookupsPerThread, i + 1) );
+    }
+    for (int i = 0; i < nThreads; ++i) {
+        threads[i]->start();
+    }
+    int nFound = 0;
+    for (int i = 0; i < nThreads; ++i) {
+        threads[i]->wait();
+        nFound += threads[i]->nFound;
+        delete threads[i];
+    }
+
+    return nFound;
+}
+
+TEST(Cache, GetOrCreate) {
+    Cache<Image> cache("TestCache", NATRON_CACHE_VERSION, 1024 * 1024 * 1024, 1.);
+    ImageParamsPtr params = makeParams();
+    std::vector<ImageKey> keys = makeKeys(256);
+
+    // The keys are spread over all the shards
+    std::vector<ImagePtr> images( keys.size() );
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        EXPECT_FALSE( cache.getOrCreate(keys[i], params, 0, &images[i]) );
+        ASSERT_TRUE(images[i]);
+    }
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        std::list<ImagePtr> found;
+        ASSERT_TRUE( cache.get(keys[i], &found) );
+        ASSERT_EQ( (std::size_t)1, found.size() );
+        EXPECT_EQ( images[i], found.front() );
+
+        ImagePtr image;
+        EXPECT_TRUE( cache.getOrCreate(keys[i], params, 0, &image) );
+        EXPECT_EQ(images[i], image);
+    }
+    std::list<ImagePtr> found;
+    EXPECT_FALSE( cache.get(ImageKey(0, keys.size() + 1, false, 0, ViewIdx(0), 1., false, false), &found) );
+
+    // Concurrent lookups of entries which are all in the cache always find them
+    EXPECT_EQ( 8 * 10000, runLookupThreads(&cache, &keys, params, 8, 10000) );
+
+    cache.waitForDeleterThread();
+}
+
+TEST(Cache, ConcurrentLookupThroughput) {
+    Cache<Image> cache("TestCache", NATRON_CACHE_VERSION, 1024 * 1024 * 1024, 1.);
+    ImageParamsPtr params = makeParams();
+    std::vector<ImageKey> keys = makeKeys(1024);
+    std::vector<ImagePtr> images( keys.size() );
+
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        EXPECT_FALSE( cache.getOrCreate(keys[i], params, 0, &images[i]) );
+    }
+
+    const int nLookupsPerThread = 100000;
+    for (int nThreads = 1; nThreads <= 8; nThreads *= 2) {
+        QElapsedTimer timer;
+        timer.start();
+        int nFound = runLookupThreads(&cache, &keys, params, nThreads, nLookupsPerThread);
+        qint64 elapsed = std::max( timer.nsecsElapsed(), (qint64)1 );
+        EXPECT_EQ(nThreads * nLookupsPerThread, nFound);
+        std::cout << nThreads << " threads: " << (double)nThreads * nLookupsPerThread * 1e9 / elapsed
+                  << " get/getOrCreate per second" << std::endl;
+    }
+
+    cache.waitForDeleterThread();
+}
@@ -25,12 +25,19 @@
 
 #include "Global/Macros.h"
 
+#include <algorithm> // max
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <vector>
 #include <gtest/gtest.h>
 
 #include <QtCore/QString>
 #include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
 
 #include "Engine/Curve.h"
+#include "Engine/Hash64.h"
 
 NATRON_NAMESPACE_USING
 
@@ -125,3 +132,194 @@ TEST(Curve, Basic)
 }
 
 
+
+TEST(Curve, Hash)
+{
+    Curve c1, c2;
+
+    EXPECT_TRUE( c1.addKeyFrame( KeyFrame(0., 10.) ) );
+    EXPECT_TRUE( c1.addKeyFrame( KeyFrame(10., 20.) ) );
+    // insert in a different order, the keyframes are sorted by time
+    EXPECT_TRUE( c2.addKeyFrame( KeyFrame(10., 20.) ) );
+    EXPECT_TRUE( c2.addKeyFrame( KeyFrame(0., 10.) ) );
+
+    Hash64 h1, h2;
+    c1.appendToHash(&h1);
+    c2.appendToHash(&h2);
+    h1.computeHash();
+    h2.computeHash();
+    EXPECT_EQ( h1.value(), h2.value() ) << "Curves with the same keyframes should have the same hash.";
+
+    c2.setKeyFrameInterpolation(eKeyframeTypeLinear, 0);
+    h2.reset();
+    c2.appendToHash(&h2);
+    h2.computeHash();
+    EXPECT_NE( h1.value(), h2.value() ) << "The interpolation is part of the hash.";
+}
+
+TEST(Curve, Snapshot)
+{
+    Curve c;
+
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(0., 0., 0., 0., eKeyframeTypeLinear) ) );
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(10., 10., 0., 0., eKeyframeTypeLinear) ) );
+    EXPECT_EQ( 5., c.getValueAt(5.) );
+
+    // The changes are visible by the next evaluation
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(5., 20., 0., 0., eKeyframeTypeLinear) ) );
+    EXPECT_EQ( 20., c.getValueAt(5.) );
+    c.removeKeyFrameWithTime(5.);
+    EXPECT_EQ( 5., c.getValueAt(5.) );
+    c.setYRange(0., 3.);
+    EXPECT_EQ( 3., c.getValueAt(5.) );
+    EXPECT_EQ( 5., c.getValueAt(5., false) );
+    c.setYRange( -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity() );
+
+    // The batch evaluation gives the same values as getValueAt, in any order
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(3., 7.) ) );
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(7., -2., 0., 0., eKeyframeTypeConstant) ) );
+    std::vector<double> times;
+    for (double t = -5.; t <= 15.; t += 0.25) {
+        times.push_back(t);
+    }
+    times.push_back(4.);
+    times.push_back(-20.);
+    times.push_back(7.);
+    std::vector<double> values;
+    c.getValuesAt(times, &values);
+    ASSERT_EQ( times.size(), values.size() );
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        EXPECT_EQ( c.getValueAt(times[i]), values[i] ) << "at time " << times[i];
+    }
+
+    // Periodic curve
+    c.setXRange(0., 10.);
+    c.setPeriodic(true);
+    EXPECT_FALSE( c.isAnimated() );
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(0., 0., 0., 0., eKeyframeTypeLinear) ) );
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(5., 10., 0., 0., eKeyframeTypeLinear) ) );
+    EXPECT_EQ( 4., c.getValueAt(2.) );
+    EXPECT_EQ( c.getValueAt(2.), c.getValueAt(12.) );
+    EXPECT_EQ( c.getValueAt(7.5), c.getValueAt(-2.5) );
+    times.clear();
+    times.push_back(12.);
+    times.push_back(-2.5);
+    c.getValuesAt(times, &values);
+    EXPECT_EQ( c.getValueAt(12.), values[0] );
+    EXPECT_EQ( c.getValueAt(-2.5), values[1] );
+
+    // An empty curve is zero everywhere
+    c.clearKeyFrames();
+    EXPECT_EQ( 0., c.getValueAt(2.) );
+    c.getValuesAt(times, &values);
+    EXPECT_EQ( 0., values[0] );
+}
+
+TEST(Curve, AddKeyFrames)
+{
+    // Keyframes with various interpolations, not sorted, one of them replacing another
+    std::vector<KeyFrame> keys;
+    for (int i = 0; i < 50; ++i) {
+        KeyframeTypeEnum interp = (i % 3 == 0) ? eKeyframeTypeCubic : ( (i % 3 == 1) ? eKeyframeTypeSmooth : eKeyframeTypeCatmullRom );
+        keys.push_back( KeyFrame( (double)( (i * 7) % 50 ), std::sin(i * 0.3) * 10., 0., 0., interp ) );
+    }
+    keys.push_back( KeyFrame(10., 3.) );
+
+    Curve c1, c2;
+    EXPECT_TRUE( c1.addKeyFrame( KeyFrame(-5., 1.) ) );
+    EXPECT_TRUE( c2.addKeyFrame( KeyFrame(-5., 1.) ) );
+
+    int nAdded = 0;
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        if ( c1.addKeyFrame(keys[i]) ) {
+            ++nAdded;
+        }
+    }
+    EXPECT_EQ( 50, nAdded );
+    EXPECT_EQ( nAdded, c2.addKeyFrames(keys) );
+
+    // The curve is the same as with one addKeyFrame call per keyframe
+    KeyFrameSet keys1 = c1.getKeyFrames_mt_safe();
+    KeyFrameSet keys2 = c2.getKeyFrames_mt_safe();
+    ASSERT_EQ( keys1.size(), keys2.size() );
+    for (KeyFrameSet::const_iterator it1 = keys1.begin(), it2 = keys2.begin(); it1 != keys1.end(); ++it1, ++it2) {
+        EXPECT_EQ( it1->getTime(), it2->getTime() );
+        EXPECT_EQ( it1->getValue(), it2->getValue() );
+        EXPECT_EQ( it1->getInterpolation(), it2->getInterpolation() );
+        EXPECT_EQ( it1->getLeftDerivative(), it2->getLeftDerivative() ) << "at time " << it1->getTime();
+        EXPECT_EQ( it1->getRightDerivative(), it2->getRightDerivative() ) << "at time " << it1->getTime();
+    }
+    EXPECT_EQ( 3., c2.getValueAt(10.) );
+    EXPECT_EQ( c1.getValueAt(12.5), c2.getValueAt(12.5) );
+
+    EXPECT_EQ( 0, c2.addKeyFrames( std::vector<KeyFrame>() ) );
+}
+
+TEST(Curve, CloneRange)
+{
+    // The keyframes before tracking: a user keyframe at 0 and 6
+    Curve saved;
+    saved.addKeyFrame( KeyFrame(0., 1.) );
+    saved.addKeyFrame( KeyFrame(6., 4.) );
+
+    // Tracking went up to frame 10, but stopped at frame 4: frames 5 to 10 are rolled back
+    Curve tracked;
+    tracked.clone(saved);
+    for (int i = 1; i <= 10; ++i) {
+        tracked.addKeyFrame( KeyFrame( (double)i, i * 2. ) );
+    }
+    RangeD range;
+    range.min = 5.;
+    range.max = 10.;
+    tracked.cloneRange(saved, range);
+
+    Curve expected;
+    expected.addKeyFrame( KeyFrame(0., 1.) );
+    for (int i = 1; i <= 4; ++i) {
+        expected.addKeyFrame( KeyFrame( (double)i, i * 2. ) );
+    }
+    expected.addKeyFrame( KeyFrame(6., 4.) );
+
+    KeyFrameSet keys1 = tracked.getKeyFrames_mt_safe();
+    KeyFrameSet keys2 = expected.getKeyFrames_mt_safe();
+    ASSERT_EQ( keys1.size(), keys2.size() );
+    for (KeyFrameSet::const_iterator it1 = keys1.begin(), it2 = keys2.begin(); it1 != keys1.end(); ++it1, ++it2) {
+        EXPECT_EQ( it1->getTime(), it2->getTime() );
+        EXPECT_EQ( it1->getValue(), it2->getValue() );
+        EXPECT_EQ( it1->getLeftDerivative(), it2->getLeftDerivative() ) << "at time " << it1->getTime();
+        EXPECT_EQ( it1->getRightDerivative(), it2->getRightDerivative() ) << "at time " << it1->getTime();
+    }
+    EXPECT_EQ( expected.getValueAt(5.5), tracked.getValueAt(5.5) );
+}
+
+TEST(Curve, AddKeyFramesSpeed)
+{
+    // Bake 2000 keyframes, as a Python script would, one at a time and in bulk.
+    // Like Knob::setValueAtTime, each key added one at a time looks up the existing keyframe and clones the
+    // curve into the GUI curve, whereas Knob::setValuesAtTimes clones it once.
+    const int nKeys = 2000;
+    std::vector<KeyFrame> keys;
+    for (int i = 0; i < nKeys; ++i) {
+        keys.push_back( KeyFrame( (double)i, std::sin(i * 0.01) * 10. ) );
+    }
+
+    Curve c1, c2, guiCurve;
+    QElapsedTimer timer;
+    timer.start();
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        KeyFrame existingKey;
+        EXPECT_FALSE( c1.getKeyFrameWithTime(keys[i].getTime(), &existingKey) );
+        c1.addKeyFrame(keys[i]);
+        guiCurve.clone(c1);
+    }
+    qint64 perKey = timer.nsecsElapsed();
+    timer.restart();
+    EXPECT_EQ( nKeys, c2.addKeyFrames(keys) );
+    guiCurve.clone(c2);
+    qint64 bulk = timer.nsecsElapsed();
+    std::cout << "Added " << nKeys << " keyframes in " << perKey / 1000 << " us one at a time, "
+              << bulk / 1000 << " us in bulk (x" << (double)perKey / std::max(bulk, (qint64)1) << ")" << std::endl;
+
+    EXPECT_EQ( c1.getKeyFramesCount(), c2.getKeyFramesCount() );
+    EXPECT_EQ( c1.getValueAt(1000.5), c2.getValueAt(1000.5) );
+}
@@ -91,3 +91,34 @@ TEST(Hash64,
     EXPECT_NE(hash1, hash2);
 } // TEST
 
+
+TEST(Hash64,
+     OrderAndLength)
+{
+    // The order of the values matters, which is what distinguishes the inputs of a node
+    Hash64 hash1, hash2;
+
+    hash1.append<int>(1);
+    hash1.append<int>(2);
+    hash1.computeHash();
+    hash2.append<int>(2);
+    hash2.append<int>(1);
+    hash2.computeHash();
+    EXPECT_NE(hash1, hash2);
+
+    // Appending zeros changes the hash
+    hash1.reset();
+    hash1.append<U64>(0);
+    hash1.computeHash();
+    ASSERT_TRUE( hash1.valid() );
+    hash2.reset();
+    hash2.append<U64>(0);
+    hash2.append<U64>(0);
+    hash2.computeHash();
+    EXPECT_NE(hash1, hash2);
+
+    // Computing the hash does not prevent from appending more values
+    hash1.append<U64>(0);
+    hash1.computeHash();
+    EXPECT_EQ(hash1, hash2);
+}
@@ -0,0 +1,211 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <algorithm> // min
+#include <iostream>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QElapsedTimer>
+
+#include "Engine/Hash64.h"
+#include "Engine/HashCone.h"
+
+NATRON_NAMESPACE_USING
+
+// A node graph where the hash of a node depends on its own value and on the hash of its inputs
+struct TestGraph
+{
+    std::vector<std::vector<int> > inputs;
+    std::vector<std::vector<int> > outputs;
+    std::vector<U64> values;
+    std::vector<U64> hashes;
+
+    // The order in which the nodes were recomputed by the last propagation
+    std::vector<int> recomputed;
+
+    explicit TestGraph(int nNodes)
+        : inputs(nNodes)
+        , outputs(nNodes)
+        , values(nNodes, 0)
+        , hashes(nNodes, 0)
+        , recomputed()
+    {
+    }
+
+    void connect(int input,
+                 int output)
+    {
+        inputs[output].push_back(input);
+        outputs[input].push_back(output);
+    }
+
+    U64 computeHash(int node) const
+    {
+        Hash64 hash;
+
+        hash.append(values[node]);
+        for (std::size_t i = 0; i < inputs[node].size(); ++i) {
+            hash.append(hashes[inputs[node][i]] + i);
+        }
+        hash.computeHash();
+
+        return hash.value();
+    }
+
+    // The nodes are created in topological order: recomputing all of them in order gives the reference hashes
+    void computeAll()
+    {
+        for (std::size_t i = 0; i < hashes.size(); ++i) {
+            hashes[i] = computeHash(i);
+        }
+    }
+
+    bool recompute(int node)
+    {
+        recomputed.push_back(node);
+        U64 oldHash = hashes[node];
+        hashes[node] = computeHash(node);
+
+        return hashes[node] != oldHash;
+    }
+};
+
+struct TestGraphDependents
+{
+    TestGraph* graph;
+
+    void operator()(int node,
+                    std::vector<int>* dependents) const
+    {
+        dependents->insert( dependents->end(), graph->outputs[node].begin(), graph->outputs[node].end() );
+    }
+};
+
+struct TestGraphRecompute
+{
+    TestGraph* graph;
+
+    bool operator()(int node) const
+    {
+        return graph->recompute(node);
+    }
+};
+
+// Changes the value of node and propagates its hash like Node::computeHash, returns the number of nodes recomputed downstream
+static int
+changeValue(TestGraph* graph,
+            int node,
+            U64 value)
+{
+    graph->values[node] = value;
+    graph->recomputed.clear();
+    if ( !graph->recompute(node) ) {
+        return 0;
+    }
+    TestGraphDependents getDependents = { graph };
+    TestGraphRecompute recompute = { graph };
+
+    return HashCone<int>::propagate(std::vector<int>(1, node), getDependents, recompute);
+}
+
+TEST(HashCone, Diamond) {
+    // 0 -> 1 -> 3 -> 4 -> 5
+    //   -> 2 ------>
+    // Visiting 4 from 3 before 2 was refreshed used to leave 4 and 5 with a stale hash
+    TestGraph graph(6);
+
+    graph.connect(0, 1);
+    graph.connect(0, 2);
+    graph.connect(1, 3);
+    graph.connect(3, 4);
+    graph.connect(2, 4);
+    graph.connect(4, 5);
+    graph.computeAll();
+
+    std::vector<U64> oldHashes = graph.hashes;
+    EXPECT_EQ( 5, changeValue(&graph, 0, 1) );
+    std::vector<U64> hashes = graph.hashes;
+    graph.computeAll();
+    EXPECT_TRUE(hashes == graph.hashes);
+    for (std::size_t i = 0; i < hashes.size(); ++i) {
+        EXPECT_NE(oldHashes[i], hashes[i]);
+    }
+
+    // Each node is recomputed once, after all of its inputs
+    std::vector<int> position(graph.values.size(), -1);
+    for (std::size_t i = 0; i < graph.recomputed.size(); ++i) {
+        int node = graph.recomputed[i];
+        EXPECT_EQ(-1, position[node]) << "node " << node << " recomputed twice";
+        position[node] = i;
+        for (std::size_t j = 0; j < graph.inputs[node].size(); ++j) {
+            EXPECT_LT(position[graph.inputs[node][j]], position[node]);
+        }
+    }
+
+    // Nothing downstream is recomputed if the hash did not change
+    EXPECT_EQ( 0, changeValue(&graph, 2, graph.values[2]) );
+    EXPECT_EQ( (std::size_t)1, graph.recomputed.size() );
+
+    // Only the cone downstream of the changed node is recomputed
+    EXPECT_EQ( 2, changeValue(&graph, 3, 5) );
+    hashes = graph.hashes;
+    graph.computeAll();
+    EXPECT_TRUE(hashes == graph.hashes);
+}
+
+TEST(HashCone, LargeGraph) {
+    // A 5000-node graph where each node has up to 3 inputs among the nodes created before it
+    const int nNodes = 5000;
+    TestGraph graph(nNodes);
+    unsigned int state = 12345;
+
+    for (int i = 1; i < nNodes; ++i) {
+        int nInputs = 1 + i % 3;
+        for (int j = 0; j < nInputs; ++j) {
+            state = state * 1664525u + 1013904223u;
+            // Mostly connect to recent nodes so that the graph is deep
+            int input = i - 1 - (int)( (state >> 16) % std::min(i, 20) );
+            graph.connect(input, i);
+        }
+    }
+    graph.computeAll();
+
+    QElapsedTimer timer;
+    timer.start();
+    int nRecomputed = changeValue(&graph, 1, 1);
+    qint64 elapsed = timer.nsecsElapsed();
+    std::cout << "Propagated the hash of a " << nNodes << "-node graph to " << nRecomputed << " nodes in "
+              << elapsed / 1000 << " us" << std::endl;
+
+    EXPECT_GT(nRecomputed, nNodes / 2);
+    EXPECT_EQ( (std::size_t)nRecomputed + 1, graph.recomputed.size() );
+    std::vector<U64> hashes = graph.hashes;
+    graph.computeAll();
+    EXPECT_TRUE(hashes == graph.hashes);
+}
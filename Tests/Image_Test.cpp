@@ -25,14 +25,36 @@
 
 #include "Global/Macros.h"
 
+#include <algorithm> // min
 #include <cstring>
+#include <iostream>
+#include <vector>
 #include <gtest/gtest.h>
 
+#include <QtCore/QElapsedTimer>
+
 #include "Engine/Image.h"
 #include "Engine/ViewIdx.h"
 
 NATRON_NAMESPACE_USING
 
+// Returns true if all the pixels of the roi have the given state
+static bool
+allPixelsAre(const Bitmap& bm,
+             const RectI& roi,
+             char value)
+{
+    for (int y = roi.y1; y < roi.y2; ++y) {
+        for (int x = roi.x1; x < roi.x2; ++x) {
+            if (bm.getPixel(x, y) != value) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
 TEST(BitmapTest,
      SimpleRect)
 {
@@ -52,8 +74,7 @@ TEST(BitmapTest,
     ASSERT_TRUE(rod == nonRenderedRectsUnion);
 
     ///assert that the "underlying" bitmap is clean
-    const char* map = bm.getBitmap();
-    ASSERT_TRUE( !std::memchr( map, 1, rod.area() ) );
+    ASSERT_TRUE( allPixelsAre(bm, rod, 0) );
     ASSERT_TRUE( bm.isNonMarked(rod) );
 
     RectI halfRoD(0, 0, 100, 50);
@@ -69,14 +90,12 @@ TEST(BitmapTest,
 
 
     ///assert that the underlying bitmap is marked as expected
-    const char* start = map;
 
     ///check that there are only ones in the rendered half
-    ASSERT_TRUE( !memchr( start, 0, halfRoD.area() ) );
+    ASSERT_TRUE( allPixelsAre(bm, halfRoD, 1) );
 
     ///check that there are only 0s in the non rendered half
-    start = map + halfRoD.area();
-    ASSERT_TRUE( !memchr( start, 1, halfRoD.area() ) );
+    ASSERT_TRUE( allPixelsAre(bm, nonRenderedHalf, 0) );
 
     ///mark for renderer the other half of the rod
     bm.markForRendered(nonRenderedHalf);
@@ -85,7 +104,7 @@ TEST(BitmapTest,
     nonRenderedRects.clear();
     bm.minimalNonMarkedRects(rod, nonRenderedRects);
     ASSERT_TRUE( nonRenderedRects.empty() );
-    ASSERT_TRUE( !memchr( map, 0, rod.area() ) );
+    ASSERT_TRUE( allPixelsAre(bm, rod, 1) );
 
     ///More complex example where A,B,C,D are not rendered check that both trimap & bitmap yield the same result
     // BBBBBBBBBBBBBB
@@ -117,6 +136,223 @@ TEST(BitmapTest,
     EXPECT_TRUE(nonRenderedRects.size() == 3);
 } // TEST
 
+TEST(BitmapTest,
+     UnalignedRects)
+{
+    // The states are packed 32 pixels per word: use bounds and rectangles that do not start on a word
+    RectI rod(-7, 3, 93, 40);
+    Bitmap bm(rod);
+
+    RectI rendered(13, 5, 50, 30);
+    bm.markForRendered(rendered);
+    ASSERT_TRUE( allPixelsAre(bm, rendered, 1) );
+    ASSERT_TRUE( allPixelsAre( bm, RectI(-7, 3, 13, 40), 0 ) );
+    ASSERT_TRUE( allPixelsAre( bm, RectI(50, 3, 93, 40), 0 ) );
+    ASSERT_TRUE( bm.isNonMarked( RectI(50, 3, 93, 40) ) );
+    ASSERT_FALSE( bm.isNonMarked( RectI(49, 29, 51, 31) ) );
+
+    // The pixels left to render are around the rendered rectangle
+    std::list<RectI> nonRenderedRects;
+    bm.minimalNonMarkedRects(rod, nonRenderedRects);
+    EXPECT_EQ(4U, nonRenderedRects.size());
+    for (std::list<RectI>::iterator it = nonRenderedRects.begin(); it != nonRenderedRects.end(); ++it) {
+        EXPECT_FALSE( it->intersects(rendered) );
+    }
+    EXPECT_TRUE( bm.minimalNonMarkedBbox(rendered).isNull() );
+
+    // Only the pixels being rendered elsewhere are left in this region
+    RectI rendering(50, 5, 60, 30);
+    bm.markForRendering(rendering);
+    bool beingRenderedElsewhere = false;
+    RectI bbox = bm.minimalNonMarkedBbox_trimap(RectI(13, 5, 60, 30), &beingRenderedElsewhere);
+    EXPECT_TRUE( bbox.isNull() );
+    EXPECT_TRUE(beingRenderedElsewhere);
+    EXPECT_TRUE( bm.minimalNonMarkedBbox( RectI(13, 5, 60, 30) ) == rendering );
+
+    // Copy to a bitmap whose words are not aligned with the first one
+    Bitmap other( RectI(-30, 0, 100, 45) );
+    other.markForRendering( other.getBounds() );
+    other.copyBitmapPortion(rod, bm);
+    for (int y = rod.y1; y < rod.y2; ++y) {
+        for (int x = rod.x1; x < rod.x2; ++x) {
+            ASSERT_EQ( bm.getPixel(x, y), other.getPixel(x, y) );
+        }
+    }
+    ASSERT_TRUE( allPixelsAre( other, RectI(-30, 0, -7, 45), 2 ) );
+    ASSERT_TRUE( allPixelsAre( other, RectI(93, 0, 100, 45), 2 ) );
+
+    bm.clear(rod);
+    ASSERT_TRUE( bm.isNonMarked(rod) );
+} // TEST
+
+// The render-state bitmap as it was stored before it was packed: one char per pixel, scanned byte by byte
+class CharBitmap
+{
+public:
+
+    CharBitmap(const RectI& bounds)
+        : _bounds(bounds)
+        , _map(bounds.area(), 0)
+    {
+    }
+
+    std::size_t getSizeInBytes() const
+    {
+        return _map.size();
+    }
+
+    void markFor(const RectI& roi,
+                 char value)
+    {
+        for (int y = roi.y1; y < roi.y2; ++y) {
+            std::memset(pixel(roi.x1, y), value, roi.width());
+        }
+    }
+
+    // Same as Bitmap::minimalNonMarkedBbox_trimap
+    RectI minimalNonMarkedBbox_trimap(const RectI& roi,
+                                      bool* isBeingRenderedElsewhere) const
+    {
+        RectI bbox = roi;
+        bool rowsBeingRendered = false;
+
+        while ( bbox.y1 < bbox.y2 && !rowHasZero(bbox, bbox.y1, &rowsBeingRendered) ) {
+            ++bbox.y1;
+        }
+        while ( bbox.y1 < bbox.y2 && !rowHasZero(bbox, bbox.y2 - 1, &rowsBeingRendered) ) {
+            --bbox.y2;
+        }
+        if ( bbox.isNull() ) {
+            *isBeingRenderedElsewhere |= rowsBeingRendered;
+
+            return bbox;
+        }
+        while ( bbox.x1 < bbox.x2 && !columnHasZero(bbox, bbox.x1, &rowsBeingRendered) ) {
+            ++bbox.x1;
+        }
+        while ( bbox.x1 < bbox.x2 && !columnHasZero(bbox, bbox.x2 - 1, &rowsBeingRendered) ) {
+            --bbox.x2;
+        }
+        *isBeingRenderedElsewhere |= rowsBeingRendered;
+
+        return bbox;
+    }
+
+private:
+
+    const char* pixel(int x,
+                      int y) const
+    {
+        return &_map[(y - _bounds.y1) * _bounds.width() + (x - _bounds.x1)];
+    }
+
+    char* pixel(int x,
+                int y)
+    {
+        return &_map[(y - _bounds.y1) * _bounds.width() + (x - _bounds.x1)];
+    }
+
+    // Returns true if the row of bbox has a 0, otherwise flags the pixels being rendered
+    bool rowHasZero(const RectI& bbox,
+                    int y,
+                    bool* beingRendered) const
+    {
+        bool metUnavailablePixel = false;
+
+        for (const char* pix = pixel(bbox.x1, y); pix < pixel(bbox.x2, y); ++pix) {
+            if (!*pix) {
+                return true;
+            }
+            metUnavailablePixel |= (*pix == 2);
+        }
+        *beingRendered |= metUnavailablePixel;
+
+        return false;
+    }
+
+    bool columnHasZero(const RectI& bbox,
+                       int x,
+                       bool* beingRendered) const
+    {
+        bool metUnavailablePixel = false;
+
+        for (int y = bbox.y1; y < bbox.y2; ++y) {
+            char value = *pixel(x, y);
+            if (!value) {
+                return true;
+            }
+            metUnavailablePixel |= (value == 2);
+        }
+        *beingRendered |= metUnavailablePixel;
+
+        return false;
+    }
+
+    RectI _bounds;
+    std::vector<char> _map;
+};
+
+TEST(BitmapTest,
+     TileRenderSpeed)
+{
+    // A 4K image rendered in 256x256 tiles: each tile is queried, marked as being rendered then as rendered,
+    // and the whole image is queried again as the next render of the image would
+    RectI rod(0, 0, 3840, 2160);
+    Bitmap bm(rod);
+    CharBitmap reference(rod);
+    std::vector<RectI> tiles;
+
+    for (int y = rod.y1; y < rod.y2; y += 256) {
+        for (int x = rod.x1; x < rod.x2; x += 256) {
+            tiles.push_back( RectI( x, y, std::min(x + 256, rod.x2), std::min(y + 256, rod.y2) ) );
+        }
+    }
+    std::cout << "Bitmap memory: " << bm.getSizeInBytes() << " bytes, " << reference.getSizeInBytes()
+              << " bytes with one char per pixel" << std::endl;
+    EXPECT_LE( bm.getSizeInBytes() * 4, reference.getSizeInBytes() + rod.height() * sizeof(U64) * 4 );
+
+    // Both give the same results
+    for (std::size_t i = 0; i < tiles.size(); ++i) {
+        bool beingRendered = false, referenceBeingRendered = false;
+        EXPECT_TRUE( bm.minimalNonMarkedBbox_trimap(tiles[i], &beingRendered) ==
+                     reference.minimalNonMarkedBbox_trimap(tiles[i], &referenceBeingRendered) );
+        bm.markForRendering(tiles[i]);
+        reference.markFor(tiles[i], 2);
+        bm.markForRendered(tiles[i]);
+        reference.markFor(tiles[i], 1);
+        EXPECT_TRUE( bm.minimalNonMarkedBbox_trimap(rod, &beingRendered) ==
+                     reference.minimalNonMarkedBbox_trimap(rod, &referenceBeingRendered) );
+        EXPECT_EQ(referenceBeingRendered, beingRendered);
+    }
+    bm.clear(rod);
+    reference.markFor(rod, 0);
+
+    QElapsedTimer timer;
+    timer.start();
+    for (std::size_t i = 0; i < tiles.size(); ++i) {
+        bool beingRendered = false;
+        RectI bbox = bm.minimalNonMarkedBbox_trimap(tiles[i], &beingRendered);
+        Q_UNUSED(bbox);
+        bm.markForRendering(tiles[i]);
+        bm.markForRendered(tiles[i]);
+        bbox = bm.minimalNonMarkedBbox_trimap(rod, &beingRendered);
+    }
+    qint64 packedTime = timer.elapsed();
+
+    timer.restart();
+    for (std::size_t i = 0; i < tiles.size(); ++i) {
+        bool beingRendered = false;
+        RectI bbox = reference.minimalNonMarkedBbox_trimap(tiles[i], &beingRendered);
+        Q_UNUSED(bbox);
+        reference.markFor(tiles[i], 2);
+        reference.markFor(tiles[i], 1);
+        bbox = reference.minimalNonMarkedBbox_trimap(rod, &beingRendered);
+    }
+    qint64 referenceTime = timer.elapsed();
+    std::cout << tiles.size() << " tiles: " << packedTime << " ms, " << referenceTime
+              << " ms with one char per pixel" << std::endl;
+} // TEST
+
 TEST(ImageKeyTest, Equality) {
     srand(2000);
     // coverity[dont_call]
@@ -26,8 +26,14 @@
 #include "Global/Macros.h"
 
 #include <cstdlib>
+#include <iostream>
+#include <vector>
 #include <gtest/gtest.h>
+
+#include <QtCore/QElapsedTimer>
+
 #include "Engine/Lut.h"
+#include "Engine/RectI.h"
 
 NATRON_NAMESPACE_USING
 using namespace NATRON_NAMESPACE::Color;
@@ -52,3 +58,168 @@ TEST(Lut, IntConversions) {
         EXPECT_EQ( i, uint8xxToChar( charToUint8xx(i) ) );
     }
 }
+
+TEST(Lut, BatchConversions) {
+    const Lut* lut = LutManager::sRGBLut();
+
+    lut->validate();
+
+    // All byte and short values, read every 3 elements as in an RGB image
+    std::vector<unsigned char> bytes(256 * 3);
+    std::vector<unsigned short> shorts(0x10000 * 3);
+    for (int i = 0; i < 0x10000; ++i) {
+        if (i < 256) {
+            bytes[i * 3] = (unsigned char)i;
+        }
+        shorts[i * 3] = (unsigned short)i;
+    }
+    std::vector<float> linear(0x10000);
+    lut->fromColorSpaceUint8ToLinearFloatFast(&bytes[0], &linear[0], 256, 3);
+    for (int i = 0; i < 256; ++i) {
+        EXPECT_EQ( lut->fromColorSpaceUint8ToLinearFloatFast( (unsigned char)i ), linear[i] );
+    }
+    lut->fromColorSpaceUint16ToLinearFloatFast(&shorts[0], &linear[0], 0x10000, 3);
+    for (int i = 0; i < 0x10000; ++i) {
+        EXPECT_EQ( lut->fromColorSpaceUint16ToLinearFloatFast( (unsigned short)i ), linear[i] );
+    }
+
+    // Linear values, including some outside of [0,1], written every 4 elements as in an RGBA image
+    const int n = 5000;
+    std::vector<float> values(n);
+    for (int i = 0; i < n; ++i) {
+        values[i] = -0.1f + 1.3f * i / (n - 1);
+    }
+    std::vector<unsigned short> uint8xx(n * 4), uint16(n * 4);
+    std::vector<float> floats(n * 4), fromFloats(n);
+    lut->toColorSpaceUint8xxFromLinearFloatFast(&values[0], &uint8xx[0], n, 1, 4);
+    lut->toColorSpaceUint16FromLinearFloatFast(&values[0], &uint16[0], n, 1, 4);
+    lut->toColorSpaceFloatFromLinearFloat(&values[0], &floats[0], n, 1, 4);
+    lut->fromColorSpaceFloatToLinearFloat(&values[0], &fromFloats[0], n);
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ( lut->toColorSpaceUint8xxFromLinearFloatFast(values[i]), uint8xx[i * 4] );
+        EXPECT_EQ( lut->toColorSpaceUint16FromLinearFloatFast(values[i]), uint16[i * 4] );
+        EXPECT_EQ( lut->toColorSpaceFloatFromLinearFloat(values[i]), floats[i * 4] );
+        EXPECT_EQ( lut->fromColorSpaceFloatToLinearFloat(values[i]), fromFloats[i] );
+    }
+}
+
+TEST(Lut, ErrorDiffusion) {
+    const Lut* lut = LutManager::sRGBLut();
+
+    lut->validate();
+
+    // A constant row between two byte values is dithered between them, with the right average
+    const int width = 1000;
+    const unsigned char low = 100;
+    const float value = ( lut->fromColorSpaceUint8ToLinearFloatFast(low) + lut->fromColorSpaceUint8ToLinearFloatFast(low + 1) ) / 2;
+    const int quantized = lut->toColorSpaceUint8xxFromLinearFloatFast(value);
+    std::vector<float> row(width, value);
+    for (int y = 0; y < 10; ++y) {
+        int start = errorDiffusionStart(y, width);
+        ASSERT_TRUE(start >= 0 && start < width);
+
+        std::vector<unsigned char> bytes(width), bytesAgain(width);
+        lut->toColorSpaceUint8FromLinearFloatFast(&row[0], &bytes[0], width, start);
+        lut->toColorSpaceUint8FromLinearFloatFast(&row[0], &bytesAgain[0], width, start);
+        EXPECT_TRUE(bytes == bytesAgain);
+
+        int sum = 0;
+        for (int x = 0; x < width; ++x) {
+            EXPECT_TRUE(bytes[x] == low || bytes[x] == low + 1);
+            sum += bytes[x];
+        }
+        EXPECT_NEAR( (double)sum / width, quantized / 256., 2. / width );
+    }
+
+    // The start only depends on the row, and changes from one row to the next
+    EXPECT_EQ( errorDiffusionStart(1234, width), errorDiffusionStart(1234, width) );
+    int nDistinct = 0;
+    for (int y = 1; y < 100; ++y) {
+        if ( errorDiffusionStart(y, width) != errorDiffusionStart(y - 1, width) ) {
+            ++nDistinct;
+        }
+    }
+    EXPECT_GT(nDistinct, 90);
+}
+
+// Converts an RGB image with the packed functions and with the batch functions, row by row and channel by channel as
+// ImageConvert does, checks that they give the same result and prints the time taken by each.
+TEST(Lut, BatchVsPackedBenchmark) {
+    const Lut* lut = LutManager::sRGBLut();
+
+    lut->validate();
+
+    const int width = 1920;
+    const int height = 1080;
+    const int nComps = 3;
+    const int nPix = width * height * nComps;
+    const RectI bounds(0, 0, width, height);
+    std::vector<unsigned char> bytes(nPix);
+    unsigned int state = 1;
+    for (int i = 0; i < nPix; ++i) {
+        state = state * 1664525u + 1013904223u;
+        bytes[i] = (unsigned char)(state >> 24);
+    }
+
+    // bytes to linear floats
+    std::vector<float> packedFloats(nPix), batchFloats(nPix);
+    QElapsedTimer timer;
+    timer.start();
+    lut->from_byte_packed(&packedFloats[0], &bytes[0], bounds, bounds, bounds, ePixelPackingRGB, ePixelPackingRGB, false, false);
+    qint64 packedTime = timer.nsecsElapsed();
+    timer.start();
+    for (int y = 0; y < height; ++y) {
+        for (int c = 0; c < nComps; ++c) {
+            int offset = y * width * nComps + c;
+            lut->fromColorSpaceUint8ToLinearFloatFast(&bytes[offset], &batchFloats[offset], width, nComps, nComps);
+        }
+    }
+    qint64 batchTime = timer.nsecsElapsed();
+    EXPECT_TRUE(packedFloats == batchFloats);
+    std::cout << "bytes to linear: from_byte_packed " << packedTime / 1000 << " us, batch " << batchTime / 1000 << " us" << std::endl;
+
+    // linear floats to dithered bytes: to_byte_packed flips the image vertically
+    std::vector<unsigned char> packedBytes(nPix), batchBytes(nPix);
+    timer.start();
+    lut->to_byte_packed(&packedBytes[0], &packedFloats[0], bounds, bounds, bounds, ePixelPackingRGB, ePixelPackingRGB, true, false);
+    packedTime = timer.nsecsElapsed();
+    timer.start();
+    for (int y = 0; y < height; ++y) {
+        int start = errorDiffusionStart(y, width);
+        for (int c = 0; c < nComps; ++c) {
+            lut->toColorSpaceUint8FromLinearFloatFast(&packedFloats[y * width * nComps + c], &batchBytes[(height - 1 - y) * width * nComps + c],
+                                                      width, start, nComps, nComps);
+        }
+    }
+    batchTime = timer.nsecsElapsed();
+    EXPECT_TRUE(packedBytes == batchBytes);
+    std::cout << "linear to bytes: to_byte_packed " << packedTime / 1000 << " us, batch " << batchTime / 1000 << " us" << std::endl;
+
+    // the batch versions of the short conversions, against their per-value versions
+    std::vector<unsigned short> shorts(nPix), shortsAgain(nPix);
+    for (int i = 0; i < nPix; ++i) {
+        state = state * 1664525u + 1013904223u;
+        shorts[i] = (unsigned short)(state >> 16);
+    }
+    timer.start();
+    for (int i = 0; i < nPix; ++i) {
+        packedFloats[i] = lut->fromColorSpaceUint16ToLinearFloatFast(shorts[i]);
+    }
+    qint64 valueTime = timer.nsecsElapsed();
+    timer.start();
+    lut->fromColorSpaceUint16ToLinearFloatFast(&shorts[0], &batchFloats[0], nPix);
+    batchTime = timer.nsecsElapsed();
+    EXPECT_TRUE(packedFloats == batchFloats);
+    std::cout << "shorts to linear: per value " << valueTime / 1000 << " us, batch " << batchTime / 1000 << " us" << std::endl;
+
+    timer.start();
+    for (int i = 0; i < nPix; ++i) {
+        shorts[i] = lut->toColorSpaceUint16FromLinearFloatFast(batchFloats[i]);
+    }
+    valueTime = timer.nsecsElapsed();
+    timer.start();
+    lut->toColorSpaceUint16FromLinearFloatFast(&batchFloats[0], &shortsAgain[0], nPix);
+    batchTime = timer.nsecsElapsed();
+    EXPECT_TRUE(shorts == shortsAgain);
+    std::cout << "linear to shorts: per value " << valueTime / 1000 << " us, batch " << batchTime / 1000 << " us" << std::endl;
+}
@@ -0,0 +1,273 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <QtCore/QElapsedTimer>
+
+#include "Engine/MipMapKernels.h"
+
+NATRON_NAMESPACE_USING
+
+// Fills a row with random values, and for floats with the values the kernels must handle specially
+static void
+makeRow(int size,
+        std::vector<unsigned char>* row)
+{
+    row->resize(size);
+    for (int i = 0; i < size; ++i) {
+        // favor the extreme values, whose sums are the largest
+        (*row)[i] = (std::rand() % 4 == 0) ? 255 : (unsigned char)(std::rand() % 256);
+    }
+}
+
+static void
+makeRow(int size,
+        std::vector<unsigned short>* row)
+{
+    row->resize(size);
+    for (int i = 0; i < size; ++i) {
+        (*row)[i] = (std::rand() % 4 == 0) ? 65535 : (unsigned short)(std::rand() % 65536);
+    }
+}
+
+static void
+makeRow(int size,
+        std::vector<float>* row)
+{
+    static const float special[] = {
+        0.f, -0.f, 1.f, -1.f, 1e-40f, 1e38f, -1e38f,
+        std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+        std::numeric_limits<float>::quiet_NaN()
+    };
+    const int nSpecial = sizeof(special) / sizeof(special[0]);
+
+    row->resize(size);
+    for (int i = 0; i < size; ++i) {
+        if (std::rand() % 4 == 0) {
+            (*row)[i] = special[std::rand() % nSpecial];
+        } else {
+            (*row)[i] = std::rand() / (float)RAND_MAX * 2.f - 0.5f;
+        }
+    }
+}
+
+// Values are equal, NaNs whatever their sign and payload, which depend on the order in which the compiler adds them
+template <typename PIX>
+static bool
+sameValue(PIX a,
+          PIX b)
+{
+    return a == b;
+}
+
+template <>
+bool
+sameValue(float a,
+          float b)
+{
+    return (a != a && b != b) || std::memcmp( &a, &b, sizeof(float) ) == 0;
+}
+
+static const int widths[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 64, 127 };
+
+template <typename PIX>
+static void
+checkHalveRows(int seed)
+{
+    std::srand(seed);
+    for (int nComps = 1; nComps <= 4; ++nComps) {
+        for (std::size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); ++w) {
+            const int width = widths[w];
+            // one more element so that the rows are not empty when width is 0
+            std::vector<PIX> row0, row1;
+            makeRow(2 * width * nComps + 1, &row0);
+            makeRow(2 * width * nComps + 1, &row1);
+            // and so that an overflow of the vectorized loops is detected
+            std::vector<PIX> ref(width * nComps + 1, (PIX)42), sse2(width * nComps + 1, (PIX)42);
+            MipMapKernels::Scalar::halveRows(&row0[0], &row1[0], width, nComps, &ref[0]);
+            EXPECT_EQ( (PIX)42, ref[width * nComps] );
+            if ( MipMapKernels::SSE2::isAvailable() ) {
+                MipMapKernels::SSE2::halveRows(&row0[0], &row1[0], width, nComps, &sse2[0]);
+                for (std::size_t i = 0; i < ref.size(); ++i) {
+                    EXPECT_TRUE( sameValue(ref[i], sse2[i]) ) << "nComps=" << nComps << " width=" << width << " i=" << i;
+                }
+            }
+        }
+    }
+}
+
+TEST(MipMapKernels, HalveRowsByte) {
+    checkHalveRows<unsigned char>(2018);
+}
+
+TEST(MipMapKernels, HalveRowsShort) {
+    checkHalveRows<unsigned short>(2019);
+}
+
+TEST(MipMapKernels, HalveRowsFloat) {
+    checkHalveRows<float>(2020);
+}
+
+TEST(MipMapKernels, HalveRowsBox) {
+    // 2x2 RGBA pixels halved to 1 pixel
+    const float row0[] = { 0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f };
+    const float row1[] = { 8.f, 9.f, 10.f, 11.f, 12.f, 13.f, 14.f, 15.f };
+    float dst[4];
+
+    MipMapKernels::halveRows(row0, row1, 1, 4, dst);
+    EXPECT_EQ(6.f, dst[0]);
+    EXPECT_EQ(7.f, dst[1]);
+    EXPECT_EQ(8.f, dst[2]);
+    EXPECT_EQ(9.f, dst[3]);
+
+    // integer depths truncate
+    const unsigned char b0[] = { 255, 254 };
+    const unsigned char b1[] = { 254, 254 };
+    unsigned char bdst;
+    MipMapKernels::halveRows(b0, b1, 1, 1, &bdst);
+    EXPECT_EQ(254, bdst);
+}
+
+// The per-pixel loop of Image::halveRoIForDepth which computed every pixel before the row kernels,
+// for a source image of srcWidth x srcHeight pixels whose origin is at (0,0)
+template <typename PIX>
+static void
+halveImagePerPixel(const PIX* src,
+                   int srcWidth,
+                   int srcHeight,
+                   int nComps,
+                   PIX* dst)
+{
+    const int srcRowSize = srcWidth * nComps;
+    const int dstRowSize = (srcWidth / 2) * nComps;
+
+    for (int y = 0; y < srcHeight / 2; ++y) {
+        const PIX* const srcLineStart = src + y * 2 * srcRowSize;
+        PIX* const dstLineStart = dst + y * dstRowSize;
+        int srcy = y * 2;
+        bool pickThisRow = 0 <= (srcy + 0) && (srcy + 0) < srcHeight;
+        bool pickNextRow = 0 <= (srcy + 1) && (srcy + 1) < srcHeight;
+        int sumH = (int)pickNextRow + (int)pickThisRow;
+
+        for (int x = 0; x < srcWidth / 2; ++x) {
+            const PIX* const srcPixStart = srcLineStart + x * 2 * nComps;
+            PIX* const dstPixStart = dstLineStart + x * nComps;
+            int srcx = x * 2;
+            bool pickThisCol = 0 <= (srcx + 0) && (srcx + 0) < srcWidth;
+            bool pickNextCol = 0 <= (srcx + 1) && (srcx + 1) < srcWidth;
+            int sumW = (int)pickThisCol + (int)pickNextCol;
+            const int sum = sumW * sumH;
+
+            if (sum == 0) {
+                for (int k = 0; k < nComps; ++k) {
+                    dstPixStart[k] = 0;
+                }
+                continue;
+            }
+
+            for (int k = 0; k < nComps; ++k) {
+                const PIX a = (pickThisCol && pickThisRow) ? *(srcPixStart + k) : 0;
+                const PIX b = (pickNextCol && pickThisRow) ? *(srcPixStart + k + nComps) : 0;
+                const PIX c = (pickThisCol && pickNextRow) ? *(srcPixStart + k + srcRowSize) : 0;
+                const PIX d = (pickNextCol && pickNextRow) ? *(srcPixStart + k + srcRowSize  + nComps)  : 0;
+                dstPixStart[k] = (a + b + c + d) / sum;
+            }
+        }
+    }
+}
+
+// The same image halved by the row kernels, as Image::halveRoIForDepth now does
+template <typename PIX>
+static void
+halveImageRows(const PIX* src,
+               int srcWidth,
+               int srcHeight,
+               int nComps,
+               PIX* dst)
+{
+    const int srcRowSize = srcWidth * nComps;
+    const int dstRowSize = (srcWidth / 2) * nComps;
+
+    for (int y = 0; y < srcHeight / 2; ++y) {
+        MipMapKernels::halveRows(src + y * 2 * srcRowSize, src + y * 2 * srcRowSize + srcRowSize, srcWidth / 2, nComps, dst + y * dstRowSize);
+    }
+}
+
+template <typename PIX>
+static void
+benchmarkHalveImage(const char* depthName,
+                    int seed)
+{
+    std::srand(seed);
+    const int srcWidth = 1920;
+    const int srcHeight = 1080;
+    const int nIterations = 10;
+
+    for (int nComps = 1; nComps <= 4; ++nComps) {
+        std::vector<PIX> src;
+        makeRow(srcWidth * srcHeight * nComps, &src);
+        std::vector<PIX> perPixel( (srcWidth / 2) * (srcHeight / 2) * nComps ), rows( perPixel.size() );
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < nIterations; ++i) {
+            halveImagePerPixel(&src[0], srcWidth, srcHeight, nComps, &perPixel[0]);
+        }
+        qint64 perPixelTime = timer.nsecsElapsed();
+
+        timer.start();
+        for (int i = 0; i < nIterations; ++i) {
+            halveImageRows(&src[0], srcWidth, srcHeight, nComps, &rows[0]);
+        }
+        qint64 rowsTime = timer.nsecsElapsed();
+
+        int nDifferent = 0;
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            if ( !sameValue(perPixel[i], rows[i]) ) {
+                ++nDifferent;
+            }
+        }
+        EXPECT_EQ(0, nDifferent) << depthName << " nComps=" << nComps;
+
+        std::cout << depthName << " " << nComps << " components: per-pixel " << perPixelTime / nIterations / 1000
+                  << " us, row kernels " << rowsTime / nIterations / 1000 << " us per "
+                  << srcWidth << "x" << srcHeight << " image ("
+                  << (MipMapKernels::SSE2::isAvailable() ? "SSE2" : "scalar") << ")" << std::endl;
+    }
+}
+
+TEST(MipMapKernels, HalveImageBenchmark) {
+    benchmarkHalveImage<unsigned char>("byte", 2021);
+    benchmarkHalveImage<unsigned short>("short", 2022);
+    benchmarkHalveImage<float>("float", 2023);
+}
@@ -0,0 +1,120 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <cmath>
+#include <gtest/gtest.h>
+#include "Engine/NativeExpression.h"
+
+#ifndef M_PI
+#define M_PI        3.14159265358979323846264338327950288   /* pi             */
+#endif
+
+NATRON_NAMESPACE_USING
+
+// Evaluates an expression not referencing any parameter
+static bool
+evaluate(const std::string& expr,
+         double frame,
+         double* value,
+         bool* isInt)
+{
+    NativeExpressionPtr e = NativeExpression::compile(expr, 0, 1);
+
+    if (!e) {
+        return false;
+    }
+
+    return e->evaluate(0, frame, ViewIdx(0), value, isInt);
+}
+
+#define EXPECT_EXPR(expr, frame, expectedValue, expectedIsInt) \
+    { \
+        double value = 0.; \
+        bool isInt = false; \
+        EXPECT_TRUE( evaluate(expr, frame, &value, &isInt) ) << expr; \
+        EXPECT_DOUBLE_EQ(expectedValue, value) << expr; \
+        EXPECT_EQ(expectedIsInt, isInt) << expr; \
+    }
+
+TEST(NativeExpression, Arithmetic) {
+    EXPECT_EXPR("frame * 2 + 1", 12, 25, true);
+    EXPECT_EXPR("frame * 2", 12.5, 25, false);
+    EXPECT_EXPR("-2 ** 2", 0, -4, true);
+    EXPECT_EXPR("2 ** -1", 0, 0.5, false);
+    EXPECT_EXPR("(frame + 1) * (frame - 1) / 3.0", 3, 8. / 3., false);
+    EXPECT_EXPR("1e3 + .5 + 1.", 0, 1001.5, false);
+    EXPECT_EXPR("dimension + view", 0, 1, true);
+    // Python rounds towards minus infinity and the modulo has the sign of the divisor
+    EXPECT_EXPR("frame // 2", -7, -4, true);
+    EXPECT_EXPR("frame % 3", -7, 2, true);
+    EXPECT_EXPR("frame % -2", 7.5, -0.5, false);
+    EXPECT_EXPR("-7 // -2.5", 0, 2, false);
+#if PY_MAJOR_VERSION >= 3
+    EXPECT_EXPR("frame / 2", 13, 6.5, false);
+#else
+    EXPECT_EXPR("frame / 2", 13, 6, true);
+    EXPECT_EXPR("frame / 2", -13, -7, true);
+#endif
+}
+
+TEST(NativeExpression, Functions) {
+    EXPECT_EXPR("sin(frame) + cos(frame)", 3, std::sin(3.) + std::cos(3.), false);
+    EXPECT_EXPR("log(8, 2)", 0, 3, false);
+    EXPECT_EXPR("abs(-3)", 0, 3, true);
+    EXPECT_EXPR("abs(-2.5)", 0, 2.5, false);
+    EXPECT_EXPR("min(3, 2.0, 2)", 0, 2, false);
+    EXPECT_EXPR("max(1, 4)", 0, 4, true);
+    EXPECT_EXPR("int(-3.7)", 0, -3, true);
+    EXPECT_EXPR("float(2)", 0, 2, false);
+    EXPECT_EXPR("pi", 0, M_PI, false);
+}
+
+TEST(NativeExpression, LeftToPython) {
+    double value;
+    bool isInt;
+
+    // Not compiled
+    EXPECT_FALSE( NativeExpression::compile("frame < 2", 0, 0) );
+    EXPECT_FALSE( NativeExpression::compile("\"abc\"", 0, 0) );
+    EXPECT_FALSE( NativeExpression::compile("012", 0, 0) );
+    EXPECT_FALSE( NativeExpression::compile("foo(1)", 0, 0) );
+    EXPECT_FALSE( NativeExpression::compile("frame.real", 0, 0) );
+    EXPECT_FALSE( NativeExpression::compile("sin(1, 2)", 0, 0) );
+    // random, curve and parameters need the knob
+    EXPECT_FALSE( NativeExpression::compile("random()", 0, 0) );
+    EXPECT_FALSE( NativeExpression::compile("thisNode.size.get()", 0, 0) );
+
+    // Python raises an exception
+    EXPECT_FALSE( evaluate("1 / 0", 0, &value, &isInt) );
+    EXPECT_FALSE( evaluate("1 % 0", 0, &value, &isInt) );
+    EXPECT_FALSE( evaluate("sqrt(-1)", 0, &value, &isInt) );
+    EXPECT_FALSE( evaluate("log(0)", 0, &value, &isInt) );
+    EXPECT_FALSE( evaluate("exp(1000)", 0, &value, &isInt) );
+    EXPECT_FALSE( evaluate("(-8) ** (1.0 / 3)", 0, &value, &isInt) );
+    // Python ints are not bounded
+    EXPECT_FALSE( evaluate("10 ** 20", 0, &value, &isInt) );
+}
@@ -0,0 +1,73 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <gtest/gtest.h>
+
+#include "Engine/ParallelRenderArgs.h"
+
+NATRON_NAMESPACE_USING
+
+static FrameViewPair
+makeFrameView(double time,
+              int view)
+{
+    FrameViewPair ret;
+
+    ret.time = time;
+    ret.view = ViewIdx(view);
+
+    return ret;
+}
+
+TEST(ParallelRenderArgs, FrameViewOrdering) {
+    FrameView_compare_less less;
+
+    // Strict weak ordering: irreflexive and asymmetric
+    EXPECT_FALSE( less( makeFrameView(1., 0), makeFrameView(1., 0) ) );
+    EXPECT_TRUE( less( makeFrameView(1., 0), makeFrameView(1., 1) ) );
+    EXPECT_FALSE( less( makeFrameView(1., 1), makeFrameView(1., 0) ) );
+    EXPECT_TRUE( less( makeFrameView(1., 1), makeFrameView(2., 0) ) );
+    EXPECT_FALSE( less( makeFrameView(2., 0), makeFrameView(1., 1) ) );
+
+    // Each frame/view of a node request is found again whatever the insertion order
+    NodeFrameViewRequestData frames;
+    int views[3] = { 2, 0, 1 };
+    for (int t = 0; t < 3; ++t) {
+        for (int i = 0; i < 3; ++i) {
+            frames[makeFrameView(t, views[i])].finalData.finalRoi = RectD(0, 0, t + 1, views[i] + 1);
+        }
+    }
+    ASSERT_EQ( (std::size_t)9, frames.size() );
+    for (int t = 0; t < 3; ++t) {
+        for (int v = 0; v < 3; ++v) {
+            NodeFrameViewRequestData::const_iterator found = frames.find( makeFrameView(t, v) );
+            ASSERT_TRUE( found != frames.end() );
+            EXPECT_EQ(t + 1, found->second.finalData.finalRoi.x2);
+            EXPECT_EQ(v + 1, found->second.finalData.finalRoi.y2);
+        }
+    }
+}
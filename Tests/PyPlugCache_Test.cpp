@@ -0,0 +1,192 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+
+#include "Engine/PyPlugCache.h"
+
+NATRON_NAMESPACE_USING
+
+static QString
+testPath(const char* fileName)
+{
+    return QDir::temp().absoluteFilePath( QString::fromUtf8("NatronPyPlugCacheTest_") + QString::fromUtf8(fileName) );
+}
+
+static void
+writeScript(const QString& filePath,
+            const char* content)
+{
+    QFile file(filePath);
+
+    ASSERT_TRUE( file.open(QIODevice::WriteOnly | QIODevice::Truncate) );
+    file.write(content);
+}
+
+static const PyPlugCache::Entry*
+findEntry(const std::vector<PyPlugCache::Entry>& entries,
+          const QString& scriptPath)
+{
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].scriptPath == scriptPath) {
+            return &entries[i];
+        }
+    }
+
+    return 0;
+}
+
+TEST(PyPlugCache, Scan) {
+    QStringList scripts;
+    scripts << testPath("Plug.py") << testPath("Module.py") << testPath("GuiPlug.py") << testPath("Missing.py");
+    writeScript(scripts[0], NATRON_PYPLUG_MAGIC "\ndef createInstance(app, group):\n    pass\n");
+    writeScript(scripts[1], "def foo():\n    return 1\n");
+    writeScript(scripts[2], "from " NATRON_GUI_PYTHON_MODULE_NAME " import *\ndef getIsToolSet():\n    return True\n");
+    QFile::remove(scripts[3]);
+
+    PyPlugCache cache;
+    std::vector<PyPlugCache::Entry> serial, parallel;
+    cache.scanScripts(scripts, &serial, false);
+    cache.scanScripts(scripts, &parallel, true);
+    ASSERT_EQ( 3, (int)serial.size() );
+    ASSERT_EQ( 3, (int)parallel.size() );
+    for (std::size_t i = 0; i < serial.size(); ++i) {
+        EXPECT_EQ(serial[i].scriptPath, parallel[i].scriptPath);
+        EXPECT_EQ(serial[i].isPyPlug, parallel[i].isPyPlug);
+        EXPECT_EQ(serial[i].importsNatronGui, parallel[i].importsNatronGui);
+        EXPECT_FALSE(serial[i].hasInfos);
+    }
+
+    const PyPlugCache::Entry* plug = findEntry(serial, scripts[0]);
+    ASSERT_TRUE(plug != 0);
+    EXPECT_TRUE(plug->isPyPlug);
+    EXPECT_FALSE(plug->importsNatronGui);
+    const PyPlugCache::Entry* module = findEntry(serial, scripts[1]);
+    ASSERT_TRUE(module != 0);
+    EXPECT_FALSE(module->isPyPlug);
+    const PyPlugCache::Entry* guiPlug = findEntry(serial, scripts[2]);
+    ASSERT_TRUE(guiPlug != 0);
+    EXPECT_TRUE(guiPlug->isPyPlug);
+    EXPECT_TRUE(guiPlug->importsNatronGui);
+    EXPECT_TRUE( findEntry(serial, scripts[3]) == 0 );
+
+    for (int i = 0; i < scripts.size(); ++i) {
+        QFile::remove(scripts[i]);
+    }
+}
+
+TEST(PyPlugCache, Incremental) {
+    QString cachePath = testPath("Cache.bin");
+    QStringList scripts;
+    scripts << testPath("Plug1.py") << testPath("Plug2.py");
+    writeScript(scripts[0], "def createInstance(app, group):\n    pass\n");
+    writeScript(scripts[1], "def createInstance(app, group):\n    pass\n");
+    QFile::remove(cachePath);
+
+    // First launch: nothing is cached, the infos are those returned by the scripts
+    {
+        PyPlugCache cache;
+        EXPECT_FALSE( cache.read(cachePath) );
+
+        std::vector<PyPlugCache::Entry> entries;
+        cache.scanScripts(scripts, &entries);
+        ASSERT_EQ( 2, (int)entries.size() );
+        for (std::size_t i = 0; i < entries.size(); ++i) {
+            entries[i].hasInfos = true;
+            entries[i].pluginID = i == 0 ? "fr.inria.Plug1" : "fr.inria.Plug2";
+            entries[i].pluginLabel = "Plug";
+            entries[i].grouping = "Other/Group";
+            entries[i].version = 3;
+            cache.insert(entries[i]);
+        }
+        EXPECT_TRUE( cache.isDirty() );
+        EXPECT_TRUE( cache.write(cachePath) );
+    }
+
+    // Second launch: the scripts did not change, they are registered from the cache
+    {
+        PyPlugCache cache;
+        EXPECT_TRUE( cache.read(cachePath) );
+
+        std::vector<PyPlugCache::Entry> entries;
+        cache.scanScripts(scripts, &entries);
+        ASSERT_EQ( 2, (int)entries.size() );
+        const PyPlugCache::Entry* e = findEntry(entries, scripts[1]);
+        ASSERT_TRUE(e != 0);
+        EXPECT_TRUE(e->hasInfos);
+        EXPECT_EQ("fr.inria.Plug2", e->pluginID);
+        EXPECT_EQ("Other/Group", e->grouping);
+        EXPECT_EQ(3u, e->version);
+        for (std::size_t i = 0; i < entries.size(); ++i) {
+            cache.insert(entries[i]);
+        }
+        EXPECT_FALSE( cache.isDirty() );
+    }
+
+    // Only the script that changed is scanned again, and a removed script is dropped from the cache
+    writeScript(scripts[0], "def createInstance(app, group):\n    pass\n\ndef getLabel():\n    return 'Plug'\n");
+    QFile::remove(scripts[1]);
+    scripts << testPath("Plug3.py");
+    writeScript(scripts[2], "def foo():\n    pass\n");
+    {
+        PyPlugCache cache;
+        EXPECT_TRUE( cache.read(cachePath) );
+
+        std::vector<PyPlugCache::Entry> entries;
+        cache.scanScripts(scripts, &entries);
+        ASSERT_EQ( 2, (int)entries.size() );
+        const PyPlugCache::Entry* e = findEntry(entries, scripts[0]);
+        ASSERT_TRUE(e != 0);
+        EXPECT_TRUE(e->isPyPlug);
+        EXPECT_FALSE(e->hasInfos);
+        e = findEntry(entries, scripts[2]);
+        ASSERT_TRUE(e != 0);
+        EXPECT_FALSE(e->isPyPlug);
+        cache.insert(entries[1]);
+        EXPECT_TRUE( cache.isDirty() );
+    }
+
+    // A cache written by another version is ignored
+    {
+        QFile file(cachePath);
+        ASSERT_TRUE( file.open(QIODevice::WriteOnly | QIODevice::Truncate) );
+        file.write("garbage");
+    }
+    {
+        PyPlugCache cache;
+        EXPECT_FALSE( cache.read(cachePath) );
+    }
+
+    for (int i = 0; i < scripts.size(); ++i) {
+        QFile::remove(scripts[i]);
+    }
+    QFile::remove(cachePath);
+}
@@ -0,0 +1,168 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QThread>
+
+#include "Engine/RenderTrace.h"
+
+NATRON_NAMESPACE_USING
+
+namespace {
+class TraceThread
+    : public QThread
+{
+public:
+
+    int nEvents;
+
+    TraceThread(int nEvents,
+                const char* name)
+        : nEvents(nEvents)
+    {
+        setObjectName( QString::fromUtf8(name) );
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        for (int i = 0; i < nEvents; ++i) {
+            RenderTraceScope trace("render", kRenderTraceCategoryRender);
+        }
+    }
+};
+
+int
+countOccurrences(const std::string& str,
+                 const std::string& pattern)
+{
+    int n = 0;
+
+    for (std::size_t pos = str.find(pattern); pos != std::string::npos; pos = str.find(pattern, pos + 1)) {
+        ++n;
+    }
+
+    return n;
+}
+}
+
+TEST(RenderTrace, Disabled) {
+    RenderTrace::setEnabled(false);
+    RenderTrace::clear();
+    {
+        RenderTraceScope trace("renderRoI", kRenderTraceCategoryRender);
+    }
+    EXPECT_EQ( 0, RenderTrace::getNumEvents() );
+}
+
+TEST(RenderTrace, ChromeTrace) {
+    RenderTrace::clear();
+    RenderTrace::setEnabled(true);
+    {
+        RenderTraceScope outer("renderRoI", kRenderTraceCategoryRender);
+        RenderTraceScope inner("Cache::get", kRenderTraceCategoryCache);
+    }
+    RenderTrace::addEvent( "render", kRenderTraceCategoryAction, std::string("Blur\"1"), 1000, 3500 );
+
+    // Events of other threads are kept after they exit, and older events are overwritten
+    const int nThreadEvents = (1 << NATRON_RENDER_TRACE_EVENTS_PER_THREAD_LOG2) + 10;
+    TraceThread t1(nThreadEvents, "t1"), t2(5, "t2");
+    t1.start();
+    t2.start();
+    t1.wait();
+    t2.wait();
+    RenderTrace::setEnabled(false);
+
+    // The slot of the oldest event of a full buffer is the one written next, it is not read
+    EXPECT_EQ( 3 + (1 << NATRON_RENDER_TRACE_EVENTS_PER_THREAD_LOG2) - 1 + 5, RenderTrace::getNumEvents() );
+
+    std::stringstream ss;
+    RenderTrace::writeChromeTrace(ss);
+    std::string json = ss.str();
+    EXPECT_EQ( 0u, json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[") );
+    EXPECT_EQ( RenderTrace::getNumEvents(), countOccurrences(json, "\"ph\":\"X\"") );
+    EXPECT_EQ( 3, countOccurrences(json, "\"ph\":\"M\"") );
+    EXPECT_NE( std::string::npos, json.find("\"name\":\"render\",\"cat\":\"action\",\"ph\":\"X\",\"ts\":1.000,\"dur\":2.500") );
+    EXPECT_NE( std::string::npos, json.find("\"args\":{\"node\":\"Blur\\\"1\"}") );
+    EXPECT_NE( std::string::npos, json.find("\"name\":\"Cache::get\",\"cat\":\"cache\"") );
+
+    RenderTrace::clear();
+    EXPECT_EQ( 0, RenderTrace::getNumEvents() );
+}
+
+TEST(RenderTrace, FinishedThreads) {
+    RenderTrace::clear();
+    RenderTrace::setEnabled(true);
+
+    // A thread reuses the buffer of a finished thread of the same name
+    for (int i = 0; i < 10; ++i) {
+        TraceThread t(5, "t");
+        t.start();
+        t.wait();
+    }
+    EXPECT_EQ( 50, RenderTrace::getNumEvents() );
+
+    std::stringstream ss;
+    RenderTrace::writeChromeTrace(ss);
+    EXPECT_EQ( 1, countOccurrences(ss.str(), "\"ph\":\"M\"") );
+
+    // clear() frees the buffers of the threads that exited
+    RenderTrace::clear();
+    TraceThread t(3, "t");
+    t.start();
+    t.wait();
+    RenderTrace::setEnabled(false);
+    EXPECT_EQ( 3, RenderTrace::getNumEvents() );
+    ss.str( std::string() );
+    RenderTrace::writeChromeTrace(ss);
+    EXPECT_NE( std::string::npos, ss.str().find("\"tid\":") );
+    EXPECT_EQ( 1, countOccurrences(ss.str(), "\"ph\":\"M\"") );
+
+    RenderTrace::clear();
+}
+
+TEST(RenderTrace, WriteWhileRendering) {
+    RenderTrace::clear();
+    RenderTrace::setEnabled(true);
+
+    // The trace is written while a thread records enough events to wrap its buffer several times
+    TraceThread t(8 * (1 << NATRON_RENDER_TRACE_EVENTS_PER_THREAD_LOG2), "t");
+    t.start();
+    for (int i = 0; i < 20; ++i) {
+        std::stringstream ss;
+        RenderTrace::writeChromeTrace(ss);
+        std::string json = ss.str();
+        EXPECT_LT( countOccurrences(json, "\"ph\":\"X\""), 1 << NATRON_RENDER_TRACE_EVENTS_PER_THREAD_LOG2 );
+        EXPECT_EQ( 0, countOccurrences(json, "\"name\":\"\"") );
+    }
+    t.wait();
+    RenderTrace::setEnabled(false);
+    RenderTrace::clear();
+}
@@ -0,0 +1,371 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <algorithm> // max
+#include <cmath>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <cairo/cairo.h>
+
+#include "Engine/RotoRasterizer.h"
+
+NATRON_NAMESPACE_USING
+
+static Point
+makePoint(double x,
+          double y)
+{
+    Point p;
+
+    p.x = x;
+    p.y = y;
+
+    return p;
+}
+
+static void
+addRectangle(std::vector<Point>* contour,
+             double x1,
+             double y1,
+             double x2,
+             double y2)
+{
+    contour->push_back( makePoint(x1, y1) );
+    contour->push_back( makePoint(x2, y1) );
+    contour->push_back( makePoint(x2, y2) );
+    contour->push_back( makePoint(x1, y2) );
+}
+
+static RotoRasterizer::FeatherPatch
+makePatch(double x0, double y0,
+          double x1, double y1,
+          double x2, double y2,
+          double x3, double y3)
+{
+    RotoRasterizer::FeatherPatch patch;
+
+    patch.p[0] = makePoint(x0, y0);
+    patch.p[1] = makePoint(x1, y1);
+    patch.p[2] = makePoint(x2, y2);
+    patch.p[3] = makePoint(x3, y3);
+
+    return patch;
+}
+
+// A disc of the given radius with a feather of the given width, made of nPoints points as the polygons of the beziers
+static RotoRasterizer::Shape
+makeFeatheredDisc(double cx,
+                  double cy,
+                  double radius,
+                  double featherWidth,
+                  double fallOff,
+                  int nPoints)
+{
+    RotoRasterizer::Shape shape;
+
+    shape.fallOff = fallOff;
+    for (int i = 0; i < nPoints; ++i) {
+        double a = 2. * M_PI * i / nPoints;
+        shape.contour.push_back( makePoint(cx + radius * std::cos(a), cy + radius * std::sin(a) ) );
+    }
+    for (int i = 0; i < nPoints; ++i) {
+        double a0 = 2. * M_PI * ( (i + nPoints - 1) % nPoints ) / nPoints;
+        double a1 = 2. * M_PI * i / nPoints;
+        double r = radius + featherWidth;
+        shape.feather.push_back( makePatch(cx + radius * std::cos(a0), cy + radius * std::sin(a0),
+                                           cx + r * std::cos(a0), cy + r * std::sin(a0),
+                                           cx + r * std::cos(a1), cy + r * std::sin(a1),
+                                           cx + radius * std::cos(a1), cy + radius * std::sin(a1) ) );
+    }
+
+    return shape;
+}
+
+TEST(RotoRasterizer, OpaqueShape) {
+    RectI bounds(-10, -10, 50, 50);
+    RotoRasterizer rasterizer(bounds);
+    RotoRasterizer::Shape shape;
+
+    addRectangle(&shape.contour, 0, 0, 20, 30);
+    rasterizer.addShape(shape);
+
+    for (int y = bounds.y1; y < bounds.y2; ++y) {
+        for (int x = bounds.x1; x < bounds.x2; ++x) {
+            float expected = (x >= 0 && x < 20 && y >= 0 && y < 30) ? 1.f : 0.f;
+            EXPECT_EQ( expected, rasterizer.getCoverageAt(x, y) );
+        }
+    }
+    EXPECT_EQ( 0.f, rasterizer.getCoverageAt(1000, 0) );
+}
+
+TEST(RotoRasterizer, Winding) {
+    // The contour is filled with the non-zero winding rule, as cairo_fill() does by default
+    RectI bounds(0, 0, 40, 40);
+    RotoRasterizer rasterizer(bounds);
+    RotoRasterizer::Shape shape;
+
+    // Two overlapping rectangles joined by a segment going back and forth
+    addRectangle(&shape.contour, 0, 0, 20, 20);
+    shape.contour.push_back( makePoint(0, 0) );
+    addRectangle(&shape.contour, 10, 10, 30, 30);
+    shape.contour.push_back( makePoint(10, 10) );
+    rasterizer.addShape(shape);
+
+    EXPECT_EQ( 1.f, rasterizer.getCoverageAt(5, 5) );
+    EXPECT_EQ( 1.f, rasterizer.getCoverageAt(15, 15) );
+    EXPECT_EQ( 1.f, rasterizer.getCoverageAt(25, 25) );
+    EXPECT_EQ( 0.f, rasterizer.getCoverageAt(25, 5) );
+    EXPECT_EQ( 0.f, rasterizer.getCoverageAt(35, 35) );
+}
+
+TEST(RotoRasterizer, Feather) {
+    // A feather going from the shape at x = 0 to the outer edge at x = 100
+    RectI bounds(0, 0, 100, 4);
+    RotoRasterizer rasterizer(bounds);
+    RotoRasterizer::Shape shape;
+
+    shape.feather.push_back( makePatch(0, 0, 100, 0, 100, 4, 0, 4) );
+    rasterizer.addShape(shape);
+
+    float prev = 1.f;
+    for (int x = 0; x < 100; ++x) {
+        float v = rasterizer.getCoverageAt(x, 2);
+        EXPECT_LE(v, prev);
+        EXPECT_FLOAT_EQ( v, rasterizer.getCoverageAt(x, 1) );
+        prev = v;
+    }
+    EXPECT_GT(rasterizer.getCoverageAt(0, 2), 0.95f);
+    EXPECT_LT(rasterizer.getCoverageAt(99, 2), 0.05f);
+
+    // The opacity is squared as with the cairo mask, and the fall-off curve is symmetric for a fall-off of 1
+    EXPECT_NEAR(0.25f, rasterizer.getCoverageAt(50, 2), 0.02f);
+
+    // A larger fall-off makes the feather more transparent
+    RotoRasterizer hardRasterizer(bounds);
+    shape.fallOff = 3.;
+    hardRasterizer.addShape(shape);
+    EXPECT_LT( hardRasterizer.getCoverageAt(50, 2), rasterizer.getCoverageAt(50, 2) );
+}
+
+TEST(RotoRasterizer, OverlappingPatches) {
+    // The last patch replaces the pixels of the previous ones, as in the cairo mesh rasterizer
+    RectI bounds(0, 0, 10, 10);
+    RotoRasterizer::Shape shape;
+
+    shape.feather.push_back( makePatch(0, 0, 10, 0, 10, 10, 0, 10) );
+    shape.feather.push_back( makePatch(10, 0, 0, 0, 0, 10, 10, 10) );
+
+    RotoRasterizer rasterizer(bounds);
+    rasterizer.addShape(shape);
+
+    RotoRasterizer::Shape last;
+    last.feather.push_back(shape.feather.back());
+    RotoRasterizer lastOnly(bounds);
+    lastOnly.addShape(last);
+
+    for (int y = bounds.y1; y < bounds.y2; ++y) {
+        for (int x = bounds.x1; x < bounds.x2; ++x) {
+            EXPECT_EQ( lastOnly.getCoverageAt(x, y), rasterizer.getCoverageAt(x, y) );
+        }
+    }
+}
+
+TEST(RotoRasterizer, Tiles) {
+    // The result does not depend on how the tiles are rendered
+    RectI bounds(-3, -7, 3 * NATRON_ROTO_RASTERIZER_TILE_SIZE + 11, 2 * NATRON_ROTO_RASTERIZER_TILE_SIZE + 5);
+    RotoRasterizer::Shape shape = makeFeatheredDisc(180.5, 120.25, 100., 30., 0.5, 64);
+
+    RotoRasterizer serial(bounds);
+    RotoRasterizer parallel(bounds);
+    serial.addShape(shape, false);
+    parallel.addShape(shape, true);
+
+    for (int y = bounds.y1; y < bounds.y2; ++y) {
+        for (int x = bounds.x1; x < bounds.x2; ++x) {
+            ASSERT_EQ( serial.getCoverageAt(x, y), parallel.getCoverageAt(x, y) );
+        }
+    }
+
+    // Rendering a part of the bounds only gives the same pixels
+    RectI part(100, 50, 100 + NATRON_ROTO_RASTERIZER_TILE_SIZE / 2, 250);
+    RotoRasterizer partial(part);
+    partial.addShape(shape);
+    for (int y = part.y1; y < part.y2; ++y) {
+        for (int x = part.x1; x < part.x2; ++x) {
+            ASSERT_EQ( serial.getCoverageAt(x, y), partial.getCoverageAt(x, y) );
+        }
+    }
+}
+
+TEST(RotoRasterizer, Compositing) {
+    RectI bounds(0, 0, 10, 10);
+    RotoRasterizer rasterizer(bounds);
+    RotoRasterizer::Shape shape;
+
+    shape.feather.push_back( makePatch(0, 0, 20, 0, 20, 10, 0, 10) );
+    rasterizer.addShape(shape);
+    float once = rasterizer.getCoverageAt(5, 5);
+    EXPECT_GT(once, 0.f);
+    EXPECT_LT(once, 1.f);
+
+    // A second sample is composited over the first one, as motion blur samples are
+    rasterizer.addShape(shape);
+    EXPECT_FLOAT_EQ( once + once * (1.f - once), rasterizer.getCoverageAt(5, 5) );
+
+    // The interior covers the pixels fully
+    addRectangle(&shape.contour, 0, 0, 10, 10);
+    rasterizer.addShape(shape);
+    EXPECT_EQ( 1.f, rasterizer.getCoverageAt(5, 5) );
+}
+
+TEST(RotoRasterizer, CubicToContour) {
+    Point p0 = makePoint(0, 0), p1 = makePoint(100, 300), p2 = makePoint(300, -200), p3 = makePoint(400, 100);
+    std::vector<Point> contour;
+
+    RotoRasterizer::appendCubicToContour(p0, p1, p2, p3, &contour);
+    ASSERT_GT(contour.size(), (std::size_t)10);
+    EXPECT_EQ(p3.x, contour.back().x);
+    EXPECT_EQ(p3.y, contour.back().y);
+
+    // All the points of the curve are within the tolerance of the polygon
+    contour.insert(contour.begin(), p0);
+    for (int i = 0; i <= 1000; ++i) {
+        double t = i / 1000.;
+        double u = 1. - t;
+        double x = u * u * u * p0.x + 3 * u * u * t * p1.x + 3 * u * t * t * p2.x + t * t * t * p3.x;
+        double y = u * u * u * p0.y + 3 * u * u * t * p1.y + 3 * u * t * t * p2.y + t * t * t * p3.y;
+        double minDist = 1e10;
+        for (std::size_t j = 0; j + 1 < contour.size(); ++j) {
+            const Point& a = contour[j];
+            const Point& b = contour[j + 1];
+            double dx = b.x - a.x, dy = b.y - a.y;
+            double l = std::max( 0., std::min( 1., ( (x - a.x) * dx + (y - a.y) * dy ) / (dx * dx + dy * dy) ) );
+            minDist = std::min( minDist, std::sqrt( (a.x + l * dx - x) * (a.x + l * dx - x) + (a.y + l * dy - y) * (a.y + l * dy - y) ) );
+        }
+        EXPECT_LT(minDist, 0.1);
+    }
+}
+
+// Renders the shape as RotoContextPrivate::renderBezier does with cairo
+static void
+renderShapeWithCairo(const RotoRasterizer::Shape& shape,
+                     cairo_t* cr)
+{
+    cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+    cairo_new_path(cr);
+
+    cairo_pattern_t* mesh = cairo_pattern_create_mesh();
+    const double fallOff = shape.fallOff;
+    const double fallOffInverse = 1. / fallOff;
+    for (std::size_t i = 0; i < shape.feather.size(); ++i) {
+        const Point* p = shape.feather[i].p;
+        double p0p1x = (p[0].x * fallOff * 2. + fallOffInverse * p[1].x) / (fallOff * 2. + fallOffInverse);
+        double p0p1y = (p[0].y * fallOff * 2. + fallOffInverse * p[1].y) / (fallOff * 2. + fallOffInverse);
+        double p1p0x = (p[0].x * fallOff + 2. * fallOffInverse * p[1].x) / (fallOff + 2. * fallOffInverse);
+        double p1p0y = (p[0].y * fallOff + 2. * fallOffInverse * p[1].y) / (fallOff + 2. * fallOffInverse);
+        double p2p3x = (p[3].x * fallOff + 2. * fallOffInverse * p[2].x) / (fallOff + 2. * fallOffInverse);
+        double p2p3y = (p[3].y * fallOff + 2. * fallOffInverse * p[2].y) / (fallOff + 2. * fallOffInverse);
+        double p3p2x = (p[3].x * fallOff * 2. + fallOffInverse * p[2].x) / (fallOff * 2. + fallOffInverse);
+        double p3p2y = (p[3].y * fallOff * 2. + fallOffInverse * p[2].y) / (fallOff * 2. + fallOffInverse);
+
+        cairo_mesh_pattern_begin_patch(mesh);
+        cairo_mesh_pattern_move_to(mesh, p[0].x, p[0].y);
+        cairo_mesh_pattern_curve_to(mesh, p0p1x, p0p1y, p1p0x, p1p0y, p[1].x, p[1].y);
+        cairo_mesh_pattern_line_to(mesh, p[2].x, p[2].y);
+        cairo_mesh_pattern_curve_to(mesh, p2p3x, p2p3y, p3p2x, p3p2y, p[3].x, p[3].y);
+        cairo_mesh_pattern_line_to(mesh, p[0].x, p[0].y);
+        cairo_mesh_pattern_set_corner_color_rgba(mesh, 0, 1., 1., 1., 1.);
+        cairo_mesh_pattern_set_corner_color_rgba(mesh, 1, 1., 1., 1., 0.);
+        cairo_mesh_pattern_set_corner_color_rgba(mesh, 2, 1., 1., 1., 0.);
+        cairo_mesh_pattern_set_corner_color_rgba(mesh, 3, 1., 1., 1., 1.);
+        cairo_mesh_pattern_end_patch(mesh);
+    }
+
+    cairo_set_source_rgba(cr, 1, 1, 1, 1);
+    if ( !shape.contour.empty() ) {
+        cairo_move_to(cr, shape.contour[0].x, shape.contour[0].y);
+        for (std::size_t i = 1; i < shape.contour.size(); ++i) {
+            cairo_line_to(cr, shape.contour[i].x, shape.contour[i].y);
+        }
+        cairo_fill(cr);
+    }
+
+    cairo_set_source(cr, mesh);
+    cairo_mask(cr, mesh);
+    cairo_pattern_destroy(mesh);
+}
+
+TEST(RotoRasterizer, SameAsCairo) {
+    // Compare with the cairo rendering of the same shape, with the settings of RotoDrawableItem::renderMaskInternal
+    RectI bounds(0, 0, 300, 260);
+    cairo_surface_t* cairoImg = cairo_image_surface_create( CAIRO_FORMAT_A8, bounds.width(), bounds.height() );
+    ASSERT_EQ( CAIRO_STATUS_SUCCESS, cairo_surface_status(cairoImg) );
+    cairo_t* cr = cairo_create(cairoImg);
+    cairo_set_fill_rule(cr, CAIRO_FILL_RULE_WINDING);
+    cairo_set_antialias(cr, CAIRO_ANTIALIAS_NONE);
+
+    RotoRasterizer rasterizer(bounds);
+    // Two motion blur samples with different fall-offs
+    RotoRasterizer::Shape shapes[2] = {
+        makeFeatheredDisc(140.5, 120.25, 80., 35., 1., 100),
+        makeFeatheredDisc(160.75, 130.5, 70., 20., 2.5, 77)
+    };
+    for (int i = 0; i < 2; ++i) {
+        renderShapeWithCairo(shapes[i], cr);
+        rasterizer.addShape(shapes[i]);
+    }
+    cairo_surface_flush(cairoImg);
+
+    const unsigned char* data = cairo_image_surface_get_data(cairoImg);
+    const int stride = cairo_image_surface_get_stride(cairoImg);
+    int nCovered = 0;
+    int nDifferent = 0;
+    double sumDiff = 0.;
+    for (int y = bounds.y1; y < bounds.y2; ++y) {
+        for (int x = bounds.x1; x < bounds.x2; ++x) {
+            float cairoCoverage = data[y * stride + x] / 255.f;
+            float coverage = rasterizer.getCoverageAt(x, y);
+            if ( (cairoCoverage > 0.f) || (coverage > 0.f) ) {
+                ++nCovered;
+            }
+            float diff = std::abs(cairoCoverage - coverage);
+            sumDiff += diff;
+            // Pixels on the edges of the patches may be sampled differently by the cairo mesh rasterizer
+            if (diff > 0.05f) {
+                ++nDifferent;
+            }
+        }
+    }
+    ASSERT_GT(nCovered, 0);
+    EXPECT_LT(nDifferent, nCovered / 100);
+    EXPECT_LT(sumDiff / nCovered, 0.01);
+
+    cairo_destroy(cr);
+    cairo_surface_destroy(cairoImg);
+}
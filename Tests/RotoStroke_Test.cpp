@@ -0,0 +1,198 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <algorithm> // max
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <boost/make_shared.hpp>
+
+#include <QtCore/QElapsedTimer>
+
+#include "Engine/Image.h"
+#include "Engine/RotoContextPrivate.h"
+
+NATRON_NAMESPACE_USING
+
+// The dots of a stroke along a sine wave across the image, with a soft brush whose pressure varies
+static std::vector<RotoContextPrivate::StrokeDot>
+makeStrokeDots(const RectI& bounds,
+               int nDots,
+               double radius)
+{
+    std::vector<RotoContextPrivate::StrokeDot> dots(nDots);
+
+    for (int i = 0; i < nDots; ++i) {
+        double t = nDots > 1 ? (double)i / (nDots - 1) : 0.;
+        RotoContextPrivate::StrokeDot& dot = dots[i];
+        dot.center.x = bounds.x1 + radius + t * (bounds.width() - 2 * radius);
+        dot.center.y = (bounds.y1 + bounds.y2) / 2. + std::sin(t * 6.) * (bounds.height() / 2. - radius);
+        dot.pressure = 0.5 + 0.5 * std::sin(t * 20.);
+        dot.internalRadius = radius * 0.5;
+        dot.externalRadius = radius;
+        dot.opacityStops.push_back( std::make_pair(0., 0.8) );
+        dot.opacityStops.push_back( std::make_pair(1., 0.) );
+    }
+
+    return dots;
+}
+
+static ImagePtr
+makeStrokeImage(const ImagePlaneDesc& components,
+                const RectI& bounds)
+{
+    RectD rod(bounds.x1, bounds.y1, bounds.x2, bounds.y2);
+    ImagePtr image = boost::make_shared<Image>(components, rod, bounds, 0, 1., eImageBitDepthFloat, eImagePremultiplicationPremultiplied, eImageFieldingOrderNone);
+
+    image->fillZero(bounds);
+
+    return image;
+}
+
+// Renders the dots in 2 movements, the second one composited over the first, as successive movements of the brush are
+static void
+renderStroke(const std::vector<RotoContextPrivate::StrokeDot>& dots,
+             int bandHeight,
+             bool doBuildUp,
+             Image* image)
+{
+    const double shapeColor[3] = { 1., 0.5, 0.25 };
+    const RectI& bounds = image->getBounds();
+    std::size_t half = dots.size() / 2;
+    std::vector<RotoContextPrivate::StrokeDot> first(dots.begin(), dots.begin() + half);
+    std::vector<RotoContextPrivate::StrokeDot> second(dots.begin() + half, dots.end());
+
+    RotoContextPrivate::renderStrokeDots(first, bounds, bandHeight, doBuildUp, 1., shapeColor, false, 0, image);
+    RotoContextPrivate::renderStrokeDots(second, bounds, bandHeight, doBuildUp, 1., shapeColor, true, 0, image);
+}
+
+// Returns the number of values which differ by more than an 8-bit step
+static int
+countDifferentValues(const Image* a,
+                     const Image* b)
+{
+    const RectI& bounds = a->getBounds();
+    int nComps = (int)a->getComponentsCount();
+    Image::ReadAccess accA = a->getReadRights();
+    Image::ReadAccess accB = b->getReadRights();
+    int nDifferent = 0;
+
+    for (int y = bounds.y1; y < bounds.y2; ++y) {
+        const float* pixA = (const float*)accA.pixelAt(bounds.x1, y);
+        const float* pixB = (const float*)accB.pixelAt(bounds.x1, y);
+        for (int i = 0; i < bounds.width() * nComps; ++i) {
+            if (std::abs(pixA[i] - pixB[i]) > 1.f / 255.f) {
+                ++nDifferent;
+            }
+        }
+    }
+
+    return nDifferent;
+}
+
+// Returns the sum of the values of the image, to check that something was rendered
+static double
+sumValues(const Image* image)
+{
+    const RectI& bounds = image->getBounds();
+    int nComps = (int)image->getComponentsCount();
+    Image::ReadAccess acc = image->getReadRights();
+    double sum = 0.;
+
+    for (int y = bounds.y1; y < bounds.y2; ++y) {
+        const float* pix = (const float*)acc.pixelAt(bounds.x1, y);
+        for (int i = 0; i < bounds.width() * nComps; ++i) {
+            sum += pix[i];
+        }
+    }
+
+    return sum;
+}
+
+TEST(RotoStroke, BandsSameAsSingleBand) {
+    // Bands which do not divide the height, and dots overlapping several bands
+    const RectI bounds(10, -20, 310, 237);
+    std::vector<RotoContextPrivate::StrokeDot> dots = makeStrokeDots(bounds, 200, 30.);
+    const int bandHeights[] = { 1, 7, 64 };
+
+    for (int buildUp = 0; buildUp < 2; ++buildUp) {
+        for (int rgba = 0; rgba < 2; ++rgba) {
+            const ImagePlaneDesc& components = rgba ? ImagePlaneDesc::getRGBAComponents() : ImagePlaneDesc::getAlphaComponents();
+            ImagePtr singleBand = makeStrokeImage(components, bounds);
+            renderStroke(dots, bounds.height(), (bool)buildUp, singleBand.get());
+            EXPECT_LT( 0., sumValues( singleBand.get() ) );
+
+            for (std::size_t i = 0; i < sizeof(bandHeights) / sizeof(bandHeights[0]); ++i) {
+                ImagePtr bands = makeStrokeImage(components, bounds);
+                renderStroke(dots, bandHeights[i], (bool)buildUp, bands.get());
+                EXPECT_EQ( 0, countDifferentValues( singleBand.get(), bands.get() ) ) << "buildUp=" << buildUp << " rgba=" << rgba << " bandHeight=" << bandHeights[i];
+            }
+        }
+    }
+}
+
+TEST(RotoStroke, BrushLatency) {
+    // A large soft brush painting a stroke across a 2K image, the stroke image being updated at each movement of the
+    // pen as in RotoStrokeItem::renderSingleStroke: the latency is the time to render the dots added by one movement
+    const RectI bounds(0, 0, 2048, 1556);
+    const double radius = 200.;
+    const int nMovements = 50;
+    const int nDotsPerMovement = 20;
+    const double shapeColor[3] = { 1., 1., 1. };
+    std::vector<RotoContextPrivate::StrokeDot> dots = makeStrokeDots(bounds, nMovements * nDotsPerMovement, radius);
+
+    const int bandHeights[] = { bounds.height(), 64 };
+    for (std::size_t b = 0; b < sizeof(bandHeights) / sizeof(bandHeights[0]); ++b) {
+        ImagePtr image = makeStrokeImage(ImagePlaneDesc::getAlphaComponents(), bounds);
+        qint64 totalTime = 0;
+        qint64 maxTime = 0;
+        for (int m = 0; m < nMovements; ++m) {
+            std::vector<RotoContextPrivate::StrokeDot> movement(dots.begin() + m * nDotsPerMovement, dots.begin() + (m + 1) * nDotsPerMovement);
+            // The movement is rendered in the bbox of its dots
+            RectI movementBounds;
+            for (std::size_t i = 0; i < movement.size(); ++i) {
+                RectI dotBounds( (int)std::floor(movement[i].center.x - radius), (int)std::floor(movement[i].center.y - radius),
+                                 (int)std::ceil(movement[i].center.x + radius) + 1, (int)std::ceil(movement[i].center.y + radius) + 1 );
+                movementBounds.merge(dotBounds);
+            }
+            movementBounds.intersect(bounds, &movementBounds);
+            int bandHeight = bandHeights[b] == bounds.height() ? movementBounds.height() : bandHeights[b];
+
+            QElapsedTimer timer;
+            timer.start();
+            RotoContextPrivate::renderStrokeDots(movement, movementBounds, bandHeight, true, 1., shapeColor, m > 0, 0, image.get());
+            qint64 elapsed = timer.nsecsElapsed();
+            totalTime += elapsed;
+            maxTime = std::max(maxTime, elapsed);
+        }
+        EXPECT_LT( 0., sumValues( image.get() ) );
+        std::cout << (b == 0 ? "single band" : "bands of 64 rows") << ": mean latency " << totalTime / nMovements / 1000
+                  << " us, max latency " << maxTime / 1000 << " us per movement of " << nDotsPerMovement << " dots" << std::endl;
+    }
+}
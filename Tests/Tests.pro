@@ -45,11 +45,26 @@ SOURCES += \
     google-mock/src/gmock-all.cc \
     BaseTest.cpp \
     Hash64_Test.cpp \
+    HashCone_Test.cpp \
     Image_Test.cpp \
     Lut_Test.cpp \
+    NativeExpression_Test.cpp \
     KnobFile_Test.cpp \
     Curve_Test.cpp \
     Tracker_Test.cpp \
+    ViewerTextureKernels_Test.cpp \
+    CacheJournal_Test.cpp \
+    RotoRasterizer_Test.cpp \
+    RotoStroke_Test.cpp \
+    PyPlugCache_Test.cpp \
+    ThreadTeam_Test.cpp \
+    BufferPool_Test.cpp \
+    RenderTrace_Test.cpp \
+    MipMapKernels_Test.cpp \
+    ViewerSpeculativeRenderer_Test.cpp \
+    CacheCompression_Test.cpp \
+    ParallelRenderArgs_Test.cpp \
+    Cache_Test.cpp \
     wmain.cpp
 
 HEADERS += \
@@ -0,0 +1,323 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <algorithm> // min, max
+#include <iostream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QThread>
+#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
+
+#include "Engine/AppManager.h"
+#include "Engine/EffectInstance.h"
+#include "Engine/OfxHost.h"
+#include "Engine/TLSHolder.h"
+#include "Engine/ThreadPool.h"
+
+NATRON_NAMESPACE_USING
+
+static void
+countTask(std::vector<QAtomicInt>* counts,
+          int task)
+{
+    (*counts)[task].fetchAndAddOrdered(1);
+}
+
+TEST(ThreadTeam, ManySmallCalls) {
+    // As a plug-in calling multiThread() for each block of rows would
+    ThreadTeam team;
+
+    for (int call = 0; call < 10000; ++call) {
+        int nTasks = 1 + call % 7;
+        std::vector<QAtomicInt> counts(nTasks);
+        ASSERT_TRUE( team.tryRun( nTasks, 1 + call % 5, boost::bind(countTask, &counts, _1) ) );
+        for (int i = 0; i < nTasks; ++i) {
+            ASSERT_EQ( 1, (int)counts[i] );
+        }
+    }
+    // The team grew to the largest number of threads asked for, the calling thread excluded
+    EXPECT_EQ( 4, team.getNWorkers() );
+
+    // More threads allowed later: the team grows
+    std::vector<QAtomicInt> counts(16);
+    ASSERT_TRUE( team.tryRun( 16, 8, boost::bind(countTask, &counts, _1) ) );
+    EXPECT_EQ( 7, team.getNWorkers() );
+    for (int i = 0; i < 16; ++i) {
+        ASSERT_EQ( 1, (int)counts[i] );
+    }
+}
+
+static ThreadTeam* nestedTeam = 0;
+static QAtomicInt nNestedCallsRefused;
+
+static void
+nestedTask(int /*task*/)
+{
+    std::vector<QAtomicInt> counts(2);
+
+    if ( !nestedTeam->tryRun( 2, 2, boost::bind(countTask, &counts, _1) ) ) {
+        nNestedCallsRefused.fetchAndAddOrdered(1);
+    }
+}
+
+TEST(ThreadTeam, Nested) {
+    // A call made from a task of the team is refused, the caller runs it some other way
+    ThreadTeam team;
+
+    nestedTeam = &team;
+    nNestedCallsRefused.fetchAndStoreOrdered(0);
+    ASSERT_TRUE( team.tryRun(8, 4, nestedTask) );
+    EXPECT_EQ( 8, (int)nNestedCallsRefused );
+    nestedTeam = 0;
+}
+
+// A synthetic plug-in processing a frame by blocks of rows, calling multiThread() for each block as some plug-ins do
+struct SyntheticPluginBlock
+{
+    std::vector<float>* pixels;
+    int width;
+    int y1, y2;
+};
+
+static void
+syntheticPluginThreadFunction(unsigned int threadIndex,
+                              unsigned int threadMax,
+                              void* customArg)
+{
+    const SyntheticPluginBlock* block = (const SyntheticPluginBlock*)customArg;
+    int nRows = block->y2 - block->y1;
+    int y1 = block->y1 + nRows * (int)threadIndex / (int)threadMax;
+    int y2 = block->y1 + nRows * ( (int)threadIndex + 1 ) / (int)threadMax;
+
+    for (int y = y1; y < y2; ++y) {
+        float* pix = &(*block->pixels)[(std::size_t)y * block->width];
+        for (int x = 0; x < block->width; ++x) {
+            pix[x] = pix[x] * 0.5f + 0.25f;
+        }
+    }
+}
+
+static void
+syntheticPluginTask(unsigned int threadMax,
+                    void* customArg,
+                    int threadIndex)
+{
+    syntheticPluginThreadFunction( (unsigned int)threadIndex, threadMax, customArg );
+}
+
+// A fresh thread per call, as the multi-thread suite does when the thread pool is disabled
+class SyntheticPluginThread
+    : public QThread
+{
+public:
+
+    SyntheticPluginThread(unsigned int threadIndex,
+                          unsigned int threadMax,
+                          void* customArg)
+        : QThread()
+        , _threadIndex(threadIndex)
+        , _threadMax(threadMax)
+        , _customArg(customArg)
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        syntheticPluginThreadFunction(_threadIndex, _threadMax, _customArg);
+    }
+
+    unsigned int _threadIndex;
+    unsigned int _threadMax;
+    void* _customArg;
+};
+
+enum SyntheticPluginDispatchEnum
+{
+    eSyntheticPluginDispatchTeam,
+    eSyntheticPluginDispatchThreadPool,
+    eSyntheticPluginDispatchFreshThreads,
+    eSyntheticPluginDispatchOfxHost
+};
+
+// Renders nFrames frames of the synthetic plug-in and returns the time it took in milliseconds
+static double
+renderSyntheticPlugin(SyntheticPluginDispatchEnum dispatch,
+                      int nFrames,
+                      unsigned int nThreads,
+                      std::vector<float>* pixels,
+                      int width,
+                      int height,
+                      int rowsPerCall)
+{
+    ThreadTeam team;
+    std::vector<unsigned int> threadIndexes(nThreads);
+
+    for (unsigned int i = 0; i < nThreads; ++i) {
+        threadIndexes[i] = i;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int frame = 0; frame < nFrames; ++frame) {
+        for (int y = 0; y < height; y += rowsPerCall) {
+            SyntheticPluginBlock block;
+            block.pixels = pixels;
+            block.width = width;
+            block.y1 = y;
+            block.y2 = std::min(y + rowsPerCall, height);
+            switch (dispatch) {
+            case eSyntheticPluginDispatchTeam: {
+                bool ran = team.tryRun( nThreads, nThreads, boost::bind(syntheticPluginTask, nThreads, &block, _1) );
+                EXPECT_TRUE(ran);
+                break;
+            }
+            case eSyntheticPluginDispatchThreadPool:
+                QtConcurrent::map( threadIndexes, boost::bind(syntheticPluginThreadFunction, _1, nThreads, &block) ).waitForFinished();
+                break;
+            case eSyntheticPluginDispatchFreshThreads: {
+                std::vector<SyntheticPluginThread*> threads(nThreads);
+                for (unsigned int i = 0; i < nThreads; ++i) {
+                    threads[i] = new SyntheticPluginThread(i, nThreads, &block);
+                    threads[i]->start();
+                }
+                for (unsigned int i = 0; i < nThreads; ++i) {
+                    threads[i]->wait();
+                    delete threads[i];
+                }
+                break;
+            }
+            case eSyntheticPluginDispatchOfxHost: {
+                OfxStatus stat = const_cast<OfxHost*>( appPTR->getOFXHost() )->multiThread(syntheticPluginThreadFunction, nThreads, &block);
+                EXPECT_EQ(kOfxStatOK, stat);
+                break;
+            }
+            }
+        }
+    }
+
+    return timer.nsecsElapsed() / 1e6;
+}
+
+TEST(ThreadTeam, SyntheticPluginBenchmark) {
+    // Compares the dispatch of many small multiThread() calls, each processing 8 rows of a 1920x1080 frame
+    const int width = 1920;
+    const int height = 1080;
+    const int rowsPerCall = 8;
+    const int nFrames = 20;
+    const unsigned int nThreads = (unsigned int)std::max(2, QThread::idealThreadCount());
+    const char* names[4] = { "persistent team", "QtConcurrent::map", "fresh threads", "OfxHost::multiThread" };
+    std::vector<float> reference;
+
+    std::cout << nFrames * ( (height + rowsPerCall - 1) / rowsPerCall ) << " multiThread() calls on " << nThreads << " threads:" << std::endl;
+    for (int i = 0; i < 4; ++i) {
+        std::vector<float> pixels( (std::size_t)width * height, 1.f );
+        double ms = renderSyntheticPlugin( (SyntheticPluginDispatchEnum)i, nFrames, nThreads, &pixels, width, height, rowsPerCall );
+        std::cout << "  " << names[i] << ": " << ms << " ms" << std::endl;
+
+        // All the dispatches process each row once per frame
+        if ( reference.empty() ) {
+            reference = pixels;
+        } else {
+            EXPECT_TRUE(pixels == reference);
+        }
+    }
+}
+
+typedef TLSHolder<EffectInstance::EffectTLSData> EffectTLSHolder;
+
+struct TileTLSCheck
+{
+    const QThread* callingThread;
+    boost::shared_ptr<EffectTLSHolder> tls;
+    QAtomicInt nHelperTasks;
+    QAtomicInt nInvalidHelperTLS;
+};
+
+// QThread::usleep() is not public in Qt 4
+static void
+busyWait(qint64 nsecs)
+{
+    QElapsedTimer timer;
+
+    timer.start();
+    while (timer.nsecsElapsed() < nsecs) {
+    }
+}
+
+static bool
+tileTLSTask(TileTLSCheck* check,
+            int /*task*/)
+{
+    EffectInstance::EffectTLSDataPtr tls = check->tls->getTLSData();
+
+    if ( QThread::currentThread() == check->callingThread ) {
+        // As the render of a tile does with its render args
+        tls->currentRenderArgs.validArgs = true;
+        tls->userPlaneStrings.push_back("tile");
+        busyWait(500000);
+        tls->userPlaneStrings.pop_back();
+        tls->currentRenderArgs.validArgs = false;
+    } else {
+        check->nHelperTasks.fetchAndAddOrdered(1);
+        // A helper inherits the TLS of the calling thread as it was before any tile was rendered
+        if ( !tls || tls->currentRenderArgs.validArgs || (tls->userPlaneStrings.size() != 1) ) {
+            check->nInvalidHelperTLS.fetchAndAddOrdered(1);
+        }
+        busyWait(500000);
+    }
+
+    return true;
+}
+
+TEST(TileScheduler, HostFrameThreadingTLS) {
+    // The calling thread renders tiles, modifying its TLS, while the helpers of the pool start and copy it
+    TileTLSCheck check;
+
+    check.callingThread = QThread::currentThread();
+    check.tls = boost::make_shared<EffectTLSHolder>();
+    check.nHelperTasks.fetchAndStoreOrdered(0);
+    check.nInvalidHelperTLS.fetchAndStoreOrdered(0);
+    check.tls->getOrCreateTLSData()->userPlaneStrings.push_back("render");
+
+    for (int i = 0; i < 20; ++i) {
+        TileScheduler scheduler( 64, boost::bind(tileTLSTask, &check, _1) );
+        EXPECT_TRUE( scheduler.run() );
+    }
+    EXPECT_EQ( 0, (int)check.nInvalidHelperTLS );
+    std::cout << (int)check.nHelperTasks << " tiles out of " << 20 * 64 << " rendered by the helpers" << std::endl;
+
+    appPTR->getAppTLS()->cleanupTLSForThread();
+}
@@ -0,0 +1,232 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <boost/make_shared.hpp>
+
+#include <QtCore/QThread>
+
+#include "Engine/AbortableRenderInfo.h"
+#include "Engine/AppManager.h"
+#include "Engine/Cache.h"
+#include "Engine/Image.h"
+#include "Engine/ImageKey.h"
+#include "Engine/ImageParams.h"
+#include "Engine/OutputSchedulerThread.h"
+#include "Engine/TLSHolder.h"
+#include "Engine/ThreadPool.h"
+#include "Engine/ViewIdx.h"
+
+NATRON_NAMESPACE_USING
+
+static std::vector<int>
+framesToRender(int time,
+               int direction,
+               int nFrames,
+               int first,
+               int last)
+{
+    std::vector<int> frames;
+
+    ViewerSpeculativeRenderer::getFramesToRender(time, direction, nFrames, first, last, &frames);
+
+    return frames;
+}
+
+TEST(ViewerSpeculativeRenderer, NoDirection) {
+    const int expected[] = { 11, 9, 12, 8, 13, 7 };
+    std::vector<int> frames = framesToRender(10, 0, 6, 1, 100);
+
+    EXPECT_EQ( std::vector<int>( expected, expected + sizeof(expected) / sizeof(expected[0]) ), frames );
+}
+
+TEST(ViewerSpeculativeRenderer, ScrubDirection) {
+    const int forward[] = { 11, 12, 9, 13, 14, 8 };
+    std::vector<int> frames = framesToRender(10, 1, 6, 1, 100);
+    EXPECT_EQ( std::vector<int>( forward, forward + sizeof(forward) / sizeof(forward[0]) ), frames );
+
+    const int backward[] = { 9, 8, 11, 7, 6, 12 };
+    frames = framesToRender(10, -1, 6, 1, 100);
+    EXPECT_EQ( std::vector<int>( backward, backward + sizeof(backward) / sizeof(backward[0]) ), frames );
+}
+
+TEST(ViewerSpeculativeRenderer, TimelineBounds) {
+    // The frames past the end are skipped, the others are still rendered
+    const int expected[] = { 100, 98, 97, 96, 95 };
+    std::vector<int> frames = framesToRender(99, 1, 5, 1, 100);
+    EXPECT_EQ( std::vector<int>( expected, expected + sizeof(expected) / sizeof(expected[0]) ), frames );
+
+    // All the frames of a short range
+    frames = framesToRender(2, -1, 10, 1, 3);
+    const int all[] = { 1, 3 };
+    EXPECT_EQ( std::vector<int>( all, all + sizeof(all) / sizeof(all[0]) ), frames );
+
+    EXPECT_TRUE( framesToRender(1, 0, 10, 1, 1).empty() );
+    EXPECT_TRUE( framesToRender(10, 1, 0, 1, 100).empty() );
+}
+
+// Allocates images in a cache on behalf of a render, as the threads of a render do
+class CacheRenderThread
+    : public QThread
+    , public AbortableThread
+{
+public:
+
+    CacheRenderThread(Cache<Image>* cache,
+                      const AbortableRenderInfoPtr& abortInfo,
+                      int firstKey,
+                      int nImages)
+        : QThread()
+        , AbortableThread(this)
+        , bytesAllocated(0)
+        , _cache(cache)
+        , _abortInfo(abortInfo)
+        , _firstKey(firstKey)
+        , _nImages(nImages)
+    {
+    }
+
+    std::size_t bytesAllocated;
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        if (_abortInfo) {
+            setAbortInfo(false, _abortInfo, EffectInstancePtr());
+        }
+        ImageParamsPtr params = boost::make_shared<ImageParams>( RectD(0, 0, 16, 16), 1., 0, RectI(0, 0, 16, 16), eImageBitDepthByte, eImageFieldingOrderNone,
+                                                                 eImagePremultiplicationPremultiplied, false, ImagePlaneDesc::getRGBAComponents(),
+                                                                 eStorageModeRAM, 0 );
+        for (int i = 0; i < _nImages; ++i) {
+            ImagePtr image;
+            _cache->getOrCreate(ImageKey(0, _firstKey + i, false, 0, ViewIdx(0), 1., false, false), params, 0, &image);
+            image->allocateMemory();
+            bytesAllocated += image->size();
+        }
+        clearAbortInfo();
+    }
+
+    Cache<Image>* _cache;
+    AbortableRenderInfoPtr _abortInfo;
+    int _firstKey;
+    int _nImages;
+};
+
+TEST(ViewerSpeculativeRenderer, CacheBytesOfRender) {
+    Cache<Image> cache("TestCache", NATRON_CACHE_VERSION, 1024 * 1024 * 1024, 1.);
+    AbortableRenderInfoPtr abortInfo = AbortableRenderInfo::create(true, 0);
+
+    CacheRenderThread renderThread(&cache, abortInfo, 1, 10);
+    renderThread.start();
+    renderThread.wait();
+    EXPECT_LT( (std::size_t)0, renderThread.bytesAllocated );
+    EXPECT_EQ( renderThread.bytesAllocated, abortInfo->getCacheBytesAllocated() );
+
+    // The entries allocated by threads which do not run the render are not accounted for
+    CacheRenderThread otherThread(&cache, AbortableRenderInfoPtr(), 100, 10);
+    otherThread.start();
+    otherThread.wait();
+    EXPECT_EQ( renderThread.bytesAllocated, abortInfo->getCacheBytesAllocated() );
+
+    cache.waitForDeleterThread();
+}
+
+// Joins the render of its spawner thread as the threads of the thread pool do, and records its priority
+class HelperThread
+    : public QThread
+{
+public:
+
+    HelperThread(QThread* spawnerThread)
+        : QThread()
+        , priorityWhileHelping(QThread::InheritPriority)
+        , priorityAfterHelping(QThread::InheritPriority)
+        , _spawnerThread(spawnerThread)
+    {
+    }
+
+    QThread::Priority priorityWhileHelping;
+    QThread::Priority priorityAfterHelping;
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        appPTR->getAppTLS()->copyTLS(_spawnerThread, this);
+        priorityWhileHelping = priority();
+        appPTR->getAppTLS()->cleanupTLSForThread();
+        priorityAfterHelping = priority();
+    }
+
+    QThread* _spawnerThread;
+};
+
+class SpawnerThread
+    : public QThread
+{
+public:
+
+    SpawnerThread(HelperThread** helper)
+        : QThread()
+        , _helper(helper)
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        *_helper = new HelperThread(this);
+        (*_helper)->start(QThread::NormalPriority);
+        (*_helper)->wait();
+    }
+
+    HelperThread** _helper;
+};
+
+TEST(ViewerSpeculativeRenderer, HelperThreadsPriority) {
+    // The helpers of a background render run at its priority while they help it
+    HelperThread* helper = 0;
+    SpawnerThread spawner(&helper);
+    spawner.start(QThread::LowestPriority);
+    spawner.wait();
+    ASSERT_TRUE(helper);
+    EXPECT_EQ(QThread::LowestPriority, helper->priorityWhileHelping);
+    EXPECT_EQ(QThread::NormalPriority, helper->priorityAfterHelping);
+    delete helper;
+
+    // The helpers of a render at a higher priority keep theirs
+    SpawnerThread normalSpawner(&helper);
+    normalSpawner.start(QThread::HighPriority);
+    normalSpawner.wait();
+    ASSERT_TRUE(helper);
+    EXPECT_EQ(QThread::NormalPriority, helper->priorityWhileHelping);
+    EXPECT_EQ(QThread::NormalPriority, helper->priorityAfterHelping);
+    delete helper;
+}
@@ -0,0 +1,232 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <https://natrongithub.github.io/>,
+ * (C) 2018-2020 The Natron developers
+ * (C) 2013-2018 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <algorithm> // max
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <QtCore/QElapsedTimer>
+
+#include "Engine/ViewerTextureKernels.h"
+
+NATRON_NAMESPACE_USING
+
+// Fills a row of RGBA pixels with random values in [-0.5, 1.5] and with the values the kernels must handle specially
+static void
+makeRow(int width,
+        std::vector<float>* row)
+{
+    static const float special[] = {
+        0.f, -0.f, 1.f, -1.f, 0.5f, 1.0001f, 0.9999f, 1e-8f, 2.f, 1e30f, -1e30f,
+        std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+        std::numeric_limits<float>::quiet_NaN()
+    };
+    const int nSpecial = sizeof(special) / sizeof(special[0]);
+
+    row->resize(width * 4);
+    for (int i = 0; i < width * 4; ++i) {
+        if (std::rand() % 4 == 0) {
+            (*row)[i] = special[std::rand() % nSpecial];
+        } else {
+            (*row)[i] = std::rand() / (float)RAND_MAX * 2.f - 0.5f;
+        }
+    }
+}
+
+static const int widths[] = { 0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 64, 127 };
+static const double gains[] = { 1., 0.5, 2.7, 1e-3 };
+static const double offsets[] = { 0., 0.1, -0.25 };
+
+TEST(ViewerTextureKernels, ToBGRA8) {
+    std::srand(2016);
+    for (std::size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); ++w) {
+        const int width = widths[w];
+        std::vector<float> row;
+        makeRow(width, &row);
+        for (std::size_t g = 0; g < sizeof(gains) / sizeof(gains[0]); ++g) {
+            for (std::size_t o = 0; o < sizeof(offsets) / sizeof(offsets[0]); ++o) {
+                for (int opaque = 0; opaque < 2; ++opaque) {
+                    // one more element so that an overflow of the vectorized loops is detected
+                    std::vector<U32> ref(width + 1, 0xdeadbeef), sse2(width + 1, 0xdeadbeef), avx2(width + 1, 0xdeadbeef);
+                    const float* src = width ? &row[0] : 0;
+                    ViewerTextureKernels::Scalar::toBGRA8(src, width, gains[g], offsets[o], opaque, &ref[0]);
+                    if ( ViewerTextureKernels::SSE2::isAvailable() ) {
+                        ViewerTextureKernels::SSE2::toBGRA8(src, width, gains[g], offsets[o], opaque, &sse2[0]);
+                        for (int x = 0; x <= width; ++x) {
+                            EXPECT_EQ(ref[x], sse2[x]) << "width=" << width << " x=" << x;
+                        }
+                    }
+                    if ( ViewerTextureKernels::AVX2::isAvailable() ) {
+                        ViewerTextureKernels::AVX2::toBGRA8(src, width, gains[g], offsets[o], opaque, &avx2[0]);
+                        for (int x = 0; x <= width; ++x) {
+                            EXPECT_EQ(ref[x], avx2[x]) << "width=" << width << " x=" << x;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(ViewerTextureKernels, ApplyGainOffset) {
+    std::srand(2017);
+    for (std::size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); ++w) {
+        const int width = widths[w];
+        std::vector<float> row;
+        makeRow(width, &row);
+        const float* src = width ? &row[0] : 0;
+        for (std::size_t g = 0; g < sizeof(gains) / sizeof(gains[0]); ++g) {
+            for (std::size_t o = 0; o < sizeof(offsets) / sizeof(offsets[0]); ++o) {
+                std::vector<float> ref(width * 4 + 1, 42.f), sse2(width * 4 + 1, 42.f), avx2(width * 4 + 1, 42.f);
+                ViewerTextureKernels::Scalar::applyGainOffsetRGBA(src, width, gains[g], offsets[o], &ref[0]);
+                // compare the bit patterns so that NaNs compare equal
+                if ( ViewerTextureKernels::SSE2::isAvailable() ) {
+                    ViewerTextureKernels::SSE2::applyGainOffsetRGBA(src, width, gains[g], offsets[o], &sse2[0]);
+                    EXPECT_EQ( 0, std::memcmp( &ref[0], &sse2[0], ref.size() * sizeof(float) ) ) << "width=" << width;
+                }
+                if ( ViewerTextureKernels::AVX2::isAvailable() ) {
+                    ViewerTextureKernels::AVX2::applyGainOffsetRGBA(src, width, gains[g], offsets[o], &avx2[0]);
+                    EXPECT_EQ( 0, std::memcmp( &ref[0], &avx2[0], ref.size() * sizeof(float) ) ) << "width=" << width;
+                }
+            }
+        }
+    }
+}
+
+TEST(ViewerTextureKernels, CopyRGBA32) {
+    std::srand(2018);
+    for (std::size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); ++w) {
+        const int width = widths[w];
+        std::vector<float> row;
+        makeRow(width, &row);
+        const float* src = width ? &row[0] : 0;
+        for (int opaque = 0; opaque < 2; ++opaque) {
+            std::vector<float> ref(width * 4 + 1, 42.f), sse2(width * 4 + 1, 42.f);
+            ViewerTextureKernels::Scalar::copyRGBA32(src, width, opaque, &ref[0]);
+            if ( ViewerTextureKernels::SSE2::isAvailable() ) {
+                ViewerTextureKernels::SSE2::copyRGBA32(src, width, opaque, &sse2[0]);
+                EXPECT_EQ( 0, std::memcmp( &ref[0], &sse2[0], ref.size() * sizeof(float) ) ) << "width=" << width;
+            }
+        }
+    }
+}
+
+TEST(ViewerTextureKernels, ToBGRA8Channels) {
+    static const int channels[][3] = { { 0, 1, 2 }, { 0, 0, 0 }, { 1, 1, 1 }, { 2, 2, 2 }, { 3, 3, 3 } };
+
+    std::srand(2019);
+    for (std::size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); ++w) {
+        const int width = widths[w];
+        std::vector<float> row;
+        makeRow(width, &row);
+        const float* src = width ? &row[0] : 0;
+        for (std::size_t c = 0; c < sizeof(channels) / sizeof(channels[0]); ++c) {
+            for (int matteChannel = -1; matteChannel < 4; ++matteChannel) {
+                for (int opaque = 0; opaque < 2; ++opaque) {
+                    const double gain = gains[(c + matteChannel + 1) % ( sizeof(gains) / sizeof(gains[0]) )];
+                    const double offset = offsets[(w + c) % ( sizeof(offsets) / sizeof(offsets[0]) )];
+                    std::vector<U32> ref(width + 1, 0xdeadbeef), sse2(width + 1, 0xdeadbeef), avx2(width + 1, 0xdeadbeef);
+                    ViewerTextureKernels::Scalar::toBGRA8Channels(src, width, gain, offset, opaque,
+                                                                  channels[c][0], channels[c][1], channels[c][2], matteChannel, &ref[0]);
+                    if ( (c == 0) && (matteChannel == -1) ) {
+                        // Same as toBGRA8 with the default channels and no matte
+                        std::vector<U32> def(width + 1, 0xdeadbeef);
+                        ViewerTextureKernels::Scalar::toBGRA8(src, width, gain, offset, opaque, &def[0]);
+                        EXPECT_TRUE(ref == def) << "width=" << width;
+                    }
+                    if ( ViewerTextureKernels::SSE2::isAvailable() ) {
+                        ViewerTextureKernels::SSE2::toBGRA8Channels(src, width, gain, offset, opaque,
+                                                                    channels[c][0], channels[c][1], channels[c][2], matteChannel, &sse2[0]);
+                        for (int x = 0; x <= width; ++x) {
+                            EXPECT_EQ(ref[x], sse2[x]) << "width=" << width << " x=" << x << " channel=" << channels[c][0] << " matte=" << matteChannel;
+                        }
+                    }
+                    if ( ViewerTextureKernels::AVX2::isAvailable() ) {
+                        ViewerTextureKernels::AVX2::toBGRA8Channels(src, width, gain, offset, opaque,
+                                                                    channels[c][0], channels[c][1], channels[c][2], matteChannel, &avx2[0]);
+                        for (int x = 0; x <= width; ++x) {
+                            EXPECT_EQ(ref[x], avx2[x]) << "width=" << width << " x=" << x << " channel=" << channels[c][0] << " matte=" << matteChannel;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Times the conversion of a HD image to the 8-bit texture by each implementation
+TEST(ViewerTextureKernels, ToBGRA8Speed) {
+    const int width = 1920;
+    const int height = 1080;
+    std::vector<float> image(width * height * 4);
+
+    std::srand(2020);
+    for (std::size_t i = 0; i < image.size(); ++i) {
+        image[i] = std::rand() / (float)RAND_MAX * 2.f - 0.5f;
+    }
+    std::vector<U32> texture(width * height);
+
+    for (int variant = 0; variant < 3; ++variant) {
+        // RGB, the alpha channel displayed, the RGB with the alpha matte overlay
+        const int rOffset = variant == 1 ? 3 : 0;
+        const int gOffset = variant == 1 ? 3 : 1;
+        const int bOffset = variant == 1 ? 3 : 2;
+        const int matteChannel = variant == 2 ? 3 : -1;
+        const char* name = variant == 0 ? "RGB" : (variant == 1 ? "A" : "RGB+matte");
+        qint64 elapsed[3] = { 0, 0, 0 };
+        for (int impl = 0; impl < 3; ++impl) {
+            if ( ( (impl == 1) && !ViewerTextureKernels::SSE2::isAvailable() ) ||
+                 ( (impl == 2) && !ViewerTextureKernels::AVX2::isAvailable() ) ) {
+                continue;
+            }
+            QElapsedTimer timer;
+            timer.start();
+            for (int y = 0; y < height; ++y) {
+                const float* src = &image[y * width * 4];
+                U32* dst = &texture[y * width];
+                switch (impl) {
+                case 0:
+                    ViewerTextureKernels::Scalar::toBGRA8Channels(src, width, 1.5, 0.1, false, rOffset, gOffset, bOffset, matteChannel, dst);
+                    break;
+                case 1:
+                    ViewerTextureKernels::SSE2::toBGRA8Channels(src, width, 1.5, 0.1, false, rOffset, gOffset, bOffset, matteChannel, dst);
+                    break;
+                default:
+                    ViewerTextureKernels::AVX2::toBGRA8Channels(src, width, 1.5, 0.1, false, rOffset, gOffset, bOffset, matteChannel, dst);
+                    break;
+                }
+            }
+            elapsed[impl] = std::max(timer.nsecsElapsed(), (qint64)1);
+        }
+        std::cout << name << ": scalar " << elapsed[0] / 1000 << " us, SSE2 " << elapsed[1] / 1000
+                  << " us, AVX2 " << elapsed[2] / 1000 << " us per HD frame" << std::endl;
+    }
+}